@@ -1,7 +1,8 @@
 
 set(test_case_seq 1)
 
-# define a function to check if the running result is right
+# define a function to check if the running result is right, the name of the
+# test is left in `last_test_name` for setting more properties, e.g. fixtures
 function(do_test prefix result cmd args)
   math(EXPR argc "${ARGC} - 1" OUTPUT_FORMAT DECIMAL)
   set(argl ${ARGV${argc}})
@@ -18,6 +19,23 @@ function(do_test prefix result cmd args)
     )
   math(EXPR test_case_seq "${test_case_seq} + 1" OUTPUT_FORMAT DECIMAL)
   set(test_case_seq ${test_case_seq} PARENT_SCOPE)
+  set(last_test_name ${testname} PARENT_SCOPE)
+endfunction()
+
+# define a function to check that the running result does not contain `result`
+function(do_test_absent prefix result cmd args)
+  math(EXPR argc "${ARGC} - 1" OUTPUT_FORMAT DECIMAL)
+  set(argl ${ARGV${argc}})
+  set(testname ${prefix}${test_case_seq}-${argl})
+
+  add_test(NAME ${testname} COMMAND ${cmd} ${args} ${ARGN})
+  set_tests_properties(${testname} PROPERTIES
+    FAIL_REGULAR_EXPRESSION ${result}
+    WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
+    )
+  math(EXPR test_case_seq "${test_case_seq} + 1" OUTPUT_FORMAT DECIMAL)
+  set(test_case_seq ${test_case_seq} PARENT_SCOPE)
+  set(last_test_name ${testname} PARENT_SCOPE)
 endfunction()
 
 function(do_testf prefix samplef resultf cmd args)
@@ -0,0 +1,628 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+#include "builtins.h"
+#include "ca_parser.h"
+#include "ca.tab.h"
+#include "const_eval.h"
+#include "symtable.h"
+#include "type_system.h"
+
+#include <string.h>
+#include <vector>
+
+struct BuiltinEntry {
+  const char *name;
+  CABuiltinKind kind;
+};
+
+// the operations called in domain of vector type, e.g. `v4f32::splat(1.0)`
+static BuiltinEntry s_vector_builtins[] = {
+  {"splat",            BI_VecSplat},
+  {"extract",          BI_VecExtract},
+  {"insert",           BI_VecInsert},
+  {"shuffle",          BI_VecShuffle},
+  {"select",           BI_VecSelect},
+  {"reduce_add",       BI_VecReduceAdd},
+  {"reduce_mul",       BI_VecReduceMul},
+  {"reduce_min",       BI_VecReduceMin},
+  {"reduce_max",       BI_VecReduceMax},
+  {"reduce_and",       BI_VecReduceAnd},
+  {"reduce_or",        BI_VecReduceOr},
+  {"reduce_xor",       BI_VecReduceXor},
+  {"load",             BI_VecLoad},
+  {"load_unaligned",   BI_VecLoadUnaligned},
+  {"store",            BI_VecStore},
+  {"store_unaligned",  BI_VecStoreUnaligned},
+};
+
+// the intrinsic functions called by name, e.g. `ctpop(x)`
+static BuiltinEntry s_intrinsic_builtins[] = {
+  {"ctpop",            BI_CtPop},
+  {"ctlz",             BI_Ctlz},
+  {"cttz",             BI_Cttz},
+  {"bswap",            BI_Bswap},
+  {"rotl",             BI_Rotl},
+  {"rotr",             BI_Rotr},
+  {"fshl",             BI_Fshl},
+  {"fshr",             BI_Fshr},
+  {"fma",              BI_Fma},
+  {"sqrt",             BI_Sqrt},
+  {"min",              BI_Min},
+  {"max",              BI_Max},
+  {"prefetch",         BI_Prefetch},
+  {"memcpy",           BI_Memcpy},
+  {"memset",           BI_Memset},
+  {"assume",           BI_Assume},
+  {"atomic_load",      BI_AtomicLoad},
+  {"atomic_store",     BI_AtomicStore},
+  {"atomic_fetch_add", BI_AtomicFetchAdd},
+  {"atomic_fetch_sub", BI_AtomicFetchSub},
+  {"atomic_fetch_and", BI_AtomicFetchAnd},
+  {"atomic_fetch_or",  BI_AtomicFetchOr},
+  {"atomic_fetch_xor", BI_AtomicFetchXor},
+  {"atomic_exchange",  BI_AtomicExchange},
+  {"atomic_compare_exchange", BI_AtomicCompareExchange},
+  {"fence",            BI_Fence},
+  {"spawn",            BI_Spawn},
+  {"join",             BI_Join},
+};
+
+static const char *s_atomic_ordering_names[] = {
+  "", "relaxed", "acquire", "release", "acq_rel", "seq_cst",
+};
+
+static const char *builtin_name(ASTNode *call) {
+  ASTNode *name = call->exprn.operands[0];
+  if (name->type == TTE_Id)
+    return catype_get_function_name(name->idn.i);
+
+  DomainNames *domain = name->domainfn.u.domain;
+  return symname_get((int)(long)vec_at(domain->parts, 1));
+}
+
+static CABuiltinKind builtin_lookup_intrinsic(ASTNode *call) {
+  ASTNode *name = call->exprn.operands[0];
+  if (name->idn.idtype != TTEId_FnName || sym_getsym(call->symtable, name->idn.i, 1))
+    return BI_None;
+
+  const char *fnname = catype_get_function_name(name->idn.i);
+  for (auto &entry : s_intrinsic_builtins) {
+    if (!strcmp(entry.name, fnname))
+      return entry.kind;
+  }
+
+  return BI_None;
+}
+
+CABuiltinKind builtin_lookup(ASTNode *call, CADataType **domaintype) {
+  ASTNode *name = call->exprn.operands[0];
+  if (domaintype)
+    *domaintype = nullptr;
+
+  if (name->type == TTE_Id)
+    return builtin_lookup_intrinsic(call);
+
+  if (name->type != TTE_Domain || name->domainfn.type != DFT_Domain)
+    return BI_None;
+
+  DomainNames *domain = name->domainfn.u.domain;
+  if (!domain->relative || domain->count != 2)
+    return BI_None;
+
+  // the vector type names are primitive type names, they cannot be shadowed
+  int typename_ = (int)(long)vec_at(domain->parts, 0);
+  CADataType *catype = catype_get_primitive_by_name(sym_form_type_id(typename_));
+  if (!catype || catype->type != VECTOR)
+    return BI_None;
+
+  const char *fnname = builtin_name(call);
+  for (auto &entry : s_vector_builtins) {
+    if (!strcmp(entry.name, fnname)) {
+      if (domaintype)
+        *domaintype = catype;
+      return entry.kind;
+    }
+  }
+
+  caerror(&(name->begloc), &(name->endloc), "no builtin function `%s` for vector type `%s`",
+          fnname, symname_get(typename_));
+  return BI_None;
+}
+
+static void builtin_check_argc(ASTNode *call, int argc, int argc_max) {
+  ASTNode *args = call->exprn.operands[1];
+  if (args->arglistn.argc < argc || args->arglistn.argc > argc_max) {
+    caerror(&(args->begloc), &(args->endloc), "builtin function `%s` takes %d parameters but %d found",
+            builtin_name(call), argc, args->arglistn.argc);
+  }
+}
+
+static void builtin_check_arg(ASTNode *call, int i, CADataType *formaltype) {
+  ASTNode *args = call->exprn.operands[1];
+  ASTNode *expr = args->arglistn.exprs[i];
+  determine_expr_type(expr, formaltype->signature);
+  typeid_t realtype = get_expr_type_from_tree(expr);
+  if (!catype_check_identical_in_symtable(expr->symtable, realtype, args->symtable, formaltype->signature)) {
+    caerror(&(args->begloc), &(args->endloc), "the %d parameter type '%s' not match the parameter declared type '%s'",
+            i, catype_get_type_name(realtype), catype_get_type_name(formaltype->signature));
+  }
+}
+
+static CADataType *builtin_inference_arg(ASTNode *call, int i) {
+  ASTNode *args = call->exprn.operands[1];
+  ASTNode *expr = args->arglistn.exprs[i];
+  typeid_t type = inference_expr_type(expr);
+  CADataType *catype = catype_get_by_name(expr->symtable, type);
+  CHECK_GET_TYPE_VALUE(expr, catype, type);
+  return catype;
+}
+
+// the lane index, it is checked here when it is a constant
+static void builtin_check_lane_index(ASTNode *call, int i, int lanes) {
+  CADataType *catype = builtin_inference_arg(call, i);
+  ASTNode *expr = call->exprn.operands[1]->arglistn.exprs[i];
+  if (!catype_is_integer(catype->type)) {
+    caerror(&(expr->begloc), &(expr->endloc), "the lane index should be integer, but find `%s`",
+            catype_get_type_name(catype->signature));
+    return;
+  }
+
+  ASTNode *lit = const_eval_try_literal(expr, catype->signature, expr->symtable);
+  if (lit) {
+    int64_t index = parse_to_int64(&lit->litn.litv);
+    if (index < 0 || index >= lanes)
+      caerror(&(expr->begloc), &(expr->endloc), "the lane index `%ld` out of the vector lanes `%d`", index, lanes);
+  }
+}
+
+int builtin_vector_memory_is_slice(ASTNode *call) {
+  ASTNode *expr = call->exprn.operands[1]->arglistn.exprs[0];
+  CADataType *catype = catype_get_by_name(expr->symtable, get_expr_type_from_tree(expr));
+  return catype->type == SLICE;
+}
+
+// check the memory argument: pointer to the element or slice of the element with an index, return the next argument position
+static int builtin_check_memory_arg(ASTNode *call, CADataType *vectype) {
+  CADataType *elemtype = vectype->array_layout->type;
+  CADataType *catype = builtin_inference_arg(call, 0);
+  CADataType *pointee = nullptr;
+  if (catype->type == POINTER && catype->pointer_layout->dimension == 1)
+    pointee = catype->pointer_layout->type;
+  else if (catype->type == SLICE)
+    pointee = catype->struct_layout->fields[0].type->pointer_layout->type;
+
+  ASTNode *expr = call->exprn.operands[1]->arglistn.exprs[0];
+  if (!pointee || pointee->signature != elemtype->signature) {
+    caerror(&(expr->begloc), &(expr->endloc), "expected pointer or slice of `%s` for vector `%s`, but find `%s`",
+            catype_get_type_name(elemtype->signature), catype_get_type_name(vectype->signature),
+            catype_get_type_name(catype->signature));
+    return 0;
+  }
+
+  if (catype->type != SLICE)
+    return 1;
+
+  CADataType *indextype = builtin_inference_arg(call, 1);
+  if (!catype_is_integer(indextype->type)) {
+    expr = call->exprn.operands[1]->arglistn.exprs[1];
+    caerror(&(expr->begloc), &(expr->endloc), "the slice index should be integer, but find `%s`",
+            catype_get_type_name(indextype->signature));
+  }
+
+  return 2;
+}
+
+static ASTNode *builtin_shuffle_indices(ASTNode *call) {
+  ASTNode *expr = call->exprn.operands[1]->arglistn.exprs[2];
+  if (expr->type != TTE_Expr || expr->exprn.op != ARRAY) {
+    caerror(&(expr->begloc), &(expr->endloc), "the shuffle indices should be an array of constant");
+    return nullptr;
+  }
+
+  return expr->exprn.operands[0];
+}
+
+int builtin_vector_shuffle_mask(ASTNode *call, int *mask) {
+  CADataType *vectype = nullptr;
+  builtin_lookup(call, &vectype);
+  int lanes = vectype->array_layout->dimarray[0];
+
+  ASTNode *arraydef = builtin_shuffle_indices(call);
+  CAArrayExpr aexpr = arraydef->anoden.aexpr;
+  int count = aexpr.repeat_count ? aexpr.repeat_count : arrayexpr_size(aexpr);
+  if (count != lanes) {
+    caerror(&(arraydef->begloc), &(arraydef->endloc), "the shuffle indices number `%d` not equal to the vector lanes `%d`",
+            count, lanes);
+    return 0;
+  }
+
+  typeid_t indextype = sym_form_type_id_from_token(I32);
+  for (int i = 0; i < count; ++i) {
+    ASTNode *expr = arrayexpr_get(aexpr, aexpr.repeat_count ? 0 : i);
+    ASTNode *lit = const_eval_literal(expr, indextype, expr->symtable);
+    int64_t index = parse_to_int64(&lit->litn.litv);
+    if (index < 0 || index >= 2 * lanes) {
+      caerror(&(expr->begloc), &(expr->endloc), "the shuffle index `%ld` out of the lanes `%d` of both vectors",
+              index, 2 * lanes);
+      return 0;
+    }
+
+    mask[i] = (int)index;
+  }
+
+  return count;
+}
+
+static typeid_t builtin_inference_vector(ASTNode *call, CABuiltinKind kind, CADataType *vectype) {
+  CADataType *elemtype = vectype->array_layout->type;
+  int lanes = vectype->array_layout->dimarray[0];
+  int argi = 0;
+
+  switch (kind) {
+  case BI_VecSplat:
+    builtin_check_argc(call, 1, 1);
+    builtin_check_arg(call, 0, elemtype);
+    return vectype->signature;
+  case BI_VecExtract:
+    builtin_check_argc(call, 2, 2);
+    builtin_check_arg(call, 0, vectype);
+    builtin_check_lane_index(call, 1, lanes);
+    return elemtype->signature;
+  case BI_VecInsert:
+    builtin_check_argc(call, 3, 3);
+    builtin_check_arg(call, 0, vectype);
+    builtin_check_lane_index(call, 1, lanes);
+    builtin_check_arg(call, 2, elemtype);
+    return vectype->signature;
+  case BI_VecShuffle: {
+    std::vector<int> mask(lanes);
+    builtin_check_argc(call, 3, 3);
+    builtin_check_arg(call, 0, vectype);
+    builtin_check_arg(call, 1, vectype);
+    builtin_vector_shuffle_mask(call, mask.data());
+    return vectype->signature;
+  }
+  case BI_VecSelect:
+    builtin_check_argc(call, 3, 3);
+    builtin_check_arg(call, 0, catype_get_vector_mask_type(vectype));
+    builtin_check_arg(call, 1, vectype);
+    builtin_check_arg(call, 2, vectype);
+    return vectype->signature;
+  case BI_VecReduceAnd:
+  case BI_VecReduceOr:
+  case BI_VecReduceXor:
+    if (!catype_is_integer(elemtype->type)) {
+      caerror(&(call->begloc), &(call->endloc), "builtin function `%s` requires integer vector, but find `%s`",
+              builtin_name(call), catype_get_type_name(vectype->signature));
+    }
+  case BI_VecReduceAdd:
+  case BI_VecReduceMul:
+  case BI_VecReduceMin:
+  case BI_VecReduceMax:
+    builtin_check_argc(call, 1, 1);
+    builtin_check_arg(call, 0, vectype);
+    return elemtype->signature;
+  case BI_VecLoad:
+  case BI_VecLoadUnaligned:
+    builtin_check_argc(call, 1, 2);
+    argi = builtin_check_memory_arg(call, vectype);
+    builtin_check_argc(call, argi, argi);
+    return vectype->signature;
+  case BI_VecStore:
+  case BI_VecStoreUnaligned:
+    builtin_check_argc(call, 2, 3);
+    argi = builtin_check_memory_arg(call, vectype);
+    builtin_check_argc(call, argi + 1, argi + 1);
+    builtin_check_arg(call, argi, vectype);
+    return sym_form_type_id_from_token(VOID);
+  default:
+    yyerror("(internal) not a builtin function call");
+    return typeid_novalue;
+  }
+}
+
+// the first operand decides the type of the intrinsic, it is the integer or float type, or the vector of them
+static CADataType *builtin_check_operand(ASTNode *call, bool allowint, bool allowfloat) {
+  CADataType *catype = builtin_inference_arg(call, 0);
+  tokenid_t tok = catype_scalar_token(catype);
+  if ((allowint && catype_is_integer(tok)) || (allowfloat && catype_is_float(tok)))
+    return catype;
+
+  ASTNode *expr = call->exprn.operands[1]->arglistn.exprs[0];
+  caerror(&(expr->begloc), &(expr->endloc), "builtin function `%s` requires %s type, but find `%s`",
+          builtin_name(call), allowint ? (allowfloat ? "integer or float" : "integer") : "float",
+          catype_get_type_name(catype->signature));
+  return catype;
+}
+
+static CADataType *builtin_check_pointer_arg(ASTNode *call, int i) {
+  CADataType *catype = builtin_inference_arg(call, i);
+  if (catype->type != POINTER) {
+    ASTNode *expr = call->exprn.operands[1]->arglistn.exprs[i];
+    caerror(&(expr->begloc), &(expr->endloc), "builtin function `%s` requires pointer, but find `%s`",
+            builtin_name(call), catype_get_type_name(catype->signature));
+  }
+
+  return catype;
+}
+
+// the argument should be a constant integer in [min, max]
+static void builtin_check_const_arg(ASTNode *call, int i, int min, int max) {
+  CADataType *i32type = catype_get_primitive_by_token(I32);
+  builtin_check_arg(call, i, i32type);
+
+  ASTNode *expr = call->exprn.operands[1]->arglistn.exprs[i];
+  ASTNode *lit = const_eval_literal(expr, i32type->signature, expr->symtable);
+  int64_t value = parse_to_int64(&lit->litn.litv);
+  if (value < min || value > max) {
+    caerror(&(expr->begloc), &(expr->endloc), "the %d parameter of builtin function `%s` should be in [%d, %d], but find `%ld`",
+            i, builtin_name(call), min, max, value);
+  }
+}
+
+// the number of value arguments of the atomic builtins, the orderings follow them
+static int builtin_atomic_value_argc(CABuiltinKind kind) {
+  switch (kind) {
+  case BI_Fence:
+    return 0;
+  case BI_AtomicLoad:
+    return 1;
+  case BI_AtomicCompareExchange:
+    return 3;
+  default:
+    return 2;
+  }
+}
+
+int builtin_value_argc(ASTNode *call, CABuiltinKind kind) {
+  switch (kind) {
+  case BI_VecShuffle:
+    return 2;
+  case BI_AtomicLoad:
+  case BI_AtomicStore:
+  case BI_AtomicFetchAdd:
+  case BI_AtomicFetchSub:
+  case BI_AtomicFetchAnd:
+  case BI_AtomicFetchOr:
+  case BI_AtomicFetchXor:
+  case BI_AtomicExchange:
+  case BI_AtomicCompareExchange:
+  case BI_Fence:
+    return builtin_atomic_value_argc(kind);
+  case BI_Spawn:
+    // the function call is not generated but its argument
+    return 0;
+  default:
+    return call->exprn.operands[1]->arglistn.argc;
+  }
+}
+
+CAAtomicOrdering builtin_atomic_ordering(ASTNode *call, CABuiltinKind kind, int i) {
+  ASTNode *args = call->exprn.operands[1];
+  int argi = builtin_atomic_value_argc(kind) + i;
+  if (argi >= args->arglistn.argc)
+    return AO_None;
+
+  ASTNode *expr = args->arglistn.exprs[argi];
+  if (expr->type == TTE_Literal && expr->litn.litv.littypetok == CSTRING) {
+    const char *name = symname_get(expr->litn.litv.u.strvalue.text);
+    for (int ord = AO_Relaxed; ord <= AO_SeqCst; ++ord) {
+      if (!strcmp(name, s_atomic_ordering_names[ord]))
+        return (CAAtomicOrdering)ord;
+    }
+  }
+
+  caerror(&(expr->begloc), &(expr->endloc), "expected memory ordering: \"relaxed\", \"acquire\", \"release\", "
+          "\"acq_rel\" or \"seq_cst\" for builtin function `%s`", builtin_name(call));
+  return AO_None;
+}
+
+// check the ordering `i` is not one of the `invalid` orderings
+static void builtin_check_atomic_ordering(ASTNode *call, CABuiltinKind kind, int i,
+                                          std::initializer_list<CAAtomicOrdering> invalid) {
+  CAAtomicOrdering ordering = builtin_atomic_ordering(call, kind, i);
+  for (CAAtomicOrdering ord : invalid) {
+    if (ordering == ord) {
+      ASTNode *expr = call->exprn.operands[1]->arglistn.exprs[builtin_atomic_value_argc(kind) + i];
+      caerror(&(expr->begloc), &(expr->endloc), "memory ordering \"%s\" is invalid for builtin function `%s`",
+              s_atomic_ordering_names[ordering], builtin_name(call));
+    }
+  }
+}
+
+// check the atomic memory argument and return the type of the value in memory
+static CADataType *builtin_check_atomic_memory(ASTNode *call, bool allowfloat) {
+  CADataType *catype = builtin_check_pointer_arg(call, 0);
+  CADataType *valuetype = catype->pointer_layout->dimension == 1 ? catype->pointer_layout->type : nullptr;
+  if (valuetype && (catype_is_integer(valuetype->type) || (allowfloat && catype_is_float(valuetype->type))))
+    return valuetype;
+
+  ASTNode *expr = call->exprn.operands[1]->arglistn.exprs[0];
+  caerror(&(expr->begloc), &(expr->endloc), "builtin function `%s` requires pointer of integer%s, but find `%s`",
+          builtin_name(call), allowfloat ? " or float" : "", catype_get_type_name(catype->signature));
+  return nullptr;
+}
+
+static typeid_t builtin_inference_atomic(ASTNode *call, CABuiltinKind kind) {
+  int argc = builtin_atomic_value_argc(kind);
+  int norderings = kind == BI_AtomicCompareExchange ? 2 : 1;
+  builtin_check_argc(call, argc, argc + norderings);
+  if (kind == BI_Fence) {
+    builtin_check_atomic_ordering(call, kind, 0, {AO_Relaxed});
+    return sym_form_type_id_from_token(VOID);
+  }
+
+  bool allowfloat = kind == BI_AtomicLoad || kind == BI_AtomicStore || kind == BI_AtomicExchange;
+  CADataType *valuetype = builtin_check_atomic_memory(call, allowfloat);
+  for (int i = 1; i < argc; ++i)
+    builtin_check_arg(call, i, valuetype);
+
+  switch (kind) {
+  case BI_AtomicLoad:
+    builtin_check_atomic_ordering(call, kind, 0, {AO_Release, AO_AcqRel});
+    return valuetype->signature;
+  case BI_AtomicStore:
+    builtin_check_atomic_ordering(call, kind, 0, {AO_Acquire, AO_AcqRel});
+    return sym_form_type_id_from_token(VOID);
+  case BI_AtomicCompareExchange: {
+    // the failure ordering is a load, it cannot be stronger than the load part of success ordering
+    static const int strength[] = {2, 0, 1, 0, 1, 2};
+    CAAtomicOrdering success = builtin_atomic_ordering(call, kind, 0);
+    CAAtomicOrdering failure = builtin_atomic_ordering(call, kind, 1);
+    builtin_check_atomic_ordering(call, kind, 1, {AO_Release, AO_AcqRel});
+    if (failure != AO_None && strength[failure] > strength[success])
+      builtin_check_atomic_ordering(call, kind, 1, {failure});
+    return valuetype->signature;
+  }
+  default:
+    builtin_atomic_ordering(call, kind, 0);
+    return valuetype->signature;
+  }
+}
+
+STEntry *builtin_spawn_function(ASTNode *call) {
+  ASTNode *expr = call->exprn.operands[1]->arglistn.exprs[0];
+  STEntry *entry = nullptr;
+  const char *fnname = nullptr;
+  if (expr->type == TTE_Expr && expr->exprn.op == FN_CALL &&
+      expr->exprn.operands[0]->type == TTE_Id && builtin_lookup(expr, nullptr) == BI_None &&
+      extract_function_or_tuple(expr->symtable, expr->exprn.operands[0]->idn.i, &entry, &fnname) == 0)
+    return entry;
+
+  caerror(&(expr->begloc), &(expr->endloc), "builtin function `spawn` requires a call of function, e.g. `spawn(f(p))`");
+  return nullptr;
+}
+
+static typeid_t builtin_inference_thread(ASTNode *call, CABuiltinKind kind) {
+  typeid_t voidtype = sym_form_type_id_from_token(VOID);
+  builtin_check_argc(call, 1, 1);
+  if (kind == BI_Join) {
+    builtin_check_arg(call, 0, catype_get_primitive_by_token(U64));
+    return voidtype;
+  }
+
+  // the thread entry of the runtime is `void (*)(void *)`
+  STEntry *entry = builtin_spawn_function(call);
+  ASTNode *fncall = call->exprn.operands[1]->arglistn.exprs[0];
+  ST_ArgList *formalparam = entry->u.f.arglists;
+  CADataType *paramtype = nullptr;
+  if (formalparam->argc == 1 && !formalparam->contain_varg) {
+    STEntry *paramentry = sym_getsym(formalparam->symtable, formalparam->argnames[0], 0);
+    paramtype = catype_get_by_name(formalparam->symtable, paramentry->u.varshielding.current->datatype);
+  }
+
+  CADataType *rettype = catype_get_by_name(formalparam->symtable, entry->u.f.rettype);
+  if (!paramtype || paramtype->type != POINTER || !rettype || rettype->type != VOID) {
+    caerror(&(fncall->begloc), &(fncall->endloc), "the function `%s` called by `spawn` should have one pointer "
+            "parameter and return nothing", builtin_name(fncall));
+  }
+
+  builtin_check_argc(fncall, 1, 1);
+  builtin_check_arg(fncall, 0, paramtype);
+  return catype_get_primitive_by_token(U64)->signature;
+}
+
+static typeid_t builtin_inference_intrinsic(ASTNode *call, CABuiltinKind kind) {
+  CADataType *catype = nullptr;
+  typeid_t voidtype = sym_form_type_id_from_token(VOID);
+
+  switch (kind) {
+  case BI_CtPop:
+  case BI_Ctlz:
+  case BI_Cttz:
+  case BI_Bswap:
+    builtin_check_argc(call, 1, 1);
+    catype = builtin_check_operand(call, true, false);
+    if (kind == BI_Bswap && catype_get_primitive_by_token(catype_scalar_token(catype))->size < 2) {
+      caerror(&(call->begloc), &(call->endloc), "builtin function `bswap` requires integer of at least 2 bytes, but find `%s`",
+              catype_get_type_name(catype->signature));
+    }
+    return catype->signature;
+  case BI_Rotl:
+  case BI_Rotr:
+    builtin_check_argc(call, 2, 2);
+    catype = builtin_check_operand(call, true, false);
+    builtin_check_arg(call, 1, catype);
+    return catype->signature;
+  case BI_Fshl:
+  case BI_Fshr:
+    builtin_check_argc(call, 3, 3);
+    catype = builtin_check_operand(call, true, false);
+    builtin_check_arg(call, 1, catype);
+    builtin_check_arg(call, 2, catype);
+    return catype->signature;
+  case BI_Fma:
+    builtin_check_argc(call, 3, 3);
+    catype = builtin_check_operand(call, false, true);
+    builtin_check_arg(call, 1, catype);
+    builtin_check_arg(call, 2, catype);
+    return catype->signature;
+  case BI_Sqrt:
+    builtin_check_argc(call, 1, 1);
+    catype = builtin_check_operand(call, false, true);
+    return catype->signature;
+  case BI_Min:
+  case BI_Max:
+    builtin_check_argc(call, 2, 2);
+    catype = builtin_check_operand(call, true, true);
+    builtin_check_arg(call, 1, catype);
+    return catype->signature;
+  case BI_Prefetch:
+    builtin_check_argc(call, 3, 3);
+    builtin_check_pointer_arg(call, 0);
+    builtin_check_const_arg(call, 1, 0, 1);
+    builtin_check_const_arg(call, 2, 0, 3);
+    return voidtype;
+  case BI_Memcpy:
+  case BI_Memset:
+    builtin_check_argc(call, 3, 3);
+    builtin_check_pointer_arg(call, 0);
+    if (kind == BI_Memcpy)
+      builtin_check_pointer_arg(call, 1);
+    else
+      builtin_check_arg(call, 1, catype_get_primitive_by_token(U8));
+    builtin_check_arg(call, 2, catype_get_primitive_by_token(U64));
+    return voidtype;
+  case BI_Assume:
+    builtin_check_argc(call, 1, 1);
+    builtin_check_arg(call, 0, catype_get_primitive_by_token(BOOL));
+    return voidtype;
+  case BI_AtomicLoad:
+  case BI_AtomicStore:
+  case BI_AtomicFetchAdd:
+  case BI_AtomicFetchSub:
+  case BI_AtomicFetchAnd:
+  case BI_AtomicFetchOr:
+  case BI_AtomicFetchXor:
+  case BI_AtomicExchange:
+  case BI_AtomicCompareExchange:
+  case BI_Fence:
+    return builtin_inference_atomic(call, kind);
+  case BI_Spawn:
+  case BI_Join:
+    return builtin_inference_thread(call, kind);
+  default:
+    yyerror("(internal) not a builtin function call");
+    return typeid_novalue;
+  }
+}
+
+typeid_t builtin_inference_type(ASTNode *call) {
+  CADataType *vectype = nullptr;
+  CABuiltinKind kind = builtin_lookup(call, &vectype);
+  if (vectype)
+    return builtin_inference_vector(call, kind, vectype);
+
+  return builtin_inference_intrinsic(call, kind);
+}
+
@@ -0,0 +1,169 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+/**
+ * @file The builtin functions of the compiler.
+ *
+ * The builtin functions are not defined in the source, they are recognized
+ * by name when parsing a call and lowered into LLVM instructions or
+ * intrinsics directly by the IR generator.
+ *
+ * The SIMD vector operations are called in the domain form of the vector
+ * type, e.g. `v4f32::splat(1.0)`:
+ * - `splat(x: E) -> V`: every lane is `x`
+ * - `extract(v: V, i) -> E`, `insert(v: V, i, x: E) -> V`: the lane `i`
+ * - `shuffle(a: V, b: V, [indices]) -> V`: lanes are selected from the
+ *   concatenation of `a` and `b` by the constant indices
+ * - `select(mask: M, a: V, b: V) -> V`: lanes of `a` where `mask` is not zero
+ *   else lanes of `b`, `M` is the result type of vector comparison
+ * - `reduce_add`, `reduce_mul`, `reduce_min`, `reduce_max`, `reduce_and`,
+ *   `reduce_or`, `reduce_xor`: `(v: V) -> E` horizontal reduction
+ * - `load(p: *E) -> V`, `load(s: [E], i) -> V`: load the lanes from memory
+ *   which is aligned to the vector size, `load_unaligned` for any address
+ * - `store(p: *E, v: V)`, `store(s: [E], i, v: V)`, `store_unaligned`
+ *
+ * The intrinsic functions are called by name like normal functions, the
+ * function defined in the source with the same name shadows the intrinsic.
+ * `T` is a integer or float type, or a vector of them:
+ * - `ctpop(x: T) -> T`, `ctlz(x: T) -> T`, `cttz(x: T) -> T`: count the one
+ *   bits, the leading and trailing zero bits of integer
+ * - `bswap(x: T) -> T`: reverse the bytes of integer
+ * - `rotl(x: T, n: T) -> T`, `rotr(x: T, n: T) -> T`: rotate the integer
+ * - `fshl(a: T, b: T, n: T) -> T`, `fshr(a: T, b: T, n: T) -> T`: the
+ *   funnel shift of the concatenation of the integers `a` and `b`
+ * - `fma(a: T, b: T, c: T) -> T`: `a * b + c` of float without rounding
+ *   the middle result
+ * - `sqrt(x: T) -> T`: the square root of float
+ * - `min(a: T, b: T) -> T`, `max(a: T, b: T) -> T`: the float one returns
+ *   the other operand when one is NaN
+ * - `prefetch(p: *X, rw, locality)`: prefetch the memory for read (rw 0)
+ *   or write (rw 1), the constant locality is from 0 (none) to 3 (keep in
+ *   all levels of cache)
+ * - `memcpy(dst: *X, src: *Y, n: u64)`, `memset(dst: *X, v: u8, n: u64)`:
+ *   copy or set `n` bytes, the memory of `memcpy` should not overlap
+ * - `assume(cond: bool)`: let the optimizer assume `cond` is true
+ *
+ * The atomic operations on the memory `p: *T` of integer `T`, the float
+ * is also supported by load, store and exchange. The last optional
+ * arguments are the memory ordering string literals: "relaxed",
+ * "acquire", "release", "acq_rel", "seq_cst" (default):
+ * - `atomic_load(p) -> T`, `atomic_store(p, v: T)`
+ * - `atomic_fetch_add`, `atomic_fetch_sub`, `atomic_fetch_and`,
+ *   `atomic_fetch_or`, `atomic_fetch_xor`: `(p, v: T) -> T` return the old
+ *   value
+ * - `atomic_exchange(p, v: T) -> T`: store `v` and return the old value
+ * - `atomic_compare_exchange(p, expected: T, desired: T[, success, failure]) -> T`:
+ *   store `desired` when the old value is `expected`, return the old value,
+ *   so it succeeded when the result is `expected`
+ * - `fence([ordering])`: the memory fence, it cannot be "relaxed"
+ *
+ * The native threads, see `ca_rt_spawn` of the runtime:
+ * - `spawn(f(p)) -> u64`: call `f` in a new thread and return the handle of
+ *   the thread, `f` is a function with one pointer parameter returning
+ *   nothing, the argument `p` is evaluated in the current thread
+ * - `join(h: u64)`: wait the thread of `spawn` to exit
+ */
+
+#ifndef __builtins_h__
+#define __builtins_h__
+
+#include "ca_parser.h"
+#include "symtable.h"
+
+#ifdef __cplusplus
+BEGIN_EXTERN_C
+#endif
+
+typedef enum CABuiltinKind {
+  BI_None,
+  BI_VecSplat,
+  BI_VecExtract,
+  BI_VecInsert,
+  BI_VecShuffle,
+  BI_VecSelect,
+  BI_VecReduceAdd,
+  BI_VecReduceMul,
+  BI_VecReduceMin,
+  BI_VecReduceMax,
+  BI_VecReduceAnd,
+  BI_VecReduceOr,
+  BI_VecReduceXor,
+  BI_VecLoad,
+  BI_VecLoadUnaligned,
+  BI_VecStore,
+  BI_VecStoreUnaligned,
+  BI_CtPop,
+  BI_Ctlz,
+  BI_Cttz,
+  BI_Bswap,
+  BI_Rotl,
+  BI_Rotr,
+  BI_Fshl,
+  BI_Fshr,
+  BI_Fma,
+  BI_Sqrt,
+  BI_Min,
+  BI_Max,
+  BI_Prefetch,
+  BI_Memcpy,
+  BI_Memset,
+  BI_Assume,
+  BI_AtomicLoad,
+  BI_AtomicStore,
+  BI_AtomicFetchAdd,
+  BI_AtomicFetchSub,
+  BI_AtomicFetchAnd,
+  BI_AtomicFetchOr,
+  BI_AtomicFetchXor,
+  BI_AtomicExchange,
+  BI_AtomicCompareExchange,
+  BI_Fence,
+  BI_Spawn,
+  BI_Join,
+} CABuiltinKind;
+
+typedef enum CAAtomicOrdering {
+  AO_None, /// not specified
+  AO_Relaxed,
+  AO_Acquire,
+  AO_Release,
+  AO_AcqRel,
+  AO_SeqCst,
+} CAAtomicOrdering;
+
+/// get the builtin function called by `call` (FN_CALL node), `domaintype` receives the vector type of domain call or NULL
+CABuiltinKind builtin_lookup(ASTNode *call, CADataType **domaintype);
+
+/// check and determine the argument types of builtin function call, return the type of the call
+typeid_t builtin_inference_type(ASTNode *call);
+
+/// get the constant lane indices of `shuffle` call into `mask` of vector lanes size, return the number of indices
+int builtin_vector_shuffle_mask(ASTNode *call, int *mask);
+
+/// the number of leading arguments which are values to be generated, the rest are compile time constants
+int builtin_value_argc(ASTNode *call, CABuiltinKind kind);
+
+/// the memory ordering of the atomic builtin call, `i` is the position of the ordering in the orderings
+CAAtomicOrdering builtin_atomic_ordering(ASTNode *call, CABuiltinKind kind, int i);
+
+/// the function entry called in the new thread by `spawn`
+STEntry *builtin_spawn_function(ASTNode *call);
+
+/// whether the memory argument of vector `load` or `store` is a slice with an index argument
+int builtin_vector_memory_is_slice(ASTNode *call);
+
+#ifdef __cplusplus
+END_EXTERN_C
+#endif
+
+#endif
+
@@ -37,11 +37,15 @@ int yyparser_init();
 }
 
 static void usage() {
-  // [-ll] | [-S] | [-native] | [-c] | [-jit] [-O] | [-g] | [-nomain] | [-dot <dotfile>]
+  // [-ll] | [-bc] | [-S] | [-native] | [-c] | [-jit] [-O] | [-g] | [-nomain] | [-rtprint] | [-bounds-check] | [-overflow-check] | [-fprofile-generate[=<file>]] | [-fprofile-use[=<file>]] | [-flto] | [-dot <dotfile>]
+  // ca [-O[123]] [-flto-export=<symbols>] -flto-link <output> <input>...
   fprintf(stderr,
 	  "Usage: ca [options] <input> [<output>]\n"
+	  "       ca [-O[123]] [-flto-export=<symbols>] -flto-link <output> <input>...\n"
+	  "         <input> is the ca source file, or the .bc, .ll file compiled by -bc, -ll before\n"
 	  "Options:\n"
 	  "         -ll:      compile into IR assembly file: .ll (llvm)\n"
+	  "         -bc:      compile into IR binary file: .bc (llvm bitcode)\n"
 	  "         -S:       compile into native (as) assembly file: .s\n"
 	  "         -native:  compile into native execute file: ELF file on linux, PE file on windows (default value)\n"
 	  "         -c:       compile into native object file: .o\n"
@@ -49,11 +53,38 @@ static void usage() {
 	  "         -O[123]:  do optimization of level 1 2 3, default is level 2\n"
 	  "         -g:       do not do any optimization (default value)\n"
 	  "         -main:    do generate the default main function\n"
+	  "         -rtprint: lower `print` into ca runtime functions instead of printf, default\n"
+	  "                   for -jit and -native, the output of -ll, -S, -c then need link with libcaruntime.a\n"
+	  "         -bounds-check: check the index of array indexing and slicing when running\n"
+	  "         -overflow-check: check the overflow of integer `+`, `-`, `*` when running\n"
+	  "         -fprofile-generate[=<file>]: instrument the code to generate the profile when running,\n"
+	  "                   -jit writes the .profdata (default.profdata) directly, the native program\n"
+	  "                   writes the .profraw (default.profraw) to be merged by llvm-profdata\n"
+	  "         -fprofile-use[=<file>]: optimize with the profile .profdata, default is default.profdata\n"
+	  "         -flto:    -c compiles into llvm bitcode object for the link time optimization\n"
+	  "         -flto-link <output>: link the -flto objects into one native object file <output>,\n"
+	  "                   or into IR file when <output> ends with .bc or .ll\n"
+	  "         -flto-export=<symbols>: the comma separated symbols kept exported besides `main`\n"
 	  "         -dot <dotfile>:  generate the dot graph files\n"
 	  );
   exit(-1);
 }
 
+static void set_profile_path(char *dest, const char *path) {
+  if (!path[0] || strlen(path) > MAX_PATH) {
+    fprintf(stderr, "bad profile file path: `%s`\n\n", path);
+    usage();
+  }
+
+  strcpy(dest, path);
+}
+
+// the front end output of -bc or -ll, it is compiled from the IR directly
+static int is_ir_input(const char *path) {
+  size_t len = strlen(path);
+  return len > 3 && (!strcmp(path + len - 3, ".bc") || !strcmp(path + len - 3, ".ll"));
+}
+
 static int init_config(int argc, char *argv[]) {
   int arg = 0;
 
@@ -66,12 +97,23 @@ static int init_config(int argc, char *argv[]) {
   genv.emit_main = 0;
   genv.emit_dot = 0;
   genv.dot_sparsed = 1;
-
-  int i = 0;
-  while(i < 3) {
+  genv.rt_print = -1;
+  genv.bounds_check = 0;
+  genv.overflow_check = 0;
+  genv.profile_generate = 0;
+  genv.profile_generate_path[0] = '\0';
+  genv.profile_use_path[0] = '\0';
+  genv.lto = 0;
+  genv.lto_ninputs = 0;
+  genv.lto_inputs = NULL;
+  genv.lto_exports[0] = '\0';
+
+  while(1) {
     if (argv[arg][0] == '-') {
       if (!strcmp(argv[arg], "-ll")) {
 	genv.llvm_gen_type = LGT_LL;
+      } else if (!strcmp(argv[arg], "-bc")) {
+	genv.llvm_gen_type = LGT_BC;
       } else if (!strcmp(argv[arg], "-S")) {
 	genv.llvm_gen_type = LGT_S;
       } else if (!strcmp(argv[arg], "-native")) {
@@ -92,6 +134,35 @@ static int init_config(int argc, char *argv[]) {
 	genv.emit_debug = 1;
       } else if (!strcmp(argv[arg], "-main")) {
 	genv.emit_main = 1;
+      } else if (!strcmp(argv[arg], "-rtprint")) {
+	genv.rt_print = 1;
+      } else if (!strcmp(argv[arg], "-bounds-check")) {
+	genv.bounds_check = 1;
+      } else if (!strcmp(argv[arg], "-overflow-check")) {
+	genv.overflow_check = 1;
+      } else if (!strcmp(argv[arg], "-fprofile-generate") ||
+		 !strncmp(argv[arg], "-fprofile-generate=", 19)) {
+	genv.profile_generate = 1;
+	if (argv[arg][18] == '=')
+	  set_profile_path(genv.profile_generate_path, argv[arg] + 19);
+      } else if (!strcmp(argv[arg], "-fprofile-use") ||
+		 !strncmp(argv[arg], "-fprofile-use=", 14)) {
+	set_profile_path(genv.profile_use_path, argv[arg][13] == '=' ? argv[arg] + 14 : "default.profdata");
+      } else if (!strcmp(argv[arg], "-flto")) {
+	genv.lto = 1;
+      } else if (!strcmp(argv[arg], "-flto-link")) {
+	genv.llvm_gen_type = LGT_LTO_LINK;
+	if (++arg >= argc || argv[arg][0] == '-' || strlen(argv[arg]) > MAX_PATH) {
+	  fprintf(stderr, "Should specify a output file path\n\n");
+	  usage();
+	}
+	strcpy(genv.outfile, argv[arg]);
+      } else if (!strncmp(argv[arg], "-flto-export=", 13)) {
+	if (strlen(argv[arg] + 13) > MAX_PATH) {
+	  fprintf(stderr, "too long of export symbols: %s\n\n", argv[arg] + 13);
+	  usage();
+	}
+	strcpy(genv.lto_exports, argv[arg] + 13);
       } else if (!strcmp(argv[arg], "-dot")) {
 	genv.emit_dot = 1;
 	if (++arg >= argc || argv[arg][0] == '-') {
@@ -106,16 +177,31 @@ static int init_config(int argc, char *argv[]) {
       if (++arg >= argc)
 	usage();
 
-      ++i;
       continue;
     }
 
     break;
   }
 
+  if (genv.profile_generate && genv.profile_use_path[0]) {
+    fprintf(stderr, "-fprofile-generate and -fprofile-use cannot be used together\n\n");
+    usage();
+  }
+
+  // the executable from -jit and -native are linked with the ca runtime
+  if (genv.rt_print == -1)
+    genv.rt_print = genv.llvm_gen_type == LGT_JIT || genv.llvm_gen_type == LGT_NATIVE;
+
   if (arg >= argc)
     usage();
 
+  // the rest arguments are all input objects when linking
+  if (genv.llvm_gen_type == LGT_LTO_LINK) {
+    genv.lto_ninputs = argc - arg;
+    genv.lto_inputs = argv + arg;
+    return 0;
+  }
+
   size_t len = strlen(argv[arg]);
   if (len > MAX_PATH) {
     fprintf(stderr, "too long of source file path: %s\n", argv[arg]);
@@ -161,6 +247,19 @@ int main(int argc, char *argv[]) {
     exit(-1);
   }
 
+  if (genv.llvm_gen_type == LGT_LTO_LINK) {
+    init_llvm_env();
+    return llvm_lto_link() ? -1 : 0;
+  }
+
+  if (is_ir_input(genv.src_path)) {
+    init_llvm_env();
+    if (genv.llvm_gen_type == LGT_JIT)
+      fprintf(stderr, "program `%s` :\n", genv.src_path);
+
+    return llvm_codegen_ir_file() ? -1 : 0;
+  }
+
   if (yyparser_init()) {
     fprintf(stderr, "init parser failed\n");
     exit(-1);
@@ -54,6 +54,7 @@ extern TypeImplInfo *current_type_impl;
 extern int current_trait_id;
 
 extern int extern_flag;
+extern int curr_fn_attrs;
 extern ST_ArgList curr_arglist;
 
 extern int glineno;
@@ -91,17 +92,19 @@ extern int yychar, yylineno;
   DomainAs domain_as;
   FnNameInfo fnname_info;
   void *generic_types;
+  void *astnodes; /* vec of ASTNode * */
 };
 
 %token	<litb>		LITERAL STR_LITERAL
 %token	<symnameid>	VOID I16 I32 I64 U16 U32 U64 F32 F64 BOOL I8 U8 ATOMTYPE_END STRUCT ARRAY POINTER CSTRING
 %token	<symnameid>	IDENT // OSELF CSELF
 %token			WHILE IF IFE DBGPRINT DBGPRINTTYPE GOTO EXTERN FN RET LET EXTERN_VAR IMPL TRAIT
-%token			LOOP FOR IN BREAK CONTINUE MATCH USE MOD
+%token			LOOP FOR IN BREAK CONTINUE MATCH USE MOD PARALLEL ENUM BECOME
 %token			BAND BOR BXOR BNOT
 %token			ASSIGN_ADD ASSIGN_SUB ASSIGN_MUL ASSIGN_DIV ASSIGN_MOD ASSIGN_SHIFTL ASSIGN_SHIFTR ASSIGN_BAND ASSIGN_BOR ASSIGN_BXOR
-%token			FN_DEF FN_CALL VARG COMMENT EMPTY_BLOCK STMT_EXPR IF_EXPR ARRAYITEM STRUCTITEM TUPLE RANGE SLICE
+%token			FN_DEF FN_CALL VARG COMMENT EMPTY_BLOCK STMT_EXPR IF_EXPR ARRAYITEM STRUCTITEM TUPLE RANGE SLICE VECTOR
 %token			INFER ADDRESS DEREF TYPE SIZEOF TYPEOF TYPEID ZERO_INITIAL REF DOMAIN
+%token			LIKELY UNLIKELY CONST STATIC
 %nonassoc		IFX
 %nonassoc		ELSE
 %left			IGNORE IRANGE
@@ -130,12 +133,12 @@ extern int yychar, yylineno;
 %type	<fnname_info>	fn_proto_name
 %type	<generic_types>	fn_proto_generic generic_types
 %type	<astnode>	fn_args_p fn_args_call_or_tuple_p fn_call fn_method_call fn_domain_call
-%type	<astnode>	ifstmt stmt_list_star block_body let_stmt assignment_stmt assign_op_stmt struct_type_def tuple_type_def type_def
+%type	<astnode>	ifstmt stmt_list_star block_body let_stmt assignment_stmt assign_op_stmt struct_type_def tuple_type_def enum_type_def type_def
 %type	<astnode>	trait_def trait_fn_defs trait_fn_def trait_fn_defs_all
 %type	<astnode>	ifexpr stmtexpr_list_block stmtexpr_list for_stmt
 %type	<forstmtid>	for_stmt_ident
 %type	<var>		iddef iddef_typed iddef_typed_for_impl
-%type	<symnameid>	label_id attrib_scope ret_type
+%type	<symnameid>	label_id attrib_scope attrib_fn attrib_fns struct_attribs_opt ret_type
 //			%type	<symnameid>	atomic_type
 %type	<tid>		data_type pointer_type array_type ident_type gen_tuple_type
 %type	<deleft>	deref_pointer
@@ -145,7 +148,10 @@ extern int yychar, yylineno;
 %type	<symnameid>	assign_op
 %type	<symnameids>	let_more_var
 %type	<capattern>	let_stmt_left let_stmt_one_left let_stmt_left_pattern let_stmt_one_left_typed pattern_tuple_arg let_stmt_more_left_typed let_stmt_more_left pattern_struct_arg
-%type	<patterngroup>	pattern_struct_args_all pattern_tuple_args_all pattern_tuple_args pattern_struct_args
+%type	<astnodes>	match_arms match_arms_all
+%type	<astnode>	match_stmt match_arm pattern_literal
+%type	<capattern>	match_alt
+%type	<patterngroup>	match_alts pattern_struct_args_all pattern_tuple_args_all pattern_tuple_args pattern_struct_args
 %type	<range>		general_range
 %type	<impl_info>	type_impl_head
 %type	<domain_names>	domain domain_extend
@@ -165,12 +171,12 @@ paragraphs:	paragraphs stmt { make_paragraphs($2); }
 	|       {dot_emit("paragraphs", ""); /*empty */ } /* when not allow empty source file */
 		;
 
-fn_unit:	{
+fn_unit:	fn_attribs_opt {
 			if (current_type_impl)
 				current_type_impl->fn_def_recursive_count += 1;
 		}
 		fn_def
-		{	dot_emit("fn_unit", "fn_def"); $$ = $2;
+		{	dot_emit("fn_unit", "fn_def"); $$ = $3;
 			if (current_type_impl)
 				current_type_impl->fn_def_recursive_count -= 1;
 		}
@@ -192,8 +198,27 @@ fn_impl_defs_all:
 		;
 
 /* collect function into a group assoicated with one type */
-fn_impl_defs:	fn_impl_defs fn_def { $$ = make_fn_def_impl_next($$, $2); }
-	|	fn_def { $$ = make_fn_def_impl_begin($1); }
+fn_impl_defs:	fn_impl_defs fn_attribs_opt fn_def { $$ = make_fn_def_impl_next($$, $3); }
+	|	fn_attribs_opt fn_def { $$ = make_fn_def_impl_begin($2); }
+	;
+
+/* the attributes of the function definition, they take effect on the following fn_proto */
+fn_attribs_opt:	{ curr_fn_attrs = 0; }
+	|	attrib_fns { curr_fn_attrs = make_attrib_check($1, 0); }
+	;
+
+/* the layout attributes of the struct definition: `#[repr(C)]`, `#[repr(packed)]`, `#[repr(align(N))]`, `#[repr(auto)]` */
+struct_attribs_opt: { $$ = 0; }
+	|	attrib_fns { $$ = make_attrib_check($1, 1); }
+	;
+
+attrib_fns:	attrib_fns attrib_fn { $$ = make_attrib_fn_list($1, $2); }
+	|	attrib_fn { $$ = $1; }
+	;
+
+attrib_fn:	'#' '[' IDENT ']' { $$ = make_attrib_fn($3, -1); }
+	|	'#' '[' IDENT '(' IDENT ')' ']' { $$ = make_attrib_fn($3, $5); }
+	|	'#' '[' IDENT '(' IDENT '(' LITERAL ')' ')' ']' { $$ = make_attrib_fn_arg($3, $5, &$7); }
 	;
 
 fn_def:		fn_proto fn_body { $$ = make_fn_def($1, $2); }
@@ -218,6 +243,7 @@ fn_method_call:	structfield_op '(' fn_args_call_or_tuple ')' {$$ = make_method_c
 		;
 
 fn_domain_call: domain_fn '(' fn_args_call_or_tuple ')' { $$ = make_domain_call(&$1, $3); }
+	|	domain { $$ = make_domain_value(&$1); }
 		;
 
 domain_fn:	domain    { $$ = make_domainfn_domain(&$1); }
@@ -302,14 +328,18 @@ stmt:		';'			{ $$ = make_empty(); }
 //	|	DBGPRINTTYPE '(' data_type ')' ';' { $$ = make_stmt_print_datatype($3); } // the brackets conflict with general tuple so disable it
 	|	RET expr ';'            { $$ = make_stmt_ret_expr($2); }
 	|	RET ';'		        { $$ = make_stmt_ret(); }
+	|	BECOME expr ';'         { $$ = make_stmt_become($2); }
 	|	let_stmt                { $$ = $1; }
-	|	match_stmt              {  }
+	|	CONST IDENT ':' data_type '=' expr ';' { $$ = make_const_item($2, $4, $6); }
+	|	STATIC IDENT ':' data_type '=' expr ';' { $$ = make_static_item($2, $4, $6); }
+	|	match_stmt              { $$ = $1; }
 	|	assignment_stmt         { $$ = $1; }
 	|	assign_op_stmt          { $$ = $1; }
 	|	BREAK ';'               { $$ = make_break(); }
 	|	CONTINUE ';'            { $$ = make_continue(); }
 	|	LOOP stmt_list_block    { $$ = make_loop($2); }
 	|	for_stmt                { $$ = $1; }
+	|	PARALLEL for_stmt       { $$ = make_parallel_for($2); }
 	|	WHILE '(' expr ')' stmt_list_block { $$ = make_while($3, $5); }
 	|	ifstmt                  { dot_emit("stmt", "ifstmt"); $$ = $1; }
 	|	stmt_list_block         { dot_emit("stmt", "stmt_list_block"); $$ = $1; }
@@ -317,6 +347,7 @@ stmt:		';'			{ $$ = make_empty(); }
 	|	GOTO label_id ';'       { $$ = make_goto($2); }
 	|	struct_type_def         { $$ = $1; }
 	|	tuple_type_def          { $$ = $1; }
+	|	enum_type_def           { $$ = $1; }
 	|	trait_def               { $$ = $1; }
 	|	type_def                { $$ = $1; }
 	|	DROP IDENT ';'          { $$ = make_drop($2); }
@@ -350,9 +381,10 @@ general_range:	IGNORE           { general_range_init(&$$, 0, NULL, NULL); } // .
 	;
 
 attrib_scope:	'#' '[' IDENT '(' IDENT ')' ']' { $$ = make_attrib_scope($3, $5); }
+	|	'#' '[' IDENT ']' { $$ = make_attrib_scope($3, -1); }
 	;
 
-let_stmt:	attrib_scope LET iddef '=' vardef_value ';'  { $$ = make_global_vardef($3, $5, 1); }
+let_stmt:	attrib_scope LET iddef '=' vardef_value ';'  { $$ = make_global_vardef($3, $5, $1); }
 //	|	LET iddef '=' vardef_value ';'               { $$ = make_global_vardef($2, $4, 0); }
 	|	LET let_stmt_left '=' vardef_value ';' { $$ = make_let_stmt($2, $4); }
 	|	LET let_stmt_left ';'                  {
@@ -391,11 +423,21 @@ let_stmt_left_pattern:
 		IDENT                                 { $$ = capattern_new($1, PT_Var, NULL); } // simple pattern, simple variable binding
 	|	IDENT '(' pattern_tuple_args_all ')'  { $$ = capattern_new($1, PT_Tuple, $3); } // tuple style pattern match, for tuple/enum/union type
 	|	IDENT '{' pattern_struct_args_all '}' { $$ = capattern_new($1, PT_Struct, $3); } // struct style pattern match, for struct/tuple type
+	|	IDENT DOMAIN IDENT '(' pattern_tuple_args_all ')' { $$ = make_capattern_variant($1, $3, $5); } // enum variant, refutable, only for match
+	|	IDENT DOMAIN IDENT                    { $$ = make_capattern_variant($1, $3, NULL); }
 	|	'(' pattern_tuple_args_all ')'        { $$ = capattern_new(0, PT_GenTuple, $2); } // general tuple (unnamed) pattern match
 	|	'[' pattern_tuple_args_all ']'        { $$ = capattern_new(0, PT_Array, $2); }
 	|	'_'                                   { $$ = capattern_new(0, PT_IgnoreOne, NULL); } // ignorance the pattern
-//	|	literal
+	|	pattern_literal                       { $$ = make_capattern_literal($1, NULL, 1); } // refutable, only for match
+	|	pattern_literal IGNORE pattern_literal { $$ = make_capattern_literal($1, $3, 0); }
+	|	pattern_literal IRANGE pattern_literal { $$ = make_capattern_literal($1, $3, 1); }
+	;
+
+pattern_literal:
+		literal                               { $$ = make_literal(&$1); }
+	|	'-' literal                           { $$ = make_uminus_expr(make_literal(&$2)); }
 //	|	IDENT ':' ':' IDENT // TODO: domain type or enum type
+	;
 
 pattern_tuple_args_all:
 		pattern_tuple_args
@@ -455,15 +497,29 @@ pattern_struct_arg:
 		}
 	;
 
-match_stmt: 	MATCH '(' expr ')' '{' match_patterns '}' {}
+match_stmt: 	MATCH '(' expr ')' '{' match_arms_all '}' { $$ = make_match($3, $6); }
 	;
 
-match_patterns:	match_patterns ',' match_pattern {}
-	|	match_patterns match_pattern {}
-	|	match_pattern {}
+match_arms_all:	match_arms
+	|	match_arms ','
 	;
 
-match_pattern:	let_stmt_left INFER stmt_list_block {}
+match_arms:	match_arms match_arm     { vec_append($1, $2); $$ = $1; }
+	|	match_arms ',' match_arm { vec_append($1, $3); $$ = $1; }
+	|	match_arm                { $$ = vec_new(); vec_append($$, $1); }
+	;
+
+match_arm:	{ SymTable *st = push_new_symtable(); /* the pattern variables need a symbol table in the arm */ }
+		match_alts INFER     { make_match_arm_entry($2); }
+		stmt_list_block      { $$ = make_match_arm($2, $5); }
+	;
+
+match_alts:	match_alts '|' match_alt { $$ = patterngroup_push($1, $3); }
+	|	match_alt                { $$ = patterngroup_push(patterngroup_new(), $1); }
+	;
+
+match_alt:	let_stmt_more_left
+	|	let_stmt_one_left
 	;
 
 /* match_left:	let_stmt_left */
@@ -506,6 +562,7 @@ for_stmt:	FOR                   { SymTable *st = push_new_symtable(); /* the inn
 for_stmt_ident:	IDENT               { $$ = (ForStmtId){0, $1}; }
 	|	'*' IDENT           { $$ = (ForStmtId){'*', $2}; }
 	|	REF IDENT           { $$ = (ForStmtId){'&', $2}; }
+	|	'&' IDENT           { $$ = (ForStmtId){'&', $2}; }
 	;
 
 ifstmt:		{ ifstmt_new_push(); } ifstmt1 { $$ = ifstmt_current(); ifstmt_pop(0); }
@@ -587,6 +644,8 @@ expr:     	literal               { $$ = make_literal(&$1); }
 	|	ifexpr                { dot_emit("expr", "ifexpr"); $$ = $1; }
 	|	expr AS data_type     { $$ = make_as($1, $3); }
 	|	SIZEOF '(' data_type ')'{ $$ = make_sizeof($3); }
+	|	LIKELY '(' expr ')'   { $$ = make_expr(LIKELY, 1, $3); }
+	|	UNLIKELY '(' expr ')' { $$ = make_expr(UNLIKELY, 1, $3); }
 	|	deref_pointer         { $$ = make_deref($1.expr); }
 	|	'&' expr %prec UADDR  { $$ = make_address($2); }
 	|	structfield_op        { $$ = make_structfield_right($1); }
@@ -652,8 +711,8 @@ data_type:	ident_type            { $$ = $1; }
 ident_type: 	IDENT { $$ = sym_form_type_id($1); }
 		;
 
-struct_type_def: STRUCT IDENT { reset_arglist_with_new_symtable(); }
-		'{' struct_members_dot '}'       { $$ = make_struct_type($2, &curr_arglist, 0); }
+struct_type_def: struct_attribs_opt STRUCT IDENT { reset_arglist_with_new_symtable(); }
+		'{' struct_members_dot '}'       { $$ = make_struct_type($3, &curr_arglist, 0, $1); }
 	;
 
 struct_members_dot: struct_members | struct_members ','
@@ -663,8 +722,25 @@ struct_members: struct_members ',' iddef_typed   { add_struct_member(&curr_argli
 	|	
 	;
 
-tuple_type_def:	STRUCT IDENT { tuplelist_new_push(); }
-		'(' tuple_members_dot ')' ';'    { $$ = make_struct_type($2, tuplelist_current(), 1); tuplelist_pop(); }
+tuple_type_def:	struct_attribs_opt STRUCT IDENT { tuplelist_new_push(); }
+		'(' tuple_members_dot ')' ';'    { $$ = make_struct_type($3, tuplelist_current(), 1, $1); tuplelist_pop(); }
+	;
+
+enum_type_def:	struct_attribs_opt ENUM IDENT { enum_variants_begin(); }
+		'{' enum_variants_dot '}'        { $$ = make_enum_type($3, $1); }
+	;
+
+enum_variants_dot: enum_variants | enum_variants ','
+	;
+
+enum_variants:	enum_variants ',' enum_variant
+	|	enum_variant
+	|
+	;
+
+enum_variant:	IDENT                            { add_enum_variant($1, typeid_novalue, NULL); }
+	|	IDENT '=' expr                   { add_enum_variant($1, typeid_novalue, $3); }
+	|	IDENT gen_tuple_type             { add_enum_variant($1, $2, NULL); }
 	;
 
 gen_tuple_type:	 { tuplelist_new_push(); }
@@ -694,6 +770,7 @@ trait_fn_defs:	trait_fn_defs trait_fn_def { $$ = trait_fn_next($1, $2); }
 
 trait_fn_def:	fn_proto ';' { $$ = $1; pop_symtable(); }
 	|	fn_def   { $$ = $1; /* for default function implementation in trait */ }
+	|	attrib_fns { curr_fn_attrs = make_attrib_check($1, 0); } fn_def { $$ = $3; }
 	;
 
 type_def:	TYPE IDENT '=' data_type ';' { $$ = make_type_def($2, $4); }
@@ -707,6 +784,7 @@ array_type:	'[' data_type ';' LITERAL ']'
 		// the LITERAL must be u64 or usize type that which is 8bytes length
 		$$ = make_array_type($2, &$4);
 		}
+	|	'[' data_type ';' IDENT ']' { $$ = make_array_type_const($2, $4); }
 	;
 
 iddef:		iddef_typed  { dot_emit("iddef", "iddef_typed"); $$ = $1; }
@@ -730,6 +808,7 @@ literal:	LITERAL { dot_emit("literal", "LITERAL"); create_literal(&$$, $1.text,
 array_def:	'[' array_def_items ']' { $$ = $2; }
 	|	'[' ']' { $$ = arrayexpr_new(); }
 	|	'['expr ';' literal ']' { $$ = make_array_def_fill($2, &$4); }
+	|	'['expr ';' IDENT ']' { $$ = make_array_def_fill_const($2, $4); }
 	;
 
 array_def_items:array_def_items ',' expr { $$ = arrayexpr_append($1, $3); }
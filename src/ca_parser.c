@@ -23,6 +23,8 @@
 #include "ca.tab.h"
 #include "ca_types.h"
 #include "config.h"
+#include "const_eval.h"
+#include "builtins.h"
 #include "dotgraph.h"
 #include "symtable.h"
 #include "type_system.h"
@@ -82,6 +84,7 @@ SymTable *curr_fn_symtable = NULL;
  * expression has a different type, an error will be reported.
  */
 int extern_flag = 0; /// indicate if need handling the extern function
+int curr_fn_attrs = 0; /// the attributes of the function being parsed, see make_attrib_fn
 // int call_flag = 0;  // indicate if it under a call statement, used for actual
 // parameter checking
 ST_ArgList curr_arglist;
@@ -334,6 +337,12 @@ ASTNode *make_fn_def(ASTNode *proto, ASTNode *body) {
   proto->fndefn.stmts = body;
   proto->endloc.row = glineno;
   proto->endloc.col = gcolno;
+
+  // the function defined can be called when evaluating the later constants
+  STEntry *entry = sym_getsym(sym_parent_or_global(curr_symtable),
+                              proto->fndefn.fn_decl->fndecln.name, 0);
+  const_eval_register_fn(entry, proto);
+
   pop_symtable();
 
   curr_fn_rettype = 0;
@@ -525,6 +534,7 @@ ASTNode *make_stmt_ret_expr(ASTNode *expr) {
 
   ASTNode *p = new_ASTNode(TTE_Ret);
   p->retn.expr = expr;
+  p->retn.become = 0;
   set_address(p, &(SLoc){glineno_prev, gcolno_prev}, &(SLoc){glineno, gcolno});
   return p;
 }
@@ -537,10 +547,22 @@ ASTNode *make_stmt_ret() {
 
   ASTNode *p = new_ASTNode(TTE_Ret);
   p->retn.expr = NULL;
+  p->retn.become = 0;
   set_address(p, &(SLoc){glineno_prev, gcolno_prev}, &(SLoc){glineno, gcolno});
   return p;
 }
 
+ASTNode *make_stmt_become(ASTNode *expr) {
+  if (expr->type != TTE_Expr || expr->exprn.op != FN_CALL) {
+    caerror(&(expr->begloc), &(expr->endloc), "`become` requires a function call");
+    return NULL;
+  }
+
+  ASTNode *p = make_stmt_ret_expr(expr);
+  p->retn.become = 1;
+  return p;
+}
+
 ASTNode *make_stmtexpr_list_block(ASTNode *exprblockbody) {
   dot_emit("stmtexpr_list_block", "exprblock_body");
   // or
@@ -593,6 +615,23 @@ typeid_t make_array_type(typeid_t type, LitBuffer *size) {
   // return catype_make_array_type(type, len);
 }
 
+static STEntry *get_const_entry(int constname) {
+  STEntry *entry = sym_getsym(curr_symtable, constname, 1);
+  if (!entry || entry->sym_type != Sym_Const) {
+    SLoc stloc = {glineno, gcolno};
+    caerror(&stloc, NULL, "`%s` is not a constant", symname_get(constname));
+    return NULL;
+  }
+
+  return entry;
+}
+
+typeid_t make_array_type_const(typeid_t type, int constname) {
+  STEntry *entry = get_const_entry(constname);
+  uint64_t len = const_eval_array_len(entry);
+  return sym_form_array_id(type, (int)len);
+}
+
 typeid_t make_tuple_type(ST_ArgList *arglist) {
   // t:(;), t:(;i32), t:(;i32, bool), t:(;i32, (;i32, i32)), t:(;(;i32, i32,), i32), ...
   typeid_t id = typeid_novalue;
@@ -627,6 +666,7 @@ STEntry *make_type_def_entry(int id, typeid_t type, SymTable *symtable,
 
   entry = sym_insert(symtable, newtype, Sym_DataType);
   entry->u.datatype.id = type;
+  entry->u.datatype.repr = 0;
   entry->u.datatype.idtable = symtable;
   entry->u.datatype.runables.opaque = NULL;
   entry->u.datatype.members = NULL;
@@ -868,6 +908,12 @@ CAArrayExpr make_array_def_fill(ASTNode *expr, CALiteral *lit) {
   return caexpr;
 }
 
+CAArrayExpr make_array_def_fill_const(ASTNode *expr, int constname) {
+  STEntry *entry = get_const_entry(constname);
+  uint64_t len = const_eval_array_len(entry);
+  return arrayexpr_fill(arrayexpr_new(), expr, len);
+}
+
 ASTNode *make_struct_expr(CAStructExpr expr) {
   ASTNode *p = new_ASTNode(TTE_StructExpr);
   p->snoden = expr;
@@ -945,6 +991,16 @@ ASTNode *make_deref_left(DerefLeft deleft) {
 
 int make_attrib_scope(int attrfn, int attrparam) {
   const char *scope = symname_get(attrfn);
+  if (attrparam == -1) {
+    if (strcmp(scope, "thread_local")) {
+      SLoc stloc = {glineno, gcolno};
+      caerror(&stloc, NULL, "attribute here only support `thread_local`, but find `%s`", scope);
+      return -1;
+    }
+
+    return CAVA_Global | CAVA_ThreadLocal;
+  }
+
   const char *global = symname_get(attrparam);
   if (strcmp(scope, "scope")) {
     SLoc stloc = {glineno, gcolno};
@@ -958,7 +1014,120 @@ int make_attrib_scope(int attrfn, int attrparam) {
     return -1;
   }
 
-  return attrparam;
+  return CAVA_Global;
+}
+
+int make_attrib_fn(int attrfn, int attrparam) {
+  const char *name = symname_get(attrfn);
+  const char *param = attrparam == -1 ? NULL : symname_get(attrparam);
+  SLoc stloc = {glineno, gcolno};
+
+  if (!strcmp(name, "inline")) {
+    if (!param || !strcmp(param, "always"))
+      return CAFA_Inline;
+
+    if (!strcmp(param, "never"))
+      return CAFA_NoInline;
+
+    caerror(&stloc, NULL, "attribute `inline` only support `always` or `never`, but find `%s`", param);
+    return 0;
+  }
+
+  if (!strcmp(name, "repr")) {
+    if (param && !strcmp(param, "C"))
+      return CASA_ReprC;
+
+    if (param && !strcmp(param, "packed"))
+      return CASA_ReprPacked;
+
+    if (param && !strcmp(param, "auto"))
+      return CASA_ReprAuto;
+
+    caerror(&stloc, NULL, "attribute `repr` only support `C`, `packed`, `auto` or `align(N)`, but find `%s`",
+	    param ? param : "");
+    return 0;
+  }
+
+  int attr = 0;
+  if (!strcmp(name, "cold"))
+    attr = CAFA_Cold;
+  else if (!strcmp(name, "hot"))
+    attr = CAFA_Hot;
+  else if (!strcmp(name, "minsize"))
+    attr = CAFA_MinSize;
+
+  if (!attr) {
+    caerror(&stloc, NULL, "unknown function attribute `%s`", name);
+    return 0;
+  }
+
+  if (param) {
+    caerror(&stloc, NULL, "function attribute `%s` have no parameter", name);
+    return 0;
+  }
+
+  return attr;
+}
+
+// `#[repr(align(N))]`, N must be power of 2
+int make_attrib_fn_arg(int attrfn, int attrparam, LitBuffer *arg) {
+  const char *name = symname_get(attrfn);
+  const char *param = symname_get(attrparam);
+  const char *text = symname_get(arg->text);
+  SLoc stloc = {glineno, gcolno};
+
+  if (strcmp(name, "repr") || strcmp(param, "align")) {
+    caerror(&stloc, NULL, "unknown attribute `%s(%s(%s))`", name, param, text);
+    return 0;
+  }
+
+  uint64_t align = 0;
+  if (arg->typetok == U64)
+    sscanf(text, "%lu", &align);
+
+  if (!align || (align & (align - 1)) || align > (1 << 29)) {
+    caerror(&stloc, NULL, "the alignment of `repr(align(N))` must be power of 2, but find `%s`", text);
+    return 0;
+  }
+
+  int shift = 0;
+  while ((1UL << shift) < align)
+    ++shift;
+
+  return CASA_ReprAlign | (shift << CASA_AlignShift);
+}
+
+int make_attrib_fn_list(int attrs, int attr) {
+  SLoc stloc = {glineno, gcolno};
+  if (attrs & attr & CASA_ReprAlign)
+    caerror(&stloc, NULL, "multiple `repr(align(N))` attributes");
+
+  attrs |= attr;
+  if ((attrs & CAFA_Inline) && (attrs & CAFA_NoInline))
+    caerror(&stloc, NULL, "function attribute `inline` conflicts with `inline(never)`");
+
+  if ((attrs & CAFA_Cold) && (attrs & CAFA_Hot))
+    caerror(&stloc, NULL, "function attribute `cold` conflicts with `hot`");
+
+  if ((attrs & CASA_ReprPacked) && (attrs & (CASA_ReprAlign | CASA_ReprAuto)))
+    caerror(&stloc, NULL, "attribute `repr(packed)` conflicts with `repr(align(N))` and `repr(auto)`");
+
+  if ((attrs & CASA_ReprC) && (attrs & CASA_ReprAuto))
+    caerror(&stloc, NULL, "attribute `repr(C)` conflicts with `repr(auto)`");
+
+  return attrs;
+}
+
+// check the attributes are used on the right item, the function or the struct
+int make_attrib_check(int attrs, int isstruct) {
+  SLoc stloc = {glineno, gcolno};
+  if (isstruct && (attrs & CAFA_Mask))
+    caerror(&stloc, NULL, "function attribute cannot be used on struct");
+
+  if (!isstruct && (attrs & CASA_Mask))
+    caerror(&stloc, NULL, "attribute `repr` can only be used on struct");
+
+  return attrs;
 }
 
 /**
@@ -984,6 +1153,13 @@ void register_variable(CAVariable *cavar, SymTable *symtable) {
       return;
     }
 
+    if (entry->u.varshielding.current->isstatic) {
+      SLoc stloc = {glineno, gcolno};
+      caerror(&stloc, NULL, "cannot shadow static `%s` in the same scope",
+              symname_get(cavar->name));
+      return;
+    }
+
     vec_append(entry->u.varshielding.varlist, entry->u.varshielding.current);
   } else {
     entry = sym_insert(symtable, cavar->name, Sym_Variable);
@@ -993,7 +1169,21 @@ void register_variable(CAVariable *cavar, SymTable *symtable) {
   entry->u.varshielding.current = cavar;
 }
 
-ASTNode *make_global_vardef(CAVariable *var, ASTNode *exprn, int global) {
+/**
+ * Evaluate the initializer of global variable into a constant when it can be,
+ * so the computed value, e.g. `let N: u64 = fact(5);`, is emitted directly
+ * as the initial value of the global variable. The expression keeps as it is
+ * when it is not a constant expression.
+ */
+static ASTNode *fold_global_initializer(ASTNode *exprn, typeid_t type) {
+  if (exprn->type == TTE_Literal || exprn->type == TTE_VarDefZeroValue)
+    return exprn;
+
+  ASTNode *lit = const_eval_try_literal(exprn, type, curr_symtable);
+  return lit ? lit : exprn;
+}
+
+ASTNode *make_global_vardef(CAVariable *var, ASTNode *exprn, int attrs) {
   dot_emit("stmt", "vardef");
 
   // TODO: realize multiple let statement in one scope in the future
@@ -1004,7 +1194,7 @@ ASTNode *make_global_vardef(CAVariable *var, ASTNode *exprn, int global) {
   // curr_symtable == g_main_symtable` already includes the judgement
   if (enable_emit_main()) {
     // only take effect when `-main` option is specified to generate main function
-    var->global = global;
+    var->global = !!(attrs & CAVA_Global);
 
     // it is in generated main function scope, and `#[scope(global)]` is provided
     if (curr_symtable == g_main_symtable && var->global) {
@@ -1021,11 +1211,23 @@ ASTNode *make_global_vardef(CAVariable *var, ASTNode *exprn, int global) {
        * To address this, reassign the symtable using the global table. However,
        * some bugs may still persist.
        */
+      exprn = fold_global_initializer(exprn, var->datatype);
       exprn->symtable = symtable;
     }
     // or else generate local variable against main or defined function
   }
 
+  if (attrs & CAVA_ThreadLocal) {
+    if (symtable != &g_root_symtable) {
+      SLoc stloc = {glineno, gcolno};
+      caerror(&stloc, NULL, "`#[thread_local]` only for global variable `%s`",
+              symname_get(var->name));
+      return NULL;
+    }
+
+    var->tls = 1;
+  }
+
   register_variable(var, symtable);
 
   CAPattern *cap = capattern_new(var->name, PT_Var, NULL);
@@ -1111,8 +1313,17 @@ static void register_capattern_symtable(CAPattern *cap, SLoc *loc,
     break;
   case PT_Tuple:
   case PT_Struct:
+  case PT_Variant:
     register_structpattern_symtable(cap, 1, 1, loc, sethandler);
     break;
+  case PT_Literal:
+  case PT_Range:
+    // the literal binds nothing but the variables of `x @ 1..=9`
+    for (size_t i = 0; i < vec_size(cap->morebind); ++i) {
+      int name = (int)(long)vec_at(cap->morebind, i);
+      capattern_register_variable(name, typeid_novalue, loc, sethandler);
+    }
+    break;
   case PT_IgnoreOne:
   case PT_IgnoreRange:
     return;
@@ -1128,6 +1339,7 @@ static const char *capattern_check_ignore(CAPattern *cap) {
   case PT_GenTuple:
   case PT_Tuple:
   case PT_Struct:
+  case PT_Variant:
     for (int i = 0; i < cap->items->size; ++i) {
       if (cap->items->patterns[i]->type == PT_IgnoreRange)
         count += 1;
@@ -1152,6 +1364,8 @@ static const char *capattern_check_ignore(CAPattern *cap) {
 
     return NULL;
   case PT_IgnoreOne:
+  case PT_Literal:
+  case PT_Range:
     return NULL;
   case PT_IgnoreRange:
     // the ignore range must be in tuple or struct
@@ -1159,6 +1373,50 @@ static const char *capattern_check_ignore(CAPattern *cap) {
   }
 }
 
+/// the pattern may fail to match, it contains literal or range pattern
+static int capattern_is_refutable(CAPattern *cap) {
+  switch (cap->type) {
+  case PT_Literal:
+  case PT_Range:
+  case PT_Variant:
+    return 1;
+  case PT_Array:
+  case PT_GenTuple:
+  case PT_Tuple:
+  case PT_Struct:
+    for (int i = 0; i < cap->items->size; ++i) {
+      if (capattern_is_refutable(cap->items->patterns[i]))
+        return 1;
+    }
+    return 0;
+  default:
+    return 0;
+  }
+}
+
+/// the pattern binds any variable
+static int capattern_has_binding(CAPattern *cap) {
+  if (vec_size(cap->morebind))
+    return 1;
+
+  switch (cap->type) {
+  case PT_Var:
+    return 1;
+  case PT_Array:
+  case PT_GenTuple:
+  case PT_Tuple:
+  case PT_Struct:
+  case PT_Variant:
+    for (int i = 0; i < cap->items->size; ++i) {
+      if (capattern_has_binding(cap->items->patterns[i]))
+        return 1;
+    }
+    return 0;
+  default:
+    return 0;
+  }
+}
+
 /**
  * @brief When the `exprn` is NULL, it indicates an uninitialized let binding:
  *        let a: i32;
@@ -1175,6 +1433,11 @@ ASTNode *make_let_stmt(CAPattern *cap, ASTNode *exprn) {
    * Parse variables (possibly with different data types) in the CApattern 
    * and record them in the symbol table for later use.
    */
+  if (capattern_is_refutable(cap)) {
+    caerror(&cap->loc, NULL, "refutable pattern in `let` binding, use `match` instead");
+    return NULL;
+  }
+
   if (curr_symtable == &g_root_symtable && cap->type != PT_Var) {
     SLoc stloc = {glineno, gcolno};
     caerror(&stloc, NULL, "left `%s` cannot do pattern match for `%s` globally",
@@ -1182,6 +1445,10 @@ ASTNode *make_let_stmt(CAPattern *cap, ASTNode *exprn) {
     return NULL;
   }
 
+  // the initializer of global variable should be a constant
+  if (curr_symtable == &g_root_symtable)
+    exprn = fold_global_initializer(exprn, cap->datatype);
+
   void *sethandler = set_new();
   register_capattern_symtable(cap, &exprn->endloc, sethandler);
   set_drop(sethandler);
@@ -1201,6 +1468,68 @@ ASTNode *make_vardef_zero_value(VarInitType init_type) {
   return p;
 }
 
+ASTNode *make_const_item(int name, typeid_t type, ASTNode *exprn) {
+  dot_emit("stmt", "const_item");
+
+  STEntry *entry = sym_getsym(curr_symtable, name, 0);
+  if (entry) {
+    caerror(&exprn->begloc, &exprn->endloc, "name `%s` already defined on line %d, col %d.",
+            symname_get(name), entry->sloc.row, entry->sloc.col);
+    return NULL;
+  }
+
+  ASTNode *lit = const_eval_literal(exprn, type, curr_symtable);
+
+  entry = sym_insert(curr_symtable, name, Sym_Const);
+  entry->sloc = exprn->begloc;
+  entry->u.constant.litnode = lit;
+
+  // the value is used in place, so there is nothing to generate for the item
+  return make_empty();
+}
+
+/// evaluate the scalar initializer or each of the elements of array initializer into literals
+static ASTNode *fold_static_initializer(ASTNode *exprn) {
+  if (exprn->type != TTE_Expr || exprn->exprn.op != ARRAY)
+    return exprn->type == TTE_Literal ? exprn : const_eval_literal(exprn, typeid_novalue, curr_symtable);
+
+  CAArrayExpr aexpr = exprn->exprn.operands[0]->anoden.aexpr;
+  size_t size = arrayexpr_size(aexpr);
+  for (size_t i = 0; i < size; ++i)
+    arrayexpr_set(aexpr, i, fold_static_initializer(arrayexpr_get(aexpr, i)));
+
+  return exprn;
+}
+
+ASTNode *make_static_item(int name, typeid_t type, ASTNode *exprn) {
+  dot_emit("stmt", "static_item");
+
+  STEntry *entry = sym_getsym(curr_symtable, name, 0);
+  if (entry) {
+    caerror(&exprn->begloc, &exprn->endloc, "name `%s` already defined on line %d, col %d.",
+            symname_get(name), entry->sloc.row, entry->sloc.col);
+    return NULL;
+  }
+
+  exprn = fold_static_initializer(exprn);
+
+  // it is always a global variable even when defined in function
+  CAVariable *var = cavar_create_with_loc(name, type, &exprn->begloc);
+  var->global = 1;
+  var->isstatic = 1;
+  register_variable(var, curr_symtable);
+
+  CAPattern *cap = capattern_new(name, PT_Var, NULL);
+  cap->datatype = type;
+
+  ASTNode *p = new_ASTNode(TTE_LetBind);
+  p->grammartype = NGT_static_item;
+  p->letbindn.cap = cap;
+  p->letbindn.expr = exprn;
+  set_address(p, &(SLoc){glineno_prev, gcolno_prev}, &exprn->endloc);
+  return p;
+}
+
 static ASTNode *make_assign_common(ASTNode *left, ASTNode *right) {
   ASTNode *p = new_ASTNode(TTE_Assign);
   p->assignn.id = left;
@@ -1220,6 +1549,14 @@ static ASTNode *make_assign_var(int id, ASTNode *exprn) {
     return NULL;
   }
 
+  if (entry->sym_type == Sym_Const ||
+      (entry->sym_type == Sym_Variable && entry->u.varshielding.current->isstatic)) {
+    SLoc stloc = {glineno, gcolno};
+    caerror(&stloc, NULL, "cannot assign to %s `%s`",
+            entry->sym_type == Sym_Const ? "constant" : "static", symname_get(id));
+    return NULL;
+  }
+
   ASTNode *idn = make_id(id, TTEId_VarAssign);
   idn->entry = entry;
 
@@ -1227,7 +1564,52 @@ static ASTNode *make_assign_var(int id, ASTNode *exprn) {
   return p;
 }
 
+/*
+ * Get the variable that the memory of left value `node` belongs to, e.g. `a`
+ * of `a[1].f`, it is NULL when the memory is behind a pointer, e.g. `p->f`.
+ */
+static STEntry *left_value_root_entry(ASTNode *node) {
+  while (node) {
+    switch (node->type) {
+    case TTE_Id:
+      return sym_getsym(curr_symtable, node->idn.i, 1);
+    case TTE_ArrayItemLeft:
+    case TTE_ArrayItemRight:
+      node = node->aitemn.arraynode;
+      break;
+    case TTE_StructFieldOpLeft:
+    case TTE_StructFieldOpRight:
+      if (!node->sfopn.direct)
+        return NULL;
+      node = node->sfopn.expr;
+      break;
+    case TTE_Expr:
+      if (node->exprn.op != ARRAYITEM && node->exprn.op != STRUCTITEM)
+        return NULL;
+      node = node->exprn.operands[0];
+      break;
+    default:
+      return NULL;
+    }
+  }
+
+  return NULL;
+}
+
+/// the static is placed in read-only data, any part of it cannot be assigned
+static void check_static_left_value(ASTNode *node) {
+  STEntry *entry = left_value_root_entry(node);
+  if (entry && entry->sym_type == Sym_Variable && entry->u.varshielding.current->isstatic) {
+    SLoc stloc = {glineno, gcolno};
+    caerror(&stloc, NULL, "cannot assign to static `%s`", symname_get(entry->sym_name));
+  }
+}
+
 static ASTNode *make_deref_left_assign(DerefLeft deleft, ASTNode *exprn) {
+  // `*&s = v`
+  if (deleft.derefcount == 1 && deleft.expr->type == TTE_Expr && deleft.expr->exprn.op == ADDRESS)
+    check_static_left_value(deleft.expr->exprn.operands[0]);
+
   ASTNode *derefln = make_deref_left(deleft);
   ASTNode *p = make_assign_common(derefln, exprn);
   return p;
@@ -1238,6 +1620,7 @@ static ASTNode *make_arrayitem_left_assign(ArrayItem ai, ASTNode *exprn) {
   aitemn->aitemn = ai;
   set_address(aitemn, &(SLoc){glineno_prev, gcolno_prev},
               &(SLoc){glineno, gcolno});
+  check_static_left_value(aitemn);
 
   ASTNode *p = make_assign_common(aitemn, exprn);
   return p;
@@ -1249,6 +1632,7 @@ static ASTNode *make_structfield_left_assign(StructFieldOp sfop,
   sfopn->sfopn = sfop;
   set_address(sfopn, &(SLoc){glineno_prev, gcolno_prev},
               &(SLoc){glineno, gcolno});
+  check_static_left_value(sfopn);
 
   ASTNode *p = make_assign_common(sfopn, exprn);
   return p;
@@ -1376,6 +1760,13 @@ static typeid_t get_structfield_expr_type_from_tree(ASTNode *node) {
     return typeid_novalue;
   }
 
+  if (catype->struct_layout->type == Struct_Enum) {
+    caerror(&(node->begloc), &(node->endloc),
+            "the fields of enum `%s` can only be accessed by `match`",
+            catype_get_type_name(catype->signature));
+    return typeid_novalue;
+  }
+
   if (catype->struct_layout->type) {
     if (node->sfopn.fieldname < catype->struct_layout->fieldnum)
       return catype->struct_layout->fields[node->sfopn.fieldname]
@@ -1515,6 +1906,35 @@ int is_logic_op(int op) {
   }
 }
 
+STEntry *enum_variant_lookup(ASTNode *call, int *variant) {
+  ASTNode *name = call->exprn.operands[0];
+  if (name->type != TTE_Domain || name->domainfn.type != DFT_Domain)
+    return NULL;
+
+  DomainNames *domain = name->domainfn.u.domain;
+  if (!domain->relative || domain->count != 2)
+    return NULL;
+
+  int enumname = (int)(long)vec_at(domain->parts, 0);
+  STEntry *entry = sym_getsym(name->symtable, sym_form_type_id(enumname), 1);
+  if (!entry || entry->sym_type != Sym_DataType || entry->u.datatype.tuple != Struct_Enum)
+    return NULL;
+
+  int variantname = (int)(long)vec_at(domain->parts, 1);
+  ST_ArgList *members = entry->u.datatype.members;
+  for (int i = 0; i < members->argc; ++i) {
+    if (members->argnames[i] == variantname) {
+      if (variant)
+        *variant = i;
+      return entry;
+    }
+  }
+
+  caerror(&(name->begloc), &(name->endloc), "no variant `%s` in enum `%s`",
+          symname_get(variantname), symname_get(enumname));
+  return NULL;
+}
+
 typeid_t get_fncall_form_datatype(ASTNode *node, int id) {
   STEntry *entry = sym_getsym(node->symtable, id, 1);
   if (entry)
@@ -1535,7 +1955,7 @@ typeid_t get_fncall_form_datatype(ASTNode *node, int id) {
     return typeid_novalue;
   }
 
-  if (!entry->u.datatype.tuple) {
+  if (entry->u.datatype.tuple != Struct_NamedTuple) {
     caerror(&(node->begloc), &(node->endloc),
             "only support tuple call here: `%s`", fnname);
     return typeid_novalue;
@@ -1693,6 +2113,17 @@ typeid_t inference_expr_expr_type(ASTNode *node) {
   }
   case FN_CALL: {
     // Handle calls: suitable for cases when the idn is of all kinds of call types
+    if (builtin_lookup(node, NULL) != BI_None) {
+      type1 = builtin_inference_type(node);
+      break;
+    }
+
+    // the enum variant construction `E::A(1, 2)`, `E::B`
+    STEntry *enumentry = enum_variant_lookup(node, NULL);
+    if (enumentry) {
+      type1 = enumentry->u.datatype.id;
+      break;
+    }
 
     // get function return type
     ASTNode *idn = node->exprn.operands[0];
@@ -1783,8 +2214,8 @@ typeid_t inference_expr_expr_type(ASTNode *node) {
         if (node->exprn.op == SHIFTL || node->exprn.op == SHIFTR) {
           CADataType *catype1 = catype_get_by_name(node->symtable, type1);
           CADataType *catype2 = catype_get_by_name(node->symtable, type);
-          if (!catype_is_integer(catype1->type) ||
-              !catype_is_integer(catype2->type)) {
+          if (!catype_is_integer(catype_scalar_token(catype1)) ||
+              !catype_is_integer(catype_scalar_token(catype2))) {
             caerror(
                 &(node->begloc), &(node->endloc),
                 "expected `integer`, but found `%s` `%s` for shift operation",
@@ -1811,8 +2242,14 @@ typeid_t inference_expr_expr_type(ASTNode *node) {
     break;
   }
 
-  if (is_logic_op(node->exprn.op))
-    type1 = sym_form_type_id_from_token(BOOL);
+  if (is_logic_op(node->exprn.op)) {
+    // the vector comparison is element-wise, it results a mask vector
+    catype = catype_get_by_name(node->symtable, type1);
+    if (catype && catype->type == VECTOR)
+      type1 = catype_get_vector_mask_type(catype)->signature;
+    else
+      type1 = sym_form_type_id_from_token(BOOL);
+  }
 
   node->exprn.expr_type = type1;
   return type1;
@@ -1862,6 +2299,25 @@ typeid_t inference_expr_type(ASTNode *p) {
     exprdt = catype_get_by_name(p->symtable, type1);
     CHECK_GET_TYPE_VALUE(p, exprdt, type1);
 
+    if (exprdt->type == VECTOR || typedt->type == VECTOR) {
+      // splat a scalar into vector, or convert the vector of same lanes element-wise
+      int convertable = typedt->type == VECTOR;
+      if (convertable && exprdt->type == VECTOR)
+        convertable = exprdt->array_layout->dimarray[0] == typedt->array_layout->dimarray[0];
+      else if (convertable)
+        convertable = catype_is_integer(exprdt->type) || catype_is_float(exprdt->type);
+
+      if (!convertable) {
+        caerror(&(p->begloc), &(p->endloc),
+                "type `%s` cannot convert (as) to type `%s`",
+                catype_get_type_name(exprdt->signature),
+                catype_get_type_name(typedt->signature));
+        return -1;
+      }
+
+      return typedt->signature;
+    }
+
     if (!as_type_convertable(exprdt->type, typedt->type)) {
       caerror(&(p->begloc), &(p->endloc),
               "type `%s` cannot convert (as) to type `%s`",
@@ -2012,7 +2468,13 @@ static int determine_expr_expr_type(ASTNode *node, typeid_t type) {
     // get return type of the function
     // NEXT TODO: handle method call and domain call when idn is not normal id
     ASTNode *idn = node->exprn.operands[0];
-    typeid_t type1 = get_fncall_form_datatype(node, idn->idn.i);
+    typeid_t type1 = typeid_novalue;
+    if (builtin_lookup(node, NULL) != BI_None)
+      type1 = builtin_inference_type(node);
+    else if (enum_variant_lookup(node, NULL))
+      type1 = inference_expr_type(node);
+    else
+      type1 = get_fncall_form_datatype(node, idn->idn.i);
     catype_check_identical_in_symtable_witherror(
         node->symtable, type, node->symtable, type1, 1, &node->begloc);
     break;
@@ -2077,6 +2539,14 @@ static int determine_expr_expr_type(ASTNode *node, typeid_t type) {
   case EQ: {
     // determine the type of logical expresssion, they must be bool
     datatype = catype_get_by_name(node->symtable, type);
+    if (datatype->type == VECTOR) {
+      // or the mask vector of the compared vectors
+      catype_check_identical_in_symtable_witherror(
+          node->symtable, type, node->symtable, inference_expr_type(node), 1,
+          &node->begloc);
+      break;
+    }
+
     if (datatype->type != BOOL) {
       caerror(&(node->begloc), &(node->endloc),
               "`bool` type is required for determining the logical operation, but `%s` "
@@ -2088,6 +2558,19 @@ static int determine_expr_expr_type(ASTNode *node, typeid_t type) {
     inference_expr_type(node);
     break;
   }
+  case SHIFTL:
+  case SHIFTR:
+    // the vector can be shifted by a scalar amount, which not need the same type
+    datatype = catype_get_by_name(node->symtable, type);
+    if (datatype->type == VECTOR) {
+      determine_expr_type(node->exprn.operands[0], type);
+      inference_expr_type(node->exprn.operands[1]);
+      break;
+    }
+
+    for (int i = 0; i < node->exprn.noperand; ++i)
+      determine_expr_type(node->exprn.operands[i], type);
+    break;
   case '+':
   case '-':
     assert(node->exprn.noperand == 2);
@@ -2536,6 +3019,7 @@ ASTNode *build_mock_main_fn_node() {
   decl->fndecln.name = sym_form_function_id(fnid);
 
   decl->fndecln.is_extern = 0;
+  decl->fndecln.fn_attrs = 0;
 
   set_address(decl, &(SLoc){glineno_prev, gcolno_prev},
               &(SLoc){glineno, gcolno});
@@ -2556,6 +3040,7 @@ static ASTNode *build_fn_decl(typeid_t name, void *generic_types,
   p->fndecln.generic_types = generic_types;
   p->fndecln.args = *al;
   p->fndecln.is_extern = 0; // TODO: make extern real extern
+  p->fndecln.fn_attrs = 0;
 
   set_address(p, &beg, &end);
   return p;
@@ -2614,6 +3099,7 @@ ASTNode *make_for(ForStmtId id, ASTNode *listnode, ASTNode *stmts) {
   p->forn.var = id;
   p->forn.listnode = listnode;
   p->forn.body = stmts;
+  p->forn.parallel = 0;
 
   set_address(p, &listnode->begloc, &stmts->endloc);
   return p;
@@ -2628,6 +3114,20 @@ ASTNode *make_for_stmt(ForStmtId id, ASTNode *listnode, ASTNode *stmts) {
   return node;
 }
 
+ASTNode *make_parallel_for(ASTNode *forstmt) {
+  dot_emit("stmt", "parallel_for");
+
+  // the for node is wrapped in the lexical body by make_for_stmt
+  ASTNode *forn = forstmt->lnoden.stmts;
+  if (forn->forn.var.vartype) {
+    caerror(&forn->begloc, &forn->endloc, "the variable of `parallel for` can only iterate by value");
+    return forstmt;
+  }
+
+  forn->forn.parallel = 1;
+  return forstmt;
+}
+
 ASTNode *make_while(ASTNode *cond, ASTNode *whilebody) {
   dot_emit("stmt", "whileloop");
 
@@ -2639,6 +3139,90 @@ ASTNode *make_while(ASTNode *cond, ASTNode *whilebody) {
   return p;
 }
 
+CAPattern *make_capattern_literal(ASTNode *lo, ASTNode *hi, int inclusive) {
+  CAPattern *cap = capattern_new(0, hi ? PT_Range : PT_Literal, NULL);
+  cap->lo = lo;
+  cap->hi = hi;
+  cap->inclusive = inclusive;
+  cap->loc = lo->begloc;
+  return cap;
+}
+
+CAPattern *make_capattern_variant(int enumname, int variant, PatternGroup *items) {
+  CAPattern *cap = capattern_new(enumname, PT_Variant, items ? items : patterngroup_new());
+  cap->variant = variant;
+  return cap;
+}
+
+// the variable pattern naming a `const` item is the literal pattern of its value
+static void capattern_resolve_const(CAPattern *cap) {
+  switch (cap->type) {
+  case PT_Var: {
+    STEntry *entry = sym_getsym(curr_symtable, cap->name, 1);
+    if (entry && entry->sym_type == Sym_Const && !vec_size(cap->morebind)) {
+      cap->type = PT_Literal;
+      cap->lo = const_eval_use(entry);
+    }
+    break;
+  }
+  case PT_Array:
+  case PT_GenTuple:
+  case PT_Tuple:
+  case PT_Struct:
+  case PT_Variant:
+    for (int i = 0; i < cap->items->size; ++i)
+      capattern_resolve_const(cap->items->patterns[i]);
+    break;
+  default:
+    break;
+  }
+}
+
+void make_match_arm_entry(PatternGroup *pats) {
+  for (int i = 0; i < pats->size; ++i) {
+    CAPattern *cap = pats->patterns[i];
+    const char *error = capattern_check_ignore(cap);
+    if (error) {
+      caerror(&cap->loc, NULL, error);
+      return;
+    }
+
+    capattern_resolve_const(cap);
+    if (pats->size > 1 && capattern_has_binding(cap)) {
+      caerror(&cap->loc, NULL, "variable binding is not allowed in alternative patterns");
+      return;
+    }
+  }
+
+  // the variables are in the symbol table of the arm, visible in the arm body
+  void *sethandler = set_new();
+  register_capattern_symtable(pats->patterns[0], &pats->patterns[0]->loc, sethandler);
+  set_drop(sethandler);
+}
+
+ASTNode *make_match_arm(PatternGroup *pats, ASTNode *body) {
+  ASTNode *p = new_ASTNode(TTE_MatchArm);
+  p->matcharmn.pats = pats;
+  p->matcharmn.body = body;
+  set_address(p, &pats->patterns[0]->loc, &body->endloc);
+
+  ASTNode *node = make_lexical_body(p);
+  pop_symtable();
+  return node;
+}
+
+ASTNode *make_match(ASTNode *expr, void *arms) {
+  dot_emit("stmt", "match");
+
+  ASTNode *p = new_ASTNode(TTE_Match);
+  p->matchn.expr = expr;
+  p->matchn.arms = arms;
+
+  ASTNode *lastarm = (ASTNode *)vec_at(arms, vec_size(arms) - 1);
+  set_address(p, &expr->begloc, &lastarm->endloc);
+  return p;
+}
+
 ASTNode *new_ifstmt_node() {
   ASTNode *p = new_ASTNode(TTE_If);
   p->ifn.ncond = 0;
@@ -2697,7 +3281,7 @@ static STEntry *check_tuple_name(int id) {
   SymTable *symtable = sym_parent_or_global(curr_symtable);
   STEntry *entry = sym_getsym(symtable, type, 0);
 
-  if (entry && entry->u.datatype.tuple)
+  if (entry && entry->u.datatype.tuple == Struct_NamedTuple)
     return entry;
 
   return NULL;
@@ -2816,6 +3400,10 @@ ASTNode *make_fn_proto(FnNameInfo *name_info, ST_ArgList *arglist,
     ASTNode *defn = build_fn_define(fnname, name_info->generic_types, arglist,
                                     rettype, beg, end);
 
+    // the attributes are parsed before the prototype, see `fn_attribs_opt`
+    defn->fndefn.fn_decl->fndecln.fn_attrs = curr_fn_attrs;
+    curr_fn_attrs = 0;
+
     /*
      * fix the symbol table, when function can be defined in inner scope,
      * it should uses the parent's symbol table
@@ -2937,6 +3525,12 @@ ASTNode *make_domain_call(DomainFn *domain_fn, ASTNode *param) {
   return make_expr(FN_CALL, 2, domainnode, param);
 }
 
+// the domain without the argument list is the enum variant without fields: `E::A`
+ASTNode *make_domain_value(DomainNames *domain_names) {
+  DomainFn domain_fn = make_domainfn_domain(domain_names);
+  return make_domain_call(&domain_fn, make_expr_arglists_actual(NULL));
+}
+
 ASTNode *make_gen_tuple_expr(ASTNode *param) {
   return make_expr(TUPLE, 1, param);
 }
@@ -2951,6 +3545,10 @@ ASTNode *make_ident_expr(int id) {
     return NULL;
   }
 
+  // the use of `const` item is replaced with its value
+  if (entry->sym_type == Sym_Const)
+    return const_eval_use(entry);
+
   ASTNode *node = make_id(id, TTEId_VarUse);
   node->entry = entry;
   return node;
@@ -3023,6 +3621,67 @@ int add_tuple_member(ST_ArgList *arglist, typeid_t tid) {
   return 0;
 }
 
+static ST_ArgList s_enum_variants;
+static ST_EnumVariant s_enum_variant_values[MAX_ARGS];
+
+void enum_variants_begin() {
+  s_enum_variants.argc = 0;
+  s_enum_variants.contain_varg = 0;
+  s_enum_variants.symtable = curr_symtable;
+}
+
+/**
+ * @brief Add the variant of the enum being defined. The discriminant is
+ * the constant `value` or the previous one plus 1, the first is 0.
+ */
+int add_enum_variant(int name, typeid_t payload, ASTNode *value) {
+  SLoc stloc = {glineno, gcolno};
+  ST_ArgList *arglist = &s_enum_variants;
+  if (arglist->argc >= MAX_ARGS) {
+    caerror(&stloc, NULL, "too many enum variants '%s', max variant supports are `%d`",
+            symname_get(name), MAX_ARGS);
+    return -1;
+  }
+
+  for (int i = 0; i < arglist->argc; ++i) {
+    if (arglist->argnames[i] == name) {
+      caerror(&stloc, NULL, "enum variant `%s` already defined", symname_get(name));
+      return -1;
+    }
+  }
+
+  ST_EnumVariant *variant = &s_enum_variant_values[arglist->argc];
+  variant->payload = payload != typeid_novalue ? payload : sym_form_tuple_id(NULL, 0);
+  variant->value = arglist->argc ? s_enum_variant_values[arglist->argc - 1].value + 1 : 0;
+  if (value) {
+    ASTNode *lit = const_eval_literal(value, sym_form_type_id_from_token(I64), curr_symtable);
+    variant->value = strtoll(symname_get(lit->litn.litv.textid), NULL, 10);
+  }
+
+  arglist->argnames[arglist->argc++] = name;
+  return 0;
+}
+
+ASTNode *make_enum_type(int id, int repr) {
+  SLoc stloc = {glineno, gcolno};
+  if (s_enum_variants.argc == 0) {
+    caerror(&stloc, NULL, "enum `%s` have no variant", symname_get(id));
+    return NULL;
+  }
+
+  // the layout is decided by the variants, see catype_formalize_enum_layout
+  if (repr & ~CASA_ReprC) {
+    caerror(&stloc, NULL, "only attribute `repr(C)` can be used on enum `%s`", symname_get(id));
+    return NULL;
+  }
+
+  ASTNode *p = make_struct_type(id, &s_enum_variants, Struct_Enum, repr);
+  size_t size = sizeof(ST_EnumVariant) * s_enum_variants.argc;
+  p->entry->u.datatype.variants = (ST_EnumVariant *)malloc(size);
+  memcpy(p->entry->u.datatype.variants, s_enum_variant_values, size);
+  return p;
+}
+
 void reset_arglist_with_new_symtable() {
   SymTable *st = push_new_symtable();
   curr_arglist.argc = 0;
@@ -3041,7 +3700,7 @@ static STEntry *check_function_name(int id) {
   return NULL;
 }
 
-ASTNode *make_struct_type(int id, ST_ArgList *arglist, int tuple) {
+ASTNode *make_struct_type(int id, ST_ArgList *arglist, int tuple, int repr) {
   dot_emit("struct_type_def", "IDENT");
 
   // see make_fn_proto
@@ -3082,10 +3741,18 @@ ASTNode *make_struct_type(int id, ST_ArgList *arglist, int tuple) {
     return NULL;
   }
 
+  // the tuple fields are accessed by position, they cannot be reordered
+  if (tuple && (repr & CASA_ReprAuto)) {
+    SLoc stloc = {glineno, gcolno};
+    caerror(&stloc, NULL, "attribute `repr(auto)` cannot be used on tuple `%s`", structname);
+    return NULL;
+  }
+
   ASTNode *p = new_ASTNode(TTE_Struct);
   entry = sym_insert(curr_symtable, structtype, Sym_DataType);
   entry->u.datatype.tuple = tuple;
   entry->u.datatype.id = structtype;
+  entry->u.datatype.repr = repr;
   entry->u.datatype.idtable = curr_symtable;
   entry->u.datatype.runables.opaque = NULL;
   entry->u.datatype.members = (ST_ArgList *)malloc(sizeof(ST_ArgList));
@@ -71,6 +71,8 @@ typedef enum {
   TTE_FnDefImpl,
   TTE_Domain,
   TTE_TraitFn,
+  TTE_Match,
+  TTE_MatchArm,
   TTE_Num,
 } ASTNodeType;
 
@@ -96,6 +98,7 @@ typedef enum {
 typedef enum {
   NGT_None,
   NGT_stmt_expr,
+  NGT_static_item, /// the TTE_LetBind node of `static` item
   NGT_Num,
 } ASTNodeGrammartype;
 
@@ -131,8 +134,31 @@ typedef struct {
   struct ASTNode **operands; /// operands
 } TExprNode;
 
+/// the function attributes `#[inline]`, `#[cold]` ..., see make_attrib_fn
+typedef int CAFnAttr;
+#define CAFA_Inline 1   /// `#[inline]` or `#[inline(always)]`, always inline the function
+#define CAFA_NoInline 2 /// `#[inline(never)]`, never inline the function
+#define CAFA_Cold 4     /// `#[cold]`, the function is rarely called
+#define CAFA_Hot 8      /// `#[hot]`, the function is frequently called
+#define CAFA_MinSize 16 /// `#[minsize]`, optimize the function for size
+#define CAFA_Mask 0xff  /// the bits of the function attributes
+
+/// the struct layout attributes `#[repr(C)]`, `#[repr(packed)]` ..., they are
+/// parsed with the function attributes, see make_attrib_fn and make_attrib_check
+#define CASA_ReprC 0x100      /// `#[repr(C)]`, the natural C layout, it is the default
+#define CASA_ReprPacked 0x200 /// `#[repr(packed)]`, no padding between fields, the alignment is 1
+#define CASA_ReprAuto 0x400   /// `#[repr(auto)]`, order the fields by descending alignment
+#define CASA_ReprAlign 0x800  /// `#[repr(align(N))]`, log2(N) is stored from bit CASA_AlignShift
+#define CASA_AlignShift 16
+#define CASA_Mask 0xffff00    /// the bits of the struct layout attributes
+
+/// the global variable attributes `#[scope(global)]`, `#[thread_local]`, see make_attrib_scope
+#define CAVA_Global 1      /// `#[scope(global)]`, the variable is global in the generated main function
+#define CAVA_ThreadLocal 2 /// `#[thread_local]`, the global variable is thread local
+
 typedef struct TFnDeclNode {
   int is_extern;       /// is extern function
+  CAFnAttr fn_attrs;   /// the function attributes, bitmask of CAFA_*
   typeid_t ret;        /// specify the return type of the function, typeid_novalue stand for no return value
   typeid_t name;       /// function name subscript to sym array
   void *generic_types; /// int vector
@@ -183,6 +209,7 @@ typedef struct TTypeDef {
 
 typedef struct TRet {
   struct ASTNode *expr;
+  int become; /// when not 0, it is `become f(args)` which must be a tail call
 } TRet;
 
 typedef struct TAssign {
@@ -304,8 +331,19 @@ typedef struct TFor {
   ForStmtId var;
   struct ASTNode *listnode;
   struct ASTNode *body;
+  int parallel; /// `parallel for`, the iterations run on the thread pool of runtime
 } TFor;
 
+typedef struct TMatch {
+  struct ASTNode *expr; /// the matched expression
+  void *arms;           /// vec of the arms, each is a TTE_LexicalBody of TTE_MatchArm
+} TMatch;
+
+typedef struct TMatchArm {
+  PatternGroup *pats;   /// the alternative patterns `p1 | p2 | ...` of the arm
+  struct ASTNode *body;
+} TMatchArm;
+
 typedef struct TBox {
   struct ASTNode *expr;
 } TBox;
@@ -355,6 +393,8 @@ typedef struct ASTNode {
     TLexicalBody lnoden; /// @brief lexical scope body
     TLoop loopn;         /// @brief loop node
     TFor forn;           /// @brief for node
+    TMatch matchn;       /// @brief match statement
+    TMatchArm matcharmn; /// @brief arm of match statement
     TBox boxn;           /// @brief box node
     TDrop dropn;         /// @brief drop node
     TLetBind letbindn;   /// @brief the binding operation for let
@@ -401,6 +441,7 @@ void free_symtable(SymTable *symtable);
 int add_fn_args(ST_ArgList *arglist, SymTable *st, CAVariable *var);
 int add_fn_args_actual(SymTable *st, ASTNode *arg);
 ASTNode *new_ASTNode(ASTNodeType nodetype);
+void set_address(ASTNode *node, const SLoc *first, const SLoc *last);
 void free_ASTNode(ASTNode *node);
 const char *sym_form_label_name(const char *name);
 const char *sym_form_type_name(const char *name);
@@ -430,6 +471,10 @@ const char *get_node_name_or_value(ASTNode *node);
 ASTNode *build_mock_main_fn_node();
 
 int make_attrib_scope(int attrfn, int attrparam);
+int make_attrib_fn(int attrfn, int attrparam);
+int make_attrib_fn_arg(int attrfn, int attrparam, LitBuffer *arg);
+int make_attrib_fn_list(int attrs, int attr);
+int make_attrib_check(int attrs, int isstruct);
 int make_program();
 void make_paragraphs(ASTNode *paragraph);
 ASTNode *make_fn_def(ASTNode *proto, ASTNode *body);
@@ -446,10 +491,12 @@ ASTNode *make_stmt_print_datatype(typeid_t tid);
 ASTNode *make_stmt_expr(ASTNode *expr);
 ASTNode *make_stmt_ret_expr(ASTNode *expr);
 ASTNode *make_stmt_ret();
+ASTNode *make_stmt_become(ASTNode *expr);
 ASTNode *make_stmtexpr_list_block(ASTNode *exprblockbody);
 ASTNode *make_stmtexpr_list(ASTNode *stmts, ASTNode *expr);
 typeid_t make_pointer_type(typeid_t datatype);
 typeid_t make_array_type(typeid_t type, LitBuffer *size);
+typeid_t make_array_type_const(typeid_t type, int constname);
 typeid_t make_tuple_type(ST_ArgList *arglist);
 STEntry *make_type_def_entry(int id, typeid_t type, SymTable *symtable, SLoc *beg, SLoc *end);
 ASTNode *make_type_def(int name, typeid_t type);
@@ -462,8 +509,10 @@ ASTNode *make_empty();
 ASTNode *make_expr(int op, int noperands, ...);
 ASTNode *make_expr_arglists_actual(ST_ArgListActual *al);
 ASTNode *make_id(int id, IdType idtype);
-ASTNode *make_global_vardef(CAVariable *var, ASTNode *exprn, int global);
+ASTNode *make_global_vardef(CAVariable *var, ASTNode *exprn, int attrs);
 ASTNode *make_let_stmt(CAPattern *cap, ASTNode *exprn);
+ASTNode *make_const_item(int name, typeid_t type, ASTNode *exprn);
+ASTNode *make_static_item(int name, typeid_t type, ASTNode *exprn);
 ASTNode *make_vardef_zero_value(VarInitType init_type);
 ASTNode *make_assign(LeftValueId *lvid, ASTNode *exprn);
 ASTNode *make_assign_op(LeftValueId *lvid, int op, ASTNode *exprn);
@@ -473,6 +522,7 @@ ASTNode *make_literal(CALiteral *litv);
 ASTNode *make_general_range(GeneralRange *range);
 ASTNode *make_array_def(CAArrayExpr expr);
 CAArrayExpr make_array_def_fill(ASTNode *expr, CALiteral *literal);
+CAArrayExpr make_array_def_fill_const(ASTNode *expr, int constname);
 ASTNode *make_struct_expr(CAStructExpr expr);
 ASTNode *make_tuple_expr(CAStructExpr expr);
 ASTNode *make_arrayitem_right(ArrayItem ai);
@@ -485,7 +535,13 @@ ASTNode *make_loop(ASTNode *loopbody);
 void make_for_var_entry(int id);
 ASTNode *make_for(ForStmtId id, ASTNode *listnode, ASTNode *stmts);
 ASTNode *make_for_stmt(ForStmtId id, ASTNode *listnode, ASTNode *stmts);
+ASTNode *make_parallel_for(ASTNode *forstmt);
 ASTNode *make_while(ASTNode *cond, ASTNode *whilebody);
+CAPattern *make_capattern_literal(ASTNode *lo, ASTNode *hi, int inclusive);
+CAPattern *make_capattern_variant(int enumname, int variant, PatternGroup *items);
+void make_match_arm_entry(PatternGroup *pats);
+ASTNode *make_match_arm(PatternGroup *pats, ASTNode *body);
+ASTNode *make_match(ASTNode *expr, void *arms);
 ASTNode *new_ifstmt_node();
 ASTNode *make_ifpart(ASTNode *p, ASTNode *cond, ASTNode *body);
 ASTNode *make_elsepart(ASTNode *p, ASTNode *body);
@@ -499,6 +555,7 @@ DomainAs make_domain_as(DomainNames *main, DomainNames *as, int fnname);
 DomainFn make_domainfn_domain(DomainNames *domain_names);
 DomainFn make_domainfn_domainas(DomainAs *domainas);
 ASTNode *make_domain_call(DomainFn *domain_fn, ASTNode *param);
+ASTNode *make_domain_value(DomainNames *domain_names);
 ASTNode *make_gen_tuple_expr(ASTNode *param);
 ASTNode *make_ident_expr(int id);
 ASTNode *make_uminus_expr(ASTNode *expr);
@@ -528,7 +585,13 @@ void put_astnode_into_list(ASTNode *stmt, int begin);
 int add_struct_member(ST_ArgList *arglist, SymTable *st, CAVariable *var);
 int add_tuple_member(ST_ArgList *arglist, typeid_t tid);
 void reset_arglist_with_new_symtable();
-ASTNode *make_struct_type(int id, ST_ArgList *arglist, int tuple);
+ASTNode *make_struct_type(int id, ST_ArgList *arglist, int tuple, int repr);
+void enum_variants_begin();
+int add_enum_variant(int name, typeid_t payload, ASTNode *value);
+ASTNode *make_enum_type(int id, int repr);
+
+/// get the enum type entry when `call` (FN_CALL node) constructs the enum variant `E::A(...)`, `variant` receives the variant position
+STEntry *enum_variant_lookup(ASTNode *call, int *variant);
 
 //void push_lexical_body();
 //void pop_lexical_body();
@@ -12,9 +12,651 @@
 
 #include "ca_runtime.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define RT_LIKELY(x) __builtin_expect(!!(x), 1)
+#define RT_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define RT_COLD __attribute__((noinline, cold))
+#else
+#define RT_LIKELY(x) (x)
+#define RT_UNLIKELY(x) (x)
+#define RT_COLD
+#endif
+
 struct Slice {};
 
 #ifdef TEST_RUNTIME
 int rt_add(int a, int b) { return a + b; }
 int rt_sub(int a, int b) { return a - b; }
 #endif
+
+static void *rt_xrealloc(void *p, size_t size) {
+  void *np = realloc(p, size);
+  if (!np) {
+    fprintf(stderr, "ca runtime: out of memory when allocating %zu bytes\n", size);
+    abort();
+  }
+
+  return np;
+}
+
+static void *rt_xcalloc(size_t n, size_t size) {
+  void *p = calloc(n, size);
+  if (!p) {
+    fprintf(stderr, "ca runtime: out of memory when allocating %zu bytes\n", n * size);
+    abort();
+  }
+
+  return p;
+}
+
+static RT_COLD void rt_index_out_of_range(uint64_t index, uint64_t len) {
+  fprintf(stderr, "ca runtime: index out of range: the len is %llu but the index is %llu\n",
+	  (unsigned long long)len, (unsigned long long)index);
+  abort();
+}
+
+/*
+ * The integer to decimal conversion, convert 2 digits each time with a lookup
+ * table, the digits are written backward from `end`, return the start position
+ */
+static const char rt_digits2[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+static char *rt_u64_to_dec(char *end, uint64_t v) {
+  char *p = end;
+  while (v >= 100) {
+    unsigned idx = (unsigned)(v % 100) * 2;
+    v /= 100;
+    p -= 2;
+    p[0] = rt_digits2[idx];
+    p[1] = rt_digits2[idx + 1];
+  }
+
+  if (v >= 10) {
+    unsigned idx = (unsigned)v * 2;
+    p -= 2;
+    p[0] = rt_digits2[idx];
+    p[1] = rt_digits2[idx + 1];
+  } else {
+    *--p = (char)('0' + v);
+  }
+
+  return p;
+}
+
+static char *rt_i64_to_dec(char *end, int64_t v) {
+  // convert with unsigned value to make INT64_MIN work
+  uint64_t uv = v < 0 ? (uint64_t)0 - (uint64_t)v : (uint64_t)v;
+  char *p = rt_u64_to_dec(end, uv);
+  if (v < 0)
+    *--p = '-';
+
+  return p;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// growable vector
+////////////////////////////////////////////////////////////////////////////////
+
+void ca_rt_vec_init(CAVec *v, uint64_t elemsize, uint64_t cap) {
+  v->data = NULL;
+  v->len = 0;
+  v->cap = 0;
+  v->elemsize = elemsize ? elemsize : 1;
+  if (cap)
+    ca_rt_vec_reserve(v, cap);
+}
+
+void ca_rt_vec_free(CAVec *v) {
+  free(v->data);
+  v->data = NULL;
+  v->len = 0;
+  v->cap = 0;
+}
+
+void ca_rt_vec_reserve(CAVec *v, uint64_t cap) {
+  if (cap <= v->cap)
+    return;
+
+  v->data = (uint8_t *)rt_xrealloc(v->data, cap * v->elemsize);
+  v->cap = cap;
+}
+
+void ca_rt_vec_clear(CAVec *v) {
+  v->len = 0;
+}
+
+// out of the push fast path, doubling the capacity to make push amortized O(1)
+static RT_COLD void rt_vec_grow(CAVec *v) {
+  uint64_t cap = v->cap ? v->cap * 2 : (v->elemsize >= 64 ? 4 : 16);
+  ca_rt_vec_reserve(v, cap);
+}
+
+void ca_rt_vec_push(CAVec *v, const void *elem) {
+  if (RT_UNLIKELY(v->len == v->cap))
+    rt_vec_grow(v);
+
+  memcpy(v->data + v->len * v->elemsize, elem, v->elemsize);
+  v->len += 1;
+}
+
+int32_t ca_rt_vec_pop(CAVec *v, void *elem) {
+  if (v->len == 0)
+    return 0;
+
+  v->len -= 1;
+  if (elem)
+    memcpy(elem, v->data + v->len * v->elemsize, v->elemsize);
+
+  return 1;
+}
+
+void *ca_rt_vec_at(CAVec *v, uint64_t index) {
+  if (RT_UNLIKELY(index >= v->len))
+    rt_index_out_of_range(index, v->len);
+
+  return v->data + index * v->elemsize;
+}
+
+uint64_t ca_rt_vec_len(CAVec *v) {
+  return v->len;
+}
+
+void ca_rt_vec_push_i64(CAVec *v, int64_t elem) {
+  if (RT_UNLIKELY(v->len == v->cap))
+    rt_vec_grow(v);
+
+  ((int64_t *)v->data)[v->len++] = elem;
+}
+
+int64_t ca_rt_vec_get_i64(CAVec *v, uint64_t index) {
+  if (RT_UNLIKELY(index >= v->len))
+    rt_index_out_of_range(index, v->len);
+
+  return ((int64_t *)v->data)[index];
+}
+
+void ca_rt_vec_set_i64(CAVec *v, uint64_t index, int64_t elem) {
+  if (RT_UNLIKELY(index >= v->len))
+    rt_index_out_of_range(index, v->len);
+
+  ((int64_t *)v->data)[index] = elem;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// open addressing hash map
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Control byte of each slot:
+ * - 0b1000_0000: empty slot
+ * - 0b1111_1110: deleted slot (tombstone)
+ * - 0b0xxx_xxxx: full slot, the low 7 bits is H2 (low 7 bits of the hash)
+ *
+ * The hash position H1 (the remaining high bits of the hash) selects the first
+ * group to probe, the groups are probed in triangular sequence which visits
+ * every group when group number is a power of 2. In a group the H2 is compared
+ * against all the control bytes at once and only the matched slots compare
+ * the keys, and an empty slot in the group stops the probing.
+ */
+#define RT_CTRL_EMPTY   ((uint8_t)0x80)
+#define RT_CTRL_DELETED ((uint8_t)0xFE)
+
+#if defined(__SSE2__)
+#define RT_GROUP_WIDTH 16
+typedef uint32_t rt_bitmask_t;
+
+static inline rt_bitmask_t rt_group_match(const uint8_t *ctrl, uint8_t h2) {
+  __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+  return (rt_bitmask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((char)h2), group));
+}
+
+static inline rt_bitmask_t rt_group_match_empty(const uint8_t *ctrl) {
+  __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+  return (rt_bitmask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((char)RT_CTRL_EMPTY), group));
+}
+
+static inline rt_bitmask_t rt_group_match_empty_or_deleted(const uint8_t *ctrl) {
+  // only empty and deleted control bytes have the sign bit
+  __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+  return (rt_bitmask_t)_mm_movemask_epi8(group);
+}
+
+// slot offset inside group of the lowest bit in mask
+#define RT_MASK_LOWEST(mask) ((uint64_t)__builtin_ctz(mask))
+#else // portable version: probe 8 control bytes in a machine word
+#define RT_GROUP_WIDTH 8
+typedef uint64_t rt_bitmask_t;
+
+#define RT_LSBS 0x0101010101010101ULL
+#define RT_MSBS 0x8080808080808080ULL
+
+static inline uint64_t rt_group_load(const uint8_t *ctrl) {
+  uint64_t group;
+  memcpy(&group, ctrl, sizeof(group));
+  return group;
+}
+
+// may have false positive, it is fine because the key is compared later
+static inline rt_bitmask_t rt_group_match(const uint8_t *ctrl, uint8_t h2) {
+  uint64_t x = rt_group_load(ctrl) ^ (RT_LSBS * h2);
+  return (x - RT_LSBS) & ~x & RT_MSBS;
+}
+
+static inline rt_bitmask_t rt_group_match_empty(const uint8_t *ctrl) {
+  uint64_t group = rt_group_load(ctrl);
+  return group & ~(group << 6) & RT_MSBS;
+}
+
+static inline rt_bitmask_t rt_group_match_empty_or_deleted(const uint8_t *ctrl) {
+  return rt_group_load(ctrl) & RT_MSBS;
+}
+
+// byte order of the word is little endian on all the supported targets
+#define RT_MASK_LOWEST(mask) ((uint64_t)__builtin_ctzll(mask) >> 3)
+#endif
+
+static inline uint64_t rt_hash_u64(uint64_t key) {
+  // finalizer of murmur3, all input bits affect all output bits
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return key;
+}
+
+#define RT_H1(hash) ((hash) >> 7)
+#define RT_H2(hash) ((uint8_t)((hash) & 0x7f))
+
+static uint64_t rt_map_capacity_to_growth(uint64_t cap) {
+  // max load factor 7/8
+  return cap - cap / 8;
+}
+
+static void rt_map_alloc(CAHashMap *m, uint64_t cap) {
+  m->ctrl = (uint8_t *)rt_xrealloc(NULL, cap);
+  memset(m->ctrl, RT_CTRL_EMPTY, cap);
+  m->keys = (uint64_t *)rt_xcalloc(cap, sizeof(uint64_t));
+  m->values = (uint64_t *)rt_xcalloc(cap, sizeof(uint64_t));
+  m->cap = cap;
+  m->len = 0;
+  m->growth_left = rt_map_capacity_to_growth(cap);
+}
+
+void ca_rt_map_init(CAHashMap *m, uint64_t cap) {
+  uint64_t realcap = RT_GROUP_WIDTH;
+  // make the capacity can hold `cap` elements without rehash
+  while (rt_map_capacity_to_growth(realcap) < cap)
+    realcap *= 2;
+
+  rt_map_alloc(m, realcap);
+}
+
+void ca_rt_map_free(CAHashMap *m) {
+  free(m->ctrl);
+  free(m->keys);
+  free(m->values);
+  m->ctrl = NULL;
+  m->keys = NULL;
+  m->values = NULL;
+  m->cap = 0;
+  m->len = 0;
+  m->growth_left = 0;
+}
+
+void ca_rt_map_clear(CAHashMap *m) {
+  memset(m->ctrl, RT_CTRL_EMPTY, m->cap);
+  m->len = 0;
+  m->growth_left = rt_map_capacity_to_growth(m->cap);
+}
+
+// return the slot position of the key or -1 when not found
+static inline int64_t rt_map_find(CAHashMap *m, uint64_t key, uint64_t hash) {
+  uint64_t groupmask = m->cap / RT_GROUP_WIDTH - 1;
+  uint64_t group = RT_H1(hash) & groupmask;
+  uint8_t h2 = RT_H2(hash);
+
+  for (uint64_t step = 1; ; ++step) {
+    const uint8_t *ctrl = m->ctrl + group * RT_GROUP_WIDTH;
+    rt_bitmask_t match = rt_group_match(ctrl, h2);
+    while (match) {
+      uint64_t pos = group * RT_GROUP_WIDTH + RT_MASK_LOWEST(match);
+      if (RT_LIKELY(m->keys[pos] == key))
+	return (int64_t)pos;
+
+      match &= match - 1;
+    }
+
+    if (RT_LIKELY(rt_group_match_empty(ctrl)))
+      return -1;
+
+    // all groups are visited, it only happen when no empty slot any more
+    if (step > groupmask)
+      return -1;
+
+    group = (group + step) & groupmask;
+  }
+}
+
+// find the first empty or deleted slot in the probe sequence
+static inline uint64_t rt_map_find_insert_slot(CAHashMap *m, uint64_t hash) {
+  uint64_t groupmask = m->cap / RT_GROUP_WIDTH - 1;
+  uint64_t group = RT_H1(hash) & groupmask;
+
+  for (uint64_t step = 1; ; ++step) {
+    const uint8_t *ctrl = m->ctrl + group * RT_GROUP_WIDTH;
+    rt_bitmask_t mask = rt_group_match_empty_or_deleted(ctrl);
+    if (RT_LIKELY(mask))
+      return group * RT_GROUP_WIDTH + RT_MASK_LOWEST(mask);
+
+    group = (group + step) & groupmask;
+  }
+}
+
+static RT_COLD void rt_map_rehash(CAHashMap *m) {
+  CAHashMap old = *m;
+
+  // when it is full of tombstones, rehash into the same size
+  uint64_t newcap = old.len * 2 >= rt_map_capacity_to_growth(old.cap) ? old.cap * 2 : old.cap;
+  rt_map_alloc(m, newcap);
+
+  for (uint64_t i = 0; i < old.cap; ++i) {
+    if (old.ctrl[i] & 0x80)
+      continue;
+
+    uint64_t hash = rt_hash_u64(old.keys[i]);
+    uint64_t pos = rt_map_find_insert_slot(m, hash);
+    m->ctrl[pos] = RT_H2(hash);
+    m->keys[pos] = old.keys[i];
+    m->values[pos] = old.values[i];
+  }
+
+  m->len = old.len;
+  m->growth_left -= old.len;
+
+  free(old.ctrl);
+  free(old.keys);
+  free(old.values);
+}
+
+int32_t ca_rt_map_insert(CAHashMap *m, uint64_t key, uint64_t value) {
+  if (RT_UNLIKELY(!m->cap))
+    ca_rt_map_init(m, 0);
+
+  uint64_t hash = rt_hash_u64(key);
+  int64_t found = rt_map_find(m, key, hash);
+  if (found >= 0) {
+    m->values[found] = value;
+    return 0;
+  }
+
+  uint64_t pos = rt_map_find_insert_slot(m, hash);
+  // reusing a tombstone does not consume the growth
+  if (RT_UNLIKELY(m->growth_left == 0 && m->ctrl[pos] == RT_CTRL_EMPTY)) {
+    rt_map_rehash(m);
+    pos = rt_map_find_insert_slot(m, hash);
+  }
+
+  if (m->ctrl[pos] == RT_CTRL_EMPTY)
+    m->growth_left -= 1;
+
+  m->ctrl[pos] = RT_H2(hash);
+  m->keys[pos] = key;
+  m->values[pos] = value;
+  m->len += 1;
+  return 1;
+}
+
+int32_t ca_rt_map_get(CAHashMap *m, uint64_t key, uint64_t *value) {
+  if (RT_UNLIKELY(!m->cap))
+    return 0;
+
+  int64_t pos = rt_map_find(m, key, rt_hash_u64(key));
+  if (pos < 0)
+    return 0;
+
+  if (value)
+    *value = m->values[pos];
+
+  return 1;
+}
+
+uint64_t ca_rt_map_get_or(CAHashMap *m, uint64_t key, uint64_t defval) {
+  uint64_t value = defval;
+  ca_rt_map_get(m, key, &value);
+  return value;
+}
+
+int32_t ca_rt_map_contains(CAHashMap *m, uint64_t key) {
+  return ca_rt_map_get(m, key, NULL);
+}
+
+int32_t ca_rt_map_remove(CAHashMap *m, uint64_t key) {
+  if (RT_UNLIKELY(!m->cap))
+    return 0;
+
+  int64_t pos = rt_map_find(m, key, rt_hash_u64(key));
+  if (pos < 0)
+    return 0;
+
+  /*
+   * When the group still has an empty slot, no probe sequence ever passed
+   * through this group, so the slot can become empty directly
+   */
+  const uint8_t *ctrl = m->ctrl + (pos / RT_GROUP_WIDTH) * RT_GROUP_WIDTH;
+  if (rt_group_match_empty(ctrl)) {
+    m->ctrl[pos] = RT_CTRL_EMPTY;
+    m->growth_left += 1;
+  } else {
+    m->ctrl[pos] = RT_CTRL_DELETED;
+  }
+
+  m->len -= 1;
+  return 1;
+}
+
+uint64_t ca_rt_map_len(CAHashMap *m) {
+  return m->len;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// string builder
+////////////////////////////////////////////////////////////////////////////////
+
+void ca_rt_strbuf_init(CAStrBuf *sb, uint64_t cap) {
+  if (cap < 16)
+    cap = 16;
+
+  sb->data = (char *)rt_xrealloc(NULL, cap);
+  sb->data[0] = '\0';
+  sb->len = 0;
+  sb->cap = cap;
+}
+
+void ca_rt_strbuf_free(CAStrBuf *sb) {
+  free(sb->data);
+  sb->data = NULL;
+  sb->len = 0;
+  sb->cap = 0;
+}
+
+void ca_rt_strbuf_clear(CAStrBuf *sb) {
+  sb->len = 0;
+  if (sb->data)
+    sb->data[0] = '\0';
+}
+
+// make sure `more` bytes and the tail '\0' can be appended
+static RT_COLD void rt_strbuf_grow(CAStrBuf *sb, uint64_t more) {
+  uint64_t cap = sb->cap ? sb->cap * 2 : 16;
+  while (cap < sb->len + more + 1)
+    cap *= 2;
+
+  sb->data = (char *)rt_xrealloc(sb->data, cap);
+  sb->cap = cap;
+}
+
+static inline char *rt_strbuf_reserve(CAStrBuf *sb, uint64_t more) {
+  if (RT_UNLIKELY(sb->len + more + 1 > sb->cap))
+    rt_strbuf_grow(sb, more);
+
+  return sb->data + sb->len;
+}
+
+void ca_rt_strbuf_push_char(CAStrBuf *sb, char c) {
+  char *p = rt_strbuf_reserve(sb, 1);
+  p[0] = c;
+  p[1] = '\0';
+  sb->len += 1;
+}
+
+void ca_rt_strbuf_push_bytes(CAStrBuf *sb, const uint8_t *s, uint64_t len) {
+  char *p = rt_strbuf_reserve(sb, len);
+  memcpy(p, s, len);
+  p[len] = '\0';
+  sb->len += len;
+}
+
+void ca_rt_strbuf_push_str(CAStrBuf *sb, const char *s) {
+  ca_rt_strbuf_push_bytes(sb, (const uint8_t *)s, strlen(s));
+}
+
+void ca_rt_strbuf_push_i64(CAStrBuf *sb, int64_t v) {
+  char buf[24];
+  char *end = buf + sizeof(buf);
+  char *start = rt_i64_to_dec(end, v);
+  ca_rt_strbuf_push_bytes(sb, (const uint8_t *)start, (uint64_t)(end - start));
+}
+
+void ca_rt_strbuf_push_u64(CAStrBuf *sb, uint64_t v) {
+  char buf[24];
+  char *end = buf + sizeof(buf);
+  char *start = rt_u64_to_dec(end, v);
+  ca_rt_strbuf_push_bytes(sb, (const uint8_t *)start, (uint64_t)(end - start));
+}
+
+void ca_rt_strbuf_push_f64(CAStrBuf *sb, double v) {
+  char buf[64];
+  int len = snprintf(buf, sizeof(buf), "%f", v);
+  ca_rt_strbuf_push_bytes(sb, (const uint8_t *)buf, (uint64_t)len);
+}
+
+const char *ca_rt_strbuf_cstr(CAStrBuf *sb) {
+  if (!sb->data)
+    ca_rt_strbuf_init(sb, 0);
+
+  return sb->data;
+}
+
+uint64_t ca_rt_strbuf_len(CAStrBuf *sb) {
+  return sb->len;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// output used by `print` statement
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * The output goes into the buffer of the `stdout` stream directly, the CA
+ * programs often mix the `print` statement with `extern fn printf` and `puts`,
+ * with the same buffer the output keeps the order. The values are converted
+ * without parsing any format string at runtime, and the buffer is flushed by
+ * the C library when exiting or by `ca_rt_flush`. Each value is written by one
+ * locking call, so the threads spawned by the program can print concurrently.
+ */
+
+void ca_rt_write_i64(int64_t v) {
+  char buf[24];
+  char *end = buf + sizeof(buf);
+  char *start = rt_i64_to_dec(end, v);
+  fwrite(start, 1, (size_t)(end - start), stdout);
+}
+
+void ca_rt_write_u64(uint64_t v) {
+  char buf[24];
+  char *end = buf + sizeof(buf);
+  char *start = rt_u64_to_dec(end, v);
+  fwrite(start, 1, (size_t)(end - start), stdout);
+}
+
+void ca_rt_write_f64(double v) {
+  // keep the same output with "%f" format, max double have 309 integer digits
+  char buf[512];
+  int len = snprintf(buf, sizeof(buf), "%f", v);
+  fwrite(buf, 1, (size_t)len, stdout);
+}
+
+void ca_rt_write_char(char c) {
+  putc(c, stdout);
+}
+
+void ca_rt_write_str(const char *s) {
+  fwrite(s, 1, strlen(s), stdout);
+}
+
+void ca_rt_write_bytes(const uint8_t *s, uint64_t len) {
+  fwrite(s, 1, (size_t)len, stdout);
+}
+
+void ca_rt_write_ptr(const void *p) {
+  // keep the same output with "%p" format of glibc
+  if (!p) {
+    ca_rt_write_str("(nil)");
+    return;
+  }
+
+  static const char hexdigits[] = "0123456789abcdef";
+  char buf[24];
+  char *end = buf + sizeof(buf);
+  char *start = end;
+  uintptr_t v = (uintptr_t)p;
+  while (v) {
+    *--start = hexdigits[v & 0xf];
+    v >>= 4;
+  }
+
+  *--start = 'x';
+  *--start = '0';
+  fwrite(start, 1, (size_t)(end - start), stdout);
+}
+
+void ca_rt_flush(void) {
+  fflush(stdout);
+}
+
+/*
+ * The failure path of the bounds checking code, the printed output is flushed
+ * before the message, so it appears in order when both go to the terminal.
+ * It exits with the same code as a rust panic instead of abort, no core file.
+ */
+RT_COLD void ca_rt_bounds_fail(int64_t index, int64_t len, int64_t row) {
+  fflush(stdout);
+  fprintf(stderr, "ca runtime: index out of bounds: the len is %lld but the index is %lld, line: %lld\n",
+	  (long long)len, (long long)index, (long long)row);
+  exit(101);
+}
+
+RT_COLD void ca_rt_overflow_fail(int32_t op, int64_t row) {
+  const char *opname = op == '+' ? "add" : (op == '-' ? "subtract" : "multiply");
+  fflush(stdout);
+  fprintf(stderr, "ca runtime: attempt to %s with overflow, line: %lld\n", opname, (long long)row);
+  exit(101);
+}
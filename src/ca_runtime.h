@@ -12,11 +12,26 @@
 
 /**
  * @file for runtime functionalities
+ *
+ * The runtime functions are exported to CA code through `extern fn`
+ * declarations, and to the JIT through `init_runtime_symbols`. All the data
+ * structures here only use primitive fields, so a CA program can declare the
+ * same layout with a `struct` and pass a pointer of it to the functions, e.g.:
+ *
+ * ```
+ * struct CAVec { data: *u8, len: u64, cap: u64, elemsize: u64 }
+ * extern fn ca_rt_vec_init(v: *CAVec, elemsize: u64, cap: u64);
+ * ```
+ *
+ * Boolean results are returned as `i32` (0 or 1) to keep the C ABI between
+ * `bool` of C and the `i1` of CA simple.
  */
 
 #ifndef __ca_runtime_h__
 #define __ca_runtime_h__
 
+#include <stdint.h>
+
 #include "ca_types.h"
 
 //#define TEST_RUNTIME // for test runtime functions in when print
@@ -30,6 +45,159 @@ int rt_add(int a, int b);
 int rt_sub(int a, int b);
 #endif
 
+/// growable vector, the capacity doubles when full, so push is amortized O(1)
+typedef struct CAVec {
+  uint8_t *data;
+  uint64_t len;
+  uint64_t cap;
+  uint64_t elemsize;
+} CAVec;
+
+void ca_rt_vec_init(CAVec *v, uint64_t elemsize, uint64_t cap);
+void ca_rt_vec_free(CAVec *v);
+void ca_rt_vec_reserve(CAVec *v, uint64_t cap);
+void ca_rt_vec_clear(CAVec *v);
+void ca_rt_vec_push(CAVec *v, const void *elem);
+int32_t ca_rt_vec_pop(CAVec *v, void *elem);
+void *ca_rt_vec_at(CAVec *v, uint64_t index);
+uint64_t ca_rt_vec_len(CAVec *v);
+
+/// fast paths for vector with 8 bytes elements, no address taken of the element
+void ca_rt_vec_push_i64(CAVec *v, int64_t elem);
+int64_t ca_rt_vec_get_i64(CAVec *v, uint64_t index);
+void ca_rt_vec_set_i64(CAVec *v, uint64_t index, int64_t elem);
+
+/**
+ * Open addressing hash map from u64 key to u64 value. The slots are organized
+ * into groups, each slot has a control byte holding 7 bits of the hash, so a
+ * whole group is probed at once (SSE2 when available, otherwise 8 bytes of a
+ * machine word) before any key is compared.
+ */
+typedef struct CAHashMap {
+  uint8_t *ctrl;
+  uint64_t *keys;
+  uint64_t *values;
+  uint64_t cap;         /// slot number, power of 2 and multiple of group width
+  uint64_t len;         /// number of live elements
+  uint64_t growth_left; /// number of elements can be inserted before rehash
+} CAHashMap;
+
+void ca_rt_map_init(CAHashMap *m, uint64_t cap);
+void ca_rt_map_free(CAHashMap *m);
+void ca_rt_map_clear(CAHashMap *m);
+int32_t ca_rt_map_insert(CAHashMap *m, uint64_t key, uint64_t value);
+int32_t ca_rt_map_get(CAHashMap *m, uint64_t key, uint64_t *value);
+uint64_t ca_rt_map_get_or(CAHashMap *m, uint64_t key, uint64_t defval);
+int32_t ca_rt_map_contains(CAHashMap *m, uint64_t key);
+int32_t ca_rt_map_remove(CAHashMap *m, uint64_t key);
+uint64_t ca_rt_map_len(CAHashMap *m);
+
+/// string builder, the content is always kept '\0' terminated
+typedef struct CAStrBuf {
+  char *data;
+  uint64_t len;
+  uint64_t cap;
+} CAStrBuf;
+
+void ca_rt_strbuf_init(CAStrBuf *sb, uint64_t cap);
+void ca_rt_strbuf_free(CAStrBuf *sb);
+void ca_rt_strbuf_clear(CAStrBuf *sb);
+void ca_rt_strbuf_push_char(CAStrBuf *sb, char c);
+void ca_rt_strbuf_push_str(CAStrBuf *sb, const char *s);
+void ca_rt_strbuf_push_bytes(CAStrBuf *sb, const uint8_t *s, uint64_t len);
+void ca_rt_strbuf_push_i64(CAStrBuf *sb, int64_t v);
+void ca_rt_strbuf_push_u64(CAStrBuf *sb, uint64_t v);
+void ca_rt_strbuf_push_f64(CAStrBuf *sb, double v);
+const char *ca_rt_strbuf_cstr(CAStrBuf *sb);
+uint64_t ca_rt_strbuf_len(CAStrBuf *sb);
+
+/**
+ * Byte slice, it has the same layout with the CA slice of `u8` (see
+ * `slice_create_catype`), the `len` is the byte number.
+ */
+typedef struct CAByteSlice {
+  uint8_t *ptr;
+  uint64_t len;
+} CAByteSlice;
+
+/// iterate lines over a byte slice, e.g. a mapped file view
+typedef struct CALineIter {
+  const uint8_t *ptr;
+  uint64_t len;
+  uint64_t pos;
+} CALineIter;
+
+/// buffered reader for the input which cannot be mapped, e.g. pipe or stdin
+typedef struct CAReader {
+  int64_t fd;
+  uint8_t *buf;
+  uint64_t cap;
+  uint64_t start;
+  uint64_t end;
+  int64_t eof;
+} CAReader;
+
+/// map the whole file read only, `view` is empty when the file is empty
+int32_t ca_rt_file_map(const char *path, CAByteSlice *view);
+void ca_rt_file_unmap(CAByteSlice *view);
+
+/// the line returned excludes the line ending "\n" or "\r\n"
+void ca_rt_lines_init(CALineIter *it, const uint8_t *ptr, uint64_t len);
+int32_t ca_rt_lines_next(CALineIter *it, CAByteSlice *line);
+
+int32_t ca_rt_reader_open(CAReader *r, const char *path);
+int32_t ca_rt_reader_stdin(CAReader *r);
+void ca_rt_reader_close(CAReader *r);
+/// the line is valid until next call of the reader
+int32_t ca_rt_reader_next_line(CAReader *r, CAByteSlice *line);
+
+/// parse the whole byte range as a number, return 0 when it is not a number
+int32_t ca_rt_parse_i64(const uint8_t *ptr, uint64_t len, int64_t *out);
+int32_t ca_rt_parse_u64(const uint8_t *ptr, uint64_t len, uint64_t *out);
+int32_t ca_rt_parse_f64(const uint8_t *ptr, uint64_t len, double *out);
+
+/// skip the leading spaces, parse a number and advance the slice after it
+int32_t ca_rt_scan_i64(CAByteSlice *s, int64_t *out);
+int32_t ca_rt_scan_u64(CAByteSlice *s, uint64_t *out);
+int32_t ca_rt_scan_f64(CAByteSlice *s, double *out);
+
+/// output functions used by the `print` statement, see `genv.rt_print`
+void ca_rt_write_i64(int64_t v);
+void ca_rt_write_u64(uint64_t v);
+void ca_rt_write_f64(double v);
+void ca_rt_write_char(char c);
+void ca_rt_write_str(const char *s);
+void ca_rt_write_bytes(const uint8_t *s, uint64_t len);
+void ca_rt_write_ptr(const void *p);
+void ca_rt_flush(void);
+
+/**
+ * Native threads, the handle returned by `ca_rt_spawn` should be joined once.
+ * The threads are registered into the garbage collector, so the memory of
+ * `box` can be shared between threads.
+ */
+uint64_t ca_rt_spawn(void (*fn)(void *), void *arg);
+void ca_rt_join(uint64_t handle);
+
+/// the threads used by `ca_rt_parallel_for`, from `CA_NUM_THREADS` environment variable or the online cores
+int64_t ca_rt_thread_count(void);
+
+/**
+ * Run `body(lo, hi, env)` over the chunks of [begin, end) on the work stealing
+ * thread pool and return when all are done, the chunk size is not larger than
+ * `grain`, it is decided by the thread count when `grain` is 0. It is the
+ * lowering of the `parallel for` statement. The bounds are compared as signed,
+ * the u64 range is biased into the signed order by the generated code.
+ */
+void ca_rt_parallel_for(int64_t begin, int64_t end, int64_t grain,
+			void (*body)(int64_t, int64_t, void *), void *env);
+
+/// called by the code generated with `-bounds-check` when the index is out of bounds, never returns
+void ca_rt_bounds_fail(int64_t index, int64_t len, int64_t row);
+
+/// called by the code generated with `-overflow-check` when `op` (`+`, `-` or `*`) overflows, never returns
+void ca_rt_overflow_fail(int32_t op, int64_t row);
+
 #ifdef __cplusplus
 END_EXTERN_C
 #endif
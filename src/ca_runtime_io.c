@@ -0,0 +1,445 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+/**
+ * @file runtime input functionalities: memory mapped file view, line
+ * iterator, buffered reader and number parsing from byte slices
+ */
+
+#include "ca_runtime.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RT_READER_BUFSIZE (64 * 1024)
+
+////////////////////////////////////////////////////////////////////////////////
+// memory mapped file view
+////////////////////////////////////////////////////////////////////////////////
+
+int32_t ca_rt_file_map(const char *path, CAByteSlice *view) {
+  view->ptr = NULL;
+  view->len = 0;
+
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+    return 0;
+
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    close(fd);
+    return 0;
+  }
+
+  // empty file cannot be mapped, return an empty slice
+  if (st.st_size == 0) {
+    close(fd);
+    return 1;
+  }
+
+  void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps a reference of the file, no need to keep the fd
+  close(fd);
+  if (addr == MAP_FAILED)
+    return 0;
+
+#ifdef MADV_SEQUENTIAL
+  madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+
+  view->ptr = (uint8_t *)addr;
+  view->len = (uint64_t)st.st_size;
+  return 1;
+}
+
+void ca_rt_file_unmap(CAByteSlice *view) {
+  if (view->ptr)
+    munmap(view->ptr, (size_t)view->len);
+
+  view->ptr = NULL;
+  view->len = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// line iterator over a byte slice
+////////////////////////////////////////////////////////////////////////////////
+
+void ca_rt_lines_init(CALineIter *it, const uint8_t *ptr, uint64_t len) {
+  it->ptr = ptr;
+  it->len = len;
+  it->pos = 0;
+}
+
+// the line does not include the '\n' and the '\r' before it
+static inline void rt_make_line(CAByteSlice *line, const uint8_t *start, uint64_t len) {
+  if (len && start[len - 1] == '\r')
+    len -= 1;
+
+  line->ptr = (uint8_t *)start;
+  line->len = len;
+}
+
+int32_t ca_rt_lines_next(CALineIter *it, CAByteSlice *line) {
+  if (it->pos >= it->len)
+    return 0;
+
+  const uint8_t *start = it->ptr + it->pos;
+  uint64_t remain = it->len - it->pos;
+  const uint8_t *nl = (const uint8_t *)memchr(start, '\n', (size_t)remain);
+  if (nl) {
+    rt_make_line(line, start, (uint64_t)(nl - start));
+    it->pos += (uint64_t)(nl - start) + 1;
+  } else {
+    // last line without '\n'
+    rt_make_line(line, start, remain);
+    it->pos = it->len;
+  }
+
+  return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// buffered reader for the input cannot be mapped, like pipe and stdin
+////////////////////////////////////////////////////////////////////////////////
+
+static int32_t rt_reader_init_fd(CAReader *r, int fd) {
+  r->fd = fd;
+  r->buf = (uint8_t *)malloc(RT_READER_BUFSIZE);
+  if (!r->buf) {
+    r->fd = -1;
+    return 0;
+  }
+
+  r->cap = RT_READER_BUFSIZE;
+  r->start = 0;
+  r->end = 0;
+  r->eof = 0;
+  return 1;
+}
+
+int32_t ca_rt_reader_open(CAReader *r, const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    r->fd = -1;
+    r->buf = NULL;
+    return 0;
+  }
+
+  if (!rt_reader_init_fd(r, fd)) {
+    close(fd);
+    return 0;
+  }
+
+  return 1;
+}
+
+int32_t ca_rt_reader_stdin(CAReader *r) {
+  return rt_reader_init_fd(r, STDIN_FILENO);
+}
+
+void ca_rt_reader_close(CAReader *r) {
+  if (r->fd > STDIN_FILENO)
+    close(r->fd);
+
+  free(r->buf);
+  r->fd = -1;
+  r->buf = NULL;
+  r->cap = 0;
+  r->start = 0;
+  r->end = 0;
+}
+
+// move the remained data to the buffer start, grow the buffer when a line is
+// longer than the buffer, then fill the buffer, return the read bytes
+static int64_t rt_reader_fill(CAReader *r) {
+  if (r->start > 0) {
+    memmove(r->buf, r->buf + r->start, (size_t)(r->end - r->start));
+    r->end -= r->start;
+    r->start = 0;
+  }
+
+  if (r->end == r->cap) {
+    uint8_t *buf = (uint8_t *)realloc(r->buf, (size_t)(r->cap * 2));
+    if (!buf)
+      return -1;
+
+    r->buf = buf;
+    r->cap *= 2;
+  }
+
+  ssize_t n;
+  do {
+    n = read(r->fd, r->buf + r->end, (size_t)(r->cap - r->end));
+  } while (n == -1 && errno == EINTR);
+
+  if (n <= 0) {
+    r->eof = 1;
+    return n;
+  }
+
+  r->end += (uint64_t)n;
+  return n;
+}
+
+int32_t ca_rt_reader_next_line(CAReader *r, CAByteSlice *line) {
+  uint64_t scanned = 0;
+  for (;;) {
+    const uint8_t *start = r->buf + r->start;
+    uint64_t avail = r->end - r->start;
+    const uint8_t *nl = (const uint8_t *)memchr(start + scanned, '\n', (size_t)(avail - scanned));
+    if (nl) {
+      uint64_t len = (uint64_t)(nl - start);
+      rt_make_line(line, start, len);
+      r->start += len + 1;
+      return 1;
+    }
+
+    if (r->eof) {
+      if (!avail)
+	return 0;
+
+      // last line without '\n'
+      rt_make_line(line, start, avail);
+      r->start = r->end;
+      return 1;
+    }
+
+    scanned = avail;
+    if (rt_reader_fill(r) < 0)
+      return 0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// number parsing from byte slice
+////////////////////////////////////////////////////////////////////////////////
+
+static inline int rt_is_space(uint8_t c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline int rt_is_digit(uint8_t c) {
+  return (uint8_t)(c - '0') < 10;
+}
+
+/*
+ * Parse an unsigned decimal from p to end, return the position after the
+ * number, or NULL when there is no digit or overflow
+ */
+static const uint8_t *rt_parse_u64(const uint8_t *p, const uint8_t *end, uint64_t *out) {
+  const uint8_t *start = p;
+  uint64_t v = 0;
+  while (p < end && rt_is_digit(*p)) {
+    uint64_t d = (uint64_t)(*p - '0');
+    if (v > (UINT64_MAX - d) / 10)
+      return NULL;
+
+    v = v * 10 + d;
+    ++p;
+  }
+
+  if (p == start)
+    return NULL;
+
+  *out = v;
+  return p;
+}
+
+static const uint8_t *rt_parse_i64(const uint8_t *p, const uint8_t *end, int64_t *out) {
+  int neg = 0;
+  if (p < end && (*p == '-' || *p == '+')) {
+    neg = *p == '-';
+    ++p;
+  }
+
+  uint64_t v;
+  p = rt_parse_u64(p, end, &v);
+  if (!p)
+    return NULL;
+
+  if (neg) {
+    if (v > (uint64_t)INT64_MAX + 1)
+      return NULL;
+
+    *out = (int64_t)(0 - v);
+  } else {
+    if (v > (uint64_t)INT64_MAX)
+      return NULL;
+
+    *out = (int64_t)v;
+  }
+
+  return p;
+}
+
+static const double rt_exact_pow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/*
+ * When the decimal mantissa fits in 53 bits and the decimal exponent is in
+ * [-22, 22], both of them are exact doubles, so one multiplication or division
+ * give the correctly rounded result (Clinger's fast path). Other cases are
+ * handed to strtod.
+ */
+static const uint8_t *rt_parse_f64(const uint8_t *p, const uint8_t *end, double *out) {
+  const uint8_t *start = p;
+  int neg = 0;
+  if (p < end && (*p == '-' || *p == '+')) {
+    neg = *p == '-';
+    ++p;
+  }
+
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int64_t exp10 = 0;
+  int anydigit = 0;
+
+  while (p < end && rt_is_digit(*p)) {
+    if (digits < 19) {
+      mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+      if (mantissa)
+	++digits;
+    } else {
+      ++exp10;
+      ++digits;
+    }
+
+    anydigit = 1;
+    ++p;
+  }
+
+  if (p < end && *p == '.') {
+    ++p;
+    while (p < end && rt_is_digit(*p)) {
+      if (digits < 19) {
+	mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+	if (mantissa)
+	  ++digits;
+	--exp10;
+      } else {
+	++digits;
+      }
+
+      anydigit = 1;
+      ++p;
+    }
+  }
+
+  if (!anydigit)
+    return NULL;
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    int64_t e;
+    const uint8_t *q = rt_parse_i64(p + 1, end, &e);
+    if (q) {
+      exp10 += e;
+      p = q;
+    }
+  }
+
+  if (digits <= 19 && mantissa < (1ULL << 53) && exp10 >= -22 && exp10 <= 22) {
+    double v = (double)mantissa;
+    v = exp10 < 0 ? v / rt_exact_pow10[-exp10] : v * rt_exact_pow10[exp10];
+    *out = neg ? -v : v;
+    return p;
+  }
+
+  // slow path, strtod need a '\0' terminated string
+  char buf[128];
+  size_t len = (size_t)(p - start);
+  char *s = len < sizeof(buf) ? buf : (char *)malloc(len + 1);
+  if (!s)
+    return NULL;
+
+  memcpy(s, start, len);
+  s[len] = '\0';
+  *out = strtod(s, NULL);
+  if (s != buf)
+    free(s);
+
+  return p;
+}
+
+int32_t ca_rt_parse_i64(const uint8_t *ptr, uint64_t len, int64_t *out) {
+  const uint8_t *end = ptr + len;
+  const uint8_t *p = rt_parse_i64(ptr, end, out);
+  return p == end;
+}
+
+int32_t ca_rt_parse_u64(const uint8_t *ptr, uint64_t len, uint64_t *out) {
+  const uint8_t *end = ptr + len;
+  const uint8_t *p = rt_parse_u64(ptr, end, out);
+  return p == end;
+}
+
+int32_t ca_rt_parse_f64(const uint8_t *ptr, uint64_t len, double *out) {
+  const uint8_t *end = ptr + len;
+  const uint8_t *p = rt_parse_f64(ptr, end, out);
+  return p == end;
+}
+
+// skip the leading spaces of the slice, it is used by the scan functions
+static inline const uint8_t *rt_scan_begin(CAByteSlice *s, const uint8_t **end) {
+  const uint8_t *p = s->ptr;
+  *end = p + s->len;
+  while (p < *end && rt_is_space(*p))
+    ++p;
+
+  return p;
+}
+
+static inline void rt_scan_end(CAByteSlice *s, const uint8_t *p, const uint8_t *end) {
+  s->ptr = (uint8_t *)p;
+  s->len = (uint64_t)(end - p);
+}
+
+int32_t ca_rt_scan_i64(CAByteSlice *s, int64_t *out) {
+  const uint8_t *end;
+  const uint8_t *p = rt_scan_begin(s, &end);
+  p = rt_parse_i64(p, end, out);
+  if (!p)
+    return 0;
+
+  rt_scan_end(s, p, end);
+  return 1;
+}
+
+int32_t ca_rt_scan_u64(CAByteSlice *s, uint64_t *out) {
+  const uint8_t *end;
+  const uint8_t *p = rt_scan_begin(s, &end);
+  p = rt_parse_u64(p, end, out);
+  if (!p)
+    return 0;
+
+  rt_scan_end(s, p, end);
+  return 1;
+}
+
+int32_t ca_rt_scan_f64(CAByteSlice *s, double *out) {
+  const uint8_t *end;
+  const uint8_t *p = rt_scan_begin(s, &end);
+  p = rt_parse_f64(p, end, out);
+  if (!p)
+    return 0;
+
+  rt_scan_end(s, p, end);
+  return 1;
+}
+
@@ -0,0 +1,368 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+/**
+ * @file runtime thread functionalities: native threads used by the `spawn`
+ * and `join` builtins, and the work stealing thread pool used by the
+ * `parallel for` statement
+ */
+
+#include "ca_runtime.h"
+
+#include <gc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define RT_DEQUE_INITCAP 64
+
+/// the number of chunks each thread gets when the grain size is not given
+#define RT_CHUNKS_PER_THREAD 8
+
+/// the maximum threads of the pool, including the calling thread
+#define RT_MAX_THREADS 256
+
+static void *rt_thread_xmalloc(size_t size) {
+  void *p = malloc(size);
+  if (!p) {
+    fprintf(stderr, "ca runtime: out of memory when allocating %zu bytes\n", size);
+    abort();
+  }
+
+  return p;
+}
+
+/*
+ * The collector only scans the stacks of the threads it knows, an object
+ * allocated by `box` and only referenced from the stack of a thread created
+ * here would be freed when the thread is not registered. The registering of
+ * threads is only allowed after `GC_allow_register_threads` is called from an
+ * already registered thread, e.g. the main thread.
+ */
+static pthread_once_t rt_gc_once = PTHREAD_ONCE_INIT;
+
+static void rt_gc_threads_init(void) {
+  GC_init();
+  GC_allow_register_threads();
+}
+
+static void rt_gc_register_thread(void) {
+  struct GC_stack_base sb;
+  if (GC_get_stack_base(&sb) != GC_SUCCESS) {
+    fprintf(stderr, "ca runtime: cannot get the stack base of the new thread\n");
+    abort();
+  }
+
+  GC_register_my_thread(&sb);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// native thread
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct RTThread {
+  pthread_t tid;
+  void (*fn)(void *);
+  void *arg;
+} RTThread;
+
+static void *rt_thread_start(void *data) {
+  RTThread *t = (RTThread *)data;
+  rt_gc_register_thread();
+  t->fn(t->arg);
+  GC_unregister_my_thread();
+  return NULL;
+}
+
+uint64_t ca_rt_spawn(void (*fn)(void *), void *arg) {
+  pthread_once(&rt_gc_once, rt_gc_threads_init);
+
+  RTThread *t = (RTThread *)rt_thread_xmalloc(sizeof(RTThread));
+  t->fn = fn;
+  t->arg = arg;
+  if (pthread_create(&t->tid, NULL, rt_thread_start, t)) {
+    fprintf(stderr, "ca runtime: cannot create thread\n");
+    abort();
+  }
+
+  return (uint64_t)(uintptr_t)t;
+}
+
+void ca_rt_join(uint64_t handle) {
+  RTThread *t = (RTThread *)(uintptr_t)handle;
+  pthread_join(t->tid, NULL);
+  free(t);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// work stealing thread pool
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Each thread of the pool owns a deque of the tasks, the owner pushes and pops
+ * at the bottom, and the idle threads steal from the top of others. A task is
+ * a range of the iterations of a `parallel for`, it is split lazily: the
+ * thread running a task pushes the upper half back into its deque until the
+ * rest is not larger than the grain size. So the owner works on the nearby
+ * iterations while the stolen tasks are the largest ones, few steals are
+ * needed to balance the load.
+ *
+ * The slot 0 of the deques is shared by the threads not in the pool, e.g.
+ * the main thread, the calling thread runs the tasks of its loop until it is
+ * done instead of blocking, so a nested `parallel for` cannot dead lock.
+ */
+typedef struct RTJob {
+  void (*body)(int64_t, int64_t, void *);
+  void *env;
+  int64_t grain;
+  _Atomic int64_t remaining; /// the iterations not finished yet
+} RTJob;
+
+typedef struct RTTask {
+  RTJob *job;
+  int64_t lo;
+  int64_t hi;
+} RTTask;
+
+typedef struct RTDeque {
+  pthread_mutex_t lock;
+  RTTask *tasks;   /// ring buffer
+  uint64_t top;    /// the steal end
+  uint64_t bottom; /// the owner end
+  uint64_t cap;    /// power of 2
+} RTDeque;
+
+typedef struct RTPool {
+  int nthreads; /// the workers and the calling thread
+  RTDeque *deques;
+  pthread_mutex_t sleep_lock;
+  pthread_cond_t wakeup;
+  _Atomic int64_t njobs; /// the running jobs, the workers sleep when no job
+} RTPool;
+
+static RTPool rt_pool;
+static pthread_once_t rt_pool_once = PTHREAD_ONCE_INIT;
+
+/// the deque index of current thread, the threads not in the pool use 0
+static __thread int rt_worker_index = 0;
+static __thread uint32_t rt_steal_seed = 0;
+
+static void rt_deque_init(RTDeque *d) {
+  pthread_mutex_init(&d->lock, NULL);
+  d->tasks = (RTTask *)rt_thread_xmalloc(sizeof(RTTask) * RT_DEQUE_INITCAP);
+  d->top = 0;
+  d->bottom = 0;
+  d->cap = RT_DEQUE_INITCAP;
+}
+
+static void rt_deque_push(RTDeque *d, RTTask task) {
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom - d->top == d->cap) {
+    RTTask *tasks = (RTTask *)rt_thread_xmalloc(sizeof(RTTask) * d->cap * 2);
+    for (uint64_t i = d->top; i != d->bottom; ++i)
+      tasks[i & (d->cap * 2 - 1)] = d->tasks[i & (d->cap - 1)];
+
+    free(d->tasks);
+    d->tasks = tasks;
+    d->cap *= 2;
+  }
+
+  d->tasks[d->bottom & (d->cap - 1)] = task;
+  ++d->bottom;
+  pthread_mutex_unlock(&d->lock);
+}
+
+static int rt_deque_pop(RTDeque *d, RTTask *task) {
+  int found = 0;
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom != d->top) {
+    --d->bottom;
+    *task = d->tasks[d->bottom & (d->cap - 1)];
+    found = 1;
+  }
+
+  pthread_mutex_unlock(&d->lock);
+  return found;
+}
+
+static int rt_deque_steal(RTDeque *d, RTTask *task) {
+  int found = 0;
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom != d->top) {
+    *task = d->tasks[d->top & (d->cap - 1)];
+    ++d->top;
+    found = 1;
+  }
+
+  pthread_mutex_unlock(&d->lock);
+  return found;
+}
+
+static int rt_pool_steal(int self, RTTask *task) {
+  // xorshift to pick the first victim, so the thieves do not rush on the same deque
+  uint32_t x = rt_steal_seed ? rt_steal_seed : (uint32_t)(self * 2654435761u + 1);
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  rt_steal_seed = x;
+
+  int n = rt_pool.nthreads;
+  int start = (int)(x % (uint32_t)n);
+  for (int i = 0; i < n; ++i) {
+    int victim = (start + i) % n;
+    if (victim != self && rt_deque_steal(&rt_pool.deques[victim], task))
+      return 1;
+  }
+
+  return 0;
+}
+
+static void rt_task_run(RTDeque *self, RTTask task) {
+  RTJob *job = task.job;
+  while (task.hi - task.lo > job->grain) {
+    RTTask upper = task;
+    upper.lo = task.lo + (task.hi - task.lo) / 2;
+    rt_deque_push(self, upper);
+    task.hi = upper.lo;
+  }
+
+  job->body(task.lo, task.hi, job->env);
+
+  // the job may be released by its caller right after the last iterations are counted
+  atomic_fetch_sub_explicit(&job->remaining, task.hi - task.lo, memory_order_release);
+}
+
+static void *rt_worker_main(void *data) {
+  int self = (int)(intptr_t)data;
+  rt_worker_index = self;
+  rt_gc_register_thread();
+
+  RTDeque *deque = &rt_pool.deques[self];
+  for (;;) {
+    RTTask task;
+    if (rt_deque_pop(deque, &task) || rt_pool_steal(self, &task)) {
+      rt_task_run(deque, task);
+      continue;
+    }
+
+    if (atomic_load_explicit(&rt_pool.njobs, memory_order_acquire) > 0) {
+      sched_yield();
+      continue;
+    }
+
+    pthread_mutex_lock(&rt_pool.sleep_lock);
+    while (atomic_load_explicit(&rt_pool.njobs, memory_order_acquire) == 0)
+      pthread_cond_wait(&rt_pool.wakeup, &rt_pool.sleep_lock);
+    pthread_mutex_unlock(&rt_pool.sleep_lock);
+  }
+
+  return NULL;
+}
+
+static void rt_pool_init(void) {
+  pthread_once(&rt_gc_once, rt_gc_threads_init);
+
+  int n = (int)ca_rt_thread_count();
+  rt_pool.nthreads = n;
+  rt_pool.deques = (RTDeque *)rt_thread_xmalloc(sizeof(RTDeque) * n);
+  for (int i = 0; i < n; ++i)
+    rt_deque_init(&rt_pool.deques[i]);
+
+  pthread_mutex_init(&rt_pool.sleep_lock, NULL);
+  pthread_cond_init(&rt_pool.wakeup, NULL);
+  atomic_init(&rt_pool.njobs, 0);
+
+  // the workers never exit, they sleep when there is no job
+  for (int i = 1; i < n; ++i) {
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, rt_worker_main, (void *)(intptr_t)i)) {
+      fprintf(stderr, "ca runtime: cannot create worker thread\n");
+      abort();
+    }
+
+    pthread_detach(tid);
+  }
+}
+
+int64_t ca_rt_thread_count(void) {
+  static int64_t count = 0;
+  int64_t cached = __atomic_load_n(&count, __ATOMIC_RELAXED);
+  if (cached)
+    return cached;
+
+  int64_t n = 0;
+  const char *env = getenv("CA_NUM_THREADS");
+  if (env)
+    n = atoll(env);
+
+  if (n <= 0)
+    n = (int64_t)sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (n <= 0)
+    n = 1;
+  else if (n > RT_MAX_THREADS)
+    n = RT_MAX_THREADS;
+
+  __atomic_store_n(&count, n, __ATOMIC_RELAXED);
+  return n;
+}
+
+void ca_rt_parallel_for(int64_t begin, int64_t end, int64_t grain,
+			void (*body)(int64_t, int64_t, void *), void *env) {
+  if (begin >= end)
+    return;
+
+  uint64_t n = (uint64_t)end - (uint64_t)begin;
+  int64_t nthreads = ca_rt_thread_count();
+  if (grain <= 0)
+    grain = (int64_t)(n / (uint64_t)(nthreads * RT_CHUNKS_PER_THREAD));
+
+  if (grain <= 0)
+    grain = 1;
+
+  // no other thread to share the work
+  if (nthreads == 1 || n <= (uint64_t)grain) {
+    body(begin, end, env);
+    return;
+  }
+
+  pthread_once(&rt_pool_once, rt_pool_init);
+
+  RTJob job;
+  job.body = body;
+  job.env = env;
+  job.grain = grain;
+  atomic_init(&job.remaining, (int64_t)n);
+
+  int self = rt_worker_index;
+  RTDeque *deque = &rt_pool.deques[self];
+  rt_deque_push(deque, (RTTask){&job, begin, end});
+
+  pthread_mutex_lock(&rt_pool.sleep_lock);
+  atomic_fetch_add_explicit(&rt_pool.njobs, 1, memory_order_release);
+  pthread_cond_broadcast(&rt_pool.wakeup);
+  pthread_mutex_unlock(&rt_pool.sleep_lock);
+
+  // help running the tasks until all the iterations of the job are done
+  while (atomic_load_explicit(&job.remaining, memory_order_acquire) > 0) {
+    RTTask task;
+    if (rt_deque_pop(deque, &task) || rt_pool_steal(self, &task))
+      rt_task_run(deque, task);
+    else
+      sched_yield();
+  }
+
+  atomic_fetch_sub_explicit(&rt_pool.njobs, 1, memory_order_release);
+}
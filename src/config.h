@@ -36,10 +36,12 @@ typedef struct FPIC_AddrEnv {
 
 typedef enum LLVM_Gen_Type {
   LGT_LL,
+  LGT_BC,       /// the llvm bitcode
   LGT_S,
   LGT_C,
   LGT_JIT,
   LGT_NATIVE,
+  LGT_LTO_LINK, /// link the bitcode objects of -flto into one native object
 } LLVM_Gen_Type;
 
 typedef enum Optimize_Level {
@@ -64,6 +66,16 @@ typedef struct CompileEnv {
   int emit_debug; /// if enable debug information
   int emit_main;  /// if emit main function
   int emit_dot;   /// if emit dot format file (graphviz) for the grammar
+  int rt_print;   /// if lower `print` into ca runtime write functions instead of printf
+  int bounds_check; /// if generate runtime index checking code for array indexing and slicing
+  int overflow_check; /// if generate runtime overflow checking code for integer `+`, `-`, `*`
+  int profile_generate; /// if instrument the code to generate the profile (`-fprofile-generate`)
+  char profile_generate_path[MAX_PATH + 1]; /// the profile file to write, empty for the default one
+  char profile_use_path[MAX_PATH + 1];      /// the profile file to optimize with (`-fprofile-use`), empty when not use
+  int lto;            /// if emit the bitcode instead of native object for the link time optimization (`-flto`)
+  int lto_ninputs;    /// the number of the input objects of `-flto-link`
+  char **lto_inputs;  /// the input objects of `-flto-link`
+  char lto_exports[MAX_PATH + 1]; /// the comma separated symbols kept exported by `-flto-link` besides `main`
   char dotpath[MAX_PATH + 1];   /// dot file path when emit_dot is set
   int dot_sparsed;
   FILE *dotout;
@@ -0,0 +1,1075 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+#include "const_eval.h"
+#include "ca_parser.h"
+#include "ca_types.h"
+#include "symtable.h"
+#include "type_system.h"
+
+#include "ca.tab.h"
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// the limits for evaluating the function calls
+#define CONST_EVAL_MAX_DEPTH 256
+#define CONST_EVAL_MAX_STEPS (1 << 24)
+
+BEGIN_EXTERN_C
+extern int glineno_prev;
+extern int gcolno_prev;
+extern int glineno;
+extern int gcolno;
+END_EXTERN_C
+
+namespace {
+
+/**
+ * The value of a primitive scalar. The integer literal without postfix is
+ * `untyped`, it takes the type of the other operand, or else the default
+ * type `i32` (`f64` for float literal) when the type is finally needed.
+ */
+struct ConstValue {
+  tokenid_t type;
+  bool untyped;
+  int64_t i;
+  double f;
+};
+
+enum ExecResult {
+  ER_Normal,
+  ER_Return,
+  ER_Break,
+  ER_Continue,
+  ER_Error,
+};
+
+std::unordered_map<STEntry *, ASTNode *> s_const_fns;
+
+bool is_scalar_type(tokenid_t type) {
+  return catype_is_integer(type) || catype_is_float(type) || type == BOOL;
+}
+
+int type_bits(tokenid_t type) {
+  switch (type) {
+  case I8:
+  case U8:
+    return 8;
+  case I16:
+  case U16:
+    return 16;
+  case I32:
+  case U32:
+    return 32;
+  case BOOL:
+    return 1;
+  default:
+    return 64;
+  }
+}
+
+// wrap the integer value into the width of the type
+int64_t normalize_int(tokenid_t type, int64_t value) {
+  int bits = type_bits(type);
+  if (bits == 64)
+    return value;
+
+  uint64_t mask = (1ULL << bits) - 1;
+  uint64_t v = (uint64_t)value & mask;
+  if (catype_is_signed(type) && ((v >> (bits - 1)) & 1))
+    v |= ~mask;
+
+  return (int64_t)v;
+}
+
+bool int_fits_type(tokenid_t type, int64_t value) {
+  int bits = type_bits(type);
+  if (catype_is_unsigned(type))
+    return value >= 0 && (bits == 64 || value <= (int64_t)((1ULL << bits) - 1));
+
+  if (bits == 64)
+    return true;
+
+  int64_t max = (int64_t)((1ULL << (bits - 1)) - 1);
+  return value >= -max - 1 && value <= max;
+}
+
+class ConstEvaluator {
+public:
+  explicit ConstEvaluator(SymTable *symtable) : _symtable(symtable) {}
+
+  bool eval(ASTNode *p, ConstValue &v);
+  bool convert(ConstValue &v, tokenid_t type, ASTNode *p);
+  tokenid_t scalar_type(typeid_t type, ASTNode *p);
+
+  const std::string &error() const { return _error; }
+  const SLoc &errbeg() const { return _errbeg; }
+  const SLoc &errend() const { return _errend; }
+
+private:
+  bool fail(ASTNode *p, const char *fmt, ...);
+  bool step(ASTNode *p);
+  bool unify(ConstValue &a, ConstValue &b, ASTNode *p);
+  bool settle(ConstValue &v, ASTNode *p);
+
+  bool eval_literal(ASTNode *p, ConstValue &v);
+  bool eval_id(ASTNode *p, ConstValue &v);
+  bool eval_expr(ASTNode *p, ConstValue &v);
+  bool eval_unary(int op, ConstValue &v, ASTNode *p);
+  bool eval_binary(int op, ConstValue a, ConstValue b, ASTNode *p, ConstValue &v);
+  bool eval_as(ASTNode *p, ConstValue &v);
+  bool eval_call(ASTNode *p, ConstValue &v);
+  bool eval_if(ASTNode *p, ConstValue &v);
+  bool eval_block(ASTNode *p, ConstValue &v);
+
+  ExecResult exec(ASTNode *p);
+  ExecResult exec_letbind(ASTNode *p);
+  ExecResult exec_assign(ASTNode *p);
+  ExecResult exec_if(ASTNode *p);
+  ExecResult exec_loop(ASTNode *cond, ASTNode *body);
+
+  ConstValue *lookup(int name);
+  void push_frame() { _frames.emplace_back(); }
+  void pop_frame() { _frames.pop_back(); }
+
+private:
+  SymTable *_symtable;
+  std::vector<std::vector<std::pair<int, ConstValue>>> _frames;
+  ConstValue _retval;
+  int _depth = 0;
+  uint64_t _steps = 0;
+  std::string _error;
+  SLoc _errbeg = {0, 0};
+  SLoc _errend = {0, 0};
+};
+
+bool ConstEvaluator::fail(ASTNode *p, const char *fmt, ...) {
+  // keep the innermost error, it is the reason of the failure
+  if (!_error.empty())
+    return false;
+
+  char buffer[1024];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(buffer, sizeof(buffer), fmt, ap);
+  va_end(ap);
+
+  _error = buffer;
+  if (p) {
+    _errbeg = p->begloc;
+    _errend = p->endloc;
+  }
+
+  return false;
+}
+
+bool ConstEvaluator::step(ASTNode *p) {
+  if (++_steps > CONST_EVAL_MAX_STEPS)
+    return fail(p, "constant evaluation exceeds the limit of %d steps", CONST_EVAL_MAX_STEPS);
+
+  return true;
+}
+
+tokenid_t ConstEvaluator::scalar_type(typeid_t type, ASTNode *p) {
+  CADataType *catype = catype_get_by_name(_symtable, type);
+  if (!catype || !is_scalar_type(catype->type)) {
+    fail(p, "type `%s` is not a primitive scalar type for constant", catype_get_type_name(type));
+    return tokenid_novalue;
+  }
+
+  return catype->type;
+}
+
+// convert `v` into `type`, the untyped value can be converted, the typed value must be the same type
+bool ConstEvaluator::convert(ConstValue &v, tokenid_t type, ASTNode *p) {
+  if (!v.untyped) {
+    if (v.type != type)
+      return fail(p, "mismatched types: expected `%s`, found `%s`",
+                  get_type_string(type), get_type_string(v.type));
+    return true;
+  }
+
+  if (catype_is_float(v.type)) {
+    if (!catype_is_float(type))
+      return fail(p, "float literal cannot be `%s` type", get_type_string(type));
+
+    if (type == F32)
+      v.f = (float)v.f;
+  } else if (catype_is_integer(type)) {
+    if (!int_fits_type(type, v.i))
+      return fail(p, "literal `%ld` out of range of `%s` type", v.i, get_type_string(type));
+  } else if (catype_is_float(type)) {
+    v.f = type == F32 ? (float)v.i : (double)v.i;
+  } else {
+    return fail(p, "integer literal cannot be `%s` type", get_type_string(type));
+  }
+
+  v.type = type;
+  v.untyped = false;
+  return true;
+}
+
+// give the untyped value its default type
+bool ConstEvaluator::settle(ConstValue &v, ASTNode *p) {
+  if (!v.untyped)
+    return true;
+
+  return convert(v, catype_is_float(v.type) ? F64 : I32, p);
+}
+
+bool ConstEvaluator::unify(ConstValue &a, ConstValue &b, ASTNode *p) {
+  if (a.untyped && !b.untyped)
+    return convert(a, b.type, p);
+
+  if (b.untyped && !a.untyped)
+    return convert(b, a.type, p);
+
+  if (a.untyped && b.untyped) {
+    // 1 + 2.0
+    if (catype_is_float(a.type) != catype_is_float(b.type)) {
+      ConstValue &iv = catype_is_float(a.type) ? b : a;
+      iv.f = (double)iv.i;
+      iv.type = F64;
+    }
+
+    return true;
+  }
+
+  if (a.type != b.type)
+    return fail(p, "mismatched types `%s` and `%s` in constant expression",
+                get_type_string(a.type), get_type_string(b.type));
+
+  return true;
+}
+
+ConstValue *ConstEvaluator::lookup(int name) {
+  for (auto frame = _frames.rbegin(); frame != _frames.rend(); ++frame) {
+    for (auto var = frame->rbegin(); var != frame->rend(); ++var) {
+      if (var->first == name)
+        return &var->second;
+    }
+  }
+
+  return nullptr;
+}
+
+bool ConstEvaluator::eval_literal(ASTNode *p, ConstValue &v) {
+  CALiteral lit = p->litn.litv;
+  tokenid_t type = lit.postfixtypetok;
+  v.untyped = false;
+  v.i = 0;
+  v.f = 0;
+
+  switch (lit.littypetok) {
+  case I64:
+  case U64:
+    if (type == tokenid_novalue) {
+      type = lit.littypetok;
+      v.untyped = true;
+    }
+    break;
+  case F64:
+    if (type == tokenid_novalue) {
+      type = F64;
+      v.untyped = true;
+    }
+    break;
+  case BOOL:
+    type = BOOL;
+    break;
+  case I8:
+    type = I8;
+    break;
+  case U8:
+    type = U8;
+    break;
+  default:
+    return fail(p, "`%s` literal is not a scalar constant", get_type_string(lit.littypetok));
+  }
+
+  if (!is_scalar_type(type))
+    return fail(p, "`%s` literal is not a scalar constant", get_type_string(type));
+
+  // parse the text with the checking of the value scope
+  lit.fixed_type = 0;
+  determine_primitive_literal_type(&lit, catype_get_primitive_by_token(type));
+
+  v.type = type;
+  if (catype_is_float(type)) {
+    v.f = type == F32 ? (float)lit.u.f64value : lit.u.f64value;
+  } else {
+    v.i = lit.u.i64value;
+
+    // the untyped positive literal out of i64 can only be u64
+    if (v.untyped && type == U64 && v.i < 0)
+      v.untyped = false;
+    else if (!v.untyped)
+      v.i = normalize_int(type, v.i);
+  }
+
+  return true;
+}
+
+bool ConstEvaluator::eval_id(ASTNode *p, ConstValue &v) {
+  ConstValue *var = lookup(p->idn.i);
+  if (var) {
+    v = *var;
+    return true;
+  }
+
+  if (p->entry && p->entry->sym_type == Sym_Const)
+    return eval(p->entry->u.constant.litnode, v);
+
+  return fail(p, "`%s` is not a constant", symname_get(p->idn.i));
+}
+
+bool ConstEvaluator::eval_unary(int op, ConstValue &v, ASTNode *p) {
+  switch (op) {
+  case UMINUS:
+    if (catype_is_float(v.type)) {
+      v.f = -v.f;
+      return true;
+    }
+
+    if (!v.untyped && !catype_is_signed(v.type))
+      return fail(p, "cannot apply unary operator `-` to type `%s`", get_type_string(v.type));
+
+    v.i = (int64_t)(0 - (uint64_t)v.i);
+    if (!v.untyped)
+      v.i = normalize_int(v.type, v.i);
+    return true;
+  case BNOT:
+    if (v.type == BOOL) {
+      v.i = !v.i;
+      return true;
+    }
+
+    if (catype_is_float(v.type))
+      return fail(p, "cannot apply unary operator `!` to type `%s`", get_type_string(v.type));
+
+    if (!settle(v, p))
+      return false;
+
+    v.i = normalize_int(v.type, ~v.i);
+    return true;
+  default:
+    return fail(p, "unknown unary operator `%d` in constant expression", op);
+  }
+}
+
+bool ConstEvaluator::eval_binary(int op, ConstValue a, ConstValue b, ASTNode *p, ConstValue &v) {
+  if (!unify(a, b, p))
+    return false;
+
+  tokenid_t type = a.type;
+  bool isfloat = catype_is_float(type);
+  bool issigned = a.untyped || catype_is_signed(type);
+  uint64_t ua = (uint64_t)a.i;
+  uint64_t ub = (uint64_t)b.i;
+
+  v.type = type;
+  v.untyped = a.untyped && b.untyped;
+  v.i = 0;
+  v.f = 0;
+
+  switch (op) {
+  case '<':
+  case '>':
+  case GE:
+  case LE:
+  case NE:
+  case EQ: {
+    int cmp = 0;
+    if (isfloat)
+      cmp = a.f < b.f ? -1 : (a.f > b.f ? 1 : 0);
+    else if (issigned || type == BOOL)
+      cmp = a.i < b.i ? -1 : (a.i > b.i ? 1 : 0);
+    else
+      cmp = ua < ub ? -1 : (ua > ub ? 1 : 0);
+
+    bool nan = isfloat && (std::isnan(a.f) || std::isnan(b.f));
+    bool result = false;
+    switch (op) {
+    case '<': result = !nan && cmp < 0; break;
+    case '>': result = !nan && cmp > 0; break;
+    case GE:  result = !nan && cmp >= 0; break;
+    case LE:  result = !nan && cmp <= 0; break;
+    case NE:  result = nan || cmp != 0; break;
+    case EQ:  result = !nan && cmp == 0; break;
+    }
+
+    v.type = BOOL;
+    v.untyped = false;
+    v.i = result;
+    return true;
+  }
+  default:
+    break;
+  }
+
+  if (type == BOOL && op != BAND && op != BOR && op != BXOR)
+    return fail(p, "cannot apply binary operator on `bool` type in constant expression");
+
+  if (isfloat) {
+    switch (op) {
+    case '+': v.f = a.f + b.f; break;
+    case '-': v.f = a.f - b.f; break;
+    case '*': v.f = a.f * b.f; break;
+    case '/': v.f = a.f / b.f; break;
+    case '%': v.f = std::fmod(a.f, b.f); break;
+    default:
+      return fail(p, "cannot apply bit operator on `%s` type", get_type_string(type));
+    }
+
+    if (type == F32)
+      v.f = (float)v.f;
+    return true;
+  }
+
+  int bits = v.untyped ? 64 : type_bits(type);
+  switch (op) {
+  case '+':
+  case '-':
+  case '*': {
+    // the overflow is a compile error like the checked arithmetic at runtime
+    bool overflow;
+    if (issigned) {
+      int64_t r;
+      overflow = op == '+' ? __builtin_add_overflow(a.i, b.i, &r)
+        : (op == '-' ? __builtin_sub_overflow(a.i, b.i, &r) : __builtin_mul_overflow(a.i, b.i, &r));
+      v.i = r;
+    } else {
+      uint64_t r;
+      overflow = op == '+' ? __builtin_add_overflow(ua, ub, &r)
+        : (op == '-' ? __builtin_sub_overflow(ua, ub, &r) : __builtin_mul_overflow(ua, ub, &r));
+      v.i = (int64_t)r;
+    }
+
+    if (overflow || (!v.untyped && type != U64 && !int_fits_type(type, v.i)))
+      return fail(p, "attempt to %s with overflow in constant expression",
+                  op == '+' ? "add" : (op == '-' ? "subtract" : "multiply"));
+    break;
+  }
+  case '/':
+  case '%':
+    if (b.i == 0)
+      return fail(p, "attempt to divide by zero in constant expression");
+
+    if (issigned) {
+      if (b.i == -1 && a.i == normalize_int(type, INT64_MIN))
+        return fail(p, "attempt to divide with overflow in constant expression");
+
+      v.i = op == '/' ? a.i / b.i : a.i % b.i;
+    } else {
+      v.i = (int64_t)(op == '/' ? ua / ub : ua % ub);
+    }
+    break;
+  case BAND:
+    v.i = a.i & b.i;
+    break;
+  case BOR:
+    v.i = a.i | b.i;
+    break;
+  case BXOR:
+    v.i = a.i ^ b.i;
+    break;
+  case SHIFTL:
+  case SHIFTR:
+    if (b.i < 0 || b.i >= bits)
+      return fail(p, "attempt to shift with overflow in constant expression");
+
+    if (op == SHIFTL)
+      v.i = (int64_t)(ua << b.i);
+    else
+      v.i = issigned ? a.i >> b.i : (int64_t)(ua >> b.i);
+    break;
+  default:
+    return fail(p, "unknown binary operator `%d` in constant expression", op);
+  }
+
+  if (!v.untyped)
+    v.i = normalize_int(type, v.i);
+
+  return true;
+}
+
+bool ConstEvaluator::eval_as(ASTNode *p, ConstValue &v) {
+  ASTNode *asnode = p->exprn.operands[0];
+  if (!eval(asnode->exprasn.expr, v))
+    return false;
+
+  tokenid_t type = scalar_type(asnode->exprasn.type, p);
+  if (type == tokenid_novalue)
+    return false;
+
+  if (!settle(v, p))
+    return false;
+
+  if (v.type == type)
+    return true;
+
+  if (type == BOOL)
+    return fail(p, "cannot cast `%s` as `bool`", get_type_string(v.type));
+
+  if (catype_is_float(v.type)) {
+    if (catype_is_float(type)) {
+      v.f = type == F32 ? (float)v.f : v.f;
+    } else {
+      double f = std::trunc(v.f);
+      bool fits = !std::isnan(f) &&
+        (catype_is_unsigned(type) ? f >= 0 && f < 18446744073709551616.0
+                                  : f >= -9223372036854775808.0 && f < 9223372036854775808.0);
+      if (!fits)
+        return fail(p, "value `%g` out of range of `%s` type", v.f, get_type_string(type));
+
+      int64_t i = catype_is_unsigned(type) ? (int64_t)(uint64_t)f : (int64_t)f;
+      if (!int_fits_type(type, i) && !(type == U64))
+        return fail(p, "value `%g` out of range of `%s` type", v.f, get_type_string(type));
+
+      v.i = normalize_int(type, i);
+    }
+  } else if (catype_is_float(type)) {
+    double f = catype_is_unsigned(v.type) ? (double)(uint64_t)v.i : (double)v.i;
+    v.f = type == F32 ? (float)f : f;
+  } else {
+    // the integer and bool are extended by the source type, then truncated
+    v.i = normalize_int(type, v.i);
+  }
+
+  v.type = type;
+  return true;
+}
+
+bool ConstEvaluator::eval_call(ASTNode *p, ConstValue &v) {
+  ASTNode *name = p->exprn.operands[0];
+  ASTNode *args = p->exprn.operands[1];
+  if (name->type != TTE_Id)
+    return fail(p, "only the call of function can be evaluated in constant");
+
+  STEntry *entry = sym_getsym(p->symtable, name->idn.i, 1);
+  auto itr = s_const_fns.find(entry);
+  if (itr == s_const_fns.end())
+    return fail(p, "function `%s` is not defined before or cannot be evaluated in constant",
+                symname_get(name->idn.i));
+
+  ASTNode *fndef = itr->second;
+  TFnDeclNode *decl = &fndef->fndefn.fn_decl->fndecln;
+  if (decl->args.argc != args->arglistn.argc)
+    return fail(p, "actual parameter count `%d` not match formal parameter count `%d`",
+                args->arglistn.argc, decl->args.argc);
+
+  if (_depth >= CONST_EVAL_MAX_DEPTH)
+    return fail(p, "constant evaluation exceeds the limit of %d recursions", CONST_EVAL_MAX_DEPTH);
+
+  // the actual parameters are evaluated in the caller
+  std::vector<std::pair<int, ConstValue>> params;
+  for (int i = 0; i < decl->args.argc; ++i) {
+    int argname = decl->args.argnames[i];
+    STEntry *argentry = sym_getsym(decl->args.symtable, argname, 0);
+    CAVariableShielding *shielding = &argentry->u.varshielding;
+
+    // the parameter is the first one of the variables with the same name
+    CAVariable *var = vec_size(shielding->varlist) ?
+      (CAVariable *)vec_at(shielding->varlist, 0) : shielding->current;
+
+    SymTable *saved = _symtable;
+    _symtable = decl->args.symtable;
+    tokenid_t type = scalar_type(var->datatype, p);
+    _symtable = saved;
+
+    ConstValue arg;
+    if (type == tokenid_novalue || !eval(args->arglistn.exprs[i], arg) || !convert(arg, type, args->arglistn.exprs[i]))
+      return false;
+
+    params.push_back(std::make_pair(argname, arg));
+  }
+
+  SymTable *saved_symtable = _symtable;
+  auto saved_frames = std::move(_frames);
+  _symtable = decl->args.symtable;
+  _frames.clear();
+  _frames.push_back(std::move(params));
+  ++_depth;
+
+  tokenid_t rettype = scalar_type(decl->ret, p);
+  ExecResult result = rettype == tokenid_novalue ? ER_Error : exec(fndef->fndefn.stmts);
+
+  --_depth;
+  _frames = std::move(saved_frames);
+  _symtable = saved_symtable;
+
+  if (result == ER_Error)
+    return false;
+
+  if (result != ER_Return)
+    return fail(p, "function `%s` evaluated without returning a value", symname_get(name->idn.i));
+
+  v = _retval;
+  return convert(v, rettype, p);
+}
+
+// evaluate the value of the block in `ife` expression or the statement expression
+bool ConstEvaluator::eval_block(ASTNode *p, ConstValue &v) {
+  if (p->type == TTE_LexicalBody) {
+    push_frame();
+    bool ret = eval_block(p->lnoden.stmts, v);
+    pop_frame();
+    return ret;
+  }
+
+  if (p->type == TTE_Expr && p->exprn.op == STMT_EXPR) {
+    ExecResult result = exec(p->exprn.operands[0]);
+    if (result == ER_Error)
+      return false;
+
+    if (result != ER_Normal)
+      return fail(p, "control flow statement in constant expression block is not supported");
+
+    return eval(p->exprn.operands[1], v);
+  }
+
+  return eval(p, v);
+}
+
+bool ConstEvaluator::eval_if(ASTNode *p, ConstValue &v) {
+  size_t ncond = vec_size(p->ifn.conds);
+  for (size_t i = 0; i < ncond; ++i) {
+    ConstValue cond;
+    ASTNode *condnode = (ASTNode *)vec_at(p->ifn.conds, i);
+    if (!eval(condnode, cond))
+      return false;
+
+    if (cond.type != BOOL)
+      return fail(condnode, "condition expression is not `bool` type");
+
+    if (cond.i)
+      return eval_block((ASTNode *)vec_at(p->ifn.bodies, i), v);
+  }
+
+  if (!p->ifn.remain)
+    return fail(p, "`if` expression without `else` part");
+
+  return eval_block(p->ifn.remain, v);
+}
+
+bool ConstEvaluator::eval_expr(ASTNode *p, ConstValue &v) {
+  int op = p->exprn.op;
+  switch (op) {
+  case UMINUS:
+  case BNOT:
+    return eval(p->exprn.operands[0], v) && eval_unary(op, v, p);
+  case LAND:
+  case LOR: {
+    ConstValue a, b;
+    if (!eval(p->exprn.operands[0], a))
+      return false;
+
+    if (a.type != BOOL)
+      return fail(p, "the operand of logic operator is not `bool` type");
+
+    // short circuit as the generated code does
+    if ((op == LAND && !a.i) || (op == LOR && a.i)) {
+      v = a;
+      return true;
+    }
+
+    if (!eval(p->exprn.operands[1], b))
+      return false;
+
+    if (b.type != BOOL)
+      return fail(p, "the operand of logic operator is not `bool` type");
+
+    v = b;
+    return true;
+  }
+  case '+':
+  case '-':
+  case '*':
+  case '/':
+  case '%':
+  case '<':
+  case '>':
+  case GE:
+  case LE:
+  case NE:
+  case EQ:
+  case BAND:
+  case BOR:
+  case BXOR:
+  case SHIFTL:
+  case SHIFTR: {
+    ConstValue a, b;
+    return eval(p->exprn.operands[0], a) && eval(p->exprn.operands[1], b) &&
+      eval_binary(op, a, b, p, v);
+  }
+  case AS:
+    return eval_as(p, v);
+  case SIZEOF: {
+    CADataType *catype = catype_get_by_name(p->symtable, p->exprn.operands[0]->idn.i);
+    if (!catype)
+      return fail(p, "unknown type for `sizeof`");
+
+    v.type = U64;
+    v.untyped = false;
+    v.i = (int64_t)catype->size;
+    v.f = 0;
+    return true;
+  }
+  case LIKELY:
+  case UNLIKELY:
+    return eval(p->exprn.operands[0], v);
+  case FN_CALL:
+    return eval_call(p, v);
+  case STMT_EXPR:
+    return eval_block(p, v);
+  default:
+    return fail(p, "the expression cannot be evaluated in constant");
+  }
+}
+
+bool ConstEvaluator::eval(ASTNode *p, ConstValue &v) {
+  if (!p)
+    return fail(nullptr, "empty constant expression");
+
+  if (!step(p))
+    return false;
+
+  switch (p->type) {
+  case TTE_Literal:
+    return eval_literal(p, v);
+  case TTE_Id:
+    return eval_id(p, v);
+  case TTE_Expr:
+    return eval_expr(p, v);
+  case TTE_If:
+    return eval_if(p, v);
+  case TTE_LexicalBody:
+    return eval_block(p, v);
+  default:
+    return fail(p, "the expression cannot be evaluated in constant");
+  }
+}
+
+ExecResult ConstEvaluator::exec_letbind(ASTNode *p) {
+  CAPattern *cap = p->letbindn.cap;
+  ASTNode *expr = p->letbindn.expr;
+  if (cap->type != PT_Var || cap->morebind) {
+    fail(p, "only simple variable binding can be evaluated in constant");
+    return ER_Error;
+  }
+
+  tokenid_t type = tokenid_novalue;
+  if (cap->datatype != typeid_novalue) {
+    type = scalar_type(cap->datatype, p);
+    if (type == tokenid_novalue)
+      return ER_Error;
+  }
+
+  ConstValue v;
+  if (expr->type == TTE_VarDefZeroValue) {
+    if (type == tokenid_novalue) {
+      fail(p, "the type of zero initialized variable is not specified");
+      return ER_Error;
+    }
+
+    v = ConstValue{type, false, 0, 0};
+  } else {
+    if (!eval(expr, v))
+      return ER_Error;
+
+    if (type != tokenid_novalue ? !convert(v, type, expr) : !settle(v, expr))
+      return ER_Error;
+  }
+
+  _frames.back().push_back(std::make_pair(cap->name, v));
+  return ER_Normal;
+}
+
+ExecResult ConstEvaluator::exec_assign(ASTNode *p) {
+  ASTNode *left = p->assignn.id;
+  if (left->type != TTE_Id) {
+    fail(p, "only the assignment of variable can be evaluated in constant");
+    return ER_Error;
+  }
+
+  ConstValue *var = lookup(left->idn.i);
+  if (!var) {
+    fail(left, "`%s` is not a variable in constant evaluation", symname_get(left->idn.i));
+    return ER_Error;
+  }
+
+  ConstValue v;
+  if (!eval(p->assignn.expr, v))
+    return ER_Error;
+
+  int op = -1;
+  switch (p->assignn.op) {
+  case -1: break;
+  case ASSIGN_ADD: op = '+'; break;
+  case ASSIGN_SUB: op = '-'; break;
+  case ASSIGN_MUL: op = '*'; break;
+  case ASSIGN_DIV: op = '/'; break;
+  case ASSIGN_MOD: op = '%'; break;
+  case ASSIGN_SHIFTL: op = SHIFTL; break;
+  case ASSIGN_SHIFTR: op = SHIFTR; break;
+  case ASSIGN_BAND: op = BAND; break;
+  case ASSIGN_BOR: op = BOR; break;
+  case ASSIGN_BXOR: op = BXOR; break;
+  default:
+    fail(p, "unknown assignment operator `%d` in constant evaluation", p->assignn.op);
+    return ER_Error;
+  }
+
+  if (op != -1 && !eval_binary(op, *var, v, p, v))
+    return ER_Error;
+
+  if (!convert(v, var->type, p))
+    return ER_Error;
+
+  *var = v;
+  return ER_Normal;
+}
+
+ExecResult ConstEvaluator::exec_if(ASTNode *p) {
+  size_t ncond = vec_size(p->ifn.conds);
+  for (size_t i = 0; i < ncond; ++i) {
+    ConstValue cond;
+    ASTNode *condnode = (ASTNode *)vec_at(p->ifn.conds, i);
+    if (!eval(condnode, cond))
+      return ER_Error;
+
+    if (cond.type != BOOL) {
+      fail(condnode, "condition expression is not `bool` type");
+      return ER_Error;
+    }
+
+    if (cond.i)
+      return exec((ASTNode *)vec_at(p->ifn.bodies, i));
+  }
+
+  return p->ifn.remain ? exec(p->ifn.remain) : ER_Normal;
+}
+
+// `cond` is null for `loop`
+ExecResult ConstEvaluator::exec_loop(ASTNode *cond, ASTNode *body) {
+  while (true) {
+    if (cond) {
+      ConstValue v;
+      if (!eval(cond, v))
+        return ER_Error;
+
+      if (v.type != BOOL) {
+        fail(cond, "condition expression is not `bool` type");
+        return ER_Error;
+      }
+
+      if (!v.i)
+        return ER_Normal;
+    }
+
+    ExecResult result = exec(body);
+    switch (result) {
+    case ER_Break:
+      return ER_Normal;
+    case ER_Return:
+    case ER_Error:
+      return result;
+    default:
+      break;
+    }
+  }
+}
+
+ExecResult ConstEvaluator::exec(ASTNode *p) {
+  if (!p || !step(p))
+    return p ? ER_Error : ER_Normal;
+
+  switch (p->type) {
+  case TTE_Empty:
+    return ER_Normal;
+  case TTE_StmtList:
+    for (int i = 0; i < p->stmtlistn.nstmt; ++i) {
+      ExecResult result = exec(p->stmtlistn.stmts[i]);
+      if (result != ER_Normal)
+        return result;
+    }
+    return ER_Normal;
+  case TTE_LexicalBody: {
+    push_frame();
+    ExecResult result = exec(p->lnoden.stmts);
+    pop_frame();
+    return result;
+  }
+  case TTE_LetBind:
+    return exec_letbind(p);
+  case TTE_Assign:
+    return exec_assign(p);
+  case TTE_Ret:
+    if (!p->retn.expr) {
+      fail(p, "function evaluated in constant must return a value");
+      return ER_Error;
+    }
+
+    return eval(p->retn.expr, _retval) ? ER_Return : ER_Error;
+  case TTE_If:
+    if (p->ifn.isexpr)
+      break;
+    return exec_if(p);
+  case TTE_While:
+    return exec_loop(p->whilen.cond, p->whilen.body);
+  case TTE_Loop:
+    return exec_loop(nullptr, p->loopn.body);
+  case TTE_Break:
+    return ER_Break;
+  case TTE_Continue:
+    return ER_Continue;
+  case TTE_Literal:
+  case TTE_Id:
+  case TTE_Expr:
+    break;
+  default:
+    fail(p, "the statement cannot be evaluated in constant");
+    return ER_Error;
+  }
+
+  // the expression statement
+  ConstValue v;
+  return eval(p, v) ? ER_Normal : ER_Error;
+}
+
+// represent the value as a literal with postfix type, e.g. `42i32`, `-1i64`, `1.5f32`
+ASTNode *make_value_literal(const ConstValue &v, ASTNode *expr) {
+  char buffer[64];
+  tokenid_t littypetok = U64;
+
+  if (v.type == BOOL) {
+    littypetok = BOOL;
+    sprintf(buffer, "%d", v.i ? 1 : 0);
+  } else if (catype_is_float(v.type)) {
+    littypetok = F64;
+    snprintf(buffer, sizeof(buffer), "%.17g", v.f);
+    if (!strpbrk(buffer, ".eE"))
+      strcat(buffer, ".0");
+  } else if ((v.untyped || catype_is_signed(v.type)) && v.i < 0) {
+    littypetok = I64;
+    sprintf(buffer, "%ld", v.i);
+  } else {
+    sprintf(buffer, "%lu", (uint64_t)v.i);
+  }
+
+  CALiteral lit;
+  memset(&lit, 0, sizeof(lit));
+  create_literal(&lit, symname_check_insert(buffer), littypetok,
+                 v.untyped || v.type == BOOL ? tokenid_novalue : v.type);
+  lit.catype = nullptr;
+
+  ASTNode *p = new_ASTNode(TTE_Literal);
+  p->litn.litv = lit;
+  p->litn.litv.begloc = expr->begloc;
+  p->litn.litv.endloc = expr->endloc;
+  p->entry = nullptr;
+  set_address(p, &expr->begloc, &expr->endloc);
+  return p;
+}
+
+ASTNode *eval_literal_common(ASTNode *expr, typeid_t type, SymTable *symtable, bool required) {
+  ConstEvaluator evaluator(symtable);
+  ConstValue v;
+  bool ok = evaluator.eval(expr, v);
+  if (ok) {
+    if (type != typeid_novalue) {
+      tokenid_t typetok = evaluator.scalar_type(type, expr);
+      ok = typetok != tokenid_novalue && evaluator.convert(v, typetok, expr);
+    }
+
+    if (ok && catype_is_float(v.type) && !std::isfinite(v.f)) {
+      if (!required)
+        return nullptr;
+
+      caerror(&expr->begloc, &expr->endloc, "the constant value is not a finite number");
+      return nullptr;
+    }
+  }
+
+  if (!ok) {
+    if (!required)
+      return nullptr;
+
+    caerror(&evaluator.errbeg(), &evaluator.errend(), "evaluate constant failed: %s",
+            evaluator.error().c_str());
+    return nullptr;
+  }
+
+  return make_value_literal(v, expr);
+}
+
+} // namespace
+
+BEGIN_EXTERN_C
+
+void const_eval_register_fn(STEntry *entry, ASTNode *fndef) {
+  TFnDeclNode *decl = &fndef->fndefn.fn_decl->fndecln;
+  if (!entry || decl->generic_types || entry->u.f.ca_func_type != CAFT_Function)
+    return;
+
+  s_const_fns[entry] = fndef;
+}
+
+ASTNode *const_eval_literal(ASTNode *expr, typeid_t type, SymTable *symtable) {
+  return eval_literal_common(expr, type, symtable, true);
+}
+
+ASTNode *const_eval_try_literal(ASTNode *expr, typeid_t type, SymTable *symtable) {
+  return eval_literal_common(expr, type, symtable, false);
+}
+
+ASTNode *const_eval_use(STEntry *entry) {
+  ASTNode *p = new_ASTNode(TTE_Literal);
+  ASTNode *lit = entry->u.constant.litnode;
+  p->litn.litv = lit->litn.litv;
+  p->entry = nullptr;
+  p->litn.litv.begloc = (SLoc){glineno_prev, gcolno_prev};
+  p->litn.litv.endloc = (SLoc){glineno, gcolno};
+  set_address(p, &p->litn.litv.begloc, &p->litn.litv.endloc);
+  return p;
+}
+
+uint64_t const_eval_array_len(STEntry *entry) {
+  ASTNode *lit = entry->u.constant.litnode;
+  ConstEvaluator evaluator(lit->symtable);
+  ConstValue v;
+  if (!evaluator.eval(lit, v) || !evaluator.convert(v, v.untyped ? U64 : v.type, lit)) {
+    caerror(&lit->begloc, &lit->endloc, "evaluate constant failed: %s", evaluator.error().c_str());
+    return 0;
+  }
+
+  if (!catype_is_integer(v.type) || v.i < 0) {
+    SLoc stloc = {glineno, gcolno};
+    caerror(&stloc, NULL, "array size `%s` is not a non-negative integer constant",
+            symname_get(entry->sym_name));
+    return 0;
+  }
+
+  return (uint64_t)v.i;
+}
+
+END_EXTERN_C
+
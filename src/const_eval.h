@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+/**
+ * @file The compile time constant evaluation over the AST.
+ *
+ * The expressions of primitive scalar types are evaluated when parsing:
+ * literals, `const` items, arithmetic, comparison, logic and bit operations,
+ * `as` casts, `sizeof` and calls to the functions defined before, whose
+ * bodies only use `let`, assignment, `if`, `while`, `loop` and `return` on
+ * their parameters and local variables.
+ *
+ * The evaluated value is represented as a postfix typed literal node, e.g.
+ * `42i32`, so it is generated as a LLVM constant by the walk routines, it
+ * can be used as array length and initializer of global variables.
+ */
+
+#ifndef __const_eval_h__
+#define __const_eval_h__
+
+#include "ca_parser.h"
+#include "symtable.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+BEGIN_EXTERN_C
+#endif
+
+/// make the function definition `fndef` callable when evaluating constants, `entry` is its symbol entry
+void const_eval_register_fn(STEntry *entry, ASTNode *fndef);
+
+/// evaluate `expr` into a literal of `type` (typeid_novalue for the evaluated type), exit with error when failed
+ASTNode *const_eval_literal(ASTNode *expr, typeid_t type, SymTable *symtable);
+
+/// try evaluating `expr` into a literal of `type`, return NULL when it is not a constant expression
+ASTNode *const_eval_try_literal(ASTNode *expr, typeid_t type, SymTable *symtable);
+
+/// copy the literal of the `const` item `entry` for a use of it
+ASTNode *const_eval_use(STEntry *entry);
+
+/// get the value of the integer `const` item `entry` as an array length
+uint64_t const_eval_array_len(STEntry *entry);
+
+#ifdef __cplusplus
+END_EXTERN_C
+#endif
+
+#endif
+
@@ -106,6 +106,12 @@ void dot_emit_expr(const char *from, const char *to, int op) {
   case UMINUS:
     dot_emit("expr", "-expr");
     break;
+  case LIKELY:
+    dot_emit("expr", "LIKELY '(' expr ')'");
+    break;
+  case UNLIKELY:
+    dot_emit("expr", "UNLIKELY '(' expr ')'");
+    break;
   case '+':
     dot_emit("expr", "expr '+' expr");
     break;
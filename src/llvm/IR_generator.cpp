@@ -10,17 +10,22 @@
  * See the Mulan PSL v2 for more details.
  */
 
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/Type.h"
@@ -34,6 +39,10 @@
 #include "llvm/Support/Host.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils.h"
+#include "llvm/Transforms/Utils/CodeExtractor.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Vectorize.h"
 #include <algorithm>
 #include <assert.h>
 #include <cassert>
@@ -45,6 +54,7 @@
 #include <iostream>
 #include <map>
 #include <memory>
+#include <set>
 #include <sstream>
 #include <stdint.h>
 #include <stdio.h>
@@ -60,12 +70,14 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include "builtins.h"
 #include "ca_parser.h"
 #include "ca_types.h"
 #include "type_system.h"
 #include "type_system_llvm.h"
 #include "ca_runtime.h"
 #include "config.h"
+#include "const_eval.h"
 #include "symtable.h"
 #include "symtable_cpp.h"
 
@@ -73,6 +85,11 @@
 #include "ir1.h"
 #include "jit1.h"
 #include "dwarf_debug.h"
+#include "bounds_check.h"
+#include "abi_lowering.h"
+#include "attr_infer.h"
+#include "profile.h"
+#include "lto.h"
 #include "IR_generator.h"
 
 #define MANGLED_NAME_PREFIX "_CA$"
@@ -90,7 +107,7 @@ enum OperandType {
   OT_Load,
   OT_Store,    // not used yet
   OT_Alloc,
-  OT_CallInst, // use as return value
+  OT_CallInst, // use as return value, the scalar result is SSA only and has no slot
   OT_PHINode,  // not used yet
   OT_HeapAlloc,
 };
@@ -146,6 +163,7 @@ struct LoopControlInfo {
     LT_Loop,
     LT_While,
     LT_For,
+    LT_ParallelFor,
   };
 
   LoopControlInfo(LoopType looptype, int name, llvm::BasicBlock *condbb,
@@ -167,6 +185,9 @@ ir_codegen::IR1 ir1;
 extern SymTable g_root_symtable;
 extern ASTNode *main_fn_node;
 
+// the accessor of the emulated thread local variables in libgcc, see JIT1::create_instance
+extern "C" void *__emutls_get_address(void *control);
+
 /**
  * @brief Perform two iterations:
  *
@@ -265,6 +286,13 @@ static std::unordered_map<typeid_t, void *> g_function_post_check_map;
 
 static std::vector<std::unique_ptr<LoopControlInfo>> g_loop_controls;
 
+/// the generated index checks when `-bounds-check` is set, optimized after each function is generated
+static bounds_check::BoundsCheckOpt g_bounds_check_opt;
+
+/// the C ABI lowering of the functions, see `walk_fn_declare_full_withsym`
+static std::unique_ptr<abi_lowering::ABILowering> g_abi;
+static std::unordered_map<Function *, abi_lowering::FnInfo> g_fn_abi_map;
+
 const static char *box_fn_name = "GC_malloc";
 const static char *drop_fn_name = "GC_free";
 
@@ -456,13 +484,93 @@ static void llvmcode_printf_primitive(Function *fn, CADataType *catype, Value *v
   llvmcode_printf(fn, format, v, nullptr);
 }
 
+static void llvmcode_rt_write(const char *fnname, Type *type, Value *v) {
+  Function *fn = ir1.module().getFunction(fnname);
+  if (!fn) {
+    auto param_names = std::vector<const char *>(1, "v");
+    fn = ir1.gen_extern_fn(ir1.void_type(), fnname, std::vector<Type *>(1, type),
+			   &param_names, false);
+    fn->setCallingConv(CallingConv::C);
+  }
+
+  std::vector<Value *> params(1, v);
+  ir1.builder().CreateCall(fn, params);
+}
+
+/**
+ * @brief Print a primitive value with the ca runtime write functions, each
+ * type has its own entry, so no format string is parsed when running. The
+ * output is the same as the `printf` version (`get_printf_format`).
+ */
+static void llvmcode_rt_write_primitive(CADataType *catype, Value *v) {
+  switch (catype->type) {
+  case I16:
+  case I32:
+  case I64:
+    v = ir1.builder().CreateSExtOrTrunc(v, ir1.int_type<int64_t>());
+    llvmcode_rt_write("ca_rt_write_i64", ir1.int_type<int64_t>(), v);
+    break;
+  case U16:
+  case U32:
+  case U64:
+  case BOOL:
+    v = ir1.builder().CreateZExtOrTrunc(v, ir1.int_type<uint64_t>());
+    llvmcode_rt_write("ca_rt_write_u64", ir1.int_type<uint64_t>(), v);
+    break;
+  case F32:
+  case F64:
+    v = ir1.builder().CreateFPCast(v, ir1.float_type<double>());
+    llvmcode_rt_write("ca_rt_write_f64", ir1.float_type<double>(), v);
+    break;
+  case I8:
+  case U8:
+    llvmcode_rt_write("ca_rt_write_char", ir1.int_type<int8_t>(), v);
+    break;
+  case POINTER:
+    v = ir1.gen_cast_value(ICO::BitCast, v, ir1.intptr_type<int8_t>(), "ptrcast");
+    llvmcode_rt_write("ca_rt_write_ptr", ir1.intptr_type<int8_t>(), v);
+    break;
+  default:
+    llvmcode_rt_write("ca_rt_write_str", ir1.intptr_type<char>(), ir1.get_global_string("\n"));
+    break;
+  }
+}
+
+/// print the constant text, the text is used as format when using printf
+static void llvmcode_print_text(Function *fn, const char *text) {
+  if (genv.rt_print)
+    llvmcode_rt_write("ca_rt_write_str", ir1.intptr_type<char>(), ir1.get_global_string(text));
+  else
+    llvmcode_printf(fn, text, nullptr);
+}
+
+/// print the name followed by the text, the name is a constant known when compiling
+static void llvmcode_print_name_text(Function *fn, const char *name, const char *text) {
+  if (genv.rt_print) {
+    std::string s(name);
+    s += text;
+    llvmcode_print_text(fn, s.c_str());
+  } else {
+    std::string format("%s");
+    format += text;
+    llvmcode_printf(fn, format.c_str(), ir1.get_global_string(name), nullptr);
+  }
+}
+
+static void llvmcode_print_primitive(Function *fn, CADataType *catype, Value *v) {
+  if (genv.rt_print)
+    llvmcode_rt_write_primitive(catype, v);
+  else
+    llvmcode_printf_primitive(fn, catype, v);
+}
+
 static std::unique_ptr<CalcOperand> pop_right_operand(const char *name = "load", bool load = true) {
   std::unique_ptr<CalcOperand> o = std::move(oprand_stack.back());
   oprand_stack.pop_back();
 
   Value *v;
   if (load && o->type == OT_Alloc) {
-    v = ir1.builder().CreateLoad(o->operand, name);
+    v = ir1.load_var(o->operand, name);
     o->type = OT_Load;
     o->operand = v;
   }
@@ -476,7 +584,7 @@ static std::pair<Value *, CADataType *> pop_right_value(const char *name = "load
 
   Value *v;
   if (load && o->type == OT_Alloc) {
-    v = ir1.builder().CreateLoad(o->operand, name);
+    v = ir1.load_var(o->operand, name);
   } else {
     v = o->operand;
   }
@@ -484,7 +592,110 @@ static std::pair<Value *, CADataType *> pop_right_value(const char *name = "load
   return std::make_pair(v, o->catype);
 }
 
+/// the C ABI lowering info of the function, nullptr when it is not lowered, e.g. `main`
+static const abi_lowering::FnInfo *fn_abi_info(Function *fn) {
+  auto itr = g_fn_abi_map.find(fn);
+  return itr == g_fn_abi_map.end() ? nullptr : &itr->second;
+}
+
+/// the return type of the function before the C ABI lowering
+static Type *fn_ca_return_type(Function *fn) {
+  const abi_lowering::FnInfo *abiinfo = fn_abi_info(fn);
+  return abiinfo ? abiinfo->ret.type : fn->getReturnType();
+}
+
+/*
+ * Get the variable slot of a parameter, `argitr` is moved over the llvm
+ * arguments of the parameter. The `byval` memory is a copy owned by the callee,
+ * so it is used as the variable slot directly.
+ */
+static Value *aux_param_slot(const abi_lowering::ArgInfo *info, Type *type, const char *name,
+			     Function::arg_iterator &argitr) {
+  if (!info || info->kind == abi_lowering::AK_Direct)
+    return ir1.gen_var(type, name, &*argitr++);
+
+  if (info->kind == abi_lowering::AK_Indirect)
+    return &*argitr++;
+
+  std::vector<Value *> pieces;
+  for (size_t i = 0; i < info->pieces.size(); ++i)
+    pieces.push_back(&*argitr++);
+
+  AllocaInst *slot = ir1.gen_var(type, name);
+  g_abi->store_pieces(ir1.builder(), slot, *info, pieces);
+  return slot;
+}
+
+/*
+ * Append the argument for parameter `index` into `argv` in the way of the C
+ * ABI, `isaddr` means `v` is the address of the value instead of the value.
+ */
+static void llvmcode_lowered_arg(const abi_lowering::FnInfo *abiinfo, size_t index, Value *v,
+				 bool isaddr, std::vector<Value *> &argv) {
+  const abi_lowering::ArgInfo *info = nullptr;
+  if (abiinfo && index < abiinfo->params.size())
+    info = &abiinfo->params[index];
+
+  if (isaddr && (!info || info->kind == abi_lowering::AK_Direct ||
+		 v->getType() != info->type->getPointerTo())) {
+    v = ir1.builder().CreateLoad(v, "exprarg");
+    isaddr = false;
+  }
+
+  if (!info || info->kind == abi_lowering::AK_Direct) {
+    argv.push_back(v);
+    return;
+  }
+
+  // the value is in register, put it into memory first
+  if (!isaddr)
+    v = ir1.gen_entry_block_var(curr_fn, info->type, "abitmp", v);
+
+  if (info->kind == abi_lowering::AK_Indirect) {
+    argv.push_back(v);
+    return;
+  }
+
+  g_abi->load_pieces(ir1.builder(), v, *info, argv);
+}
+
+/// return the value in `retslot` in the way of the C ABI
+static void llvmcode_lowered_return(const abi_lowering::FnInfo *abiinfo, Value *retslot) {
+  if (abiinfo && abiinfo->ret.kind == abi_lowering::AK_Indirect) {
+    // the value is already written into the `sret` memory
+    ir1.builder().CreateRetVoid();
+    return;
+  }
+
+  if (!abiinfo || abiinfo->ret.kind == abi_lowering::AK_Direct) {
+    Value *v = ir1.builder().CreateLoad(retslot, "retret");
+    ir1.builder().CreateRet(v);
+    return;
+  }
+
+  std::vector<Value *> pieces;
+  g_abi->load_pieces(ir1.builder(), retslot, abiinfo->ret, pieces);
+  Value *v = pieces[0];
+  if (pieces.size() > 1) {
+    v = UndefValue::get(abiinfo->ret.coerced_type());
+    for (unsigned i = 0; i < pieces.size(); ++i)
+      v = ir1.builder().CreateInsertValue(v, pieces[i], i);
+  }
+
+  ir1.builder().CreateRet(v);
+}
+
 static int enable_debug_info() { return genv.emit_debug; }
+
+/// the address of the operand, the SSA only call result is put into a temporary slot first
+static Value *aux_operand_address(CalcOperand *o, const char *name) {
+  if (o->type != OT_CallInst || o->operand->getType()->isVoidTy())
+    return o->operand;
+
+  o->operand = ir1.gen_entry_block_var(curr_fn, o->operand->getType(), name, o->operand);
+  o->type = OT_Alloc;
+  return o->operand;
+}
 static void varshielding_rotate_variable(CAVariableShielding *shielding, bool is_back = false);
 
 static void init_fn_param_info(Function *fn, ST_ArgList &arglist, SymTable *st, int startrow) {
@@ -515,8 +726,12 @@ static void init_fn_param_info(Function *fn, ST_ArgList &arglist, SymTable *st,
     fn_debug_map.insert(std::make_pair(fn, std::move(dbginfo)));
   }
 
-  int i = 0;
-  for (auto &arg: fn->args()) {
+  const abi_lowering::FnInfo *abiinfo = fn_abi_info(fn);
+  Function::arg_iterator argitr = fn->arg_begin();
+  if (abiinfo)
+    std::advance(argitr, abiinfo->prefix());
+
+  for (int i = 0; i < arglist.argc; ++i) {
     int argn = arglist.argnames[i];
     STEntry *entry = sym_getsym(st, argn, 0);
 
@@ -533,24 +748,80 @@ static void init_fn_param_info(Function *fn, ST_ArgList &arglist, SymTable *st,
     CHECK_GET_TYPE_VALUE(curr_fn_node, dt, entry->u.varshielding.current->datatype);
 
     Type *type = llvmtype_from_catype(dt);
-    AllocaInst *slot = ir1.gen_var(type, name, &arg);
+    Value *slot = aux_param_slot(abiinfo ? &abiinfo->params[i] : nullptr, type, name, argitr);
 
     if (enable_debug_info()) {
       DIType *ditype = diinfo->get_ditype(catype_get_type_name(dt->signature)); // get_type_string(dt->type)
-      DILocalVariable *divar = diinfo->dibuilder->createParameterVariable(disp, arg.getName(), i, diunit, row, ditype, true);
+      DILocalVariable *divar = diinfo->dibuilder->createParameterVariable(disp, name, i, diunit, row, ditype, true);
 
       const DILocation *diloc = DILocation::get(disp->getContext(), row, 0, disp);
       diinfo->dibuilder->insertDeclare(slot, divar, diinfo->dibuilder->createExpression(),
 				       diloc, ir1.builder().GetInsertBlock());
     }
 #else
-    Value *slot = &arg;
+    Value *slot = &*argitr++;
 #endif
     // save the value into symbol table
     entry->u.varshielding.current->llvm_value = static_cast<void *>(slot);
     //varshielding_rotate_variable(&entry->u.varshielding, true);
+  }
+}
+
+/*
+ * Use the read only parameters directly instead of their copies. The parameter
+ * is copied into a slot by `init_fn_param_info` because it is not known yet if
+ * it will be assigned or taken address. After the function is generated, the
+ * slot only loaded is removed and the loads are replaced with the parameter.
+ */
+static void promote_readonly_params(Function *fn) {
+  for (Argument &arg : fn->args()) {
+    StoreInst *init = nullptr;
+    for (User *user : arg.users()) {
+      StoreInst *store = dyn_cast<StoreInst>(user);
+      if (store && store->getValueOperand() == &arg && isa<AllocaInst>(store->getPointerOperand()) &&
+	  store->getParent() == &fn->getEntryBlock()) {
+	init = store;
+	break;
+      }
+    }
+
+    if (!init)
+      continue;
+
+    AllocaInst *slot = cast<AllocaInst>(init->getPointerOperand());
+    std::vector<LoadInst *> loads;
+    bool readonly = true;
+    for (User *user : slot->users()) {
+      if (user == init)
+	continue;
+
+      LoadInst *load = dyn_cast<LoadInst>(user);
+      if (!load || load->isVolatile() || load->getType() != arg.getType()) {
+	readonly = false;
+	break;
+      }
+
+      loads.push_back(load);
+    }
+
+    if (!readonly)
+      continue;
+
+    for (LoadInst *load : loads) {
+      load->replaceAllUsesWith(&arg);
+      load->eraseFromParent();
+    }
+
+    if (enable_debug_info()) {
+      for (DbgDeclareInst *declare : FindDbgDeclareUses(slot)) {
+	diinfo->dibuilder->insertDbgValueIntrinsic(&arg, declare->getVariable(), declare->getExpression(),
+						   declare->getDebugLoc().get(), declare);
+	declare->eraseFromParent();
+      }
+    }
 
-    ++i;
+    init->eraseFromParent();
+    slot->eraseFromParent();
   }
 }
 
@@ -575,7 +846,9 @@ static DIType *ditype_create_from_catype(CADataType *catype, DIScope *scope) {
     for (int i = 0; i < catype->struct_layout->fieldnum; ++i) {
       CAStructField &field = catype->struct_layout->fields[i];
       DIType *ditype = ditype_get_or_create_from_catype(field.type, scope);
-      const char *fieldname = catype->struct_layout->type ? nullptr : symname_get(field.name);
+      // the members of enum are the payloads named by the variants
+      bool named = !catype->struct_layout->type || catype->struct_layout->type == Struct_Enum;
+      const char *fieldname = named ? symname_get(field.name) : nullptr;
 
       uint64_t offsetbit = field.offset * 8;
       uint64_t fieldsizebit = field.type->size * 8;
@@ -597,6 +870,12 @@ static DIType *ditype_create_from_catype(CADataType *catype, DIScope *scope) {
     DICompositeType *pty = diinfo->dibuilder->createArrayType(sizeinbit, 0, kernelty, na);
     return pty;
   }
+  case VECTOR: {
+    DIType *kernelty = ditype_get_or_create_from_catype(catype->array_layout->type, scope);
+    DISubrange *subr = diinfo->dibuilder->getOrCreateSubrange(0, catype->array_layout->dimarray[0]);
+    DINodeArray na = diinfo->dibuilder->getOrCreateArray(subr);
+    return diinfo->dibuilder->createVectorType(catype->size * 8, catype->size * 8, kernelty, na);
+  }
   case POINTER: {
     assert(catype->pointer_layout->dimension == 1);
     DIType *pointeety = ditype_get_or_create_from_catype(catype->pointer_layout->type, scope);
@@ -651,11 +930,42 @@ static int is_valued_expr(int op) {
 
 static void walk_empty(ASTNode *p) {}
 
+/// the alignment of memory `ptr` of `type`, it is not always an alloca, e.g. the `byval` parameter
+static Align aux_memory_align(Value *ptr, Type *type) {
+  if (AllocaInst *slot = dyn_cast<AllocaInst>(ptr))
+    return slot->getAlign();
+
+  if (MaybeAlign align = ir1.packed_align(ptr))
+    return *align;
+
+  return ir1.module().getDataLayout().getABITypeAlign(type);
+}
+
+/// raise the alignment of variable `var` to the alignment of the struct `catype`, the llvm
+/// struct type have no alignment of `#[repr(align(N))]`
+static void aux_set_catype_align(Value *var, CADataType *catype) {
+  CADataType *elemtype = catype;
+  while (elemtype->type == ARRAY)
+    elemtype = elemtype->array_layout->type;
+
+  if (elemtype->type != STRUCT)
+    return;
+
+  unsigned align = catype_get_align(catype);
+  if (AllocaInst *slot = dyn_cast<AllocaInst>(var)) {
+    if (align > slot->getAlign().value())
+      slot->setAlignment(Align(align));
+  } else if (GlobalVariable *gvar = dyn_cast<GlobalVariable>(var)) {
+    if (align > gvar->getAlignment())
+      gvar->setAlignment(Align(align));
+  }
+}
+
 static Value *aux_set_zero_to_store(Type *type, Value *var) {
   Type *i8type = ir1.intptr_type<int8_t>();
   Value *i8var = ir1.builder().CreatePointerCast(var, i8type);
   TypeSize size = ir1.module().getDataLayout().getTypeAllocSize(type);
-  Align align = (static_cast<AllocaInst *>(var))->getAlign();
+  Align align = aux_memory_align(var, type);
 
   CallInst *ci = ir1.builder().CreateMemSet(i8var, ir1.gen_int((int8_t)0), size, align);
   return var;
@@ -664,7 +974,9 @@ static Value *aux_set_zero_to_store(Type *type, Value *var) {
 static void aux_copy_llvmvalue_to_store(Type *type, Value *dest, Value *src, const char *name) {
   Type::TypeID id = type->getTypeID();
   if (id != Type::ArrayTyID && id != Type::StructTyID) {
-    ir1.builder().CreateStore(src, dest, name);
+    StoreInst *store = ir1.builder().CreateStore(src, dest, name);
+    if (MaybeAlign align = ir1.packed_align(dest))
+      store->setAlignment(*align);
     return;
   }
 
@@ -674,7 +986,7 @@ static void aux_copy_llvmvalue_to_store(Type *type, Value *dest, Value *src, con
   Value *pint8_srcvalue = ir1.builder().CreatePointerCast(src, pint8type);
 
   TypeSize size = ir1.module().getDataLayout().getTypeAllocSize(type);
-  Align align = (static_cast<AllocaInst *>(dest))->getAlign();
+  Align align = aux_memory_align(dest, type);
 
   ir1.builder().CreateMemCpy(pint8_destvalue, align, pint8_srcvalue, align, size);
 }
@@ -712,7 +1024,7 @@ static Value *get_deref_expr_value(ASTNode *expr) {
   if (entry) {
     assert(entry->u.varshielding.current->llvm_value != nullptr);
     Value *var = static_cast<Value *>(entry->u.varshielding.current->llvm_value);
-    var = ir1.builder().CreateLoad(var, "derefo");
+    var = ir1.load_var(var, "derefo");
     return var;
   }
 
@@ -722,6 +1034,262 @@ static Value *get_deref_expr_value(ASTNode *expr) {
   return var;
 }
 
+// the branch weights of the likely and unlikely edges, the same as clang uses for `__builtin_expect`
+static const uint32_t likely_branch_weight = 2000;
+static const uint32_t unlikely_branch_weight = 1;
+
+/// set the branch weights of `br`, the true edge is likely when `expect` > 0 and unlikely when `expect` < 0
+static void llvmcode_branch_expect(BranchInst *br, int expect) {
+  if (!expect)
+    return;
+
+  MDBuilder mdbuilder(ir1.ctx());
+  MDNode *weights = expect > 0 ?
+    mdbuilder.createBranchWeights(likely_branch_weight, unlikely_branch_weight) :
+    mdbuilder.createBranchWeights(unlikely_branch_weight, likely_branch_weight);
+  br->setMetadata(LLVMContext::MD_prof, weights);
+}
+
+/// return 1 when the condition is `likely(...)`, -1 when it is `unlikely(...)`, otherwise 0
+static int cond_expect(ASTNode *cond) {
+  if (cond->type != TTE_Expr)
+    return 0;
+
+  switch (cond->exprn.op) {
+  case LIKELY:
+    return 1;
+  case UNLIKELY:
+    return -1;
+  default:
+    return 0;
+  }
+}
+
+/**
+ * @brief Generate a runtime check, branch on `cond` to a failure block which
+ * calls `failfn` with `args`, the failure function never returns. The check
+ * passes when `cond` equals to `okwhentrue`, and the code after the check goes
+ * into the ok block.
+ */
+static BranchInst *llvmcode_runtime_check(Value *cond, bool okwhentrue, const char *okname, const char *failname,
+					  Function *failfn, std::vector<Value *> &args) {
+  BasicBlock *okbb = ir1.gen_bb(okname);
+  BasicBlock *failbb = ir1.gen_bb(failname);
+  BranchInst *br = nullptr;
+  if (okwhentrue)
+    br = ir1.builder().CreateCondBr(cond, okbb, failbb);
+  else
+    br = ir1.builder().CreateCondBr(cond, failbb, okbb);
+
+  // the failure block is cold, keep it out of the hot path
+  llvmcode_branch_expect(br, okwhentrue ? 1 : -1);
+
+  curr_fn->getBasicBlockList().push_back(failbb);
+  ir1.builder().SetInsertPoint(failbb);
+  ir1.builder().CreateCall(failfn, args);
+  ir1.builder().CreateUnreachable();
+
+  curr_fn->getBasicBlockList().push_back(okbb);
+  ir1.builder().SetInsertPoint(okbb);
+  return br;
+}
+
+static Function *init_runtime_fail_fn(const char *fnname, std::vector<Type *> &params,
+				      std::vector<const char *> &param_names) {
+  Function *fn = ir1.module().getFunction(fnname);
+  if (fn)
+    return fn;
+
+  fn = ir1.gen_extern_fn(ir1.void_type(), fnname, params, &param_names, false);
+  fn->setCallingConv(CallingConv::C);
+  fn->addFnAttr(Attribute::NoReturn);
+  fn->addFnAttr(Attribute::Cold);
+  fn->addFnAttr(Attribute::NoUnwind);
+  return fn;
+}
+
+/// the thread functions of the runtime, see `ca_runtime_thread.c`
+static Function *init_runtime_thread_fn(const char *fnname) {
+  Function *fn = ir1.module().getFunction(fnname);
+  if (fn)
+    return fn;
+
+  Type *i64type = ir1.int_type<int64_t>();
+  Type *voidptrtype = ir1.int_type<int8_t>()->getPointerTo();
+  std::vector<Type *> params;
+  std::vector<const char *> param_names;
+  Type *rettype = ir1.void_type();
+  if (!strcmp(fnname, "ca_rt_spawn")) {
+    FunctionType *entrytype = FunctionType::get(ir1.void_type(), {voidptrtype}, false);
+    params = {entrytype->getPointerTo(), voidptrtype};
+    param_names = {"fn", "arg"};
+    rettype = i64type;
+  } else if (!strcmp(fnname, "ca_rt_join")) {
+    params = {i64type};
+    param_names = {"handle"};
+  } else { // ca_rt_parallel_for
+    FunctionType *bodytype = FunctionType::get(ir1.void_type(), {i64type, i64type, voidptrtype}, false);
+    params = {i64type, i64type, i64type, bodytype->getPointerTo(), voidptrtype};
+    param_names = {"begin", "end", "grain", "body", "env"};
+  }
+
+  fn = ir1.gen_extern_fn(rettype, fnname, params, &param_names, false);
+  fn->setCallingConv(CallingConv::C);
+  return fn;
+}
+
+static Function *init_bounds_fail_fn() {
+  std::vector<Type *> params(3, ir1.int_type<int64_t>());
+  std::vector<const char *> param_names = {"index", "len", "row"};
+  return init_runtime_fail_fn("ca_rt_bounds_fail", params, param_names);
+}
+
+static Value *aux_index_to_i64(Value *v, tokenid_t type) {
+  if (catype_is_signed(type))
+    return ir1.builder().CreateSExtOrTrunc(v, ir1.int_type<int64_t>());
+  else
+    return ir1.builder().CreateZExtOrTrunc(v, ir1.int_type<int64_t>());
+}
+
+/**
+ * @brief Generate the runtime checking code of `index < bound` (or `index <=
+ * bound` when `inclusive`) for `-bounds-check`, both values are i64 and
+ * compared as unsigned, so a negative index also fails. The failure block
+ * calls `ca_rt_bounds_fail` which never returns, and the code after the check
+ * goes into the new block `boundsokbb`.
+ *
+ * The check is registered into `g_bounds_check_opt`, which removes it when it
+ * can be proved or hoists it when it is loop invariant, after the whole
+ * function is generated.
+ */
+static void llvmcode_bounds_check(Value *index, Value *bound, bool inclusive, int row) {
+  ConstantInt *cindex = dyn_cast<ConstantInt>(index);
+  ConstantInt *cbound = dyn_cast<ConstantInt>(bound);
+  if (cindex && cbound) {
+    uint64_t i = cindex->getZExtValue();
+    uint64_t b = cbound->getZExtValue();
+    if (i < b || (inclusive && i == b))
+      return;
+  }
+
+  Value *inbounds = nullptr;
+  if (inclusive)
+    inbounds = ir1.builder().CreateICmpULE(index, bound, "inbounds");
+  else
+    inbounds = ir1.builder().CreateICmpULT(index, bound, "inbounds");
+
+  std::vector<Value *> args = {index, bound, ir1.gen_int((int64_t)row)};
+  BranchInst *br = llvmcode_runtime_check(inbounds, true, "boundsokbb", "boundsfailbb",
+					  init_bounds_fail_fn(), args);
+  g_bounds_check_opt.add_check(br);
+}
+
+static Function *init_overflow_fail_fn() {
+  std::vector<Type *> params = {ir1.int_type<int32_t>(), ir1.int_type<int64_t>()};
+  std::vector<const char *> param_names = {"op", "row"};
+  return init_runtime_fail_fn("ca_rt_overflow_fail", params, param_names);
+}
+
+/**
+ * @brief Generate the `+`, `-`, `*` operation for `op`, the float operation is
+ * generated directly.
+ *
+ * Without `-overflow-check`, the operation wraps around, it carries no
+ * `nsw`, because the overflow is defined behavior without the check. The
+ * flags are only put where no wrap is proven, e.g. the increment of the index
+ * of `for` statement, see walk_for.
+ *
+ * With `-overflow-check`, it is lowered into the `llvm.[su]{add,sub,mul}.with.overflow`
+ * intrinsics with a failure block calling `ca_rt_overflow_fail`. The cheap
+ * cases need no check: both operands are constant (folded here, overflow is
+ * a compile error), adding or subtracting 0, multiplying by 0 or 1.
+ */
+static Value *llvmcode_arith_op(ASTNode *p, int op, CADataType *catype, Value *v1, Value *v2) {
+  bool issigned = catype_is_signed(catype->type);
+  const char *name = op == '+' ? "add" : (op == '-' ? "sub" : "mul");
+  if (!genv.overflow_check || !catype_is_integer(catype->type)) {
+    switch (op) {
+    case '+':
+      return ir1.gen_add(v1, v2, name);
+    case '-':
+      return ir1.gen_sub(v1, v2, name);
+    default:
+      return ir1.gen_mul(v1, v2, name);
+    }
+  }
+
+  ConstantInt *c1 = dyn_cast<ConstantInt>(v1);
+  ConstantInt *c2 = dyn_cast<ConstantInt>(v2);
+  if (c1 && c2) {
+    bool overflow = false;
+    APInt result;
+    const APInt &a = c1->getValue();
+    const APInt &b = c2->getValue();
+    switch (op) {
+    case '+':
+      result = issigned ? a.sadd_ov(b, overflow) : a.uadd_ov(b, overflow);
+      break;
+    case '-':
+      result = issigned ? a.ssub_ov(b, overflow) : a.usub_ov(b, overflow);
+      break;
+    default:
+      result = issigned ? a.smul_ov(b, overflow) : a.umul_ov(b, overflow);
+      break;
+    }
+
+    if (overflow) {
+      caerror(&(p->begloc), &(p->endloc), "attempt to compute `%s` with overflow on type `%s`",
+	      name, catype_get_type_name(catype->signature));
+      return nullptr;
+    }
+
+    return ConstantInt::get(v1->getType(), result);
+  }
+
+  bool nocheck = false;
+  switch (op) {
+  case '+':
+    nocheck = (c1 && c1->isZero()) || (c2 && c2->isZero());
+    break;
+  case '-':
+    nocheck = c2 && c2->isZero();
+    break;
+  default:
+    nocheck = (c1 && (c1->isZero() || c1->isOne())) || (c2 && (c2->isZero() || c2->isOne()));
+    break;
+  }
+
+  if (nocheck) {
+    switch (op) {
+    case '+':
+      return ir1.gen_add(v1, v2, name, !issigned, issigned);
+    case '-':
+      return ir1.gen_sub(v1, v2, name, !issigned, issigned);
+    default:
+      return ir1.gen_mul(v1, v2, name, !issigned, issigned);
+    }
+  }
+
+  Intrinsic::ID id;
+  switch (op) {
+  case '+':
+    id = issigned ? Intrinsic::sadd_with_overflow : Intrinsic::uadd_with_overflow;
+    break;
+  case '-':
+    id = issigned ? Intrinsic::ssub_with_overflow : Intrinsic::usub_with_overflow;
+    break;
+  default:
+    id = issigned ? Intrinsic::smul_with_overflow : Intrinsic::umul_with_overflow;
+    break;
+  }
+
+  Value *overflow = nullptr;
+  Value *v = ir1.gen_overflow_op(id, v1, v2, &overflow, name);
+  std::vector<Value *> args = {ir1.gen_int((int32_t)op), ir1.gen_int((int64_t)p->begloc.row)};
+  llvmcode_runtime_check(overflow, false, "nooverflowbb", "overflowbb", init_overflow_fail_fn(), args);
+  return v;
+}
+
 static Value *extract_value_from_array(ASTNode *node) {
   assert(node->type == TTE_ArrayItemLeft || node->type == TTE_ArrayItemRight);
   //STEntry *entry = sym_getsym(node->symtable, node->aitemn.varname, 1);
@@ -748,6 +1316,9 @@ static Value *extract_value_from_array(ASTNode *node) {
    * - Converting the array bounds into `llvm::Value` objects.
    * - Inserting code to compare the index value with the bound value.
    * - Printing an error message or exiting the program when the index is out of bounds.
+   *
+   * The checking code is generated by `llvmcode_bounds_check` when
+   * `-bounds-check` is specified.
    */
 
   // NEXT TODO: handle when `arraycatype->type` is slice
@@ -773,7 +1344,12 @@ static Value *extract_value_from_array(ASTNode *node) {
 
   std::vector<Value *> vindices;
   Value *arrayitemvalue = nullptr;
+  int64_t array_len = (int64_t)arraycatype->array_layout->dimarray[0];
+  int row = node->begloc.row;
   if (catype_is_integer(index_catype->type)) {
+    if (genv.bounds_check)
+      llvmcode_bounds_check(aux_index_to_i64(pair.first, index_catype->type), ir1.gen_int(array_len), false, row);
+
     vindices.push_back(ir1.gen_int(0));
     vindices.push_back(pair.first);
 
@@ -789,8 +1365,7 @@ static Value *extract_value_from_array(ASTNode *node) {
     Value *len_value = nullptr;
     Value *valueone = nullptr;
     Value *valuetwo = nullptr;
-
-    int64_t array_len = (int64_t)arraycatype->array_layout->dimarray[0];
+    Value *lenv = ir1.gen_int(array_len);
 
     tokenid_t index_type = tokenid_novalue;
     if (index_catype->range_layout->type == FullRange)
@@ -810,39 +1385,42 @@ static Value *extract_value_from_array(ASTNode *node) {
       valueone = create_default_integer_value(index_catype->range_layout->range->type, 1);
       len_value = ir1.gen_add(pair.first, valueone, "slice_len");
 
-      /*
-       * NEXT TODO: Generate runtime range check code here for when
-       * array size is greater than size(range_layout->end).
-       *
-       * Something like this, but it's in LLVM code style:
-       *
-       * if (len_value <= array_len) {
-       *     runtime_error();
-       * }
-       */
+      // array size > end
+      if (genv.bounds_check)
+	llvmcode_bounds_check(aux_index_to_i64(pair.first, index_type), lenv, false, row);
       break;
     case RightExclusiveRangeTo:
       // The length is the corresponding value of `range_layout->end`
       len_value = pair.first;
 
-      // NEXT TODO: generate the runtime range check code here array
-      // size >= size(range_layout->end)
+      // array size >= end
+      if (genv.bounds_check)
+	llvmcode_bounds_check(aux_index_to_i64(pair.first, index_type), lenv, true, row);
       break;
     case RangeFrom:
-      // NEXT TODO: generate the runtime range check code here for following 3
-      // enum variant array size >= size(range_layout->start)
+      // array size >= start
+      if (genv.bounds_check)
+	llvmcode_bounds_check(aux_index_to_i64(pair.first, index_type), lenv, true, row);
+
       offset_value = pair.first;
       len_value = ir1.gen_int(array_len);
       len_value = ir1.gen_sub(len_value, pair.first, "slice_len");
       break;
     case InclusiveRange:
-      // NEXT TODO: generate the runtime range check code here
-      // array size > size(range_layout->end) (for both start and end)
     case RightExclusiveRange:
-      // NEXT TODO: generate the runtime range check code here
-      // array size >= size(range_layout->end) (for both start and end)
       offset_value = ir1.builder().CreateExtractValue(pair.first, 0);
       valuetwo = ir1.builder().CreateExtractValue(pair.first, 1);
+
+      // start <= end and array size > end (inclusive) or array size >= end
+      if (genv.bounds_check) {
+	Value *startv = aux_index_to_i64(offset_value, index_type);
+	Value *endv = aux_index_to_i64(valuetwo, index_type);
+	bool inclusive = index_catype->range_layout->type == InclusiveRange;
+	Value *end_exclusive = inclusive ? ir1.builder().CreateAdd(endv, ir1.gen_int((int64_t)1)) : endv;
+	llvmcode_bounds_check(startv, end_exclusive, true, row);
+	llvmcode_bounds_check(endv, lenv, !inclusive, row);
+      }
+
       len_value = ir1.gen_sub(valuetwo, offset_value, "slice_len");
       if (index_catype->type == InclusiveRange) {
 	valueone = create_default_integer_value(index_type, 1);
@@ -933,6 +1511,18 @@ static inline bool is_create_global_var(STEntry *entry) {
   return curr_fn == main_fn && (!main_fn || entry->u.varshielding.current->global);
 }
 
+// `#[thread_local]` global variable, the executable is not loaded dynamically
+// so use the faster initial-exec model, the JIT module is loaded at runtime and
+// its thread local variables are emulated by `__emutls_get_address`
+static void aux_set_thread_local(GlobalVariable *gvar, STEntry *entry) {
+  if (!entry->u.varshielding.current->tls)
+    return;
+
+  gvar->setThreadLocalMode(genv.llvm_gen_type == LGT_JIT
+                               ? GlobalValue::GeneralDynamicTLSModel
+                               : GlobalValue::InitialExecTLSModel);
+}
+
 static inline bool is_var_declare(ASTNode *p) {
   return p->type == TTE_Id && p->entry->u.varshielding.current->llvm_value == nullptr;
 }
@@ -950,11 +1540,14 @@ static Value *walk_id_defv_declare(ASTNode *p, CADataType *idtype, bool zeroinit
 
   if (is_create_global_var(entry)) {
     var = ir1.gen_global_var(type, name, defval, false, zeroinitial);
+    aux_set_catype_align(var, idtype);
+    aux_set_thread_local(static_cast<GlobalVariable *>(var), entry);
 
     if (enable_debug_info())
       emit_global_var_dbginfo(name, idtype, p->endloc.row);
   } else {
     var = ir1.gen_entry_block_var(curr_fn, type, name, nullptr);
+    aux_set_catype_align(var, idtype);
 
     if (zeroinitial)
       aux_set_zero_to_store(type, var);
@@ -986,13 +1579,13 @@ static Value *inplace_assignop_assistant(ASTNode *p, CADataType *idtype, Type *t
 
   switch(assignop) {
   case ASSIGN_ADD:
-    vr = ir1.gen_add(vl, vr);
+    vr = llvmcode_arith_op(p, '+', idtype, vl, vr);
     break;
   case ASSIGN_SUB:
-    vr = ir1.gen_sub(vl, vr);
+    vr = llvmcode_arith_op(p, '-', idtype, vl, vr);
     break;
   case ASSIGN_MUL:
-    vr = ir1.gen_mul(vl, vr);
+    vr = llvmcode_arith_op(p, '*', idtype, vl, vr);
     break;
   case ASSIGN_DIV:
     vr = ir1.gen_div(vl, vr);
@@ -1059,7 +1652,7 @@ static Value *walk_id_defv(ASTNode *p, CADataType *idtype, int assignop = -1, bo
   case TTE_DerefLeft:
     var = get_deref_expr_value(p->deleftn.expr);
     for (int i = 0; i < p->deleftn.derefcount - 1; ++i)
-      var = ir1.builder().CreateLoad(var, "deref");
+      var = ir1.load_var(var, "deref");
     break;
   case TTE_ArrayItemLeft:
     var = extract_value_from_array(p);
@@ -1245,6 +1838,12 @@ static void walk_break(ASTNode *p) {
   if (enable_debug_info())
     diinfo->emit_location(p->endloc.row, p->endloc.col, curr_lexical_scope->discope);
 
+  // the iterations of a chunk are not in order with others, they cannot stop the loop
+  if (g_loop_controls.back()->looptype == LoopControlInfo::LT_ParallelFor) {
+    caerror(&p->begloc, &p->endloc, "cannot break out of `parallel for`");
+    return;
+  }
+
   ir1.builder().CreateBr(g_loop_controls.back()->outbb);
 
   BasicBlock *extrabb = ir1.gen_bb("extra", curr_fn);
@@ -1297,9 +1896,20 @@ static bool is_forstmt_pointer_var(ForStmtId forvar) {
   return forvar.vartype == '*';
 }
 
+/// attach `!llvm.loop` to the branch of the latch block, the loop without
+/// side effect is assumed to terminate as C++ does
+static void aux_set_loop_metadata(Instruction *latch) {
+  LLVMContext &ctx = ir1.ctx();
+  auto tempnode = MDNode::getTemporary(ctx, None);
+  Metadata *mds[] = {tempnode.get(), MDNode::get(ctx, MDString::get(ctx, "llvm.loop.mustprogress"))};
+  MDNode *loopid = MDNode::getDistinct(ctx, mds);
+  loopid->replaceOperandWith(0, loopid);
+  latch->setMetadata(LLVMContext::MD_loop, loopid);
+}
+
 static Value *aux_create_compare_value_for(ASTNode *p, CADataType *list_catype, CADataType *item_catype,
 					   Value *curr_value, Value *end_cond_value) {
-  if (list_catype->type == ARRAY) {
+  if (list_catype->type != RANGE) {
     return ir1.builder().CreateICmpULT(curr_value, end_cond_value);
   }
 
@@ -1337,38 +1947,322 @@ static Value *aux_create_compare_value_for(ASTNode *p, CADataType *list_catype,
   return ltv;
 }
 
-static void walk_for(ASTNode *p) {
-  if (walk_pass == 1) {
-    walk_stack(p->forn.body);
-    return;
-  }
+/*
+ * Get the bounds [lo, hi) of the range which is constructed with constant
+ * start and end, e.g. `0..10`, by looking the stores into the fresh range
+ * structure created by `walk_expr_tuple_common`. It is used for proving the
+ * index checks with the variable of `for` statement.
+ */
+static bool aux_constant_range_bounds(Value *range, tokenid_t type, bool inclusive, int64_t &lo, int64_t &hi) {
+  AllocaInst *slot = dyn_cast<AllocaInst>(range);
+  if (!slot)
+    return false;
 
-  if (!curr_fn)
-    return;
+  ConstantInt *bounds[2] = {nullptr, nullptr};
+  for (User *user : slot->users()) {
+    if (isa<LoadInst>(user))
+      continue;
 
-  BasicBlock *condbb = ir1.gen_bb("condbb");
-  BasicBlock *loopbb = ir1.gen_bb("loopbb");
-  BasicBlock *endloopbb = ir1.gen_bb("endloopbb");
+    GetElementPtrInst *gep = dyn_cast<GetElementPtrInst>(user);
+    if (!gep || gep->getPointerOperand() != slot || gep->getNumIndices() != 2)
+      return false;
 
-  if (enable_debug_info())
-    diinfo->emit_location(p->forn.listnode->endloc.row, p->forn.listnode->endloc.col, curr_lexical_scope->discope);
+    ConstantInt *field = dyn_cast<ConstantInt>(gep->getOperand(2));
+    if (!field || field->getZExtValue() > 1)
+      return false;
 
-  /*
-   * TODO: Currently, only support iterator arrays and ranges. Later,
-   * support generator lists, e.g., (1..6). The generator lists will
-   * also need allocation similar to variables.
-   */
+    for (User *gepuser : gep->users()) {
+      StoreInst *store = dyn_cast<StoreInst>(gepuser);
+      ConstantInt *v = store ? dyn_cast<ConstantInt>(store->getValueOperand()) : nullptr;
+      if (!v || store->getPointerOperand() != gep || bounds[field->getZExtValue()])
+	return false;
 
-  // prepare list nodes and the variable
+      bounds[field->getZExtValue()] = v;
+    }
+  }
+
+  if (!bounds[0] || !bounds[1])
+    return false;
+
+  if (catype_is_signed(type)) {
+    lo = bounds[0]->getSExtValue();
+    hi = bounds[1]->getSExtValue();
+  } else {
+    if (bounds[0]->getZExtValue() > INT64_MAX || bounds[1]->getZExtValue() > INT64_MAX)
+      return false;
+
+    lo = (int64_t)bounds[0]->getZExtValue();
+    hi = (int64_t)bounds[1]->getZExtValue();
+  }
+
+  return !inclusive || !__builtin_add_overflow(hi, 1, &hi);
+}
+
+/*
+ * The inclusive range whose end is the maximum value of the item type, e.g.
+ * `0..=255u8`, never stops, the index wraps around before it passes the end.
+ * Such loop must not be marked with mustprogress, it is only known to stop
+ * when the end is a constant below the maximum value.
+ */
+static bool aux_range_may_not_terminate(Value *range, CADataType *list_catype, CADataType *itemcatype) {
+  if (list_catype->type != RANGE || !list_catype->range_layout->inclusive)
+    return false;
+
+  int64_t lo = 0, end = 0;
+  if (!aux_constant_range_bounds(range, itemcatype->type, false, lo, end))
+    return true;
+
+  unsigned bits = llvmtype_from_catype(itemcatype)->getIntegerBitWidth();
+  if (catype_is_signed(itemcatype->type))
+    return end >= APInt::getSignedMaxValue(bits).getSExtValue();
+
+  return (uint64_t)end >= APInt::getMaxValue(bits).getZExtValue();
+}
+
+/**
+ * @brief Generate `parallel for` over a range, the range is split into chunks
+ * and run by `ca_rt_parallel_for` on the thread pool of the runtime.
+ *
+ * The loop over one chunk [lo, hi) is generated in the current function like
+ * a normal `for`, then its blocks are outlined into a new function by the
+ * code extractor of LLVM, the values defined out of the loop become the
+ * parameters, e.g. the address of the variables used in the body. The
+ * outlined function is called through a wrapper of the signature required by
+ * the runtime: `void (i64 lo, i64 hi, i8 *env)`, where `env` points to a
+ * struct of the other parameters.
+ *
+ * The body is run concurrently, the variables out of the loop are shared by
+ * all threads, the writes to them should be atomic.
+ */
+static void walk_for_parallel(ASTNode *p, Value *lists, CADataType *list_catype, CADataType *itemcatype,
+			      CAVariable *cavar) {
+  IRBuilder<> &builder = ir1.builder();
+  Type *i64type = ir1.int_type<int64_t>();
+  Type *item_type = llvmtype_from_catype(itemcatype);
+
+  // the bounds of the whole range in i64, the end is exclusive. The runtime
+  // compares the bounds as signed, so the u64 index is biased by flipping the
+  // sign bit, which keeps the order of the values above INT64_MAX
+  Value *listsv = builder.CreateLoad(lists);
+  Value *beginv = aux_index_to_i64(builder.CreateExtractValue(listsv, 0, "parbegin"), itemcatype->type);
+  Value *endv = aux_index_to_i64(builder.CreateExtractValue(listsv, 1, "parend"), itemcatype->type);
+  Value *biasv = itemcatype->type == U64 ? ir1.gen_int((int64_t)INT64_MIN) : nullptr;
+  if (biasv) {
+    beginv = builder.CreateXor(beginv, biasv, "parbegin");
+    endv = builder.CreateXor(endv, biasv, "parend");
+  }
+
+  // `end + 1` of the inclusive range overflows when the end is the maximum
+  // value of i64 or u64, it is rejected for the constant end, or checked at runtime
+  if (list_catype->range_layout->inclusive) {
+    int64_t lo = 0, end = 0;
+    bool wide = itemcatype->type == I64 || itemcatype->type == U64;
+    if (!wide || !aux_range_may_not_terminate(lists, list_catype, itemcatype)) {
+      endv = builder.CreateAdd(endv, ir1.gen_int((int64_t)1), "parend", false, true);
+    } else if (aux_constant_range_bounds(lists, itemcatype->type, false, lo, end)) {
+      caerror(&p->forn.listnode->begloc, &p->forn.listnode->endloc,
+	      "the inclusive range of `parallel for` cannot end at the maximum value of `%s`",
+	      catype_get_type_name(itemcatype->signature));
+      return;
+    } else {
+      Value *overflow = nullptr;
+      endv = ir1.gen_overflow_op(Intrinsic::sadd_with_overflow, endv, ir1.gen_int((int64_t)1), &overflow, "parend");
+      std::vector<Value *> args = {ir1.gen_int((int32_t)'+'), ir1.gen_int((int64_t)p->begloc.row)};
+      llvmcode_runtime_check(overflow, false, "parendokbb", "parendfailbb", init_overflow_fail_fn(), args);
+    }
+  }
+
+  // the allocas created by the body are put into the entry block, they are moved into the chunk later
+  std::set<Instruction *> prevallocas;
+  for (Instruction &inst : curr_fn->getEntryBlock()) {
+    if (isa<AllocaInst>(inst))
+      prevallocas.insert(&inst);
+  }
+
+  BasicBlock *entrybb = ir1.gen_bb("parentrybb");
+  BasicBlock *condbb = ir1.gen_bb("parcondbb");
+  BasicBlock *loopbb = ir1.gen_bb("parloopbb");
+  BasicBlock *endloopbb = ir1.gen_bb("parendloopbb");
+  builder.CreateBr(entrybb);
+
+  // 1. each chunk has its own index and item variable, beginv and endv are the bounds of the chunk here
+  curr_fn->getBasicBlockList().push_back(entrybb);
+  builder.SetInsertPoint(entrybb);
+  Value *indexvslot = builder.CreateAlloca(i64type, nullptr, "idx");
+  const char *itemname = symname_get(cavar->name);
+  Value *itemvar = builder.CreateAlloca(item_type, nullptr, itemname);
+  if (enable_debug_info())
+    emit_local_var_dbginfo(curr_fn, itemname, itemcatype, itemvar, p->forn.listnode->endloc.row);
+
+  cavar->llvm_value = static_cast<void *>(itemvar);
+  builder.CreateStore(beginv, indexvslot);
+  builder.CreateBr(condbb);
+
+  // 2. the loop of the chunk
+  curr_fn->getBasicBlockList().push_back(condbb);
+  builder.SetInsertPoint(condbb);
+  Value *indexv = builder.CreateLoad(indexvslot, "idxv");
+  builder.CreateCondBr(builder.CreateICmpSLT(indexv, endv), loopbb, endloopbb);
+
+  curr_fn->getBasicBlockList().push_back(loopbb);
+  builder.SetInsertPoint(loopbb);
+  Value *itemv = biasv ? builder.CreateXor(indexv, biasv) : indexv;
+  builder.CreateStore(builder.CreateTrunc(itemv, item_type), itemvar);
+  builder.CreateStore(builder.CreateAdd(indexv, ir1.gen_int((int64_t)1), "", false, true), indexvslot);
+
+  if (enable_debug_info())
+    diinfo->emit_location(p->forn.body->begloc.row, p->forn.body->begloc.col, curr_lexical_scope->discope);
+
+  g_loop_controls.push_back(std::make_unique<LoopControlInfo>(LoopControlInfo::LT_ParallelFor, -1, condbb, endloopbb));
+  walk_stack(p->forn.body);
+  g_loop_controls.pop_back();
+
+  if (enable_debug_info())
+    diinfo->emit_location(p->forn.body->endloc.row, p->forn.body->endloc.col, curr_lexical_scope->discope);
+
+  builder.CreateBr(condbb);
+
+  // 3. the blocks of the loop are the ones after entrybb, the only exit should be endloopbb
+  std::vector<BasicBlock *> blocks;
+  for (auto itr = entrybb->getIterator(); itr != curr_fn->end(); ++itr)
+    blocks.push_back(&*itr);
+
+  // the `return f(x)` and `become f(x)` returns directly, the `ret` have no successors
+  std::set<BasicBlock *> blockset(blocks.begin(), blocks.end());
+  for (BasicBlock *bb : blocks) {
+    if (isa_and_nonnull<ReturnInst>(bb->getTerminator())) {
+      caerror(&p->begloc, &p->endloc, "cannot return or jump out of `parallel for`");
+      return;
+    }
+
+    for (BasicBlock *succ : successors(bb)) {
+      if (!blockset.count(succ) && succ != endloopbb) {
+	caerror(&p->begloc, &p->endloc, "cannot return or jump out of `parallel for`");
+	return;
+      }
+    }
+  }
+
+  BasicBlock &fnentrybb = curr_fn->getEntryBlock();
+  for (auto itr = fnentrybb.begin(); itr != fnentrybb.end();) {
+    AllocaInst *alloca = dyn_cast<AllocaInst>(&*itr++);
+    if (!alloca || prevallocas.count(alloca))
+      continue;
+
+    bool inloop = std::all_of(alloca->user_begin(), alloca->user_end(), [&blockset](User *user) {
+      Instruction *inst = dyn_cast<Instruction>(user);
+      return inst && blockset.count(inst->getParent());
+    });
+
+    if (inloop)
+      alloca->moveBefore(&entrybb->front());
+  }
+
+  curr_fn->getBasicBlockList().push_back(endloopbb);
+
+  // 4. outline the loop, the allocas in it become local variables of the new function
+  CodeExtractor extractor(blocks, nullptr, false, nullptr, nullptr, nullptr, false, true, "parbody");
+  CodeExtractorAnalysisCache ceac(*curr_fn);
+  Function *bodyfn = extractor.isEligible() ? extractor.extractCodeRegion(ceac) : nullptr;
+  if (!bodyfn || !bodyfn->hasOneUse()) {
+    caerror(&p->begloc, &p->endloc, "cannot generate the body of `parallel for`");
+    return;
+  }
+
+  // the allocas are kept in the block after the entry by the extractor, move them into the entry to be promoted
+  BasicBlock &bodyentrybb = bodyfn->getEntryBlock();
+  for (BasicBlock &bb : *bodyfn) {
+    for (auto itr = bb.begin(); &bb != &bodyentrybb && itr != bb.end();) {
+      AllocaInst *alloca = dyn_cast<AllocaInst>(&*itr++);
+      if (alloca && isa<ConstantInt>(alloca->getArraySize()))
+	alloca->moveBefore(&bodyentrybb.front());
+    }
+  }
+
+  if (genv.bounds_check)
+    g_bounds_check_opt.run(*bodyfn);
+
+  // 5. the wrapper function called by the runtime for each chunk
+  CallInst *bodycall = cast<CallInst>(*bodyfn->user_begin());
+  std::vector<Type *> envtypes;
+  std::vector<Value *> envvalues;
+  for (Value *arg : bodycall->args()) {
+    if (arg != beginv && arg != endv) {
+      envtypes.push_back(arg->getType());
+      envvalues.push_back(arg);
+    }
+  }
+
+  StructType *envtype = StructType::get(ir1.ctx(), envtypes);
+  Function *parallelfn = init_runtime_thread_fn("ca_rt_parallel_for");
+  FunctionType *wrappertype = cast<FunctionType>(parallelfn->getArg(3)->getType()->getPointerElementType());
+  Function *wrapper = Function::Create(wrappertype, GlobalValue::InternalLinkage, bodyfn->getName() + ".chunk",
+				       &ir1.module());
+  IRBuilder<> wrapperbuilder(BasicBlock::Create(ir1.ctx(), "entry", wrapper));
+  Value *envp = wrapperbuilder.CreateBitCast(wrapper->getArg(2), envtype->getPointerTo(), "env");
+  std::vector<Value *> bodyargs;
+  unsigned envidx = 0;
+  for (Value *arg : bodycall->args()) {
+    if (arg == beginv) {
+      bodyargs.push_back(wrapper->getArg(0));
+    } else if (arg == endv) {
+      bodyargs.push_back(wrapper->getArg(1));
+    } else {
+      Value *fieldp = wrapperbuilder.CreateStructGEP(envtype, envp, envidx++);
+      bodyargs.push_back(wrapperbuilder.CreateLoad(envtypes[envidx - 1], fieldp));
+    }
+  }
+
+  wrapperbuilder.CreateCall(bodyfn, bodyargs);
+  wrapperbuilder.CreateRetVoid();
+
+  // 6. replace the call of the outlined function with the runtime
+  DebugLoc savedloc = builder.getCurrentDebugLocation();
+  builder.SetInsertPoint(bodycall);
+  Value *envslot = ir1.gen_entry_block_var(curr_fn, envtype, "parenv");
+  for (unsigned i = 0; i < envvalues.size(); ++i)
+    builder.CreateStore(envvalues[i], builder.CreateStructGEP(envtype, envslot, i));
+
+  Value *envarg = builder.CreateBitCast(envslot, parallelfn->getArg(4)->getType());
+  builder.CreateCall(parallelfn, {beginv, endv, ir1.gen_int((int64_t)0), wrapper, envarg});
+  bodycall->eraseFromParent();
+
+  builder.SetInsertPoint(endloopbb);
+  builder.SetCurrentDebugLocation(savedloc);
+}
+
+static void walk_for(ASTNode *p) {
+  if (walk_pass == 1) {
+    walk_stack(p->forn.body);
+    return;
+  }
+
+  if (!curr_fn)
+    return;
+
+  BasicBlock *condbb = ir1.gen_bb("condbb");
+  BasicBlock *loopbb = ir1.gen_bb("loopbb");
+  BasicBlock *endloopbb = ir1.gen_bb("endloopbb");
+
+  if (enable_debug_info())
+    diinfo->emit_location(p->forn.listnode->endloc.row, p->forn.listnode->endloc.col, curr_lexical_scope->discope);
+
+  /*
+   * TODO: Currently, only support iterator arrays and ranges. Later,
+   * support generator lists, e.g., (1..6). The generator lists will
+   * also need allocation similar to variables.
+   */
+
+  // prepare list nodes and the variable
   inference_expr_type(p->forn.listnode);
   walk_stack(p->forn.listnode);
   auto pair = pop_right_value("list", false);
   Value *lists = pair.first;
 
   CADataType *list_catype = pair.second;
-  if (list_catype->type != ARRAY && list_catype->type != RANGE) {
+  if (list_catype->type != ARRAY && list_catype->type != SLICE && list_catype->type != RANGE) {
     caerror(&(p->forn.listnode->begloc), &(p->forn.listnode->endloc),
-	    "currently only support iterate array and range type in for statement, but find `%s`",
+	    "currently only support iterate array, slice and range type in for statement, but find `%s`",
 	    catype_get_type_name(list_catype->signature));
     return;
   }
@@ -1390,7 +2284,16 @@ static void walk_for(ASTNode *p) {
   case ARRAY:
     itemcatype = list_catype->array_layout->type;
     break;
+  case SLICE:
+    itemcatype = list_catype->struct_layout->fields[0].type->pointer_layout->type;
+    break;
   case RANGE:
+    if (forvar.vartype) {
+      caerror(&p->forn.listnode->begloc, &p->forn.listnode->endloc,
+	      "the values of range cannot be iterated by pointer or reference");
+      return;
+    }
+
     if (list_catype->range_layout->range->type == STRUCT)
       itemcatype = list_catype->range_layout->range->struct_layout->fields[0].type;
     else
@@ -1407,6 +2310,19 @@ static void walk_for(ASTNode *p) {
     break;
   }
 
+  if (p->forn.parallel) {
+    if (list_catype->type != RANGE) {
+      caerror(&p->forn.listnode->begloc, &p->forn.listnode->endloc,
+	      "`parallel for` only support iterate range type, but find `%s`",
+	      catype_get_type_name(list_catype->signature));
+      return;
+    }
+
+    cavar->datatype = itemcatype->signature;
+    walk_for_parallel(p, lists, list_catype, itemcatype, cavar);
+    return;
+  }
+
   if (is_forstmt_pointer_var(forvar)) {
     itemcatype = catype_make_pointer_type(itemcatype);
   }
@@ -1417,9 +2333,11 @@ static void walk_for(ASTNode *p) {
   Value *valuezero = ir1.gen_int((size_t)0);
   Value *valueone = nullptr;
 
-  // 1. initial condition and terminate condition
+  // 1. initial condition and terminate condition, they are evaluated once
+  // before the loop, so the trip count is known
   Value *begin_cond_v = nullptr;
   Value *end_cond_v = nullptr;
+  Value *elems = nullptr;
   if (list_catype->type == ARRAY) {
     size_t listsize = list_catype->array_layout->dimarray[0];
     valueone = ir1.gen_int((size_t)1);
@@ -1428,6 +2346,13 @@ static void walk_for(ASTNode *p) {
 
     // list size llvm value
     end_cond_v = ir1.gen_int(listsize);
+  } else if (list_catype->type == SLICE) {
+    // the slice is `{ptr, len}`, see llvmcode_create_slice
+    Value *slicev = lists->getType()->isPointerTy() ? ir1.builder().CreateLoad(lists, "slice") : lists;
+    valueone = ir1.gen_int((size_t)1);
+    begin_cond_v = valuezero;
+    elems = ir1.builder().CreateExtractValue(slicev, 0, "sliceptr");
+    end_cond_v = ir1.builder().CreateExtractValue(slicev, 1, "slicelen");
   } else { // range
     valueone = create_default_integer_value(itemcatype->type, 1);
 
@@ -1448,35 +2373,37 @@ static void walk_for(ASTNode *p) {
 
   Type *item_type = llvmtype_from_catype(itemcatype);
 
-  Type *index_type = nullptr;
-  if (list_catype->type == ARRAY) {
-    index_type = ir1.int_type<size_t>();
-  } else {
-    index_type = item_type;
-  }
-
-  // 2. value index slot
-  Value *indexvslot = ir1.gen_entry_block_var(curr_fn, index_type, "idx", begin_cond_v);
-
-  // 3. generate item variable value used in for body
+  // 2. generate item variable value used in for body, the reference variable
+  // is the address of the item in list, it have no memory of its own
   const char *itemname = symname_get(cavar->name);
-  Value *itemvar = ir1.gen_entry_block_var(curr_fn, item_type, itemname, nullptr);
-  if (enable_debug_info())
-    emit_local_var_dbginfo(curr_fn, itemname, itemcatype, itemvar, p->forn.listnode->endloc.row);
+  Value *itemvar = nullptr;
+  if (forvar.vartype != '&') {
+    itemvar = ir1.gen_entry_block_var(curr_fn, item_type, itemname, nullptr);
+    if (enable_debug_info())
+      emit_local_var_dbginfo(curr_fn, itemname, itemcatype, itemvar, p->forn.listnode->endloc.row);
 
-  cavar->llvm_value = static_cast<void *>(itemvar);
+    cavar->llvm_value = static_cast<void *>(itemvar);
+  }
+
+  // the variable only holds the values of the range, the index checks with it may be removed
+  if (genv.bounds_check && list_catype->type == RANGE && !is_forstmt_pointer_var(forvar)) {
+    int64_t lo = 0, hi = 0;
+    if (aux_constant_range_bounds(lists, itemcatype->type, list_catype->range_layout->inclusive, lo, hi))
+      g_bounds_check_opt.add_var_range(static_cast<AllocaInst *>(itemvar), lo, hi);
+  }
 
+  BasicBlock *preheaderbb = ir1.builder().GetInsertBlock();
   ir1.builder().CreateBr(condbb);
 
   // condition block
   curr_fn->getBasicBlockList().push_back(condbb);
   ir1.builder().SetInsertPoint(condbb);
 
-  // branch according to the list nodes, when there is no node left then out else loop again
-  // 4. load value index value
-  Value *indexv = ir1.builder().CreateLoad(indexvslot, "idxv");
+  // 3. the index is the induction variable in register, the next value comes from incbb
+  PHINode *indexv = ir1.builder().CreatePHI(begin_cond_v->getType(), 2, "idxv");
+  indexv->addIncoming(begin_cond_v, preheaderbb);
 
-  // 5. compare condition index value with terminate condition
+  // 4. compare condition index value with terminate condition
   Value *ltv = aux_create_compare_value_for(p, list_catype, itemcatype, indexv, end_cond_v);
 
   ir1.builder().CreateCondBr(ltv, loopbb, endloopbb);
@@ -1484,43 +2411,62 @@ static void walk_for(ASTNode *p) {
   curr_fn->getBasicBlockList().push_back(loopbb);
   ir1.builder().SetInsertPoint(loopbb);
 
-  // copy array item value into the variable
-  
-  // 6. get item value from list
-  // TODO: handle the reference type variable
+  // 5. get item from list, the pointer and reference variable use the
+  // address of the item without copying it
   Value *listitemv = nullptr;
-  if (list_catype->type == ARRAY) {
-    std::vector<Value *> idxv(2, valuezero);
-    idxv[1] = indexv;
-    Value *listitemvslot = ir1.builder().CreateInBoundsGEP(lists, idxv);
+  if (list_catype->type == ARRAY || list_catype->type == SLICE) {
+    Value *listitemvslot = nullptr;
+    if (list_catype->type == ARRAY) {
+      std::vector<Value *> idxv(2, valuezero);
+      idxv[1] = indexv;
+      listitemvslot = ir1.builder().CreateInBoundsGEP(lists->getType()->getPointerElementType(), lists, idxv, "itemp");
+    } else {
+      listitemvslot = ir1.builder().CreateInBoundsGEP(elems->getType()->getPointerElementType(), elems, indexv, "itemp");
+    }
+
     bool iscomplextype = catype_is_complex_type(itemcatype);
     listitemv = listitemvslot;
-    if (!iscomplextype && !is_forstmt_pointer_var(forvar))
+    if (!iscomplextype && !forvar.vartype)
       listitemv = ir1.builder().CreateLoad(listitemvslot);
   } else { // range
     listitemv = indexv;
   }
 
-  // 7. copy value from list item to item variable
-  aux_copy_llvmvalue_to_store(item_type, itemvar, listitemv, "auxi");
-
-  // 8. get next index and store into slot
-  // increment the index
-  Value *indexloadv = ir1.builder().CreateLoad(indexvslot, "idxv");
-  Value *incv = ir1.builder().CreateAdd(indexloadv, valueone);
-  ir1.builder().CreateStore(incv, indexvslot);
+  // 6. copy value from list item to item variable
+  if (itemvar) {
+    aux_copy_llvmvalue_to_store(item_type, itemvar, listitemv, "auxi");
+  } else {
+    cavar->llvm_value = static_cast<void *>(listitemv);
+    if (enable_debug_info())
+      emit_local_var_dbginfo(curr_fn, itemname, itemcatype, listitemv, p->forn.listnode->endloc.row);
+  }
 
   if (enable_debug_info())
     diinfo->emit_location(p->forn.body->begloc.row, p->forn.body->begloc.col, curr_lexical_scope->discope);
 
-  g_loop_controls.push_back(std::make_unique<LoopControlInfo>(LoopControlInfo::LT_For, -1, condbb, endloopbb));
+  // `continue` goes to incbb which steps the index
+  BasicBlock *incbb = ir1.gen_bb("incbb");
+  g_loop_controls.push_back(std::make_unique<LoopControlInfo>(LoopControlInfo::LT_For, -1, incbb, endloopbb));
   walk_stack(p->forn.body);
   g_loop_controls.pop_back();
 
   if (enable_debug_info())
     diinfo->emit_location(p->forn.body->endloc.row, p->forn.body->endloc.col, curr_lexical_scope->discope);
 
-  ir1.builder().CreateBr(condbb);
+  ir1.builder().CreateBr(incbb);
+
+  // 7. get next index, the index never exceeds the end of an array, a slice
+  // or an exclusive range, so the increment cannot wrap
+  curr_fn->getBasicBlockList().push_back(incbb);
+  ir1.builder().SetInsertPoint(incbb);
+  bool nowrap = list_catype->type != RANGE || !list_catype->range_layout->inclusive;
+  bool issigned = list_catype->type == RANGE && catype_is_signed(itemcatype->type);
+  Value *incv = ir1.builder().CreateAdd(indexv, valueone, "idxnext", nowrap && !issigned, nowrap && issigned);
+  indexv->addIncoming(incv, incbb);
+
+  BranchInst *latch = ir1.builder().CreateBr(condbb);
+  if (!aux_range_may_not_terminate(lists, list_catype, itemcatype))
+    aux_set_loop_metadata(latch);
 
   curr_fn->getBasicBlockList().push_back(endloopbb);
   ir1.builder().SetInsertPoint(endloopbb);
@@ -1634,7 +2580,8 @@ static void walk_while(ASTNode *p) {
     return;
   }
 
-  ir1.builder().CreateCondBr(cond, whilebb, endwhilebb);
+  BranchInst *br = ir1.builder().CreateCondBr(cond, whilebb, endwhilebb);
+  llvmcode_branch_expect(br, cond_expect(p->whilen.cond));
 
   curr_fn->getBasicBlockList().push_back(whilebb);
   ir1.builder().SetInsertPoint(whilebb);
@@ -1707,7 +2654,8 @@ static void walk_if_common(ASTNode *p) {
   ASTNode *firstbody = static_cast<ASTNode *>(vec_at(p->ifn.bodies, 0));
   if (p->ifn.remain) { /* if else */
     elsebb = ir1.gen_bb("elsebb");
-    ir1.builder().CreateCondBr(cond, thenbb, elsebb);
+    BranchInst *br = ir1.builder().CreateCondBr(cond, thenbb, elsebb);
+    llvmcode_branch_expect(br, cond_expect(firstcond));
     curr_fn->getBasicBlockList().push_back(thenbb);
     ir1.builder().SetInsertPoint(thenbb);
     walk_stack(firstbody);
@@ -1728,7 +2676,8 @@ static void walk_if_common(ASTNode *p) {
       tt2 = tmpv2.second;
     }
   } else { /* if */
-    ir1.builder().CreateCondBr(cond, thenbb, outbb);
+    BranchInst *br = ir1.builder().CreateCondBr(cond, thenbb, outbb);
+    llvmcode_branch_expect(br, cond_expect(firstcond));
     curr_fn->getBasicBlockList().push_back(thenbb);
     ir1.builder().SetInsertPoint(thenbb);
     walk_stack(firstbody);
@@ -1815,7 +2764,8 @@ static void walk_if_common2(ASTNode *p) {
       return;
     }
 
-    ir1.builder().CreateCondBr(condv, bodybbs[i], condbbs[i]);
+    BranchInst *br = ir1.builder().CreateCondBr(condv, bodybbs[i], condbbs[i]);
+    llvmcode_branch_expect(br, cond_expect(condn));
     curr_fn->getBasicBlockList().push_back(condbbs[i]);
     ir1.builder().SetInsertPoint(condbbs[i]);
   }
@@ -1853,13 +2803,108 @@ static void walk_expr_ife(ASTNode *p) {
   walk_if_common(p);
 }
 
+/*
+ * The enum object is accessed by the byte offsets of the layout, see
+ * catype_formalize_enum_layout: the tag (or the niche field of the payload)
+ * is the integer of `tagsize` bytes at `tagoffset`, the payload of variant is
+ * the general tuple at the offset of the variant field.
+ */
+
+/// the pointer of `type` to the byte `offset` of the object at `base`
+static Value *enum_gen_offset_addr(Value *base, size_t offset, Type *type, const char *name) {
+  Value *addr = ir1.builder().CreatePointerCast(base, ir1.intptr_type<int8_t>());
+  if (offset)
+    addr = ir1.builder().CreateConstInBoundsGEP1_64(ir1.int_type<int8_t>(), addr, offset);
+
+  return ir1.builder().CreatePointerCast(addr, type->getPointerTo(), name);
+}
+
+static IntegerType *enum_tag_type(CADataType *catype) {
+  return IntegerType::get(ir1.ctx(), catype->struct_layout->enum_layout->tagsize * 8);
+}
+
+/// the tag value stored for the variant, the variants except the dataful one are the niche values in order
+static ConstantInt *enum_tag_value(CADataType *catype, int variant) {
+  CAEnum *layout = catype->struct_layout->enum_layout;
+  if (layout->dataful != -1) {
+    int rank = variant < layout->dataful ? variant : variant - 1;
+    return ConstantInt::get(enum_tag_type(catype), layout->nichestart + rank);
+  }
+
+  return ConstantInt::get(enum_tag_type(catype), layout->values[variant], layout->tagsigned);
+}
+
+static Value *enum_gen_tag(Value *base, CADataType *catype) {
+  CAEnum *layout = catype->struct_layout->enum_layout;
+  IntegerType *tagtype = enum_tag_type(catype);
+  Value *addr = enum_gen_offset_addr(base, layout->tagoffset, tagtype, "tagaddr");
+  return ir1.builder().CreateLoad(tagtype, addr, "tag");
+}
+
+static Value *enum_gen_payload_addr(Value *base, CADataType *catype, int variant) {
+  CAStructField &field = catype->struct_layout->fields[variant];
+  return enum_gen_offset_addr(base, field.offset, llvmtype_from_catype(field.type), "payload");
+}
+
+/// store the tag of the variant after the payload is stored, the dataful variant of niche layout have no tag
+static void enum_gen_set_variant(Value *base, CADataType *catype, int variant) {
+  CAEnum *layout = catype->struct_layout->enum_layout;
+  if (!layout->tagsize || variant == layout->dataful)
+    return;
+
+  Value *addr = enum_gen_offset_addr(base, layout->tagoffset, enum_tag_type(catype), "tagaddr");
+  ir1.builder().CreateStore(enum_tag_value(catype, variant), addr);
+}
+
 static void dbgprint_value(Function *fn, CADataType *catype, Value *v);
+/// print `E::A` or `E::B( 1, 2 )` of the variant dispatched by the tag
+static void dbgprint_value_enum(Function *fn, CADataType *catype, Value *v) {
+  CAStruct *layout = catype->struct_layout;
+  CAEnum *el = layout->enum_layout;
+  Value *slot = ir1.gen_entry_block_var(curr_fn, v->getType(), "printenum");
+  aux_set_catype_align(slot, catype);
+  ir1.builder().CreateStore(v, slot);
+
+  std::vector<BasicBlock *> bbs;
+  for (int i = 0; i < layout->fieldnum; ++i)
+    bbs.push_back(ir1.gen_bb("printvariant", curr_fn));
+
+  BasicBlock *endbb = ir1.gen_bb("printend", curr_fn);
+  if (!el->tagsize) {
+    ir1.builder().CreateBr(bbs[0]);
+  } else {
+    BasicBlock *defaultbb = el->dataful != -1 ? bbs[el->dataful] : endbb;
+    SwitchInst *sw = ir1.builder().CreateSwitch(enum_gen_tag(slot, catype), defaultbb, layout->fieldnum);
+    for (int i = 0; i < layout->fieldnum; ++i) {
+      if (i != el->dataful)
+	sw->addCase(enum_tag_value(catype, i), bbs[i]);
+    }
+  }
+
+  std::string name = symname_get(layout->name);
+  for (int i = 0; i < layout->fieldnum; ++i) {
+    ir1.builder().SetInsertPoint(bbs[i]);
+    llvmcode_print_text(fn, (name + "::" + symname_get(layout->fields[i].name)).c_str());
+
+    CADataType *payloadcatype = layout->fields[i].type;
+    if (payloadcatype->struct_layout->fieldnum) {
+      Value *payload = enum_gen_payload_addr(slot, catype, i);
+      dbgprint_value(fn, payloadcatype, ir1.builder().CreateLoad(payload, "payload"));
+    }
+
+    ir1.builder().CreateBr(endbb);
+  }
+
+  endbb->moveAfter(bbs.back());
+  ir1.builder().SetInsertPoint(endbb);
+}
+
 static void dbgprint_value_range(Function *fn, CADataType *catype, Value *v) {
   GeneralRangeType range_type = catype->range_layout->type;
   switch (range_type) {
   case FullRange:
     // should not come here
-    llvmcode_printf(fn, "..", nullptr);
+    llvmcode_print_text(fn, "..");
     break;
   case InclusiveRange:
   case RightExclusiveRange: {
@@ -1867,18 +2912,18 @@ static void dbgprint_value_range(Function *fn, CADataType *catype, Value *v) {
     assert(catype->range_layout->range->type == STRUCT);
     assert(catype->range_layout->range->struct_layout->type == Struct_GeneralTuple);
     dbgprint_value(fn, catype->range_layout->range->struct_layout->fields[0].type, v1);
-    llvmcode_printf(fn, range_type == InclusiveRange ? "..=" : "..", nullptr);
+    llvmcode_print_text(fn, range_type == InclusiveRange ? "..=" : "..");
     Value *v2 = ir1.builder().CreateExtractValue(v, 1);
     dbgprint_value(fn, catype->range_layout->range->struct_layout->fields[1].type, v2);
     break;
   }
   case InclusiveRangeTo:
   case RightExclusiveRangeTo:
-    llvmcode_printf(fn, range_type == InclusiveRangeTo ? "..=" : "..", nullptr);
+    llvmcode_print_text(fn, range_type == InclusiveRangeTo ? "..=" : "..");
   case RangeFrom:
     dbgprint_value(fn, catype->range_layout->range, v);
     if (catype->range_layout->type == RangeFrom)
-      llvmcode_printf(fn, "..", nullptr);
+      llvmcode_print_text(fn, "..");
 
     break;
   default:
@@ -1892,7 +2937,7 @@ static void dbgprint_value(Function *fn, CADataType *catype, Value *v) {
   switch(catype->type) {
   case ARRAY:
     assert(catype->array_layout->dimension == 1);
-    llvmcode_printf(fn, "[", nullptr);
+    llvmcode_print_text(fn, "[");
     len = catype->array_layout->dimarray[0];
     for (int i = 0; i < len; ++i) {
       //ConstantArray *arrayv = static_cast<ConstantArray *>(v);
@@ -1906,41 +2951,57 @@ static void dbgprint_value(Function *fn, CADataType *catype, Value *v) {
 
       dbgprint_value(fn, catype->array_layout->type, subv);
       if (i < len - 1)
-	llvmcode_printf(fn, ", ", nullptr);
+	llvmcode_print_text(fn, ", ");
+    }
+
+    llvmcode_print_text(fn, "]");
+    break;
+  case VECTOR:
+    llvmcode_print_text(fn, "<");
+    len = catype->array_layout->dimarray[0];
+    for (int i = 0; i < len; ++i) {
+      Value *subv = ir1.builder().CreateExtractElement(v, (uint64_t)i);
+      dbgprint_value(fn, catype->array_layout->type, subv);
+      if (i < len - 1)
+	llvmcode_print_text(fn, ", ");
     }
 
-    llvmcode_printf(fn, "]", nullptr);
+    llvmcode_print_text(fn, ">");
     break;
   case POINTER:
-    llvmcode_printf_primitive(fn, catype, v);
+    llvmcode_print_primitive(fn, catype, v);
     break;
   case SLICE:
   case STRUCT: {
+    if (catype->struct_layout->type == Struct_Enum) {
+      dbgprint_value_enum(fn, catype, v);
+      break;
+    }
+
     const char *name = symname_get(catype->struct_layout->name);
-    Constant *sname = ir1.get_global_string(name);
     CAStructField *fields = catype->struct_layout->fields;
     len = catype->struct_layout->fieldnum;
     CAStructType struct_type = catype->struct_layout->type;
     const char *fmt = NULL;
     switch(struct_type) {
     case Struct_GeneralTuple:
-      fmt = "%s( ";
+      fmt = "( ";
       break;
     case Struct_NamedTuple:
-      fmt = "%s ( ";
+      fmt = " ( ";
       break;
     case Struct_Slice:
-      fmt = "%s < ";
+      fmt = " < ";
       break;
     case Struct_Union:
     case Struct_Enum:
     case Struct_NamedStruct:
     default:
-      fmt = "%s { ";
+      fmt = " { ";
       break;
     }
 
-    llvmcode_printf(fn, fmt, sname, nullptr);
+    llvmcode_print_name_text(fn, name, fmt);
     for (int i = 0; i < len; ++i) {
       //ConstantArray *arrayv = static_cast<ConstantArray *>(v);
       //Constant *subv = arrayv->getAggregateElement(i);
@@ -1951,15 +3012,14 @@ static void dbgprint_value(Function *fn, CADataType *catype, Value *v) {
       //Type* array_t =  llvm::PointerType::getUnqual(v->getType());
       if (struct_type == Struct_NamedStruct) {
 	name = symname_get(fields[i].name); // field name
-	sname = ir1.get_global_string(name);
-	llvmcode_printf(fn, "%s: ", sname, nullptr);
+	llvmcode_print_name_text(fn, name, ": ");
       }
 
       Value *subv = ir1.builder().CreateExtractValue(v, i);
       dbgprint_value(fn, fields[i].type, subv);
 
       if (i < len - 1)
-	llvmcode_printf(fn, ", ", nullptr);
+	llvmcode_print_text(fn, ", ");
     }
 
     switch(struct_type) {
@@ -1976,7 +3036,7 @@ static void dbgprint_value(Function *fn, CADataType *catype, Value *v) {
       break;
     }
 
-    llvmcode_printf(fn, fmt, nullptr);
+    llvmcode_print_text(fn, fmt);
     //yyerror("dbgprint for struct type not implmeneted yet");
     break;
   }
@@ -1986,7 +3046,7 @@ static void dbgprint_value(Function *fn, CADataType *catype, Value *v) {
   }
   default:
     // output each of primitive type
-    llvmcode_printf_primitive(fn, catype, v);
+    llvmcode_print_primitive(fn, catype, v);
     break;
   }
 }
@@ -2044,7 +3104,10 @@ static void walk_dbgprint(ASTNode *p) {
     yyerror("cannot find declared extern printf function");
 
   if (p->printn.expr->litn.litv.littypetok == CSTRING) {
-    llvmcode_printf(printf_fn, "%s", v, nullptr);
+    if (genv.rt_print)
+      llvmcode_rt_write("ca_rt_write_str", ir1.intptr_type<char>(), v);
+    else
+      llvmcode_printf(printf_fn, "%s", v, nullptr);
     return;
   }
 
@@ -2555,7 +3618,7 @@ static CADataType *struct_subcatype_from_fieldname(CADataType *catype, int field
 
 static void determine_letbind_type_for_struct(CAPattern *cap, CADataType *catype, SymTable *symtable) {
   // when come to this function, the data type of struct or named tuple must already be determined
-  if (catype->type != STRUCT) {
+  if (catype->type != STRUCT || catype->struct_layout->type == Struct_Enum) {
     caerror(&(cap->loc), NULL, "required a struct type, but found `%s` type", catype_get_type_name(catype->signature));
     return;
   }
@@ -2638,6 +3701,49 @@ static void determine_letbind_type_for_struct(CAPattern *cap, CADataType *catype
   }
 }
 
+static void determine_letbind_type_for_variant(CAPattern *cap, CADataType *catype, SymTable *symtable) {
+  if (catype->type != STRUCT || catype->struct_layout->type != Struct_Enum) {
+    caerror(&(cap->loc), NULL, "required an enum type for variant pattern, but found `%s` type",
+	    catype_get_type_name(catype->signature));
+    return;
+  }
+
+  CADataType *dt = catype_from_capattern(cap, symtable);
+  if (dt->signature != catype->signature) {
+    caerror(&(cap->loc), NULL, "`%s` type required, but find `%s` pattern type",
+	    catype_get_type_name(catype->signature), catype_get_type_name(dt->signature));
+    return;
+  }
+
+  int pos = struct_field_position_from_fieldname(catype, cap->variant);
+  if (pos == -1) {
+    caerror(&(cap->loc), NULL, "no variant `%s` in enum `%s`",
+	    symname_get(cap->variant), symname_get(cap->name));
+    return;
+  }
+
+  if (cap->morebind)
+    bind_register_variable_catype(cap->morebind, catype->signature, symtable);
+
+  // the variant fields are matched as the general tuple of the payload
+  CADataType *payload = catype->struct_layout->fields[pos].type;
+  int fieldnum = payload->struct_layout->fieldnum;
+  int ignorerangepos = capattern_ignorerange_pos(cap);
+  int size = cap->items->size;
+  if (ignorerangepos == -1 ? size != fieldnum : size - 1 > fieldnum) {
+    caerror(&(cap->loc), NULL, "pattern have different fields `%d` than `%d` of variant `%s::%s`",
+	    size, fieldnum, symname_get(cap->name), symname_get(cap->variant));
+    return;
+  }
+
+  if (ignorerangepos == -1) {
+    determine_letbind_pattern_range(cap, payload, symtable, 0, size, 0);
+  } else {
+    determine_letbind_pattern_range(cap, payload, symtable, 0, ignorerangepos, 0);
+    determine_letbind_pattern_range(cap, payload, symtable, ignorerangepos + 1, size, fieldnum - size);
+  }
+}
+
 static void determine_letbind_type(CAPattern *cap, CADataType *catype, SymTable *symtable) {
   switch (cap->type) {
   case PT_Var:
@@ -2653,8 +3759,47 @@ static void determine_letbind_type(CAPattern *cap, CADataType *catype, SymTable
      */
     determine_letbind_type_for_struct(cap, catype, symtable);
     break;
-  case PT_Array:
-    determine_letbind_type_range(cap, catype->array_layout->type, 0, cap->items->size, symtable);
+  case PT_Variant:
+    determine_letbind_type_for_variant(cap, catype, symtable);
+    break;
+  case PT_Array: {
+    if (catype->type != ARRAY) {
+      caerror(&(cap->loc), NULL, "expected array type but find `%s` for array pattern",
+	      catype_get_type_name(catype->signature));
+      return;
+    }
+
+    int ignorerangepos = capattern_ignorerange_pos(cap);
+    int size = cap->items->size;
+    int dim = catype->array_layout->dimarray[0];
+    if (ignorerangepos == -1 ? size != dim : size - 1 > dim) {
+      caerror(&(cap->loc), NULL, "pattern have different fields `%d` than `%d` of datatype `%s`",
+	      size, dim, catype_get_type_name(catype->signature));
+      return;
+    }
+
+    if (ignorerangepos == -1) {
+      determine_letbind_type_range(cap, catype->array_layout->type, 0, size, symtable);
+    } else {
+      determine_letbind_type_range(cap, catype->array_layout->type, 0, ignorerangepos, symtable);
+      determine_letbind_type_range(cap, catype->array_layout->type, ignorerangepos + 1, size, symtable);
+    }
+
+    if (cap->morebind)
+      bind_register_variable_catype(cap->morebind, catype->signature, symtable);
+    break;
+  }
+  case PT_Literal:
+  case PT_Range:
+    // the bounds are evaluated into the type when lowering the `match`, see match_pattern_bound
+    if (!catype_is_integer(catype->type) && catype->type != BOOL) {
+      caerror(&(cap->loc), NULL, "literal pattern only match integer, char or bool, but find `%s`",
+	      catype_get_type_name(catype->signature));
+      return;
+    }
+
+    if (cap->morebind)
+      bind_register_variable_catype(cap->morebind, catype->signature, symtable);
     break;
   case PT_IgnoreOne:
     break;
@@ -2683,7 +3828,27 @@ static Value *bind_variable_value(SymTable *symtable, int name, Value *value, bo
   Value *var = nullptr;
 
   if (is_create_global_var(entry)) { // or using condition: symtable == &g_root_symtable
-    var = ir1.gen_global_var(type, varname, value, false, value == nullptr);
+    if (value && !isa<Constant>(value)) {
+      // the initializer not evaluated into constant is stored in the main function
+      if (!main_fn) {
+        caerror(&(entry->sloc), NULL, "initializer of global variable `%s` is not a constant", varname);
+        return nullptr;
+      }
+
+      // the store in main function only initialize the copy of main thread
+      if (entry->u.varshielding.current->tls) {
+        caerror(&(entry->sloc), NULL, "initializer of thread local variable `%s` is not a constant", varname);
+        return nullptr;
+      }
+
+      var = ir1.gen_global_var(type, varname, Constant::getNullValue(type), false, false);
+      aux_set_catype_align(var, catype);
+      aux_copy_llvmvalue_to_store(type, var, value, varname);
+    } else {
+      var = ir1.gen_global_var(type, varname, value, false, value == nullptr);
+      aux_set_catype_align(var, catype);
+      aux_set_thread_local(static_cast<GlobalVariable *>(var), entry);
+    }
 
     if (enable_debug_info())
       emit_global_var_dbginfo(varname, catype, entry->u.varshielding.current->loc.row);
@@ -2693,6 +3858,7 @@ static Value *bind_variable_value(SymTable *symtable, int name, Value *value, bo
       var = value;
     } else {
       var = ir1.gen_entry_block_var(curr_fn, type, varname, nullptr);
+      aux_set_catype_align(var, catype);
       if (!value) {
         if (init_type == VarInit_Zero)
           aux_set_zero_to_store(type, var);
@@ -2962,8 +4128,13 @@ static void varshielding_rotate_capattern(CAPattern *cap, SymTable *symtable, bo
   case PT_Tuple:
   case PT_GenTuple:
   case PT_Struct:
+  case PT_Variant:
     varshielding_rotate_capattern_struct(cap, symtable, is_back);
     break;
+  case PT_Literal:
+  case PT_Range:
+    varshielding_rotate_capattern_variable_bind(cap->morebind, symtable, is_back);
+    break;
   case PT_IgnoreOne:
   case PT_IgnoreRange:
     break;
@@ -2973,16 +4144,91 @@ static void varshielding_rotate_capattern(CAPattern *cap, SymTable *symtable, bo
   }
 }
 
-// TODO: Refactor walk_assign function for local and global variable binding
-static void walk_letbind(ASTNode *p) {
-  if (walk_pass == 1)
-    return;
+/// generate the constant of `type` from the initializer of `static` item, the leaves are literals, see make_static_item
+static Constant *gen_static_constant(ASTNode *expr, Type *type, CADataType *catype) {
+  if (!type->isArrayTy()) {
+    if (expr->type != TTE_Literal || catype_is_complex_type(catype)) {
+      caerror(&(expr->begloc), &(expr->endloc), "the initializer of static is not a constant of type `%s`",
+	      catype_get_type_name(catype->signature));
+      return nullptr;
+    }
 
-  CAPattern *cap = p->letbindn.cap;
-  ASTNode *exprn = p->letbindn.expr;
-  Value *v = nullptr;
-  CADataType *catype = nullptr;
-  OperandType ot = OT_Alloc;
+    return static_cast<Constant *>(gen_literal_value(&expr->litn.litv, catype, expr->begloc));
+  }
+
+  if (expr->type != TTE_Expr || expr->exprn.op != ARRAY) {
+    caerror(&(expr->begloc), &(expr->endloc), "the initializer of static array is not an array expression");
+    return nullptr;
+  }
+
+  // the catype of leaf element, multiple dimension array is represented as nested llvm array type
+  CADataType *elemcatype = catype;
+  while (elemcatype->type == ARRAY)
+    elemcatype = elemcatype->array_layout->type;
+
+  ArrayType *arraytype = static_cast<ArrayType *>(type);
+  Type *elemtype = arraytype->getElementType();
+  CAArrayExpr aexpr = expr->exprn.operands[0]->anoden.aexpr;
+  size_t count = aexpr.repeat_count ? aexpr.repeat_count : arrayexpr_size(aexpr);
+  if (count != arraytype->getNumElements()) {
+    caerror(&(expr->begloc), &(expr->endloc), "static array have %lu elements, but `%s` type requires %lu",
+	    count, catype_get_type_name(catype->signature), arraytype->getNumElements());
+    return nullptr;
+  }
+
+  std::vector<Constant *> elements;
+  for (size_t i = 0; i < count; ++i) {
+    if (i == 0 || !aexpr.repeat_count)
+      elements.push_back(gen_static_constant(arrayexpr_get(aexpr, i), elemtype, elemcatype));
+    else
+      elements.push_back(elements[0]);
+  }
+
+  return ConstantArray::get(arraytype, elements);
+}
+
+/**
+ * Generate the `static` item as a constant global variable, it is placed in
+ * read-only data and costs nothing when starting. It is generated in the first
+ * pass when in global scope, so the functions can use it no matter where it
+ * defines.
+ */
+static void walk_letbind_static(ASTNode *p) {
+  CAPattern *cap = p->letbindn.cap;
+  STEntry *entry = sym_getsym(p->symtable, cap->name, 0);
+  CAVariable *var = entry->u.varshielding.current;
+  if (var->llvm_value)
+    return;
+
+  CADataType *catype = catype_get_by_name(p->symtable, var->datatype);
+  CHECK_GET_TYPE_VALUE(p, catype, var->datatype);
+
+  const char *name = symname_get(var->name);
+  Type *type = llvmtype_from_catype(catype);
+  Constant *init = gen_static_constant(p->letbindn.expr, type, catype);
+  GlobalVariable *gvar = ir1.gen_global_var(type, name, init, true);
+
+  if (enable_debug_info())
+    emit_global_var_dbginfo(name, catype, var->loc.row);
+
+  var->llvm_value = static_cast<void *>(gvar);
+}
+
+// TODO: Refactor walk_assign function for local and global variable binding
+static void walk_letbind(ASTNode *p) {
+  if (p->grammartype == NGT_static_item) {
+    walk_letbind_static(p);
+    return;
+  }
+
+  if (walk_pass == 1)
+    return;
+
+  CAPattern *cap = p->letbindn.cap;
+  ASTNode *exprn = p->letbindn.expr;
+  Value *v = nullptr;
+  CADataType *catype = nullptr;
+  OperandType ot = OT_Alloc;
   VarInitType init_type = VarInit_Zero;
     
   if (enable_debug_info())
@@ -3077,6 +4323,552 @@ static void walk_letbind(ASTNode *p) {
   capattern_bind_value(exprn->symtable, cap, v, false, catype, init_type);
 }
 
+/*
+ * The `match` statement is lowered with the pattern matrix: each row is an
+ * alternative pattern of the arms in order, each column is a part of the
+ * matched value. The first refutable column of the first row is tested and
+ * the rows are specialized by the result of the test, so a part of the value
+ * is never tested again on the same path of the decision tree. The literals
+ * and small ranges of a column are tested by one `switch` instruction, which
+ * becomes a jump table when the cases are dense, the other ranges are tested
+ * by one comparison.
+ */
+
+// the range pattern up to the span is expanded into the cases of `switch`
+#define MATCH_SWITCH_RANGE_MAX 64
+// the max cases of one `switch`
+#define MATCH_SWITCH_CASES_MAX 1024
+
+/// a part of the matched value, it is generated when it is used
+struct MatchColumn {
+  CADataType *catype;
+  Value *value; /// the scalar value or the address of the complex value
+  Value *base;  /// the address of the complex value containing the part
+  int index;    /// the position of the part in `base`
+};
+
+/// a row of the pattern matrix, nullptr pattern is the wildcard
+struct MatchRow {
+  int arm;
+  std::vector<CAPattern *> pats;
+  std::vector<std::pair<int, MatchColumn>> binds; /// the variables bound to the parts
+};
+
+/// the inclusive bounds of the literal or range pattern
+struct MatchBound {
+  APInt lo;
+  APInt hi;
+};
+
+struct MatchContext {
+  std::vector<BasicBlock *> armbbs;
+  std::vector<SymTable *> armsymtables;
+  BasicBlock *endbb;
+  std::map<CAPattern *, MatchBound> bounds;
+};
+
+static Value *match_column_value(MatchColumn &col) {
+  if (col.value)
+    return col.value;
+
+  std::vector<Value *> idxv = {ir1.gen_int((int)0), ir1.gen_int(col.index)};
+  col.value = ir1.builder().CreateGEP(col.base, idxv);
+  if (!catype_is_complex_type(col.catype))
+    col.value = ir1.builder().CreateLoad(col.value, "pat");
+
+  return col.value;
+}
+
+static bool match_bound_le(const APInt &a, const APInt &b, bool issigned) {
+  return issigned ? a.sle(b) : a.ule(b);
+}
+
+static const MatchBound &match_pattern_bound(MatchContext &ctx, CAPattern *cap, CADataType *catype) {
+  auto itr = ctx.bounds.find(cap);
+  if (itr != ctx.bounds.end())
+    return itr->second;
+
+  // the plain literal is converted like the literal of `let`, so the char
+  // literal such as '\n' can match the `char` value
+  auto constant = [catype](ASTNode *expr) {
+    CALiteral litv;
+    if (expr->type == TTE_Literal) {
+      litv = expr->litn.litv;
+      litv.fixed_type = 0;
+      determine_primitive_literal_type(&litv, catype);
+    } else {
+      litv = const_eval_literal(expr, catype->signature, expr->symtable)->litn.litv;
+    }
+
+    Value *v = gen_literal_value(&litv, catype, expr->begloc);
+    return cast<ConstantInt>(v)->getValue();
+  };
+
+  APInt lo = constant(cap->lo);
+  APInt hi = cap->hi ? constant(cap->hi) : lo;
+  if (cap->type == PT_Range) {
+    bool issigned = catype_is_signed(catype->type);
+    if (!cap->inclusive) {
+      if (match_bound_le(hi, lo, issigned))
+	caerror(&(cap->loc), NULL, "the exclusive range pattern is empty");
+
+      hi -= 1;
+    } else if (!match_bound_le(lo, hi, issigned)) {
+      caerror(&(cap->loc), NULL, "the lower bound of range pattern is larger than the upper bound");
+    }
+  }
+
+  return ctx.bounds.emplace(cap, MatchBound{lo, hi}).first->second;
+}
+
+/// take the pattern into the column of the row, the variables are bound to the column and become the wildcard
+static CAPattern *match_row_take(MatchRow &row, CAPattern *cap, const MatchColumn &col) {
+  if (!cap)
+    return nullptr;
+
+  size_t size = vec_size(cap->morebind);
+  for (size_t i = 0; i < size; ++i)
+    row.binds.emplace_back((int)(long)vec_at(cap->morebind, i), col);
+
+  switch (cap->type) {
+  case PT_Var:
+    row.binds.emplace_back(cap->name, col);
+    return nullptr;
+  case PT_IgnoreOne:
+    return nullptr;
+  default:
+    return cap;
+  }
+}
+
+/// the sub patterns of struct, tuple or array pattern at the positions of the `n` parts, nullptr for the ignored
+static std::vector<CAPattern *> match_pattern_items(CAPattern *cap, CADataType *catype, int n) {
+  std::vector<CAPattern *> items(n, nullptr);
+  int ignorerangepos = capattern_ignorerange_pos(cap);
+  int size = cap->items->size;
+
+  if (cap->type == PT_Struct) {
+    int endpos = ignorerangepos == -1 ? size : ignorerangepos;
+    for (int i = 0; i < endpos; ++i) {
+      int pos = cap->items->patterns[i]->fieldname;
+      if (catype->struct_layout->type == Struct_NamedStruct)
+	pos = struct_field_position_from_fieldname(catype, pos);
+
+      items[pos] = cap->items->patterns[i];
+    }
+
+    return items;
+  }
+
+  for (int i = 0; i < size; ++i) {
+    if (ignorerangepos == -1 || i < ignorerangepos)
+      items[i] = cap->items->patterns[i];
+    else if (i > ignorerangepos)
+      items[n - size + i] = cap->items->patterns[i];
+  }
+
+  return items;
+}
+
+static void match_compile(MatchContext &ctx, std::vector<MatchRow> rows, std::vector<MatchColumn> cols);
+
+static void match_compile_leaf(MatchContext &ctx, MatchRow &row) {
+  SymTable *symtable = ctx.armsymtables[row.arm];
+  for (auto &bind : row.binds) {
+    CAVariable *var = sym_getsym(symtable, bind.first, 0)->u.varshielding.current;
+    Type *type = llvmtype_from_catype(bind.second.catype);
+    Value *slot = static_cast<Value *>(var->llvm_value);
+    aux_copy_llvmvalue_to_store(type, slot, match_column_value(bind.second), symname_get(bind.first));
+  }
+
+  ir1.builder().CreateBr(ctx.armbbs[row.arm]);
+}
+
+/// replace the struct, tuple or array column `j` with the columns of its parts
+static void match_compile_expand(MatchContext &ctx, std::vector<MatchRow> &rows, std::vector<MatchColumn> &cols, int j) {
+  CADataType *catype = cols[j].catype;
+  Value *base = match_column_value(cols[j]);
+  int n = catype->type == ARRAY ? catype->array_layout->dimarray[0] : catype->struct_layout->fieldnum;
+
+  std::vector<MatchColumn> subcols;
+  for (int i = 0; i < n; ++i) {
+    CADataType *subcatype = catype->type == ARRAY ? catype->array_layout->type : catype->struct_layout->fields[i].type;
+    subcols.push_back(MatchColumn{subcatype, nullptr, base, i});
+  }
+
+  cols.erase(cols.begin() + j);
+  cols.insert(cols.end(), subcols.begin(), subcols.end());
+
+  for (auto &row : rows) {
+    CAPattern *cap = row.pats[j];
+    row.pats.erase(row.pats.begin() + j);
+
+    std::vector<CAPattern *> items = cap ? match_pattern_items(cap, catype, n) : std::vector<CAPattern *>(n, nullptr);
+    for (int i = 0; i < n; ++i)
+      row.pats.push_back(match_row_take(row, items[i], subcols[i]));
+  }
+
+  match_compile(ctx, rows, cols);
+}
+
+static void match_compile_block(MatchContext &ctx, BasicBlock *bb, std::vector<MatchRow> &rows, std::vector<MatchColumn> &cols) {
+  curr_fn->getBasicBlockList().push_back(bb);
+  ir1.builder().SetInsertPoint(bb);
+  match_compile(ctx, rows, cols);
+}
+
+/// test the scalar column `j` with the range of the first row: `lo <= v <= hi`
+static void match_compile_range(MatchContext &ctx, std::vector<MatchRow> &rows, std::vector<MatchColumn> &cols, int j) {
+  CADataType *catype = cols[j].catype;
+  bool issigned = catype_is_signed(catype->type);
+  Value *v = match_column_value(cols[j]);
+  MatchBound range = match_pattern_bound(ctx, rows[0].pats[j], catype);
+
+  // `v - lo <= hi - lo` in unsigned comparison is both of the bounds for signed or unsigned
+  Value *offset = ir1.builder().CreateSub(v, ConstantInt::get(ir1.ctx(), range.lo), "matchoff");
+  Value *cond = ir1.builder().CreateICmpULE(offset, ConstantInt::get(ir1.ctx(), range.hi - range.lo), "matchcond");
+  BasicBlock *inbb = ir1.gen_bb("matchin");
+  BasicBlock *outbb = ir1.gen_bb("matchout");
+  ir1.builder().CreateCondBr(cond, inbb, outbb);
+
+  std::vector<MatchRow> inrows;
+  std::vector<MatchRow> outrows;
+  for (auto &row : rows) {
+    CAPattern *cap = row.pats[j];
+    if (!cap) {
+      inrows.push_back(row);
+      outrows.push_back(row);
+      continue;
+    }
+
+    const MatchBound &bound = match_pattern_bound(ctx, cap, catype);
+    bool covering = match_bound_le(bound.lo, range.lo, issigned) && match_bound_le(range.hi, bound.hi, issigned);
+    bool covered = match_bound_le(range.lo, bound.lo, issigned) && match_bound_le(bound.hi, range.hi, issigned);
+    bool disjoint = !match_bound_le(bound.lo, range.hi, issigned) || !match_bound_le(range.lo, bound.hi, issigned);
+
+    if (covering) {
+      inrows.push_back(row);
+      inrows.back().pats[j] = nullptr;
+    } else if (!disjoint) {
+      inrows.push_back(row);
+    }
+
+    if (!covered)
+      outrows.push_back(row);
+  }
+
+  match_compile_block(ctx, inbb, inrows, cols);
+  match_compile_block(ctx, outbb, outrows, cols);
+}
+
+/// test the scalar column `j` with the literals and the small ranges of all rows in one `switch`
+static void match_compile_switch(MatchContext &ctx, std::vector<MatchRow> &rows, std::vector<MatchColumn> &cols, int j) {
+  CADataType *catype = cols[j].catype;
+  bool issigned = catype_is_signed(catype->type);
+
+  std::vector<APInt> cases;
+  std::set<uint64_t> caseset;
+  std::set<CAPattern *> enumerated;
+  for (auto &row : rows) {
+    CAPattern *cap = row.pats[j];
+    if (!cap)
+      continue;
+
+    const MatchBound &bound = match_pattern_bound(ctx, cap, catype);
+    APInt span = bound.hi - bound.lo;
+    if (span.uge(MATCH_SWITCH_RANGE_MAX) || caseset.size() + span.getZExtValue() >= MATCH_SWITCH_CASES_MAX)
+      continue;
+
+    enumerated.insert(cap);
+    for (APInt c = bound.lo; ; ++c) {
+      if (caseset.insert(c.getZExtValue()).second)
+	cases.push_back(c);
+
+      if (c == bound.hi)
+	break;
+    }
+  }
+
+  if (cases.empty()) {
+    match_compile_range(ctx, rows, cols, j);
+    return;
+  }
+
+  Value *v = match_column_value(cols[j]);
+  BasicBlock *defaultbb = ir1.gen_bb("matchdefault");
+  SwitchInst *sw = ir1.builder().CreateSwitch(v, defaultbb, cases.size());
+
+  std::vector<MatchColumn> casecols = cols;
+  casecols.erase(casecols.begin() + j);
+
+  // the cases matching the same rows share the block, e.g. the values of a range
+  std::map<std::vector<int>, BasicBlock *> casebbs;
+  for (auto &c : cases) {
+    std::vector<int> matched;
+    for (size_t i = 0; i < rows.size(); ++i) {
+      CAPattern *cap = rows[i].pats[j];
+      if (cap) {
+	const MatchBound &bound = match_pattern_bound(ctx, cap, catype);
+	if (!match_bound_le(bound.lo, c, issigned) || !match_bound_le(c, bound.hi, issigned))
+	  continue;
+      }
+
+      matched.push_back(i);
+    }
+
+    auto itr = casebbs.find(matched);
+    if (itr != casebbs.end()) {
+      sw->addCase(ConstantInt::get(ir1.ctx(), c), itr->second);
+      continue;
+    }
+
+    BasicBlock *casebb = ir1.gen_bb("matchcase");
+    sw->addCase(ConstantInt::get(ir1.ctx(), c), casebb);
+    casebbs.insert(std::make_pair(matched, casebb));
+
+    std::vector<MatchRow> caserows;
+    for (int i : matched) {
+      caserows.push_back(rows[i]);
+      caserows.back().pats.erase(caserows.back().pats.begin() + j);
+    }
+
+    match_compile_block(ctx, casebb, caserows, casecols);
+  }
+
+  std::vector<MatchRow> defaultrows;
+  for (auto &row : rows) {
+    if (!enumerated.count(row.pats[j]))
+      defaultrows.push_back(row);
+  }
+
+  match_compile_block(ctx, defaultbb, defaultrows, cols);
+}
+
+/// the rows of the variant of the enum column `j`, the column becomes the payload of the variant
+static void match_compile_variant_case(MatchContext &ctx, BasicBlock *bb, std::vector<MatchRow> &rows,
+				       std::vector<MatchColumn> &cols, int j, int variant) {
+  curr_fn->getBasicBlockList().push_back(bb);
+  ir1.builder().SetInsertPoint(bb);
+
+  CADataType *catype = cols[j].catype;
+  std::vector<MatchColumn> casecols = cols;
+  Value *payload = enum_gen_payload_addr(match_column_value(cols[j]), catype, variant);
+  casecols[j] = MatchColumn{catype->struct_layout->fields[variant].type, payload, nullptr, 0};
+
+  std::vector<MatchRow> caserows;
+  for (auto &row : rows) {
+    CAPattern *cap = row.pats[j];
+    if (!cap || struct_field_position_from_fieldname(catype, cap->variant) == variant)
+      caserows.push_back(row);
+  }
+
+  match_compile_expand(ctx, caserows, casecols, j);
+}
+
+/// test the enum column `j` with the variants of all rows in one `switch` of the tag
+static void match_compile_variant(MatchContext &ctx, std::vector<MatchRow> &rows, std::vector<MatchColumn> &cols, int j) {
+  CADataType *catype = cols[j].catype;
+  CAEnum *layout = catype->struct_layout->enum_layout;
+  int n = catype->struct_layout->fieldnum;
+
+  std::vector<bool> tested(n, false);
+  for (auto &row : rows) {
+    if (row.pats[j])
+      tested[struct_field_position_from_fieldname(catype, row.pats[j]->variant)] = true;
+  }
+
+  // the single variant enum have no tag
+  if (!layout->tagsize) {
+    BasicBlock *bb = ir1.gen_bb("matchvariant");
+    ir1.builder().CreateBr(bb);
+    match_compile_variant_case(ctx, bb, rows, cols, j, 0);
+    return;
+  }
+
+  Value *tag = enum_gen_tag(match_column_value(cols[j]), catype);
+  BasicBlock *defaultbb = ir1.gen_bb("matchdefault");
+  SwitchInst *sw = ir1.builder().CreateSwitch(tag, defaultbb, n);
+
+  for (int v = 0; v < n; ++v) {
+    if (!tested[v] || v == layout->dataful)
+      continue;
+
+    BasicBlock *casebb = ir1.gen_bb("matchvariant");
+    sw->addCase(enum_tag_value(catype, v), casebb);
+    match_compile_variant_case(ctx, casebb, rows, cols, j, v);
+  }
+
+  // any value other than the niche values is the dataful variant
+  if (layout->dataful != -1 && tested[layout->dataful]) {
+    match_compile_variant_case(ctx, defaultbb, rows, cols, j, layout->dataful);
+    return;
+  }
+
+  // the tag is always one of the variants
+  if (layout->dataful == -1 && std::find(tested.begin(), tested.end(), false) == tested.end()) {
+    curr_fn->getBasicBlockList().push_back(defaultbb);
+    ir1.builder().SetInsertPoint(defaultbb);
+    ir1.builder().CreateUnreachable();
+    return;
+  }
+
+  // the variants not tested only match the wildcard
+  std::vector<MatchColumn> defaultcols = cols;
+  defaultcols.erase(defaultcols.begin() + j);
+  std::vector<MatchRow> defaultrows;
+  for (auto &row : rows) {
+    if (!row.pats[j]) {
+      defaultrows.push_back(row);
+      defaultrows.back().pats.erase(defaultrows.back().pats.begin() + j);
+    }
+  }
+
+  match_compile_block(ctx, defaultbb, defaultrows, defaultcols);
+}
+
+static void match_compile(MatchContext &ctx, std::vector<MatchRow> rows, std::vector<MatchColumn> cols) {
+  // no arm matched
+  if (rows.empty()) {
+    ir1.builder().CreateBr(ctx.endbb);
+    return;
+  }
+
+  MatchRow &first = rows[0];
+  int j = 0;
+  while (j < (int)first.pats.size() && !first.pats[j])
+    ++j;
+
+  if (j == (int)first.pats.size()) {
+    match_compile_leaf(ctx, first);
+    return;
+  }
+
+  switch (first.pats[j]->type) {
+  case PT_Literal:
+  case PT_Range:
+    match_compile_switch(ctx, rows, cols, j);
+    break;
+  case PT_Variant:
+    match_compile_variant(ctx, rows, cols, j);
+    break;
+  default:
+    match_compile_expand(ctx, rows, cols, j);
+    break;
+  }
+}
+
+static void match_pattern_names(CAPattern *cap, std::vector<int> &names) {
+  size_t size = vec_size(cap->morebind);
+  for (size_t i = 0; i < size; ++i)
+    names.push_back((int)(long)vec_at(cap->morebind, i));
+
+  switch (cap->type) {
+  case PT_Var:
+    names.push_back(cap->name);
+    break;
+  case PT_Array:
+  case PT_Tuple:
+  case PT_GenTuple:
+  case PT_Struct:
+  case PT_Variant:
+    for (int i = 0; i < cap->items->size; ++i)
+      match_pattern_names(cap->items->patterns[i], names);
+    break;
+  default:
+    break;
+  }
+}
+
+static void walk_match(ASTNode *p) {
+  int narm = vec_size(p->matchn.arms);
+  if (walk_pass == 1) {
+    for (int i = 0; i < narm; ++i)
+      walk_stack(static_cast<ASTNode *>(vec_at(p->matchn.arms, i)));
+
+    return;
+  }
+
+  if (!curr_fn)
+    return;
+
+  if (enable_debug_info())
+    diinfo->emit_location(p->begloc.row, p->begloc.col, curr_lexical_scope->discope);
+
+  ASTNode *exprn = p->matchn.expr;
+  inference_expr_type(exprn);
+  walk_stack(exprn);
+  auto datao = pop_right_operand("matchv", false);
+  Value *v = datao->operand;
+  CADataType *catype = datao->catype;
+  if (!catype_is_complex_type(catype)) {
+    if (datao->type == OT_Alloc)
+      v = ir1.builder().CreateLoad(v, "matchv");
+  } else if (!v->getType()->isPointerTy()) {
+    // the parts of complex value are matched through its address
+    Value *slot = ir1.gen_entry_block_var(curr_fn, v->getType(), "matchv");
+    ir1.builder().CreateStore(v, slot);
+    v = slot;
+  }
+
+  MatchContext ctx;
+  ctx.endbb = ir1.gen_bb("endmatch");
+  MatchColumn col = {catype, v, nullptr, 0};
+  std::vector<MatchRow> rows;
+
+  for (int i = 0; i < narm; ++i) {
+    ASTNode *armbody = static_cast<ASTNode *>(vec_at(p->matchn.arms, i));
+    PatternGroup *pats = armbody->lnoden.stmts->matcharmn.pats;
+    ctx.armsymtables.push_back(armbody->symtable);
+    ctx.armbbs.push_back(ir1.gen_bb("matcharm"));
+
+    for (int k = 0; k < pats->size; ++k) {
+      determine_letbind_type(pats->patterns[k], catype, armbody->symtable);
+
+      MatchRow row;
+      row.arm = i;
+      row.pats.push_back(match_row_take(row, pats->patterns[k], col));
+      rows.push_back(std::move(row));
+    }
+
+    // the variables are stored when the arm is matched, only the first alternative can bind variables
+    std::vector<int> names;
+    match_pattern_names(pats->patterns[0], names);
+    for (int name : names) {
+      CAVariable *var = sym_getsym(armbody->symtable, name, 0)->u.varshielding.current;
+      CADataType *vartype = catype_get_by_name(armbody->symtable, var->datatype);
+      Value *slot = ir1.gen_entry_block_var(curr_fn, llvmtype_from_catype(vartype), symname_get(name), nullptr);
+      aux_set_catype_align(slot, vartype);
+      var->llvm_value = static_cast<void *>(slot);
+    }
+  }
+
+  match_compile(ctx, rows, std::vector<MatchColumn>(1, col));
+
+  for (int i = 0; i < narm; ++i) {
+    curr_fn->getBasicBlockList().push_back(ctx.armbbs[i]);
+    ir1.builder().SetInsertPoint(ctx.armbbs[i]);
+    walk_stack(static_cast<ASTNode *>(vec_at(p->matchn.arms, i)));
+    ir1.builder().CreateBr(ctx.endbb);
+  }
+
+  curr_fn->getBasicBlockList().push_back(ctx.endbb);
+  ir1.builder().SetInsertPoint(ctx.endbb);
+}
+
+static void walk_match_arm(ASTNode *p) {
+  if (walk_pass > 1 && enable_debug_info()) {
+    std::vector<int> names;
+    match_pattern_names(p->matcharmn.pats->patterns[0], names);
+    for (int name : names) {
+      CAVariable *var = sym_getsym(p->symtable, name, 0)->u.varshielding.current;
+      CADataType *vartype = catype_get_by_name(p->symtable, var->datatype);
+      emit_local_var_dbginfo(curr_fn, symname_get(name), vartype, static_cast<Value *>(var->llvm_value), var->loc.row);
+    }
+  }
+
+  walk_stack(p->matcharmn.body);
+}
+
 static void walk_expr_tuple_common(ASTNode *p, CADataType *catype, std::vector<Value *> &values);
 static void walk_range(ASTNode *p) {
   if (walk_pass == 1)
@@ -3185,13 +4977,13 @@ static void walk_unary_expr(ASTNode *p) {
 
   switch (p->exprn.op) {
   case UMINUS:
-    if (catype_is_unsigned(dt->type)) {
+    if (catype_is_unsigned(catype_scalar_token(dt))) {
       yyerror("unsigned type `%s` cannot apply `-` operator", symname_get(type));
       return;
     }
     break;
   case BNOT:
-    if (!is_bnot_type(dt->type)) {
+    if (!is_bnot_type(catype_scalar_token(dt))) {
       caerror(&(p->begloc), &(p->endloc), "expected integer type for bitwise & logical not, but find `%s`",
 	      symname_get(dt->signature));
       return;
@@ -3210,7 +5002,7 @@ static void walk_unary_expr(ASTNode *p) {
 
   Value *v = nullptr;
   if (p->exprn.op == UMINUS) {
-    if (catype_is_float(pair.second->type))
+    if (catype_is_float(catype_scalar_token(pair.second)))
       v = ir1.builder().CreateFNeg(pair.first, "fneg");
     else
       v = ir1.builder().CreateNeg(pair.first, "neg");
@@ -3397,6 +5189,55 @@ static void walk_expr_tuple(ASTNode *p, STEntry *entry, std::vector<Value *> &va
   walk_expr_tuple_common(p, structcatype, values);
 }
 
+static void llvmvalue_from_exprs(ASTNode **exprs, int len, std::vector<Value *> &argv, bool isvalue);
+
+/// construct the enum variant: `E::A(1, 2)` or `E::B`
+static void walk_expr_enum_variant(ASTNode *p, STEntry *entry, int variant) {
+  typeid_t enumid = entry->u.datatype.id;
+  CADataType *catype = catype_get_by_name(entry->u.datatype.idtable, enumid);
+  CHECK_GET_TYPE_VALUE(p, catype, enumid);
+
+  p->exprn.expr_type = catype->signature;
+
+  ASTNode *args = p->exprn.operands[1];
+  CADataType *payloadcatype = catype->struct_layout->fields[variant].type;
+  int fieldnum = payloadcatype->struct_layout->fieldnum;
+  if (args->arglistn.argc != fieldnum) {
+    caerror(&(p->begloc), &(p->endloc), "enum variant `%s::%s` have `%d` fields but `%d` found",
+	    symname_get(catype->struct_layout->name), symname_get(catype->struct_layout->fields[variant].name),
+	    fieldnum, args->arglistn.argc);
+    return;
+  }
+
+  for (int i = 0; i < fieldnum; ++i) {
+    ASTNode *expr = args->arglistn.exprs[i];
+    typeid_t formaltype = payloadcatype->struct_layout->fields[i].type->signature;
+    determine_expr_type(expr, formaltype);
+    typeid_t realtype = get_expr_type_from_tree(expr);
+    if (!catype_check_identical_in_symtable(expr->symtable, realtype, expr->symtable, formaltype)) {
+      caerror(&(expr->begloc), &(expr->endloc), "the %d field type '%s' not match the variant field type '%s'",
+	      i, catype_get_type_name(realtype), catype_get_type_name(formaltype));
+      return;
+    }
+  }
+
+  std::vector<Value *> values;
+  llvmvalue_from_exprs(args->arglistn.exprs, fieldnum, values, false);
+
+  AllocaInst *slot = ir1.gen_entry_block_var(curr_fn, llvmtype_from_catype(catype), "enumtmp");
+  aux_set_catype_align(slot, catype);
+
+  StructType *payloadtype = static_cast<StructType *>(llvmtype_from_catype(payloadcatype));
+  Value *payload = enum_gen_payload_addr(slot, catype, variant);
+  for (int i = 0; i < fieldnum; ++i) {
+    Value *dest = ir1.builder().CreateStructGEP(payloadtype, payload, i);
+    aux_copy_llvmvalue_to_store(payloadtype->getElementType(i), dest, values[i], "field");
+  }
+
+  enum_gen_set_variant(slot, catype, variant);
+  oprand_stack.push_back(std::make_unique<CalcOperand>(OT_Alloc, slot, catype));
+}
+
 static void llvmvalue_from_exprs(ASTNode **exprs, int len, std::vector<Value *> &argv, bool isvalue) {
   for (int i = 0; i < len; ++i) {
     // Q: how to get the name for an expr? A: not possible/neccessary to get it
@@ -3427,32 +5268,422 @@ static void walk_expr(ASTNode *p);
 extern STEntry *sym_get_function_entry_for_method(ASTNode *name, query_type_fn_t query_fn, void **self_value, CADataType **struct_catype, STEntry **cls_entry);
 static CADataType *query_type_with_value(TStructFieldOp *sfopn, void **self_value) {
   walk_stack(sfopn->expr);
-  auto pair = pop_right_value("struct", !sfopn->direct);
+  auto o = pop_right_operand("struct", !sfopn->direct);
 
   if (self_value)
-    *self_value = pair.first;
+    *self_value = sfopn->direct ? aux_operand_address(o.get(), "selftmp") : o->operand;
 
-  return pair.second;
+  return o->catype;
 }
 
 static STEntry *sym_get_function_entry_for_method_value(ASTNode *name, Value **self_value, CADataType **struct_catype, STEntry **cls_entry) {
   return sym_get_function_entry_for_method(name, query_type_with_value, (void **)self_value, struct_catype, cls_entry);
 }
 
+/**
+ * @brief Generate the address of the vector `load` and `store` builtins, it
+ * is the pointer argument or the element address `&s[i]` of the slice
+ * argument, which is checked by `-bounds-check` to hold all the lanes.
+ */
+static Value *llvmcode_vector_address(ASTNode *p, CADataType *vectype, std::vector<Value *> &argv,
+				      std::vector<CADataType *> &argdts) {
+  Type *vecllvmtype = llvmtype_from_catype(vectype);
+  Value *ptr = argv[0];
+  if (builtin_vector_memory_is_slice(p)) {
+    Value *len = ir1.builder().CreateExtractValue(argv[0], 1, "len");
+    Value *index = aux_index_to_i64(argv[1], argdts[1]->type);
+    ptr = ir1.builder().CreateExtractValue(argv[0], 0, "ptr");
+    if (genv.bounds_check) {
+      Value *end = ir1.builder().CreateAdd(index, ir1.gen_int((int64_t)vectype->array_layout->dimarray[0]), "end");
+      llvmcode_bounds_check(index, len, false, p->begloc.row);
+      llvmcode_bounds_check(end, len, true, p->begloc.row);
+    }
+
+    ptr = ir1.builder().CreateGEP(vecllvmtype->getScalarType(), ptr, index, "elemptr");
+  }
+
+  return ir1.builder().CreatePointerCast(ptr, PointerType::get(vecllvmtype, 0), "vecptr");
+}
+
+// the vector builtins called in domain of the vector type `vectype`
+static Value *llvmcode_vector_builtin(ASTNode *p, CABuiltinKind kind, CADataType *vectype,
+				      std::vector<Value *> &argv, std::vector<CADataType *> &argdts) {
+  int lanes = vectype->array_layout->dimarray[0];
+  tokenid_t elemtok = catype_scalar_token(vectype);
+  bool isfloat = catype_is_float(elemtok);
+  bool issigned = catype_is_signed(elemtok);
+  Type *elemtype = llvmtype_from_token(elemtok);
+  IRBuilder<> &builder = ir1.builder();
+  Value *v = nullptr;
+
+  switch (kind) {
+  case BI_VecSplat:
+    v = builder.CreateVectorSplat(lanes, argv[0], "splat");
+    break;
+  case BI_VecExtract:
+  case BI_VecInsert:
+    if (genv.bounds_check)
+      llvmcode_bounds_check(aux_index_to_i64(argv[1], argdts[1]->type), ir1.gen_int((int64_t)lanes), false, p->begloc.row);
+
+    if (kind == BI_VecExtract)
+      v = builder.CreateExtractElement(argv[0], argv[1], "extract");
+    else
+      v = builder.CreateInsertElement(argv[0], argv[2], argv[1], "insert");
+    break;
+  case BI_VecShuffle: {
+    std::vector<int> mask(lanes);
+    builtin_vector_shuffle_mask(p, mask.data());
+    v = builder.CreateShuffleVector(argv[0], argv[1], mask, "shuffle");
+    break;
+  }
+  case BI_VecSelect: {
+    Value *cond = builder.CreateICmpNE(argv[0], Constant::getNullValue(argv[0]->getType()), "cond");
+    v = builder.CreateSelect(cond, argv[1], argv[2], "select");
+    break;
+  }
+  case BI_VecReduceAdd:
+    // the float reduction is ordered, it keeps the result same as the scalar loop
+    v = isfloat ? builder.CreateFAddReduce(ConstantFP::getNegativeZero(elemtype), argv[0]) : builder.CreateAddReduce(argv[0]);
+    break;
+  case BI_VecReduceMul:
+    v = isfloat ? builder.CreateFMulReduce(ConstantFP::get(elemtype, 1.0), argv[0]) : builder.CreateMulReduce(argv[0]);
+    break;
+  case BI_VecReduceMin:
+    v = isfloat ? builder.CreateFPMinReduce(argv[0]) : builder.CreateIntMinReduce(argv[0], issigned);
+    break;
+  case BI_VecReduceMax:
+    v = isfloat ? builder.CreateFPMaxReduce(argv[0]) : builder.CreateIntMaxReduce(argv[0], issigned);
+    break;
+  case BI_VecReduceAnd:
+    v = builder.CreateAndReduce(argv[0]);
+    break;
+  case BI_VecReduceOr:
+    v = builder.CreateOrReduce(argv[0]);
+    break;
+  case BI_VecReduceXor:
+    v = builder.CreateXorReduce(argv[0]);
+    break;
+  case BI_VecLoad:
+  case BI_VecLoadUnaligned: {
+    Value *ptr = llvmcode_vector_address(p, vectype, argv, argdts);
+    int align = kind == BI_VecLoad ? vectype->size : vectype->array_layout->type->size;
+    v = builder.CreateAlignedLoad(llvmtype_from_catype(vectype), ptr, Align(align), "vload");
+    break;
+  }
+  case BI_VecStore:
+  case BI_VecStoreUnaligned: {
+    Value *ptr = llvmcode_vector_address(p, vectype, argv, argdts);
+    int align = kind == BI_VecStore ? vectype->size : vectype->array_layout->type->size;
+    v = builder.CreateAlignedStore(argv.back(), ptr, Align(align));
+    break;
+  }
+  default:
+    yyerror("(internal) unknown builtin function: %d", kind);
+    return nullptr;
+  }
+
+  return v;
+
+}
+
+// the intrinsic builtins, they are lowered into the LLVM intrinsics of the first operand type
+static Value *llvmcode_intrinsic_builtin(ASTNode *p, CABuiltinKind kind, std::vector<Value *> &argv,
+					 std::vector<CADataType *> &argdts) {
+  tokenid_t tok = catype_scalar_token(argdts[0]);
+  bool isfloat = catype_is_float(tok);
+  bool issigned = catype_is_signed(tok);
+  Type *type = argv[0]->getType();
+  IRBuilder<> &builder = ir1.builder();
+
+  switch (kind) {
+  case BI_CtPop:
+    return builder.CreateUnaryIntrinsic(Intrinsic::ctpop, argv[0], nullptr, "ctpop");
+  case BI_Ctlz:
+    // the result of zero is the bit width instead of poison
+    return builder.CreateBinaryIntrinsic(Intrinsic::ctlz, argv[0], builder.getFalse(), nullptr, "ctlz");
+  case BI_Cttz:
+    return builder.CreateBinaryIntrinsic(Intrinsic::cttz, argv[0], builder.getFalse(), nullptr, "cttz");
+  case BI_Bswap:
+    return builder.CreateUnaryIntrinsic(Intrinsic::bswap, argv[0], nullptr, "bswap");
+  case BI_Rotl:
+    return builder.CreateIntrinsic(Intrinsic::fshl, {type}, {argv[0], argv[0], argv[1]}, nullptr, "rotl");
+  case BI_Rotr:
+    return builder.CreateIntrinsic(Intrinsic::fshr, {type}, {argv[0], argv[0], argv[1]}, nullptr, "rotr");
+  case BI_Fshl:
+    return builder.CreateIntrinsic(Intrinsic::fshl, {type}, argv, nullptr, "fshl");
+  case BI_Fshr:
+    return builder.CreateIntrinsic(Intrinsic::fshr, {type}, argv, nullptr, "fshr");
+  case BI_Fma:
+    return builder.CreateIntrinsic(Intrinsic::fma, {type}, argv, nullptr, "fma");
+  case BI_Sqrt:
+    return builder.CreateUnaryIntrinsic(Intrinsic::sqrt, argv[0], nullptr, "sqrt");
+  case BI_Min:
+    return builder.CreateBinaryIntrinsic(isfloat ? Intrinsic::minnum : (issigned ? Intrinsic::smin : Intrinsic::umin),
+					 argv[0], argv[1], nullptr, "min");
+  case BI_Max:
+    return builder.CreateBinaryIntrinsic(isfloat ? Intrinsic::maxnum : (issigned ? Intrinsic::smax : Intrinsic::umax),
+					 argv[0], argv[1], nullptr, "max");
+  case BI_Prefetch: {
+    // the last argument is the cache type: 1 for data cache
+    Value *ptr = builder.CreatePointerCast(argv[0], ir1.intptr_type<char>(), "ptr");
+    return builder.CreateIntrinsic(Intrinsic::prefetch, {ptr->getType()}, {ptr, argv[1], argv[2], ir1.gen_int(1)});
+  }
+  case BI_Memcpy:
+  case BI_Memset: {
+    // the pointers are aligned to their pointee types
+    MaybeAlign dstalign(catype_get_align(argdts[0]->pointer_layout->type));
+    if (kind == BI_Memset)
+      return builder.CreateMemSet(argv[0], argv[1], argv[2], dstalign);
+
+    MaybeAlign srcalign(catype_get_align(argdts[1]->pointer_layout->type));
+    return builder.CreateMemCpy(argv[0], dstalign, argv[1], srcalign, argv[2]);
+  }
+  case BI_Assume:
+    return builder.CreateAssumption(argv[0]);
+  default:
+    yyerror("(internal) unknown builtin function: %d", kind);
+    return nullptr;
+  }
+}
+
+static AtomicOrdering llvm_atomic_ordering(CAAtomicOrdering ordering) {
+  switch (ordering) {
+  case AO_Relaxed:
+    return AtomicOrdering::Monotonic;
+  case AO_Acquire:
+    return AtomicOrdering::Acquire;
+  case AO_Release:
+    return AtomicOrdering::Release;
+  case AO_AcqRel:
+    return AtomicOrdering::AcquireRelease;
+  default:
+    return AtomicOrdering::SequentiallyConsistent;
+  }
+}
+
+// the atomic builtins, the value in memory is accessed with its natural alignment
+static Value *llvmcode_atomic_builtin(ASTNode *p, CABuiltinKind kind, std::vector<Value *> &argv,
+				      std::vector<CADataType *> &argdts) {
+  AtomicOrdering ordering = llvm_atomic_ordering(builtin_atomic_ordering(p, kind, 0));
+  IRBuilder<> &builder = ir1.builder();
+  if (kind == BI_Fence)
+    return builder.CreateFence(ordering);
+
+  CADataType *valuetype = argdts[0]->pointer_layout->type;
+  Align align(valuetype->size);
+  AtomicRMWInst::BinOp op = AtomicRMWInst::BAD_BINOP;
+  switch (kind) {
+  case BI_AtomicLoad: {
+    LoadInst *load = builder.CreateAlignedLoad(llvmtype_from_catype(valuetype), argv[0], align, "atomicload");
+    load->setAtomic(ordering);
+    return load;
+  }
+  case BI_AtomicStore: {
+    StoreInst *store = builder.CreateAlignedStore(argv[1], argv[0], align);
+    store->setAtomic(ordering);
+    return store;
+  }
+  case BI_AtomicCompareExchange: {
+    // the failure ordering defaults to the strongest one allowed by the success ordering
+    CAAtomicOrdering failure = builtin_atomic_ordering(p, kind, 1);
+    AtomicOrdering failordering = failure == AO_None ?
+      AtomicCmpXchgInst::getStrongestFailureOrdering(ordering) : llvm_atomic_ordering(failure);
+    auto *cmpxchg = builder.Insert(new AtomicCmpXchgInst(argv[0], argv[1], argv[2], align, ordering,
+							 failordering, SyncScope::System), "cmpxchg");
+    return builder.CreateExtractValue(cmpxchg, 0, "old");
+  }
+  case BI_AtomicFetchAdd:
+    op = AtomicRMWInst::Add;
+    break;
+  case BI_AtomicFetchSub:
+    op = AtomicRMWInst::Sub;
+    break;
+  case BI_AtomicFetchAnd:
+    op = AtomicRMWInst::And;
+    break;
+  case BI_AtomicFetchOr:
+    op = AtomicRMWInst::Or;
+    break;
+  case BI_AtomicFetchXor:
+    op = AtomicRMWInst::Xor;
+    break;
+  case BI_AtomicExchange:
+    op = AtomicRMWInst::Xchg;
+    break;
+  default:
+    yyerror("(internal) unknown atomic builtin function: %d", kind);
+    return nullptr;
+  }
+
+  return builder.Insert(new AtomicRMWInst(op, argv[0], argv[1], align, ordering, SyncScope::System), "atomicrmw");
+}
+
+static Value *llvmcode_thread_builtin(ASTNode *p, CABuiltinKind kind, std::vector<Value *> &argv) {
+  IRBuilder<> &builder = ir1.builder();
+  if (kind == BI_Join)
+    return builder.CreateCall(init_runtime_thread_fn("ca_rt_join"), argv);
+
+  // the called function is passed to the runtime as the thread entry, only its argument is generated here
+  STEntry *entry = builtin_spawn_function(p);
+  Function *entryfn = ir1.module().getFunction(symname_get(entry->u.f.mangled_id));
+  if (!entryfn) {
+    caerror(&(p->begloc), &(p->endloc), "cannot find declared function: '%s'", symname_get(entry->u.f.mangled_id));
+    return nullptr;
+  }
+
+  ASTNode *fncall = p->exprn.operands[1]->arglistn.exprs[0];
+  walk_stack(fncall->exprn.operands[1]->arglistn.exprs[0]);
+  Value *arg = pop_right_value("spawnarg").first;
+
+  Function *spawnfn = init_runtime_thread_fn("ca_rt_spawn");
+  Value *fnptr = builder.CreateBitCast(entryfn, spawnfn->getArg(0)->getType());
+  Value *argptr = builder.CreatePointerCast(arg, spawnfn->getArg(1)->getType());
+  return builder.CreateCall(spawnfn, {fnptr, argptr}, "thread");
+}
+
+/**
+ * @brief Generate the call of builtin functions, see `builtins.h`, they are
+ * lowered into LLVM instructions or intrinsics instead of function calls.
+ */
+static void walk_expr_call_builtin(ASTNode *p, CABuiltinKind kind, CADataType *vectype) {
+  ASTNode *args = p->exprn.operands[1];
+  typeid_t rettype = builtin_inference_type(p);
+  CADataType *retdt = catype_get_by_name(p->symtable, rettype);
+  CHECK_GET_TYPE_VALUE(p, retdt, rettype);
+
+  // the constant arguments like shuffle indices and memory orderings are not walked
+  int argc = builtin_value_argc(p, kind);
+  std::vector<Value *> argv;
+  std::vector<CADataType *> argdts;
+  for (int i = 0; i < argc; ++i) {
+    walk_stack(args->arglistn.exprs[i]);
+    auto pair = pop_right_value("arg");
+    argv.push_back(pair.first);
+    argdts.push_back(pair.second);
+  }
+
+  if (enable_debug_info())
+    diinfo->emit_location(p->endloc.row, p->endloc.col, curr_lexical_scope->discope);
+
+  Value *v = nullptr;
+  if (vectype)
+    v = llvmcode_vector_builtin(p, kind, vectype, argv, argdts);
+  else if (kind >= BI_AtomicLoad && kind <= BI_Fence)
+    v = llvmcode_atomic_builtin(p, kind, argv, argdts);
+  else if (kind == BI_Spawn || kind == BI_Join)
+    v = llvmcode_thread_builtin(p, kind, argv);
+  else
+    v = llvmcode_intrinsic_builtin(p, kind, argv, argdts);
+
+  oprand_stack.push_back(std::make_unique<CalcOperand>(OT_Calc, v, retdt));
+}
+
+/// the form of the call in the return statement
+enum TailCallForm {
+  TCF_None,   /// not in the tail position
+  TCF_Return, /// `return f(args)`, the call value is returned directly
+  TCF_Become, /// `become f(args)`, the call must be a tail call
+};
+
+/// whether the pointer `v` may refer to the stack memory of current function,
+/// the pointer kept in a local variable is followed through the values stored
+/// into the variable, and it may when the address of the variable escapes
+static bool may_refer_local_memory(Value *v, int depth = 0) {
+  Value *obj = getUnderlyingObject(v);
+  if (isa<AllocaInst>(obj))
+    return true;
+
+  LoadInst *load = dyn_cast<LoadInst>(obj);
+  if (!load || !load->getType()->isPointerTy())
+    return false;
+
+  AllocaInst *slot = dyn_cast<AllocaInst>(getUnderlyingObject(load->getPointerOperand()));
+  if (!slot)
+    return false;
+
+  if (depth > 8)
+    return true;
+
+  std::vector<Value *> addrs = {slot};
+  while (!addrs.empty()) {
+    Value *addr = addrs.back();
+    addrs.pop_back();
+    for (User *user : addr->users()) {
+      if (isa<LoadInst>(user) || isa<DbgInfoIntrinsic>(user))
+	continue;
+
+      if (isa<GetElementPtrInst>(user) || isa<BitCastInst>(user)) {
+	addrs.push_back(user);
+	continue;
+      }
+
+      StoreInst *store = dyn_cast<StoreInst>(user);
+      if (!store || store->getValueOperand() == addr)
+	return true;
+
+      Value *stored = store->getValueOperand();
+      if (stored->getType()->isPointerTy() && may_refer_local_memory(stored, depth + 1))
+	return true;
+    }
+  }
+
+  return false;
+}
+
+/// whether the value of the call of `fn` can be returned as the value of
+/// current function directly, `must` also requires the same signature which
+/// the `musttail` call needs
+static bool fn_tail_callable(Function *fn, bool must) {
+  auto retkind = [](Function *f) {
+    const abi_lowering::FnInfo *info = fn_abi_info(f);
+    return info ? info->ret.kind : abi_lowering::AK_Direct;
+  };
+
+  if (retkind(fn) != retkind(curr_fn) || fn_ca_return_type(fn) != fn_ca_return_type(curr_fn) ||
+      fn->getReturnType() != curr_fn->getReturnType())
+    return false;
+
+  return !must || (fn->getFunctionType() == curr_fn->getFunctionType() &&
+		   fn->getCallingConv() == curr_fn->getCallingConv());
+}
+
 /**
  * @brief Walk the call expression.
  *
  * The expression call may be a function call or a tuple literal
  * definition, as the form of tuple literal is the same as a function.
  * Therefore, handle it here.
+ *
+ * When the call is in the return statement (`form` is not TCF_None) and its
+ * value can be returned directly it generates the return instruction and
+ * returns true, else it pushes the value of the call and returns false.
  */
-static void walk_expr_call(ASTNode *p) {
+static bool walk_expr_call_form(ASTNode *p, TailCallForm form) {
   // NEXT TODO: walk generic function, cache it and call it
   // Function *walk_fn_define_full_withsym_generic(ASTNode *p, TypeImplInfo *impl_info, SymTable *symtable, bool generic);
 
   ASTNode *name = p->exprn.operands[0];
   ASTNode *args = p->exprn.operands[1];
 
+  CADataType *domaintype = nullptr;
+  CABuiltinKind builtin = builtin_lookup(p, &domaintype);
+  int variant = 0;
+  STEntry *enumentry = builtin == BI_None ? enum_variant_lookup(p, &variant) : nullptr;
+  if (form == TCF_Become && (builtin != BI_None || enumentry)) {
+    caerror(&(p->begloc), &(p->endloc), "`become` requires a function call");
+    return false;
+  }
+
+  if (builtin != BI_None) {
+    walk_expr_call_builtin(p, builtin, domaintype);
+    return false;
+  }
+
+  if (enumentry) {
+    walk_expr_enum_variant(p, enumentry, variant);
+    return false;
+  }
+
   const char *fnname = nullptr;
   typeid_t fnname_id = typeid_novalue;
   STEntry *entry = nullptr;
@@ -3464,7 +5695,7 @@ static void walk_expr_call(ASTNode *p) {
     istuple = extract_function_or_tuple(p->symtable, name->idn.i, &entry, &fnname);
     if (istuple == -1) {
       caerror(&(p->begloc), &(p->endloc), "cannot find declared function: '%s'", fnname);
-      return;
+      return false;
     }
 
     if (IS_GENERIC_FUNCTION(entry->u.f.ca_func_type)) {
@@ -3534,7 +5765,7 @@ static void walk_expr_call(ASTNode *p) {
   }
   default:
     yyerror("bad function call type: %d", name->type);
-    return;
+    return false;
   }
 
   Function *fn = nullptr;
@@ -3543,7 +5774,7 @@ static void walk_expr_call(ASTNode *p) {
     fn = ir1.module().getFunction(fnname_full);
     if (!fn) {
       caerror(&(p->begloc), &(p->endloc), "cannot find declared function: '%s'", fnname);
-      return;
+      return false;
     }
   }
 
@@ -3554,27 +5785,87 @@ static void walk_expr_call(ASTNode *p) {
     diinfo->emit_location(p->endloc.row, p->endloc.col, curr_lexical_scope->discope);
 
   std::vector<Value *> argv;
-  
+  if (istuple) {
+    if (form == TCF_Become) {
+      caerror(&(p->begloc), &(p->endloc), "`become` requires a function call");
+      return false;
+    }
+
+    llvmvalue_from_exprs(args->arglistn.exprs, args->arglistn.argc, argv, false);
+    walk_expr_tuple(p, entry, argv);
+    return false;
+  }
+
+  // the call in the tail position returns its value without `retslot`, so
+  // it leaves the tail call to llvm, the `sret` memory of current function
+  // is passed on to the callee
+  bool tailret = form != TCF_None && fn_tail_callable(fn, form == TCF_Become);
+  if (form == TCF_Become && !tailret) {
+    caerror(&(p->begloc), &(p->endloc),
+	    "`become` requires function `%s` has the same signature as the current function", fnname);
+    return false;
+  }
+
+  // the `sret` memory is used as the result of the call directly
+  const abi_lowering::FnInfo *abiinfo = fn_abi_info(fn);
+  Value *sretslot = nullptr;
+  if (abiinfo && abiinfo->ret.kind == abi_lowering::AK_Indirect) {
+    if (tailret)
+      sretslot = (Value *)curr_fn_node->fndefn.retslot;
+    else
+      sretslot = ir1.gen_entry_block_var(curr_fn, abiinfo->ret.type, "calltmp");
+    argv.push_back(sretslot);
+  }
+
+  size_t argidx = 0;
   int is_method = name->type == TTE_Expr;
   if (is_method)
-    argv.push_back(self_value);
+    llvmcode_lowered_arg(abiinfo, argidx++, self_value, false, argv);
 
-  llvmvalue_from_exprs(args->arglistn.exprs, args->arglistn.argc, argv, !istuple);
-
-  if (istuple)
-    return walk_expr_tuple(p, entry, argv);
+  for (int i = 0; i < args->arglistn.argc; ++i) {
+    walk_stack(args->arglistn.exprs[i]);
+    auto operand = pop_right_operand("exprarg", false);
+    llvmcode_lowered_arg(abiinfo, argidx++, operand->operand, operand->type == OT_Alloc, argv);
+  }
 
-  Type *rettype = fn->getReturnType();
-  bool isvoidty = rettype->isVoidTy();
+  Type *rettype = fn_ca_return_type(fn);
+  bool isvoidty = fn->getReturnType()->isVoidTy();
 
   const char *fnname_full = symname_get(entry->u.f.mangled_id);
   auto itr = function_map.find(fnname_full);
   if (itr == function_map.end()) {
     caerror(&(p->begloc), &(p->endloc), "cannot find function '%s' node", fnname);
-    return;
+    return false;
+  }
+
+  // the frame of current function is gone when `musttail` call, so the
+  // memory of it cannot be passed, the argument passed in memory is also
+  // the memory of current function
+  if (form == TCF_Become) {
+    for (size_t i = sretslot ? 1 : 0; i < argv.size(); ++i) {
+      if (may_refer_local_memory(argv[i])) {
+	caerror(&(p->begloc), &(p->endloc),
+		"the arguments of `become` cannot refer to or be passed in the memory of current function");
+	return false;
+      }
+    }
   }
  
   CallInst *callret = ir1.builder().CreateCall(fn, argv, isvoidty ? "" : fnname);
+  if (abiinfo)
+    g_abi->set_attributes(callret, *abiinfo);
+
+  if (tailret) {
+    if (form == TCF_Become)
+      callret->setTailCallKind(CallInst::TCK_MustTail);
+
+    if (isvoidty)
+      ir1.builder().CreateRetVoid();
+    else
+      ir1.builder().CreateRet(callret);
+    return true;
+  }
+
   if ((cls_entry && (IS_GENERIC_FUNCTION(entry->u.f.ca_func_type) || entry->u.f.ca_func_type == CAFT_MethodInTrait))) {
     SymTableAssoc *assoc = runable_find_entry_assoc(cls_entry, fnname_id, -1);
     itr->second->symtable->assoc = assoc;
@@ -3586,20 +5877,39 @@ static void walk_expr_call(ASTNode *p) {
 
   OperandType optype = OT_CallInst;
   Value *newv = callret;
-  if (!isvoidty) {
+  if (sretslot) {
+    optype = OT_Alloc;
+    newv = sretslot;
+  } else if (abiinfo && abiinfo->ret.kind == abi_lowering::AK_Coerce) {
+    std::vector<Value *> pieces(1, callret);
+    if (abiinfo->ret.pieces.size() > 1) {
+      pieces.clear();
+      for (unsigned i = 0; i < abiinfo->ret.pieces.size(); ++i)
+	pieces.push_back(ir1.builder().CreateExtractValue(callret, i));
+    }
+
+    optype = OT_Alloc;
+    newv = ir1.gen_entry_block_var(curr_fn, rettype, "calltmp");
+    g_abi->store_pieces(ir1.builder(), newv, abiinfo->ret, pieces);
+  } else if (!isvoidty && catype_is_complex_type(retdt)) {
     optype = OT_Alloc;
     newv = ir1.gen_entry_block_var(curr_fn, rettype, "calltmp", callret);
   }
 
   auto operands = std::make_unique<CalcOperand>(optype, newv, retdt);
   oprand_stack.push_back(std::move(operands));
+  return false;
+}
+
+static void walk_expr_call(ASTNode *p) {
+  walk_expr_call_form(p, TCF_None);
 }
 
 static void walk_ret(ASTNode *p) {
   if (walk_pass == 1)
     return;
 
-  Type *rettype = curr_fn->getReturnType();
+  Type *rettype = fn_ca_return_type(curr_fn);
   BasicBlock *retbb = (BasicBlock *)curr_fn_node->fndefn.retbb;
 
   if (p->retn.expr) {
@@ -3614,7 +5924,19 @@ static void walk_ret(ASTNode *p) {
       CHECK_GET_TYPE_VALUE(p, retdt, itr->second->fndecln.ret);
     }
 
-    walk_stack(retn);
+    // `return f(args)` returns the value of the call directly, so llvm can
+    // make it a tail call, `become f(args)` always does
+    bool iscall = retn->type == TTE_Expr && retn->exprn.op == FN_CALL;
+    if (iscall && walk_expr_call_form(retn, p->retn.become ? TCF_Become : TCF_Return)) {
+      BasicBlock *bb = ir1.gen_bb("afterret", curr_fn);
+      ir1.builder().SetInsertPoint(bb);
+      g_with_ret_value = true;
+      return;
+    }
+
+    if (!iscall)
+      walk_stack(retn);
+
     auto pair = pop_right_value();
     Value *v = pair.first;
     if (enable_debug_info())
@@ -3631,7 +5953,7 @@ static void walk_ret(ASTNode *p) {
       return;
     }
 
-    AllocaInst *retslot = (AllocaInst *)curr_fn_node->fndefn.retslot;
+    Value *retslot = (Value *)curr_fn_node->fndefn.retslot;
     ir1.builder().CreateStore(v, retslot);
   } else {
     if (enable_debug_info())
@@ -3666,7 +5988,137 @@ static void handle_pointer_op(ASTNode *p, CADataType *dt, Value *v1, CADataType
     v3 = ir1.builder().CreateGEP(type, v1, v2, "pop");
     break;
   default:
-    caerror(&(p->begloc), &(p->endloc), "pointer operation only support `+` and `-`, but find `%c`", p->exprn.op);
+    caerror(&(p->begloc), &(p->endloc), "pointer operation only support `+` and `-`, but find `%c`", p->exprn.op);
+    return;
+  }
+
+  oprand_stack.push_back(std::make_unique<CalcOperand>(OT_Calc, v3, dt));
+  if (p->exprn.expr_type == typeid_novalue)
+    p->exprn.expr_type = dt->signature;
+
+  assert(p->exprn.expr_type == dt->signature);
+  return;
+}
+
+static void walk_expr_landor(CADataType *dt1, Value *v1, ASTNode *p) {
+  BasicBlock *thenbb = ir1.gen_bb("thenbb");
+  BasicBlock *outbb = ir1.gen_bb("outbb");
+  bool isand = (p->exprn.op == LAND);
+
+  BasicBlock *v1bb = ir1.builder().GetInsertBlock();
+
+  ir1.builder().CreateCondBr(v1, isand ? thenbb : outbb, isand ? outbb : thenbb);
+
+  // then block, to calculate the value of second bool expression
+  curr_fn->getBasicBlockList().push_back(thenbb);
+  ir1.builder().SetInsertPoint(thenbb);
+  walk_stack(p->exprn.operands[1]);
+  auto pair2 = pop_right_value("v2");
+  Value *v2 = pair2.first;
+
+  /*
+   * Because the upper walk may have appended a new basic block (BB), 
+   * we cannot use `thenbb` directly here; instead, we need to retrieve it.
+   */
+  BasicBlock *v2bb = ir1.builder().GetInsertBlock();
+
+  ir1.builder().CreateBr(outbb);
+
+  // Jump out of the block, if first bool expression already meet the requirement
+  curr_fn->getBasicBlockList().push_back(outbb);
+  ir1.builder().SetInsertPoint(outbb);
+
+  PHINode *phiv = ir1.gen_phi(ir1.bool_type(), v2bb, v2, v1bb, v1);
+  auto pnv = std::make_unique<CalcOperand>(OT_PHINode, phiv, dt1);
+  oprand_stack.push_back(std::move(pnv));
+}
+
+/**
+ * @brief Generate the element-wise operation of the SIMD vectors. The
+ * comparison results the mask vector whose lanes are all ones for true and
+ * zero for false, the shift amount can also be a scalar for all the lanes.
+ */
+static void walk_expr_op2_vector(ASTNode *p, CADataType *dt, Value *v1, CADataType *dt2, Value *v2) {
+  int op = p->exprn.op;
+  tokenid_t elemtok = catype_scalar_token(dt);
+  bool isfloat = catype_is_float(elemtok);
+  bool issigned = catype_is_signed(elemtok);
+  Value *v3 = nullptr;
+
+  if ((op == SHIFTL || op == SHIFTR) && dt2->type != VECTOR) {
+    v2 = ir1.builder().CreateZExtOrTrunc(v2, v1->getType()->getScalarType());
+    v2 = ir1.builder().CreateVectorSplat(dt->array_layout->dimarray[0], v2, "splat");
+  } else if (!catype_check_identical(dt, dt2)) {
+    caerror(&(p->begloc), &(p->endloc), "operation have 2 different types: '%s', '%s'",
+	    catype_get_type_name(dt->signature), catype_get_type_name(dt2->signature));
+    return;
+  }
+
+  switch (op) {
+  case BAND:
+  case BOR:
+  case BXOR:
+  case SHIFTL:
+  case SHIFTR:
+    if (isfloat) {
+      caerror(&(p->begloc), &(p->endloc), "expected integer vector for bitwise operation, but find `%s`",
+	      catype_get_type_name(dt->signature));
+      return;
+    }
+    break;
+  }
+
+  switch (op) {
+  case '+':
+    v3 = ir1.gen_add(v1, v2, "add");
+    break;
+  case '-':
+    v3 = ir1.gen_sub(v1, v2, "sub");
+    break;
+  case '*':
+    v3 = ir1.gen_mul(v1, v2, "mul");
+    break;
+  case '/':
+    if (isfloat)
+      v3 = ir1.builder().CreateFDiv(v1, v2, "div");
+    else
+      v3 = issigned ? ir1.builder().CreateSDiv(v1, v2, "div") : ir1.builder().CreateUDiv(v1, v2, "div");
+    break;
+  case '%':
+    if (isfloat)
+      v3 = ir1.builder().CreateFRem(v1, v2, "mod");
+    else
+      v3 = issigned ? ir1.builder().CreateSRem(v1, v2, "mod") : ir1.builder().CreateURem(v1, v2, "mod");
+    break;
+  case '<':
+  case '>':
+  case GE:
+  case LE:
+  case NE:
+  case EQ:
+    // the <N x i1> result is extended into the mask vector of the same width
+    v3 = generate_cmp_op(elemtok, v1, v2, op);
+    dt = catype_get_vector_mask_type(dt);
+    v3 = ir1.builder().CreateSExt(v3, llvmtype_from_catype(dt), "mask");
+    break;
+  case BAND:
+    v3 = ir1.builder().CreateAnd(v1, v2, "band");
+    break;
+  case BOR:
+    v3 = ir1.builder().CreateOr(v1, v2, "bor");
+    break;
+  case BXOR:
+    v3 = ir1.builder().CreateXor(v1, v2, "bxor");
+    break;
+  case SHIFTL:
+    v3 = ir1.builder().CreateShl(v1, v2, "shl");
+    break;
+  case SHIFTR:
+    v3 = issigned ? ir1.builder().CreateAShr(v1, v2, "ashr") : ir1.builder().CreateLShr(v1, v2, "lshr");
+    break;
+  default:
+    caerror(&(p->begloc), &(p->endloc), "operator `%d` not supported by vector type `%s`",
+	    op, catype_get_type_name(dt->signature));
     return;
   }
 
@@ -3675,40 +6127,6 @@ static void handle_pointer_op(ASTNode *p, CADataType *dt, Value *v1, CADataType
     p->exprn.expr_type = dt->signature;
 
   assert(p->exprn.expr_type == dt->signature);
-  return;
-}
-
-static void walk_expr_landor(CADataType *dt1, Value *v1, ASTNode *p) {
-  BasicBlock *thenbb = ir1.gen_bb("thenbb");
-  BasicBlock *outbb = ir1.gen_bb("outbb");
-  bool isand = (p->exprn.op == LAND);
-
-  BasicBlock *v1bb = ir1.builder().GetInsertBlock();
-
-  ir1.builder().CreateCondBr(v1, isand ? thenbb : outbb, isand ? outbb : thenbb);
-
-  // then block, to calculate the value of second bool expression
-  curr_fn->getBasicBlockList().push_back(thenbb);
-  ir1.builder().SetInsertPoint(thenbb);
-  walk_stack(p->exprn.operands[1]);
-  auto pair2 = pop_right_value("v2");
-  Value *v2 = pair2.first;
-
-  /*
-   * Because the upper walk may have appended a new basic block (BB), 
-   * we cannot use `thenbb` directly here; instead, we need to retrieve it.
-   */
-  BasicBlock *v2bb = ir1.builder().GetInsertBlock();
-
-  ir1.builder().CreateBr(outbb);
-
-  // Jump out of the block, if first bool expression already meet the requirement
-  curr_fn->getBasicBlockList().push_back(outbb);
-  ir1.builder().SetInsertPoint(outbb);
-
-  PHINode *phiv = ir1.gen_phi(ir1.bool_type(), v2bb, v2, v1bb, v1);
-  auto pnv = std::make_unique<CalcOperand>(OT_PHINode, phiv, dt1);
-  oprand_stack.push_back(std::move(pnv));
 }
 
 static void walk_expr_op2(ASTNode *p) {
@@ -3744,6 +6162,11 @@ static void walk_expr_op2(ASTNode *p) {
     return;
   }
 
+  if (dt->type == VECTOR) {
+    walk_expr_op2_vector(p, dt, v1, dt2, v2);
+    return;
+  }
+
   if ((p->exprn.op != SHIFTL &&  p->exprn.op != SHIFTR) && !catype_check_identical_in_symtable(p->symtable, typeid1, p->symtable, typeid2)) {
     caerror(&(p->begloc), &(p->endloc), "operation have 2 different types: '%s', '%s'",
 	    symname_get(typeid1), symname_get(typeid2));
@@ -3752,13 +6175,9 @@ static void walk_expr_op2(ASTNode *p) {
 
   switch (p->exprn.op) {
   case '+':
-    v3 = ir1.gen_add(v1, v2);
-    break;
   case '-':
-    v3 = ir1.gen_sub(v1, v2);
-    break;
   case '*':
-    v3 = ir1.gen_mul(v1, v2);
+    v3 = llvmcode_arith_op(p, p->exprn.op, dt, v1, v2);
     break;
   case '/':
     v3 = ir1.gen_div(v1, v2);
@@ -3828,6 +6247,48 @@ static void walk_expr_as(ASTNode *node) {
   CADataType *exprcatype = catype_get_by_name(node->symtable, stype);
   CHECK_GET_TYPE_VALUE(node, exprcatype, stype);
   tokenid_t stypetok = exprcatype->type;
+
+  if (astype->type == VECTOR && exprcatype->type != VECTOR) {
+    // convert the scalar into the element type and splat it into all the lanes
+    CADataType *elemtype = astype->array_layout->type;
+    Value *v = pop_right_value("tmpexpr").first;
+    Instruction::CastOps castopt = gen_cast_ops(exprcatype, elemtype);
+    if (castopt != (ICO)0)
+      v = ir1.gen_cast_value(castopt, v, llvmtype_from_catype(elemtype));
+
+    v = ir1.builder().CreateVectorSplat(astype->array_layout->dimarray[0], v, "splat");
+    oprand_stack.push_back(std::make_unique<CalcOperand>(OT_Calc, v, astype));
+    return;
+  }
+
+  if (exprcatype->type == STRUCT && exprcatype->struct_layout->type == Struct_Enum) {
+    // the enum without fields is converted into its discriminant
+    CAStruct *layout = exprcatype->struct_layout;
+    bool fieldless = std::all_of(layout->fields, layout->fields + layout->fieldnum,
+				 [](const CAStructField &field) { return field.type->size == 0; });
+    if (!fieldless || !catype_is_integer(astype->type)) {
+      caerror(&(node->begloc), &(node->endloc), "cannot convert `%s` into `%s`",
+	      catype_get_type_name(exprcatype->signature), catype_get_type_name(astype->signature));
+      return;
+    }
+
+    Value *v = pop_right_value("tmpexpr", false).first;
+    if (!v->getType()->isPointerTy()) {
+      Value *slot = ir1.gen_entry_block_var(curr_fn, v->getType(), "enumtmp");
+      ir1.builder().CreateStore(v, slot);
+      v = slot;
+    }
+
+    Type *type = llvmtype_from_catype(astype);
+    CAEnum *el = layout->enum_layout;
+    if (el->tagsize)
+      v = ir1.builder().CreateIntCast(enum_gen_tag(v, exprcatype), type, el->tagsigned, "discriminant");
+    else
+      v = ConstantInt::get(type, el->values[0], true);
+
+    oprand_stack.push_back(std::make_unique<CalcOperand>(OT_Calc, v, astype));
+    return;
+  }
   
   Instruction::CastOps castopt = gen_cast_ops(exprcatype, astype);
   if (castopt == (ICO)-1) {
@@ -3907,6 +6368,7 @@ static void walk_expr_array(ASTNode *p) {
   // allocate new array and copy related elements to the it
   Type *arraytype = llvmtype_from_catype(arraycatype);
   AllocaInst *arr = ir1.gen_entry_block_var(curr_fn, arraytype);
+  aux_set_catype_align(arr, arraycatype);
   Value *idxv0 = ir1.gen_int(0);
   std::vector<Value *> idxv(2, idxv0);
 
@@ -3987,6 +6449,13 @@ static void walk_expr_struct(ASTNode *p) {
     return;
   }
 
+  // the fields of `#[repr(auto)]` struct are not in the definition order
+  if (!snode->snoden.named && structcatype->struct_layout->reordered) {
+    caerror(&(snode->begloc), &(snode->endloc), "struct `%s` of `repr(auto)` layout must be constructed with field names",
+	    catype_get_type_name(structcatype->signature));
+    return;
+  }
+
   CAStructField *fields = structcatype->struct_layout->fields;
 
   // when it is a named field then store the order of the field in struct definition
@@ -4064,6 +6533,7 @@ static void walk_expr_struct(ASTNode *p) {
   // allocate new array and copy related elements to the array
   StructType *structype = static_cast<StructType *>(llvmtype_from_catype(structcatype));
   AllocaInst *structure = ir1.gen_entry_block_var(curr_fn, structype);
+  aux_set_catype_align(structure, structcatype);
   Value *idxv0 = ir1.gen_int((int)0);
   std::vector<Value *> idxv(2, idxv0);
 
@@ -4110,22 +6580,23 @@ static void walk_expr_structitemop(ASTNode *p) {
 static void walk_expr_deref(ASTNode *rexpr) {
   ASTNode *expr = rexpr->exprn.operands[0];
   walk_stack(expr);
-  auto pair = pop_right_value("deref", false);
-  if (pair.second->type != POINTER) {
+  auto o = pop_right_operand("deref", false);
+  if (o->catype->type != POINTER) {
     caerror(&(rexpr->begloc), &(rexpr->endloc), " cannot deref type `%s`",
-	    catype_get_type_name(pair.second->signature));
+	    catype_get_type_name(o->catype->signature));
     return;
   }
 
-  assert(pair.second->pointer_layout->dimension == 1);
-  rexpr->exprn.expr_type = pair.second->pointer_layout->type->signature;
+  assert(o->catype->pointer_layout->dimension == 1);
+  rexpr->exprn.expr_type = o->catype->pointer_layout->type->signature;
 
-  Value *v = ir1.builder().CreateLoad(pair.first, "deref");
+  // the call result is the pointer value itself, others are the slot holding the pointer
+  Value *v = o->type == OT_CallInst ? o->operand : ir1.load_var(o->operand, "deref");
   OperandType ot = OT_Alloc;
   if (!v->getType()->isPointerTy())
       ot = OT_Calc;
 
-  auto u = std::make_unique<CalcOperand>(ot, v, pair.second->pointer_layout->type);
+  auto u = std::make_unique<CalcOperand>(ot, v, o->catype->pointer_layout->type);
   oprand_stack.push_back(std::move(u));
 }
 
@@ -4133,6 +6604,7 @@ static void walk_expr_address(ASTNode *aexpr) {
   ASTNode *expr = aexpr->exprn.operands[0];
   walk_stack(expr);
   auto pair = pop_right_operand("addr", false);
+  aux_operand_address(pair.get(), "addrtmp");
 
   pair->catype = catype_make_pointer_type(pair->catype);
   pair->type = OT_Calc; // make it not loadable value
@@ -4147,6 +6619,24 @@ static void walk_expr_box(ASTNode *expr) {
   oprand_stack.push_back(std::move(pair));
 }
 
+/*
+ * The `likely(cond)` and `unlikely(cond)` is the value of `cond` itself, the
+ * expectation takes effect on the branch of `if` and `while` condition, see
+ * `cond_expect`.
+ */
+static void walk_expr_expect(ASTNode *p) {
+  walk_stack(p->exprn.operands[0]);
+
+  CADataType *catype = oprand_stack.back()->catype;
+  if (catype->type != BOOL) {
+    caerror(&(p->begloc), &(p->endloc), "`%s` only accept `bool` type, but find `%s`",
+	    p->exprn.op == LIKELY ? "likely" : "unlikely", get_type_string(catype->type));
+    return;
+  }
+
+  p->exprn.expr_type = catype->signature;
+}
+
 static void walk_expr_range(ASTNode *expr) {
   ASTNode *range_expr = expr->exprn.operands[0];
   walk_stack(range_expr);
@@ -4188,6 +6678,10 @@ static void walk_expr(ASTNode *p) {
   case BNOT:
     walk_unary_expr(p);
     break;
+  case LIKELY:
+  case UNLIKELY:
+    walk_expr_expect(p);
+    break;
   case FN_CALL:
     walk_expr_call(p);
     break;
@@ -4419,6 +6913,26 @@ static const char *mangling_function_name(SymTable *symtable, typeid_t fnname, T
   return mangling_function_name_nottype(pos + 1, trait_name_fn);
 }
 
+// map the source level attributes `#[inline]`, `#[cold]` ... to the llvm function attributes
+static void set_fn_attributes(Function *fn, CAFnAttr attrs) {
+  if (attrs & CAFA_Inline)
+    fn->addFnAttr(Attribute::AlwaysInline);
+
+  if (attrs & CAFA_NoInline)
+    fn->addFnAttr(Attribute::NoInline);
+
+  if (attrs & CAFA_Cold)
+    fn->addFnAttr(Attribute::Cold);
+
+  if (attrs & CAFA_Hot)
+    fn->addFnAttr(Attribute::Hot);
+
+  if (attrs & CAFA_MinSize) {
+    fn->addFnAttr(Attribute::MinSize);
+    fn->addFnAttr(Attribute::OptimizeForSize);
+  }
+}
+
 static Function *walk_fn_declare_full_withsym(ASTNode *p, TypeImplInfo *impl_info, SymTable *st_type) {
   STEntry *cls_entry = nullptr;
   STEntry **cls_entry_out = impl_info ? &cls_entry : nullptr;
@@ -4504,9 +7018,36 @@ static Function *walk_fn_declare_full_withsym(ASTNode *p, TypeImplInfo *impl_inf
   CADataType *retdt = catype_get_by_name(p->symtable, p->fndecln.ret);
   CHECK_GET_TYPE_VALUE(p, retdt, p->fndecln.ret);
   Type *rettype = llvmtype_from_catype(retdt);
-  fn = ir1.gen_extern_fn(rettype, fnname_full, params, &param_names, !!p->fndecln.args.contain_varg);
+
+  // lower the parameters and the return value to the C ABI, see abi_lowering.h
+  abi_lowering::FnInfo abiinfo = g_abi->classify(rettype, params, !!p->fndecln.args.contain_varg);
+  FunctionType *fntype = abiinfo.lowered_type();
+  std::vector<std::string> lowered_names;
+  if (abiinfo.prefix())
+    lowered_names.push_back("sret");
+
+  for (size_t i = 0; i < abiinfo.params.size(); ++i) {
+    if (abiinfo.params[i].kind != abi_lowering::AK_Coerce) {
+      lowered_names.push_back(param_names[i]);
+      continue;
+    }
+
+    for (size_t j = 0; j < abiinfo.params[i].pieces.size(); ++j)
+      lowered_names.push_back(std::string(param_names[i]) + ".coerce" + std::to_string(j));
+  }
+
+  std::vector<const char *> lowered_name_ptrs;
+  for (const std::string &lname : lowered_names)
+    lowered_name_ptrs.push_back(lname.c_str());
+
+  std::vector<Type *> lowered_params(fntype->param_begin(), fntype->param_end());
+  fn = ir1.gen_extern_fn(fntype->getReturnType(), fnname_full, lowered_params,
+			 &lowered_name_ptrs, fntype->isVarArg());
   function_map.insert(std::make_pair(fnname_full, p));
   fn->setCallingConv(CallingConv::C);
+  g_abi->set_attributes(fn, abiinfo);
+  g_fn_abi_map[fn] = std::move(abiinfo);
+  set_fn_attributes(fn, p->fndecln.fn_attrs);
 
   if (walk_pass == 1) {
     if (cls_entry) {
@@ -4557,9 +7098,9 @@ static void generate_final_return(ASTNode *p) {
     return;
   }
 
+  const abi_lowering::FnInfo *abiinfo = fn_abi_info(curr_fn);
   if (g_with_ret_value) {
-    Value *v = ir1.builder().CreateLoad((Value *)p->fndefn.retslot, "retret");
-    ir1.builder().CreateRet(v);
+    llvmcode_lowered_return(abiinfo, (Value *)p->fndefn.retslot);
     return;
   }
 
@@ -4569,6 +7110,11 @@ static void generate_final_return(ASTNode *p) {
     return;
   }
 
+  if (abiinfo && abiinfo->ret.kind == abi_lowering::AK_Indirect) {
+    ir1.builder().CreateRetVoid();
+    return;
+  }
+
   Value *retv = create_default_integer_value(retdt->type);
   ir1.builder().CreateRet(retv);
 }
@@ -4589,9 +7135,11 @@ static Function *walk_fn_define_full_withsym_generic(ASTNode *p, TypeImplInfo *i
   else
     generic_type_stack.push_back(std::make_pair(nullptr, generic_type_var_set_t()));
 
-  if (p->fndefn.fn_decl->fndecln.args.argc != fn->arg_size())
+  const abi_lowering::FnInfo *abiinfo = fn_abi_info(fn);
+  int paramnum = abiinfo ? (int)abiinfo->params.size() : (int)fn->arg_size();
+  if (p->fndefn.fn_decl->fndecln.args.argc != paramnum)
     yyerror("argument number not identical with definition (%d != %d)",
-	    p->fndefn.fn_decl->fndecln.args.argc, fn->arg_size());
+	    p->fndefn.fn_decl->fndecln.args.argc, paramnum);
 
   curr_fn_stack.push_back(CurrFnInfo(curr_fn, curr_fn_node));
   curr_fn_node = p;
@@ -4615,8 +7163,11 @@ static Function *walk_fn_define_full_withsym_generic(ASTNode *p, TypeImplInfo *i
 
   CADataType *retdt = catype_get_by_name(p->symtable, p->fndefn.fn_decl->fndecln.ret);
   CHECK_GET_TYPE_VALUE(p, retdt, p->fndefn.fn_decl->fndecln.ret);
-  if (retdt->type != VOID) {
-    p->fndefn.retslot = (void *)ir1.gen_entry_block_var(curr_fn, fn->getReturnType(), "retslot");
+  if (retdt->type != VOID && abiinfo && abiinfo->ret.kind == abi_lowering::AK_Indirect) {
+    // the return value is written into the memory of the caller directly
+    p->fndefn.retslot = (void *)fn->getArg(0);
+  } else if (retdt->type != VOID) {
+    p->fndefn.retslot = (void *)ir1.gen_entry_block_var(curr_fn, abiinfo->ret.type, "retslot");
   } else {
     p->fndefn.retslot = nullptr;
   }
@@ -4634,6 +7185,7 @@ static Function *walk_fn_define_full_withsym_generic(ASTNode *p, TypeImplInfo *i
   fn->getBasicBlockList().push_back(retbb);
   ir1.builder().SetInsertPoint(retbb);
   generate_final_return(p);
+  promote_readonly_params(fn);
 
   if (enable_debug_info()) {
     // finalize the debug info for only the function
@@ -4643,6 +7195,9 @@ static Function *walk_fn_define_full_withsym_generic(ASTNode *p, TypeImplInfo *i
     //diinfo->dibuilder->finalize();
   }
 
+  if (genv.bounds_check)
+    g_bounds_check_opt.run(*fn);
+
   std::string verify_message;
   llvm::raw_string_ostream rso(verify_message);
   if (llvm::verifyFunction(*fn, &rso)) {
@@ -5091,6 +7646,8 @@ static walk_fn_t walk_fn_array[TTE_Num] = {
   (walk_fn_t)walk_fn_define_impl,
   (walk_fn_t)walk_empty,
   (walk_fn_t)walk_trait_fnlist,
+  (walk_fn_t)walk_match,
+  (walk_fn_t)walk_match_arm,
 };
 
 static int walk_stack(ASTNode *p) {
@@ -5101,19 +7658,70 @@ static int walk_stack(ASTNode *p) {
   return 0;
 }
 
+// the profile instrumentation of `-fprofile-generate`, see profile.h
+static profile::ProfileInstr g_profile_instr;
+
+static void do_profile_pass() {
+  if (genv.profile_generate) {
+    bool forjit = genv.llvm_gen_type == LGT_JIT;
+    std::string output = genv.profile_generate_path;
+    if (output.empty() && forjit)
+      output = "default.profdata";
+
+    g_profile_instr.instrument(ir1.module(), output, forjit);
+  } else if (genv.profile_use_path[0]) {
+    if (!profile::ProfileInstr::use(ir1.module(), genv.profile_use_path))
+      exit(-1);
+  }
+}
+
+static TargetMachine *create_target_machine();
+
+/*
+ * Vectorize the loops, e.g. the canonical loops of `for` statement, see
+ * walk_for. The variables are promoted into registers first to expose the
+ * induction variables, the cost model of the vectorizer needs the target
+ * information to choose the vector width.
+ */
+static void do_loop_vectorize_pass() {
+  std::unique_ptr<TargetMachine> target_machine(create_target_machine());
+  legacy::PassManager pm;
+  if (target_machine)
+    pm.add(createTargetTransformInfoWrapperPass(target_machine->getTargetIRAnalysis()));
+
+  pm.add(createPromoteMemoryToRegisterPass());
+  pm.add(createInstructionCombiningPass());
+  pm.add(createLoopRotatePass());
+  pm.add(createLICMPass());
+  pm.add(createIndVarSimplifyPass());
+  pm.add(createLoopVectorizePass());
+  pm.add(createInstructionCombiningPass());
+  pm.add(createCFGSimplificationPass());
+  pm.run(ir1.module());
+}
+
 static void do_optimize_pass() {
+  // instrument or annotate before the optimization, so both see the same control flow
+  do_profile_pass();
+
   switch (genv.opt_level) {
   case OL_O1:
     {
+      // the inferred attributes help the alias analysis of the passes below
+      attr_infer::AttrInfer().run(ir1.module());
       Function *fn = ir1.module().getFunction("main");
-      ir1.fpm().run(*fn);
+      if (fn)
+	ir1.fpm().run(*fn);
       break;
     }
   case OL_O2:
     {
+      attr_infer::AttrInfer().run(ir1.module());
       Function *fn = ir1.module().getFunction("main");
-      ir1.fpm().run(*fn);
+      if (fn)
+	ir1.fpm().run(*fn);
       ir1.pm().run(ir1.module());
+      do_loop_vectorize_pass();
       break;
     }
   case OL_O3:
@@ -5185,18 +7793,50 @@ static int llvm_codegen_ll(const char *output = nullptr) {
   return 0;
 }
 
+// write the module into `path` as bitcode or IR assembly
+static int write_module_file(Module &module, const std::string &path, bool bitcode) {
+  std::error_code ec;
+
+#if LLVM_VERSION > 12
+  raw_fd_ostream os(path, ec, llvm::sys::fs::OF_None);
+#else
+  raw_fd_ostream os(path, ec, llvm::sys::fs::F_None);
+#endif
+
+  if (ec) {
+    errs() << "could not open file: " << path
+	   << ", error code: " << ec.message();
+    return -1;
+  }
+
+  if (bitcode)
+    WriteBitcodeToFile(module, os);
+  else
+    module.print(os, nullptr);
+  return 0;
+}
+
+static int llvm_codegen_bc(const char *output = nullptr) {
+  // run pass
+  do_optimize_pass();
+
+  // the bitcode is binary, it is written into `<input>.bc` when no output specified
+  std::string path = output && output[0] ? output : std::string(genv.src_path) + ".bc";
+  return write_module_file(ir1.module(), path, true);
+}
+
 static CodeGenOpt::Level to_llvm_codegenopt(Optimize_Level level) {
   return (CodeGenOpt::Level)level;
 }
 
-static int llvm_codegen_native(CodeGenFileType type, const char *output = nullptr) {
+static TargetMachine *create_target_machine() {
   // x86_64-pc-linux-gnu (clang --version)
   std::string target_triple = llvm::sys::getDefaultTargetTriple();
   std::string error;
   const Target *target = llvm::TargetRegistry::lookupTarget(target_triple, error);
   if (!target) {
     llvm::errs() << error;
-    return -1;
+    return nullptr;
   }
 
   auto cpu = "generic";
@@ -5206,14 +7846,12 @@ static int llvm_codegen_native(CodeGenFileType type, const char *output = nullpt
   Optional<CodeModel::Model> cm = None;
   CodeGenOpt::Level ol = to_llvm_codegenopt(genv.opt_level);
   bool jit = false;
-  TargetMachine *target_machine =
-    target->createTargetMachine(target_triple, cpu, features, opt, rm, cm, ol, jit);
-  ir1.module().setDataLayout(target_machine->createDataLayout());
-  ir1.module().setTargetTriple(target_triple);
-
-  // run pass
-  do_optimize_pass();
+  return target->createTargetMachine(target_triple, cpu, features, opt, rm, cm, ol, jit);
+}
 
+/// emit the module into the native assembly or object file, or the bitcode file when `bitcode` is true
+static int emit_native_file(Module &module, TargetMachine *target_machine, CodeGenFileType type,
+			    bool bitcode, const char *output) {
   legacy::PassManager pass;
   auto filetype = type; // CGFT_ObjectFile; CGFT_AssemblyFile;  CGFT_Null;
 
@@ -5232,18 +7870,79 @@ static int llvm_codegen_native(CodeGenFileType type, const char *output = nullpt
       return -1;
     }
 
+    if (bitcode) {
+      WriteBitcodeToFile(module, os);
+      os.flush();
+      return 0;
+    }
+
     target_machine->addPassesToEmitFile(pass, os, nullptr, filetype);
-    pass.run(ir1.module());
+    pass.run(module);
     os.flush();
   } else {
     target_machine->addPassesToEmitFile(pass, outs(), nullptr, filetype);
-    pass.run(ir1.module());
+    pass.run(module);
     outs().flush();
   }
 
   return 0;
 }
 
+static int llvm_codegen_native(CodeGenFileType type, const char *output = nullptr) {
+  TargetMachine *target_machine = create_target_machine();
+  if (!target_machine)
+    return -1;
+
+  ir1.module().setDataLayout(target_machine->createDataLayout());
+  ir1.module().setTargetTriple(target_machine->getTargetTriple().str());
+
+  // run pass
+  do_optimize_pass();
+
+  // with -flto the object file is the bitcode, it is optimized again when linking
+  return emit_native_file(ir1.module(), target_machine, type, genv.lto && genv.llvm_gen_type == LGT_C, output);
+}
+
+/*
+ * Link the bitcode objects of `-flto` into one native object, see lto.h. The
+ * exported symbols are kept as `main`, the other symbols are internalized.
+ */
+int llvm_lto_link() {
+  TargetMachine *target_machine = create_target_machine();
+  if (!target_machine)
+    return -1;
+
+  LLVMContext ctx;
+  lto::LTOLinker linker(ctx);
+  for (int i = 0; i < genv.lto_ninputs; ++i) {
+    if (!linker.add_file(genv.lto_inputs[i]))
+      return -1;
+  }
+
+  Module *module = linker.module();
+  module->setDataLayout(target_machine->createDataLayout());
+  module->setTargetTriple(target_machine->getTargetTriple().str());
+
+  std::vector<std::string> exports;
+  std::stringstream ss(genv.lto_exports);
+  std::string name;
+  while (std::getline(ss, name, ','))
+    if (!name.empty())
+      exports.push_back(name);
+
+  // the link step always optimizes, the default is level 2
+  unsigned optlevel = genv.opt_level == OL_NONE ? 2 : (unsigned)genv.opt_level;
+  linker.optimize(exports, optlevel);
+
+  // the linked module can be written as IR, e.g. to see what is inlined or run it in jit
+  std::string output = genv.outfile;
+  if (output.size() > 3 && (!output.compare(output.size() - 3, 3, ".bc") ||
+			    !output.compare(output.size() - 3, 3, ".ll")))
+    return write_module_file(*module, output, output.back() == 'c');
+
+  return emit_native_file(*module, target_machine, CGFT_ObjectFile, false, genv.outfile);
+}
+
 static int llvm_codegen_jit(const char *output = nullptr) {
   do_optimize_pass();
 
@@ -5271,6 +7970,18 @@ static int llvm_codegen_jit(const char *output = nullptr) {
   printf("\nreturn value: %d\n", func());
   fflush(stdout);
 
+  if (genv.profile_generate) {
+    g_profile_instr.write_jit_profile([](const std::string &name) -> const uint64_t * {
+      auto symbol = jit1->find(name);
+      if (!symbol) {
+	consumeError(symbol.takeError());
+	return nullptr;
+      }
+
+      return (const uint64_t *)(intptr_t)symbol->getAddress();
+    });
+  }
+
   if (tofile) {
     dup2(saved_stdout, STDOUT_FILENO);
     dup2(saved_stderr, STDERR_FILENO);
@@ -5282,6 +7993,27 @@ static int llvm_codegen_jit(const char *output = nullptr) {
   return 0;
 }
 
+// find the profile runtime library of clang, `libclang_rt.profile-<arch>.a`
+static const char *find_profile_runtime() {
+  static char path[MAX_PATH + 1];
+  std::string arch = Triple(sys::getProcessTriple()).getArchName().str();
+  std::string command = "clang --print-file-name=libclang_rt.profile-" + arch + ".a";
+
+  path[0] = '\0';
+  FILE *fp = popen(command.c_str(), "r");
+  if (fp) {
+    if (!fgets(path, sizeof(path), fp))
+      path[0] = '\0';
+    pclose(fp);
+  }
+
+  path[strcspn(path, "\n")] = '\0';
+  if (!path[0])
+    fprintf(stderr, "cannot find the profile runtime, set it with CA_PROFILE_RUNTIME\n");
+
+  return path;
+}
+
 static const char *make_native_linker_command(const char *input, const char *output) {
   static char command[1024];
 
@@ -5292,14 +8024,75 @@ static const char *make_native_linker_command(const char *input, const char *out
   if (!cruntime)
     cruntime = "cruntime";
 
-  sprintf(command, "ld -dynamic-linker /lib64/ld-linux-x86-64.so.2 %s/*.o %s -o %s -lc -lgc", cruntime, input, output);
+  // the ca runtime library (libcaruntime.a) is copied into the same directory when building
+  char caruntime[MAX_PATH + 1];
+  snprintf(caruntime, sizeof(caruntime), "%s/libcaruntime.a", cruntime);
+  if (access(caruntime, R_OK))
+    caruntime[0] = '\0';
+
+  // the instrumented program writes the profile by the profile runtime of LLVM (compiler-rt)
+  char profilert[MAX_PATH + 32] = "";
+  if (genv.profile_generate) {
+    const char *rtpath = std::getenv("CA_PROFILE_RUNTIME");
+    if (!rtpath)
+      rtpath = find_profile_runtime();
+
+    snprintf(profilert, sizeof(profilert), "-u__llvm_profile_runtime %s", rtpath);
+  }
+
+  // the thread functions of the runtime use pthread
+  sprintf(command, "ld -dynamic-linker /lib64/ld-linux-x86-64.so.2 %s/*.o %s %s %s -o %s -lc -lgc -lpthread",
+	  cruntime, input, caruntime, profilert, output);
 
   return command;
 }
 
-static int llvm_codegen_end() {
+static int llvm_codegen_output() {
   int ret = 0;
+  std::string verify_message;
+  llvm::raw_string_ostream rso(verify_message);
+  bool verify_debug = true;
+  if (verifyModule(ir1.module(), &rso, &verify_debug) ) {
+    fprintf(stderr, "\nmodule verify failed: %s\n",
+	    verify_message.c_str());
+  }
+
+  switch (genv.llvm_gen_type) {
+  case LGT_LL:
+    ret = llvm_codegen_ll(genv.outfile);
+    break;
+  case LGT_BC:
+    ret = llvm_codegen_bc(genv.outfile);
+    break;
+  case LGT_S:
+    ret = llvm_codegen_native(CGFT_AssemblyFile, genv.outfile);
+    break;
+  case LGT_C:
+    ret = llvm_codegen_native(CGFT_ObjectFile, genv.outfile);
+    break;
+  case LGT_JIT:
+    ret = llvm_codegen_jit(genv.outfile);
+    break;
+  case LGT_NATIVE:
+    {
+    char objname[MAX_PATH + 1];
+    sprintf(objname, "%s.o", genv.outfile);
+    ret = llvm_codegen_native(CGFT_ObjectFile, objname);
+    if (ret == -1)
+      return ret;
+
+    system(make_native_linker_command(objname, genv.outfile));
+    }
+
+    break;
+  default:
+    break;
+  }
+
+  return ret;
+}
 
+static int llvm_codegen_end() {
   // TODO: may need not handle variables release work in global lexical scope
   auto lscope = std::move(lexical_scope_stack.back());
 
@@ -5311,6 +8104,9 @@ static int llvm_codegen_end() {
     Value *v = ir1.builder().CreateLoad((Value *)main_fn_node->fndefn.retslot, "retret");
     ir1.builder().CreateRet(v);
 
+    if (genv.bounds_check)
+      g_bounds_check_opt.run(*main_fn);
+
     /*
      * Pop off the lexical block for the main function. When enhanced and other
      * functions are defined, it will need to encapsulate the related functions into a
@@ -5341,44 +8137,7 @@ static int llvm_codegen_end() {
   if (enable_debug_info())
     diinfo->dibuilder->finalize();
 
-  std::string verify_message;
-  llvm::raw_string_ostream rso(verify_message);
-  bool verify_debug = true;
-  if (verifyModule(ir1.module(), &rso, &verify_debug) ) {
-    fprintf(stderr, "\nmodule verify failed: %s\n",
-	    verify_message.c_str());
-  }
-
-  switch (genv.llvm_gen_type) {
-  case LGT_LL:
-    ret = llvm_codegen_ll(genv.outfile);
-    break;
-  case LGT_S:
-    ret = llvm_codegen_native(CGFT_AssemblyFile, genv.outfile);
-    break;
-  case LGT_C:
-    ret = llvm_codegen_native(CGFT_ObjectFile, genv.outfile);
-    break;
-  case LGT_JIT:
-    ret = llvm_codegen_jit(genv.outfile);
-    break;
-  case LGT_NATIVE:
-    {
-    char objname[MAX_PATH + 1];
-    sprintf(objname, "%s.o", genv.outfile);
-    ret = llvm_codegen_native(CGFT_ObjectFile, objname);
-    if (ret == -1)
-      return ret;
-
-    system(make_native_linker_command(objname, genv.outfile));
-    }
-
-    break;
-  default:
-    break;
-  }
-
-  return ret;
+  return llvm_codegen_output();
 }
 
 static void init_runtime_symbols() {
@@ -5387,6 +8146,80 @@ static void init_runtime_symbols() {
   name_addresses.push_back(std::make_pair("rt_add", (void *)&rt_add));
   name_addresses.push_back(std::make_pair("rt_sub", (void *)&rt_sub));
 #endif
+
+  // growable vector
+  name_addresses.push_back(std::make_pair("ca_rt_vec_init", (void *)&ca_rt_vec_init));
+  name_addresses.push_back(std::make_pair("ca_rt_vec_free", (void *)&ca_rt_vec_free));
+  name_addresses.push_back(std::make_pair("ca_rt_vec_reserve", (void *)&ca_rt_vec_reserve));
+  name_addresses.push_back(std::make_pair("ca_rt_vec_clear", (void *)&ca_rt_vec_clear));
+  name_addresses.push_back(std::make_pair("ca_rt_vec_push", (void *)&ca_rt_vec_push));
+  name_addresses.push_back(std::make_pair("ca_rt_vec_pop", (void *)&ca_rt_vec_pop));
+  name_addresses.push_back(std::make_pair("ca_rt_vec_at", (void *)&ca_rt_vec_at));
+  name_addresses.push_back(std::make_pair("ca_rt_vec_len", (void *)&ca_rt_vec_len));
+  name_addresses.push_back(std::make_pair("ca_rt_vec_push_i64", (void *)&ca_rt_vec_push_i64));
+  name_addresses.push_back(std::make_pair("ca_rt_vec_get_i64", (void *)&ca_rt_vec_get_i64));
+  name_addresses.push_back(std::make_pair("ca_rt_vec_set_i64", (void *)&ca_rt_vec_set_i64));
+
+  // hash map
+  name_addresses.push_back(std::make_pair("ca_rt_map_init", (void *)&ca_rt_map_init));
+  name_addresses.push_back(std::make_pair("ca_rt_map_free", (void *)&ca_rt_map_free));
+  name_addresses.push_back(std::make_pair("ca_rt_map_clear", (void *)&ca_rt_map_clear));
+  name_addresses.push_back(std::make_pair("ca_rt_map_insert", (void *)&ca_rt_map_insert));
+  name_addresses.push_back(std::make_pair("ca_rt_map_get", (void *)&ca_rt_map_get));
+  name_addresses.push_back(std::make_pair("ca_rt_map_get_or", (void *)&ca_rt_map_get_or));
+  name_addresses.push_back(std::make_pair("ca_rt_map_contains", (void *)&ca_rt_map_contains));
+  name_addresses.push_back(std::make_pair("ca_rt_map_remove", (void *)&ca_rt_map_remove));
+  name_addresses.push_back(std::make_pair("ca_rt_map_len", (void *)&ca_rt_map_len));
+
+  // string builder
+  name_addresses.push_back(std::make_pair("ca_rt_strbuf_init", (void *)&ca_rt_strbuf_init));
+  name_addresses.push_back(std::make_pair("ca_rt_strbuf_free", (void *)&ca_rt_strbuf_free));
+  name_addresses.push_back(std::make_pair("ca_rt_strbuf_clear", (void *)&ca_rt_strbuf_clear));
+  name_addresses.push_back(std::make_pair("ca_rt_strbuf_push_char", (void *)&ca_rt_strbuf_push_char));
+  name_addresses.push_back(std::make_pair("ca_rt_strbuf_push_str", (void *)&ca_rt_strbuf_push_str));
+  name_addresses.push_back(std::make_pair("ca_rt_strbuf_push_bytes", (void *)&ca_rt_strbuf_push_bytes));
+  name_addresses.push_back(std::make_pair("ca_rt_strbuf_push_i64", (void *)&ca_rt_strbuf_push_i64));
+  name_addresses.push_back(std::make_pair("ca_rt_strbuf_push_u64", (void *)&ca_rt_strbuf_push_u64));
+  name_addresses.push_back(std::make_pair("ca_rt_strbuf_push_f64", (void *)&ca_rt_strbuf_push_f64));
+  name_addresses.push_back(std::make_pair("ca_rt_strbuf_cstr", (void *)&ca_rt_strbuf_cstr));
+  name_addresses.push_back(std::make_pair("ca_rt_strbuf_len", (void *)&ca_rt_strbuf_len));
+
+  // input
+  name_addresses.push_back(std::make_pair("ca_rt_file_map", (void *)&ca_rt_file_map));
+  name_addresses.push_back(std::make_pair("ca_rt_file_unmap", (void *)&ca_rt_file_unmap));
+  name_addresses.push_back(std::make_pair("ca_rt_lines_init", (void *)&ca_rt_lines_init));
+  name_addresses.push_back(std::make_pair("ca_rt_lines_next", (void *)&ca_rt_lines_next));
+  name_addresses.push_back(std::make_pair("ca_rt_reader_open", (void *)&ca_rt_reader_open));
+  name_addresses.push_back(std::make_pair("ca_rt_reader_stdin", (void *)&ca_rt_reader_stdin));
+  name_addresses.push_back(std::make_pair("ca_rt_reader_close", (void *)&ca_rt_reader_close));
+  name_addresses.push_back(std::make_pair("ca_rt_reader_next_line", (void *)&ca_rt_reader_next_line));
+  name_addresses.push_back(std::make_pair("ca_rt_parse_i64", (void *)&ca_rt_parse_i64));
+  name_addresses.push_back(std::make_pair("ca_rt_parse_u64", (void *)&ca_rt_parse_u64));
+  name_addresses.push_back(std::make_pair("ca_rt_parse_f64", (void *)&ca_rt_parse_f64));
+  name_addresses.push_back(std::make_pair("ca_rt_scan_i64", (void *)&ca_rt_scan_i64));
+  name_addresses.push_back(std::make_pair("ca_rt_scan_u64", (void *)&ca_rt_scan_u64));
+  name_addresses.push_back(std::make_pair("ca_rt_scan_f64", (void *)&ca_rt_scan_f64));
+
+  // output of print statement
+  name_addresses.push_back(std::make_pair("ca_rt_write_i64", (void *)&ca_rt_write_i64));
+  name_addresses.push_back(std::make_pair("ca_rt_write_u64", (void *)&ca_rt_write_u64));
+  name_addresses.push_back(std::make_pair("ca_rt_write_f64", (void *)&ca_rt_write_f64));
+  name_addresses.push_back(std::make_pair("ca_rt_write_char", (void *)&ca_rt_write_char));
+  name_addresses.push_back(std::make_pair("ca_rt_write_str", (void *)&ca_rt_write_str));
+  name_addresses.push_back(std::make_pair("ca_rt_write_bytes", (void *)&ca_rt_write_bytes));
+  name_addresses.push_back(std::make_pair("ca_rt_write_ptr", (void *)&ca_rt_write_ptr));
+  name_addresses.push_back(std::make_pair("ca_rt_flush", (void *)&ca_rt_flush));
+
+  // threads
+  name_addresses.push_back(std::make_pair("ca_rt_spawn", (void *)&ca_rt_spawn));
+  name_addresses.push_back(std::make_pair("ca_rt_join", (void *)&ca_rt_join));
+  name_addresses.push_back(std::make_pair("ca_rt_thread_count", (void *)&ca_rt_thread_count));
+  name_addresses.push_back(std::make_pair("ca_rt_parallel_for", (void *)&ca_rt_parallel_for));
+  name_addresses.push_back(std::make_pair("__emutls_get_address", (void *)&__emutls_get_address));
+
+  // failure of bounds and overflow checking
+  name_addresses.push_back(std::make_pair("ca_rt_bounds_fail", (void *)&ca_rt_bounds_fail));
+  name_addresses.push_back(std::make_pair("ca_rt_overflow_fail", (void *)&ca_rt_overflow_fail));
   jit1->register_imported_symbols(name_addresses);
 }
 
@@ -5394,12 +8227,25 @@ BEGIN_EXTERN_C
 void init_llvm_env() {
   ir1.init_module_and_passmanager(genv.src_path);
   jit1 = exit_on_error(jit_codegen::JIT1::create_instance());
+
+  // the layout is used when generating code, e.g. the alignment of global variables
+  ir1.set_target_layout(jit1->get_datalayout());
+  g_abi = std::make_unique<abi_lowering::ABILowering>(jit1->get_datalayout(),
+							Triple(sys::getProcessTriple()));
   if (enable_debug_info())
     diinfo = std::make_unique<dwarf_debug::DWARFDebugInfo>(ir1.builder(), ir1.module(), genv.src_path);
 
   init_runtime_symbols();
 }
 
+int llvm_codegen_ir_file() {
+  // the module is from the front end output of a previous compiling
+  if (!ir1.load_module(genv.src_path))
+    return -1;
+
+  return llvm_codegen_output();
+}
+
 int walk(RootTree *tree) {
   // the first walk pass is for iterating function prototype into LLVM object
   // the second walk pass is for iterating all tree nodes
@@ -25,6 +25,8 @@ BEGIN_EXTERN_C
 
 void init_llvm_env();
 int walk(RootTree *tree);
+int llvm_lto_link();
+int llvm_codegen_ir_file();
 
 #ifdef __cplusplus
 END_EXTERN_C
@@ -0,0 +1,284 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+#include "abi_lowering.h"
+#include "llvm/IR/Attributes.h"
+
+namespace abi_lowering {
+
+using namespace llvm;
+
+// the argument registers of System V AMD64: rdi, rsi, rdx, rcx, r8, r9 and xmm0 - xmm7
+static const int sysv_int_regs = 6;
+static const int sysv_sse_regs = 8;
+
+Type *ArgInfo::coerced_type() const {
+  if (pieces.size() == 1)
+    return pieces[0];
+
+  return StructType::get(type->getContext(), pieces);
+}
+
+FunctionType *FnInfo::lowered_type() const {
+  std::vector<Type *> lparams;
+  Type *retty = ret.type;
+  switch (ret.kind) {
+  case AK_Coerce:
+    retty = ret.coerced_type();
+    break;
+  case AK_Indirect:
+    retty = Type::getVoidTy(ret.type->getContext());
+    lparams.push_back(ret.type->getPointerTo());
+    break;
+  default:
+    break;
+  }
+
+  for (const ArgInfo &param : params) {
+    switch (param.kind) {
+    case AK_Direct:
+      lparams.push_back(param.type);
+      break;
+    case AK_Coerce:
+      lparams.insert(lparams.end(), param.pieces.begin(), param.pieces.end());
+      break;
+    case AK_Indirect:
+      lparams.push_back(param.type->getPointerTo());
+      break;
+    }
+  }
+
+  return FunctionType::get(retty, lparams, vararg);
+}
+
+ABILowering::ABILowering(const DataLayout &dl, const Triple &triple) : _dl(dl) {
+  _sysv = triple.getArch() == Triple::x86_64 && !triple.isOSWindows();
+}
+
+/*
+ * Classify each scalar of the aggregate into the eightbyte it lives in, the
+ * INTEGER class wins when an eightbyte has both integer and floating point
+ * fields. Return false when the aggregate must be in MEMORY.
+ */
+bool ABILowering::classify_eightbytes(Type *type, uint64_t offset, Class classes[2],
+				      Type *scalars[2], int counts[2]) const {
+  if (StructType *sttype = dyn_cast<StructType>(type)) {
+    const StructLayout *layout = _dl.getStructLayout(sttype);
+    for (unsigned i = 0; i < sttype->getNumElements(); ++i) {
+      Type *elemtype = sttype->getElementType(i);
+      uint64_t elemoffset = offset + layout->getElementOffset(i);
+
+      // the unaligned field of the packed struct
+      if (elemoffset % _dl.getABITypeAlign(elemtype).value())
+	return false;
+
+      if (!classify_eightbytes(elemtype, elemoffset, classes, scalars, counts))
+	return false;
+    }
+
+    return true;
+  }
+
+  if (ArrayType *arrtype = dyn_cast<ArrayType>(type)) {
+    Type *elemtype = arrtype->getElementType();
+    uint64_t elemsize = _dl.getTypeAllocSize(elemtype);
+    for (uint64_t i = 0; i < arrtype->getNumElements(); ++i) {
+      if (!classify_eightbytes(elemtype, offset + i * elemsize, classes, scalars, counts))
+	return false;
+    }
+
+    return true;
+  }
+
+  Class cls;
+  if (type->isIntegerTy() || type->isPointerTy())
+    cls = C_Integer;
+  else if (type->isFloatTy() || type->isDoubleTy())
+    cls = C_SSE;
+  else
+    return false;
+
+  unsigned index = offset / 8;
+  if (index > 1 || offset % 8 + _dl.getTypeStoreSize(type) > 8)
+    return false;
+
+  if (classes[index] == C_Integer || cls == C_Integer)
+    classes[index] = C_Integer;
+  else
+    classes[index] = C_SSE;
+
+  scalars[index] = offset % 8 == 0 ? type : nullptr;
+  ++counts[index];
+  return true;
+}
+
+ArgInfo ABILowering::classify_type(Type *type, bool isret, int &intregs, int &sseregs) const {
+  ArgInfo info;
+  info.type = type;
+  if (!_sysv || type->isVoidTy())
+    return info;
+
+  if (!type->isStructTy() && !type->isArrayTy()) {
+    if (!isret) {
+      if (type->isFloatingPointTy())
+	--sseregs;
+      else
+	--intregs;
+    }
+
+    return info;
+  }
+
+  uint64_t size = _dl.getTypeAllocSize(type);
+  if (size == 0)
+    return info;
+
+  Class classes[2] = {C_None, C_None};
+  Type *scalars[2] = {nullptr, nullptr};
+  int counts[2] = {0, 0};
+  if (size > 16 || !classify_eightbytes(type, 0, classes, scalars, counts)) {
+    info.kind = AK_Indirect;
+    return info;
+  }
+
+  unsigned n = (size + 7) / 8;
+  int needint = 0, needsse = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    if (classes[i] == C_SSE)
+      ++needsse;
+    else
+      ++needint;
+  }
+
+  if (!isret) {
+    // the whole aggregate goes to the stack when the registers are not enough
+    if (needint > intregs || needsse > sseregs) {
+      info.kind = AK_Indirect;
+      return info;
+    }
+
+    intregs -= needint;
+    sseregs -= needsse;
+  }
+
+  LLVMContext &ctx = type->getContext();
+  info.kind = AK_Coerce;
+  for (unsigned i = 0; i < n; ++i) {
+    uint64_t bytes = std::min<uint64_t>(8, size - i * 8);
+    Type *scalar = counts[i] == 1 ? scalars[i] : nullptr;
+    Type *piece;
+    if (classes[i] == C_SSE) {
+      if (scalar)
+	piece = scalar;
+      else if (bytes <= 4)
+	piece = Type::getFloatTy(ctx);
+      else
+	piece = FixedVectorType::get(Type::getFloatTy(ctx), 2);
+    } else if (scalar && scalar->isPointerTy() && bytes == 8) {
+      piece = scalar;
+    } else {
+      piece = Type::getIntNTy(ctx, bytes * 8);
+    }
+
+    info.pieces.push_back(piece);
+  }
+
+  return info;
+}
+
+FnInfo ABILowering::classify(Type *rettype, const std::vector<Type *> &params, bool vararg) const {
+  FnInfo info;
+  int intregs = sysv_int_regs;
+  int sseregs = sysv_sse_regs;
+
+  info.vararg = vararg;
+  info.ret = classify_type(rettype, true, intregs, sseregs);
+
+  // the `sret` pointer takes the first integer register
+  if (info.ret.kind == AK_Indirect)
+    --intregs;
+
+  for (Type *type : params)
+    info.params.push_back(classify_type(type, false, intregs, sseregs));
+
+  return info;
+}
+
+template <typename T>
+static void set_attributes_common(T *obj, const FnInfo &info, const DataLayout &dl) {
+  LLVMContext &ctx = info.ret.type->getContext();
+  unsigned argno = 0;
+
+  if (info.ret.kind == AK_Indirect) {
+    obj->addParamAttr(0, Attribute::getWithStructRetType(ctx, info.ret.type));
+    obj->addParamAttr(0, Attribute::NoAlias);
+    obj->addParamAttr(0, Attribute::getWithAlignment(ctx, dl.getABITypeAlign(info.ret.type)));
+    argno = 1;
+  }
+
+  for (const ArgInfo &param : info.params) {
+    switch (param.kind) {
+    case AK_Direct:
+      ++argno;
+      break;
+    case AK_Coerce:
+      argno += param.pieces.size();
+      break;
+    case AK_Indirect: {
+      // the stack slot of the argument is at least eightbyte aligned
+      Align align = std::max(Align(8), dl.getABITypeAlign(param.type));
+      obj->addParamAttr(argno, Attribute::getWithByValType(ctx, param.type));
+      obj->addParamAttr(argno, Attribute::getWithAlignment(ctx, align));
+      ++argno;
+      break;
+    }
+    }
+  }
+}
+
+void ABILowering::set_attributes(Function *fn, const FnInfo &info) const {
+  set_attributes_common(fn, info, _dl);
+}
+
+void ABILowering::set_attributes(CallInst *call, const FnInfo &info) const {
+  set_attributes_common(call, info, _dl);
+}
+
+Value *ABILowering::piece_address(IRBuilder<> &builder, Value *addr, const ArgInfo &info, unsigned index) const {
+  Type *piece = info.pieces[index];
+  Value *p = builder.CreatePointerCast(addr, builder.getInt8PtrTy());
+  if (index)
+    p = builder.CreateConstInBoundsGEP1_64(builder.getInt8Ty(), p, index * 8);
+
+  return builder.CreatePointerCast(p, piece->getPointerTo(), "coerce");
+}
+
+void ABILowering::load_pieces(IRBuilder<> &builder, Value *addr, const ArgInfo &info,
+			      std::vector<Value *> &pieces) const {
+  Align align = _dl.getABITypeAlign(info.type);
+  for (unsigned i = 0; i < info.pieces.size(); ++i) {
+    Value *p = piece_address(builder, addr, info, i);
+    pieces.push_back(builder.CreateAlignedLoad(info.pieces[i], p, commonAlignment(align, i * 8), "piece"));
+  }
+}
+
+void ABILowering::store_pieces(IRBuilder<> &builder, Value *addr, const ArgInfo &info,
+			       const std::vector<Value *> &pieces) const {
+  Align align = _dl.getABITypeAlign(info.type);
+  for (unsigned i = 0; i < info.pieces.size(); ++i) {
+    Value *p = piece_address(builder, addr, info, i);
+    builder.CreateAlignedStore(pieces[i], p, commonAlignment(align, i * 8));
+  }
+}
+
+}
+
@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+/**
+ * @file the lowering of the function parameters and return value to the C ABI.
+ *
+ * LLVM passes a first-class aggregate argument field by field, which is
+ * neither the C ABI nor cheap when the aggregate is large. The functions are
+ * lowered by the System V AMD64 classification:
+ *
+ * - the aggregate larger than 16 bytes (or has unaligned field) is in MEMORY,
+ *   the argument is passed by a `byval` pointer and the return value is
+ *   written into a `sret` pointer passed as the first argument;
+ * - the smaller aggregate is split into eightbytes, each one is passed in an
+ *   integer register (INTEGER) or a vector register (SSE), the argument falls
+ *   back to `byval` when the registers are not enough;
+ * - the scalar types are passed directly.
+ *
+ * On other targets all types are passed directly as before.
+ */
+
+#ifndef __codegen_abi_lowering_h__
+#define __codegen_abi_lowering_h__
+
+#include "llvm/ADT/Triple.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include <vector>
+
+namespace abi_lowering {
+
+enum ArgKind {
+  AK_Direct,   /// pass or return the llvm value of the type directly
+  AK_Coerce,   /// pass or return the eightbytes as `pieces` in registers
+  AK_Indirect, /// pass by a `byval` pointer, or return by a `sret` pointer
+};
+
+struct ArgInfo {
+  ArgKind kind = AK_Direct;
+  llvm::Type *type = nullptr;        /// the llvm type of the CA type
+  std::vector<llvm::Type *> pieces;  /// the register type of each eightbyte when AK_Coerce
+
+  /// the type of the value in registers, a struct of the pieces when there are 2
+  llvm::Type *coerced_type() const;
+};
+
+struct FnInfo {
+  ArgInfo ret;
+  std::vector<ArgInfo> params;
+  bool vararg = false;
+
+  /// the number of llvm arguments before the first parameter, 1 for the `sret` pointer
+  unsigned prefix() const { return ret.kind == AK_Indirect ? 1 : 0; }
+
+  /// the llvm function type after lowering
+  llvm::FunctionType *lowered_type() const;
+};
+
+class ABILowering {
+public:
+  ABILowering(const llvm::DataLayout &dl, const llvm::Triple &triple);
+
+  /// classify the return type and the parameter types of a function
+  FnInfo classify(llvm::Type *rettype, const std::vector<llvm::Type *> &params, bool vararg) const;
+
+  /// set `sret`, `byval` and the alignment attributes for the lowered function or call
+  void set_attributes(llvm::Function *fn, const FnInfo &info) const;
+  void set_attributes(llvm::CallInst *call, const FnInfo &info) const;
+
+  /// load the pieces of the AK_Coerce value from memory `addr` of type `info.type`
+  void load_pieces(llvm::IRBuilder<> &builder, llvm::Value *addr, const ArgInfo &info,
+		   std::vector<llvm::Value *> &pieces) const;
+
+  /// store the pieces of the AK_Coerce value into memory `addr` of type `info.type`
+  void store_pieces(llvm::IRBuilder<> &builder, llvm::Value *addr, const ArgInfo &info,
+		    const std::vector<llvm::Value *> &pieces) const;
+
+private:
+  enum Class { C_None, C_Integer, C_SSE };
+
+  ArgInfo classify_type(llvm::Type *type, bool isret, int &intregs, int &sseregs) const;
+  bool classify_eightbytes(llvm::Type *type, uint64_t offset, Class classes[2],
+			   llvm::Type *scalars[2], int counts[2]) const;
+  llvm::Value *piece_address(llvm::IRBuilder<> &builder, llvm::Value *addr,
+			     const ArgInfo &info, unsigned index) const;
+
+  const llvm::DataLayout _dl;
+  bool _sysv;
+};
+
+}
+
+#endif
+
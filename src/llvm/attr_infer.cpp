@@ -0,0 +1,346 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+#include "attr_infer.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Attributes.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include <vector>
+
+namespace attr_infer {
+
+using namespace llvm;
+
+// the depth of the value to look through when finding the heap allocation
+static const int max_depth = 8;
+
+/*
+ * A slot is simple when it is only loaded and stored directly and its address
+ * is not taken, the generated code keeps the variables in such slots, so the
+ * value stored into a simple slot is followed through the loads of the slot.
+ */
+static bool is_simple_slot(Value *v) {
+  AllocaInst *slot = dyn_cast<AllocaInst>(v);
+  if (!slot)
+    return false;
+
+  for (User *user : slot->users()) {
+    if (isa<LoadInst>(user))
+      continue;
+
+    StoreInst *store = dyn_cast<StoreInst>(user);
+    if (!store || store->getValueOperand() == slot)
+      return false;
+  }
+
+  return true;
+}
+
+/// the memory is local when it is the stack slot or the `byval` copy of the function
+static bool is_local_memory(Value *ptr) {
+  Value *obj = getUnderlyingObject(ptr);
+  if (isa<AllocaInst>(obj))
+    return true;
+
+  Argument *arg = dyn_cast<Argument>(obj);
+  return arg && arg->hasByValAttr();
+}
+
+void AttrInfer::annotate_library(Module &module) {
+  for (Function &fn : module) {
+    if (!fn.isIntrinsic())
+      fn.setDoesNotThrow();
+  }
+
+  if (Function *fn = module.getFunction("GC_malloc"))
+    fn->setReturnDoesNotAlias();
+
+  // the functions only read the string parameter
+  const char *string_readers[] = {"printf", "ca_rt_write_str", "ca_rt_write_bytes"};
+  for (const char *name : string_readers) {
+    Function *fn = module.getFunction(name);
+    if (fn && fn->arg_size() > 0 && fn->getArg(0)->getType()->isPointerTy()) {
+      fn->addParamAttr(0, Attribute::NoCapture);
+      fn->addParamAttr(0, Attribute::ReadOnly);
+    }
+  }
+}
+
+int AttrInfer::function_effects(Function &fn) {
+  int effects = E_None;
+  for (Instruction &inst : instructions(fn)) {
+    if (LoadInst *load = dyn_cast<LoadInst>(&inst)) {
+      if (!is_local_memory(load->getPointerOperand()))
+	effects |= !load->isUnordered() ? E_ReadWrite : E_Read;
+    } else if (StoreInst *store = dyn_cast<StoreInst>(&inst)) {
+      if (!is_local_memory(store->getPointerOperand()))
+	effects |= E_Write;
+    } else if (isa<DbgInfoIntrinsic>(&inst) || inst.isLifetimeStartOrEnd()) {
+      continue;
+    } else if (MemIntrinsic *mem = dyn_cast<MemIntrinsic>(&inst)) {
+      if (!is_local_memory(mem->getRawDest()))
+	effects |= E_Write;
+
+      MemTransferInst *transfer = dyn_cast<MemTransferInst>(mem);
+      if (transfer && !is_local_memory(transfer->getRawSource()))
+	effects |= E_Read;
+    } else if (CallBase *call = dyn_cast<CallBase>(&inst)) {
+      Function *callee = call->getCalledFunction();
+      if (!callee)
+	effects |= E_ReadWrite;
+      else if (callee->doesNotAccessMemory())
+	continue;
+      else if (callee->onlyReadsMemory())
+	effects |= E_Read;
+      else
+	effects |= E_ReadWrite;
+    } else {
+      if (inst.mayReadFromMemory())
+	effects |= E_Read;
+      if (inst.mayWriteToMemory())
+	effects |= E_Write;
+    }
+
+    if (effects == E_ReadWrite)
+      break;
+  }
+
+  return effects;
+}
+
+/// the effects of the function on the memory pointed by `ptr`
+int AttrInfer::pointer_effects(Value *ptr, std::unordered_set<Value *> &visited) {
+  if (!visited.insert(ptr).second)
+    return E_None;
+
+  int effects = E_None;
+  for (Use &use : ptr->uses()) {
+    User *user = use.getUser();
+    if (isa<BitCastInst>(user) || isa<GetElementPtrInst>(user) ||
+	isa<PHINode>(user) || isa<SelectInst>(user)) {
+      effects |= pointer_effects(user, visited);
+    } else if (LoadInst *load = dyn_cast<LoadInst>(user)) {
+      effects |= !load->isUnordered() ? E_ReadWrite : E_Read;
+    } else if (StoreInst *store = dyn_cast<StoreInst>(user)) {
+      if (store->getPointerOperand() == ptr && store->getValueOperand() != ptr) {
+	effects |= E_Write;
+      } else if (is_simple_slot(store->getPointerOperand())) {
+	// the pointer is kept in a variable, follow the loads of it
+	for (User *slotuser : store->getPointerOperand()->users()) {
+	  if (isa<LoadInst>(slotuser))
+	    effects |= pointer_effects(slotuser, visited);
+	}
+      } else {
+	effects |= E_ReadWrite;
+      }
+    } else if (isa<MemIntrinsic>(user)) {
+      effects |= use.getOperandNo() == 0 ? E_Write : E_Read;
+    } else if (CallBase *call = dyn_cast<CallBase>(user)) {
+      Function *callee = call->getCalledFunction();
+      if (!callee || !call->isArgOperand(&use) || call->getArgOperandNo(&use) >= callee->arg_size()) {
+	effects |= E_ReadWrite;
+	continue;
+      }
+
+      unsigned argno = call->getArgOperandNo(&use);
+      bool nocapture = callee->hasParamAttribute(argno, Attribute::NoCapture);
+      if (callee->hasParamAttribute(argno, Attribute::ReadNone) ||
+	  (nocapture && callee->doesNotAccessMemory()))
+	continue;
+      else if (callee->hasParamAttribute(argno, Attribute::ReadOnly) ||
+	       (nocapture && callee->onlyReadsMemory()))
+	effects |= E_Read;
+      else
+	effects |= E_ReadWrite;
+    } else if (isa<ICmpInst>(user)) {
+      continue;
+    } else {
+      effects |= E_ReadWrite;
+    }
+
+    if (effects == E_ReadWrite)
+      break;
+  }
+
+  return effects;
+}
+
+/// if a copy of `ptr` may outlive the call, returning it is a capture when `retcaptures` is true
+bool AttrInfer::is_captured(Value *ptr, std::unordered_set<Value *> &visited, bool retcaptures) {
+  if (!visited.insert(ptr).second)
+    return false;
+
+  for (Use &use : ptr->uses()) {
+    User *user = use.getUser();
+    if (isa<BitCastInst>(user) || isa<GetElementPtrInst>(user) ||
+	isa<PHINode>(user) || isa<SelectInst>(user)) {
+      if (is_captured(user, visited, retcaptures))
+	return true;
+    } else if (isa<LoadInst>(user) || isa<ICmpInst>(user) || isa<MemIntrinsic>(user)) {
+      continue;
+    } else if (isa<ReturnInst>(user)) {
+      if (retcaptures)
+	return true;
+    } else if (StoreInst *store = dyn_cast<StoreInst>(user)) {
+      if (store->getPointerOperand() == ptr && store->getValueOperand() != ptr)
+	continue;
+
+      if (!is_simple_slot(store->getPointerOperand()))
+	return true;
+
+      for (User *slotuser : store->getPointerOperand()->users()) {
+	if (isa<LoadInst>(slotuser) && is_captured(slotuser, visited, retcaptures))
+	  return true;
+      }
+    } else if (CallBase *call = dyn_cast<CallBase>(user)) {
+      Function *callee = call->getCalledFunction();
+      if (!callee || !call->isArgOperand(&use) || call->getArgOperandNo(&use) >= callee->arg_size() ||
+	  !callee->hasParamAttribute(call->getArgOperandNo(&use), Attribute::NoCapture))
+	return true;
+    } else {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/// the value is null or a heap allocation made in the function, collect the allocations into `_allocations`
+bool AttrInfer::is_fresh_allocation(Value *v, int depth) {
+  if (depth > max_depth)
+    return false;
+
+  if (isa<ConstantPointerNull>(v) || isa<UndefValue>(v))
+    return true;
+
+  if (BitCastInst *cast = dyn_cast<BitCastInst>(v))
+    return is_fresh_allocation(cast->getOperand(0), depth + 1);
+
+  if (CallBase *call = dyn_cast<CallBase>(v)) {
+    Function *callee = call->getCalledFunction();
+    if (!callee || !callee->returnDoesNotAlias())
+      return false;
+
+    _allocations.push_back(call);
+    return true;
+  }
+
+  if (PHINode *phi = dyn_cast<PHINode>(v)) {
+    for (Value *incoming : phi->incoming_values()) {
+      if (!is_fresh_allocation(incoming, depth + 1))
+	return false;
+    }
+
+    return true;
+  }
+
+  if (SelectInst *select = dyn_cast<SelectInst>(v))
+    return is_fresh_allocation(select->getTrueValue(), depth + 1) &&
+      is_fresh_allocation(select->getFalseValue(), depth + 1);
+
+  LoadInst *load = dyn_cast<LoadInst>(v);
+  if (!load || !is_simple_slot(load->getPointerOperand()))
+    return false;
+
+  for (User *user : load->getPointerOperand()->users()) {
+    StoreInst *store = dyn_cast<StoreInst>(user);
+    if (store && !is_fresh_allocation(store->getValueOperand(), depth + 1))
+      return false;
+  }
+
+  return true;
+}
+
+bool AttrInfer::returns_fresh_allocation(Function &fn) {
+  _allocations.clear();
+  for (BasicBlock &bb : fn) {
+    ReturnInst *ret = dyn_cast<ReturnInst>(bb.getTerminator());
+    if (ret && !is_fresh_allocation(ret->getReturnValue(), 0))
+      return false;
+  }
+
+  // the allocation is only reachable through the returned value
+  for (Value *allocation : _allocations) {
+    std::unordered_set<Value *> visited;
+    if (is_captured(allocation, visited, false))
+      return false;
+  }
+
+  return true;
+}
+
+bool AttrInfer::infer_function(Function &fn) {
+  if (fn.isDeclaration())
+    return false;
+
+  AttributeList before = fn.getAttributes();
+
+  int effects = function_effects(fn);
+  if (effects == E_None && !fn.doesNotAccessMemory()) {
+    fn.removeFnAttr(Attribute::ReadOnly);
+    fn.setDoesNotAccessMemory();
+  } else if (effects == E_Read && !fn.onlyReadsMemory()) {
+    fn.setOnlyReadsMemory();
+  }
+
+  for (Argument &arg : fn.args()) {
+    if (!arg.getType()->isPointerTy() || arg.hasByValAttr() || arg.hasStructRetAttr())
+      continue;
+
+    unsigned argno = arg.getArgNo();
+    std::unordered_set<Value *> visited;
+    if (!arg.hasNoCaptureAttr() && !is_captured(&arg, visited, true))
+      fn.addParamAttr(argno, Attribute::NoCapture);
+
+    visited.clear();
+    int argeffects = pointer_effects(&arg, visited);
+    if (argeffects == E_None && !fn.hasParamAttribute(argno, Attribute::ReadNone)) {
+      fn.removeParamAttr(argno, Attribute::ReadOnly);
+      fn.addParamAttr(argno, Attribute::ReadNone);
+    } else if (argeffects == E_Read && !fn.hasParamAttribute(argno, Attribute::ReadNone)) {
+      fn.addParamAttr(argno, Attribute::ReadOnly);
+    }
+  }
+
+  if (fn.getReturnType()->isPointerTy() && !fn.returnDoesNotAlias() && returns_fresh_allocation(fn))
+    fn.setReturnDoesNotAlias();
+
+  return fn.getAttributes() != before;
+}
+
+int AttrInfer::run(Module &module) {
+  annotate_library(module);
+
+  // the attributes only become stronger in each round, so it stops in limited rounds
+  int total = 0;
+  size_t rounds = module.size() + 1;
+  for (size_t i = 0; i < rounds; ++i) {
+    int changed = 0;
+    for (Function &fn : module) {
+      if (infer_function(fn))
+	++changed;
+    }
+
+    if (!changed)
+      break;
+
+    total += changed;
+  }
+
+  return total;
+}
+
+}
+
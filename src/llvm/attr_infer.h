@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+/**
+ * @file the function attributes inference, it runs before the optimization
+ * passes (`-O1` and above) to help the alias analysis of LLVM.
+ *
+ * - every function is `nounwind`, CA has no exception and the C functions it
+ *   calls never unwind through CA code;
+ * - the known library functions (`GC_malloc`, `printf` ...) are annotated;
+ * - the function only reads (or never accesses) the memory visible to its
+ *   caller is `readonly` (or `readnone`), the writes to its own stack slots
+ *   are not visible to the caller;
+ * - the pointer parameter is `nocapture` when no copy of it outlives the call,
+ *   and `readonly` when it is never written through;
+ * - the function returning the pointer of a fresh heap allocation, which is
+ *   not kept anywhere else, returns `noalias`.
+ *
+ * The attributes of the callees are used by the callers, so the inference
+ * iterates over the module until nothing changes.
+ */
+
+#ifndef __codegen_attr_infer_h__
+#define __codegen_attr_infer_h__
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include <unordered_set>
+#include <vector>
+
+namespace attr_infer {
+
+class AttrInfer {
+public:
+  /// annotate the functions of the module, return the number of changed functions
+  int run(llvm::Module &module);
+
+private:
+  enum Effect {
+    E_None = 0,
+    E_Read = 1,
+    E_Write = 2,
+    E_ReadWrite = E_Read | E_Write,
+  };
+
+  void annotate_library(llvm::Module &module);
+  bool infer_function(llvm::Function &fn);
+  int function_effects(llvm::Function &fn);
+  int pointer_effects(llvm::Value *ptr, std::unordered_set<llvm::Value *> &visited);
+  bool is_captured(llvm::Value *ptr, std::unordered_set<llvm::Value *> &visited, bool retcaptures);
+  bool is_fresh_allocation(llvm::Value *v, int depth);
+  bool returns_fresh_allocation(llvm::Function &fn);
+
+  /// the heap allocations found by is_fresh_allocation
+  std::vector<llvm::Value *> _allocations;
+};
+
+}
+
+#endif
+
@@ -0,0 +1,305 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+#include "bounds_check.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include <unordered_map>
+
+namespace bounds_check {
+
+using namespace llvm;
+
+// the depth of the expression to look through, the index expression is small
+static const int max_depth = 8;
+
+/*
+ * A slot is simple when its address is not taken, it is only loaded and stored
+ * directly, so nothing other than the visible stores can change its value.
+ * Return the number of the stores, or -1 when the slot is not simple.
+ */
+static int simple_slot_stores(AllocaInst *slot, Loop *loop = nullptr) {
+  int stores = 0;
+  for (User *user : slot->users()) {
+    if (isa<LoadInst>(user)) {
+      if (cast<LoadInst>(user)->isVolatile())
+	return -1;
+      continue;
+    }
+
+    StoreInst *store = dyn_cast<StoreInst>(user);
+    if (!store || store->getValueOperand() == slot || store->isVolatile())
+      return -1;
+
+    // only count the stores inside the loop when loop is specified
+    if (!loop || loop->contains(store))
+      ++stores;
+  }
+
+  return stores;
+}
+
+void BoundsCheckOpt::add_var_range(AllocaInst *slot, int64_t lo, int64_t hi) {
+  if (lo < hi)
+    _var_ranges[slot] = std::make_pair(lo, hi);
+}
+
+/*
+ * Get the value range [lo, hi) of an index expression, it looks through the
+ * constant, the integer extending, the addition or subtraction of constant,
+ * and the load of the variable registered by `add_var_range`.
+ */
+bool BoundsCheckOpt::value_range(Value *v, int64_t &lo, int64_t &hi, int depth) {
+  if (depth > max_depth)
+    return false;
+
+  if (ConstantInt *ci = dyn_cast<ConstantInt>(v)) {
+    if (ci->getBitWidth() > 64)
+      return false;
+
+    lo = ci->getSExtValue();
+    if (__builtin_add_overflow(lo, 1, &hi))
+      return false;
+
+    return true;
+  }
+
+  if (isa<SExtInst>(v) || isa<ZExtInst>(v)) {
+    Instruction *inst = cast<Instruction>(v);
+    if (!value_range(inst->getOperand(0), lo, hi, depth + 1))
+      return false;
+
+    // the negative value become a large value after zero extending
+    return isa<SExtInst>(v) || lo >= 0;
+  }
+
+  if (BinaryOperator *bo = dyn_cast<BinaryOperator>(v)) {
+    int64_t lo1, hi1, lo2, hi2;
+    unsigned opcode = bo->getOpcode();
+    if (opcode != Instruction::Add && opcode != Instruction::Sub)
+      return false;
+
+    if (!value_range(bo->getOperand(0), lo1, hi1, depth + 1) ||
+	!value_range(bo->getOperand(1), lo2, hi2, depth + 1))
+      return false;
+
+    // [lo1, hi1) + [lo2, hi2) = [lo1 + lo2, hi1 + hi2 - 1)
+    // [lo1, hi1) - [lo2, hi2) = [lo1 - hi2 + 1, hi1 - lo2)
+    if (opcode == Instruction::Add)
+      return !__builtin_add_overflow(lo1, lo2, &lo) &&
+	!__builtin_add_overflow(hi1 - 1, hi2, &hi);
+    else
+      return !__builtin_sub_overflow(lo1, hi2 - 1, &lo) &&
+	!__builtin_sub_overflow(hi1, lo2, &hi);
+  }
+
+  if (LoadInst *load = dyn_cast<LoadInst>(v)) {
+    AllocaInst *slot = dyn_cast<AllocaInst>(load->getPointerOperand());
+    if (!slot)
+      return false;
+
+    auto itr = _var_ranges.find(slot);
+    if (itr == _var_ranges.end())
+      return false;
+
+    // the variable is changed somewhere other than the `for` statement itself
+    if (simple_slot_stores(slot) != 1)
+      return false;
+
+    lo = itr->second.first;
+    hi = itr->second.second;
+    return true;
+  }
+
+  return false;
+}
+
+bool BoundsCheckOpt::is_proved(ICmpInst *cmp) {
+  ICmpInst::Predicate pred = cmp->getPredicate();
+  if (pred != ICmpInst::ICMP_ULT && pred != ICmpInst::ICMP_ULE)
+    return false;
+
+  int64_t lo1, hi1, lo2, hi2;
+  if (!value_range(cmp->getOperand(0), lo1, hi1, 0) ||
+      !value_range(cmp->getOperand(1), lo2, hi2, 0))
+    return false;
+
+  // the max of index must be less than (or equal to) the min of the bound
+  if (lo1 < 0)
+    return false;
+
+  if (pred == ICmpInst::ICMP_ULT)
+    return hi1 - 1 < lo2;
+  else
+    return hi1 - 1 <= lo2;
+}
+
+bool BoundsCheckOpt::is_loop_invariant(Value *v, Loop *loop, int depth) {
+  if (depth > max_depth)
+    return false;
+
+  if (isa<Constant>(v) || isa<Argument>(v))
+    return true;
+
+  Instruction *inst = dyn_cast<Instruction>(v);
+  if (!inst)
+    return false;
+
+  if (!loop->contains(inst))
+    return true;
+
+  if (LoadInst *load = dyn_cast<LoadInst>(inst)) {
+    AllocaInst *slot = dyn_cast<AllocaInst>(load->getPointerOperand());
+    return slot && !loop->contains(slot) && simple_slot_stores(slot, loop) == 0;
+  }
+
+  // the division is not speculated, it may trap when the loop is not executed
+  if (BinaryOperator *bo = dyn_cast<BinaryOperator>(inst)) {
+    switch (bo->getOpcode()) {
+    case Instruction::UDiv:
+    case Instruction::SDiv:
+    case Instruction::URem:
+    case Instruction::SRem:
+      return false;
+    default:
+      break;
+    }
+  } else if (!isa<CastInst>(inst) && !isa<ICmpInst>(inst)) {
+    return false;
+  }
+
+  for (Value *op : inst->operands()) {
+    if (!is_loop_invariant(op, loop, depth + 1))
+      return false;
+  }
+
+  return true;
+}
+
+static Value *clone_into_preheader(Value *v, Loop *loop, Instruction *insertpt) {
+  Instruction *inst = dyn_cast<Instruction>(v);
+  if (!inst || !loop->contains(inst))
+    return v;
+
+  Instruction *newinst = inst->clone();
+  for (unsigned i = 0; i < inst->getNumOperands(); ++i)
+    newinst->setOperand(i, clone_into_preheader(inst->getOperand(i), loop, insertpt));
+
+  newinst->insertBefore(insertpt);
+  if (inst->hasName())
+    newinst->setName(inst->getName() + ".hoist");
+
+  return newinst;
+}
+
+/*
+ * Hoist the comparison out of the outermost loop that it is invariant in. The
+ * branch is left in the loop, but now it is on a loop invariant condition, it
+ * never mispredicts and the loop unswitching can remove it from the loop.
+ * Moving the branch itself out is not right, the check must not fail when the
+ * loop body is not executed.
+ */
+bool BoundsCheckOpt::hoist(BranchInst *br, LoopInfo &li) {
+  ICmpInst *cmp = dyn_cast<ICmpInst>(br->getCondition());
+  if (!cmp)
+    return false;
+
+  Loop *target = nullptr;
+  for (Loop *loop = li.getLoopFor(br->getParent()); loop; loop = loop->getParentLoop()) {
+    if (!is_loop_invariant(cmp, loop, 0))
+      break;
+
+    target = loop;
+  }
+
+  if (!target || !target->contains(cmp))
+    return false;
+
+  BasicBlock *preheader = target->getLoopPreheader();
+  if (!preheader)
+    return false;
+
+  Value *newcmp = clone_into_preheader(cmp, target, preheader->getTerminator());
+  br->setCondition(newcmp);
+  RecursivelyDeleteTriviallyDeadInstructions(cmp);
+  return true;
+}
+
+void BoundsCheckOpt::remove(BranchInst *br) {
+  BasicBlock *okbb = br->getSuccessor(0);
+  BasicBlock *failbb = br->getSuccessor(1);
+  Value *cond = br->getCondition();
+
+  BranchInst::Create(okbb, br);
+  br->eraseFromParent();
+
+  // the failure block uses the index too, remove it before the comparison
+  if (pred_empty(failbb))
+    DeleteDeadBlock(failbb);
+
+  RecursivelyDeleteTriviallyDeadInstructions(cond);
+}
+
+int BoundsCheckOpt::run(Function &fn) {
+  std::vector<BranchInst *> checks;
+  std::vector<BranchInst *> others;
+  for (BranchInst *br : _checks) {
+    if (br->getFunction() == &fn)
+      checks.push_back(br);
+    else
+      others.push_back(br);
+  }
+
+  _checks.swap(others);
+
+  // the function is not complete, e.g. there are errors when generating it
+  for (BasicBlock &bb : fn) {
+    if (!bb.getTerminator())
+      return 0;
+  }
+
+  int removed = 0;
+  std::vector<BranchInst *> remains;
+  for (BranchInst *br : checks) {
+    ICmpInst *cmp = dyn_cast<ICmpInst>(br->getCondition());
+    if (cmp && is_proved(cmp)) {
+      remove(br);
+      ++removed;
+    } else {
+      remains.push_back(br);
+    }
+  }
+
+  if (!remains.empty()) {
+    DominatorTree dt(fn);
+    LoopInfo li(dt);
+    for (BranchInst *br : remains)
+      hoist(br, li);
+  }
+
+  for (auto itr = _var_ranges.begin(); itr != _var_ranges.end();) {
+    if (itr->first->getFunction() == &fn)
+      itr = _var_ranges.erase(itr);
+    else
+      ++itr;
+  }
+
+  return removed;
+}
+
+}
+
@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+/**
+ * @file the optimizer of the runtime bounds checking code (`-bounds-check`).
+ *
+ * The code generator emits each check in the form of:
+ *
+ * ```
+ *   %inbounds = icmp ult i64 %index, %len    ; `ule` for the end of a slice
+ *   br i1 %inbounds, label %boundsokbb, label %boundsfailbb
+ * ```
+ *
+ * and registers the branch here. After a function is generated, the optimizer
+ * removes the checks which can be proved by constant index or by the constant
+ * range of a `for` statement, and hoists the comparison of the loop invariant
+ * checks into the loop preheader, so the branch left in the loop is on a loop
+ * invariant condition.
+ */
+
+#ifndef __codegen_bounds_check_h__
+#define __codegen_bounds_check_h__
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class Loop;
+class LoopInfo;
+}
+
+namespace bounds_check {
+
+class BoundsCheckOpt {
+public:
+  /// register a check generated by the code generator
+  void add_check(llvm::BranchInst *br) { _checks.push_back(br); }
+
+  /// the variable `slot` only holds value in [lo, hi), e.g. variable of a `for` statement
+  void add_var_range(llvm::AllocaInst *slot, int64_t lo, int64_t hi);
+
+  /// optimize the checks of the function, return the number of removed checks
+  int run(llvm::Function &fn);
+
+private:
+  bool value_range(llvm::Value *v, int64_t &lo, int64_t &hi, int depth);
+  bool is_proved(llvm::ICmpInst *cmp);
+  bool is_loop_invariant(llvm::Value *v, llvm::Loop *loop, int depth);
+  bool hoist(llvm::BranchInst *br, llvm::LoopInfo &li);
+  void remove(llvm::BranchInst *br);
+
+  std::vector<llvm::BranchInst *> _checks;
+  std::unordered_map<llvm::AllocaInst *, std::pair<int64_t, int64_t>> _var_ranges;
+};
+
+}
+
+#endif
+
@@ -15,6 +15,8 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstrTypes.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
 #include <utility>
 
@@ -53,36 +55,64 @@ void IR1::init_module_and_passmanager(const char *modname) {
   // create new builder for the module
   _builder = std::make_unique<IRBuilder<>>(*_ctx);
   
-  // create new function pass manager attached to it
-  _fpm = std::make_unique<legacy::FunctionPassManager>(_module.get());
+  init_function_passmanager();
+
+  // create new pass manager attached to it
+  _pm = std::make_unique<legacy::PassManager>();
+
+  // Inline the functions marked `#[inline]`.
+  _pm->add(createAlwaysInlinerLegacyPass());
 
   // Do simple "peephole" optimizations and bit-twiddling optzns.
-  _fpm->add(createInstructionCombiningPass());
+  _pm->add(createInstructionCombiningPass());
 
   // Reassociate expressions.
-  _fpm->add(createReassociatePass());
+  _pm->add(createReassociatePass());
 
   // Eliminate Common SubExpressions.
-  _fpm->add(createGVNPass());
+  _pm->add(createGVNPass());
 
   // Simplify the control flow graph (deleting unreachable blocks, etc).
-  _fpm->add(createCFGSimplificationPass());
-  _fpm->doInitialization();
+  _pm->add(createCFGSimplificationPass());
 
-  // create new pass manager attached to it
-  _pm = std::make_unique<legacy::PassManager>();
+  // Turn the self recursion into loop and mark the other tail calls.
+  _pm->add(createTailCallEliminationPass());
+}
+
+bool IR1::load_module(const char *path) {
+  SMDiagnostic err;
+  std::unique_ptr<Module> module = parseIRFile(path, err, *_ctx);
+  if (!module) {
+    err.print("ca", errs());
+    return false;
+  }
+
+  // the function pass manager is attached to the replaced module
+  _module = std::move(module);
+  _global_strs.clear();
+  init_function_passmanager();
+  return true;
+}
+
+void IR1::init_function_passmanager() {
+  // create new function pass manager attached to it
+  _fpm = std::make_unique<legacy::FunctionPassManager>(_module.get());
 
   // Do simple "peephole" optimizations and bit-twiddling optzns.
-  _pm->add(createInstructionCombiningPass());
+  _fpm->add(createInstructionCombiningPass());
 
   // Reassociate expressions.
-  _pm->add(createReassociatePass());
+  _fpm->add(createReassociatePass());
 
   // Eliminate Common SubExpressions.
-  _pm->add(createGVNPass());
+  _fpm->add(createGVNPass());
 
   // Simplify the control flow graph (deleting unreachable blocks, etc).
-  _pm->add(createCFGSimplificationPass());
+  _fpm->add(createCFGSimplificationPass());
+
+  // Turn the self recursion into loop and mark the other tail calls.
+  _fpm->add(createTailCallEliminationPass());
+  _fpm->doInitialization();
 }
 
 Function *
@@ -165,9 +195,13 @@ GlobalVariable *IR1::gen_global_var(Type *type, const char *name, Value *defval,
     (*_module, type, isconst, GlobalValue::InternalLinkage, 0, name);
 #endif
 
-  //Align align = (static_cast<AllocaInst *>(defval))->getAlign();
-  //gvar->setAlignment(align);
-  gvar->setAlignment(MaybeAlign(4));
+  // the natural alignment of the type on the target
+  const DataLayout &layout = _target_layout ? *_target_layout : _module->getDataLayout();
+  gvar->setAlignment(layout.getPrefTypeAlign(type));
+
+  // the address of constant is not significant, it can be merged with the same constant
+  if (isconst)
+    gvar->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
 
   // when not setInitializer the generated code will be:
   // `@count = internal global i32, align 4`
@@ -191,32 +225,39 @@ Constant *IR1::get_global_string(const std::string &s) {
 }
 
 Value *IR1::gen_two_ops_value(Value *a, Value *b, const char *name,
-			      two_fop_fn_t floatfn, two_op_fn_t intfn) {
-  switch(a->getType()->getTypeID()) {
+			      two_fop_fn_t floatfn, two_op_fn_t intfn,
+			      bool nuw, bool nsw) {
+  switch(a->getType()->getScalarType()->getTypeID()) {
   case Type::FloatTyID:
   case Type::DoubleTyID:
     return (_builder.get()->*floatfn)(a, b, name, nullptr);
   case Type::IntegerTyID:
-    return (_builder.get()->*intfn)(a, b, name, false, false);
+    return (_builder.get()->*intfn)(a, b, name, nuw, nsw);
   default:
     return nullptr;
   }  
 }
 
-Value *IR1::gen_add(Value *a, Value *b, const char *name) {
-  return gen_two_ops_value(a, b, name, &IRBuilder<>::CreateFAdd, &IRBuilder<>::CreateAdd);
+Value *IR1::gen_add(Value *a, Value *b, const char *name, bool nuw, bool nsw) {
+  return gen_two_ops_value(a, b, name, &IRBuilder<>::CreateFAdd, &IRBuilder<>::CreateAdd, nuw, nsw);
+}
+
+Value *IR1::gen_sub(Value *a, Value *b, const char *name, bool nuw, bool nsw) {
+  return gen_two_ops_value(a, b, name, &IRBuilder<>::CreateFSub, &IRBuilder<>::CreateSub, nuw, nsw);
 }
 
-Value *IR1::gen_sub(Value *a, Value *b, const char *name) {
-  return gen_two_ops_value(a, b, name, &IRBuilder<>::CreateFSub, &IRBuilder<>::CreateSub);
+Value *IR1::gen_mul(Value *a, Value *b, const char *name, bool nuw, bool nsw) {
+  return gen_two_ops_value(a, b, name, &IRBuilder<>::CreateFMul, &IRBuilder<>::CreateMul, nuw, nsw);
 }
 
-Value *IR1::gen_mul(Value *a, Value *b, const char *name) {
-  return gen_two_ops_value(a, b, name, &IRBuilder<>::CreateFMul, &IRBuilder<>::CreateMul);
+Value *IR1::gen_overflow_op(Intrinsic::ID id, Value *a, Value *b, Value **overflow, const char *name) {
+  Value *pair = _builder->CreateBinaryIntrinsic(id, a, b, nullptr, name);
+  *overflow = _builder->CreateExtractValue(pair, 1, "overflow");
+  return _builder->CreateExtractValue(pair, 0, name);
 }
 
 Value *IR1::gen_div(Value *a, Value *b, const char *name) {
-  switch(a->getType()->getTypeID()) {
+  switch(a->getType()->getScalarType()->getTypeID()) {
   case Type::FloatTyID:
   case Type::DoubleTyID:
     return _builder->CreateFDiv(a, b, name);
@@ -229,7 +270,7 @@ Value *IR1::gen_div(Value *a, Value *b, const char *name) {
 }
 
 Value *IR1::gen_mod(Value *a, Value *b, const char *name) {
-  switch(a->getType()->getTypeID()) {
+  switch(a->getType()->getScalarType()->getTypeID()) {
   case Type::FloatTyID:
   case Type::DoubleTyID:
     return _builder->CreateFRem(a, b, name);
@@ -23,6 +23,7 @@
 #include <llvm/ADT/APSInt.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/Instructions.h>
+#include <llvm/IR/Intrinsics.h>
 #include <llvm/IR/Value.h>
 #include <llvm/Support/raw_ostream.h>
 //#include <bits/stdint-intn.h>
@@ -32,16 +33,19 @@
 #include <llvm/IR/Constant.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Function.h>
+#include <llvm/IR/GetElementPtrTypeIterator.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 //#include <llvm/IR/PassManager.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Module.h>
+#include <llvm/IR/Operator.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Transforms/InstCombine/InstCombine.h>
+#include <llvm/Transforms/IPO/AlwaysInliner.h>
 #include <llvm/Transforms/Scalar.h>
 #include <llvm/Transforms/Scalar/GVN.h>
 
@@ -68,6 +72,13 @@ public:
   virtual ~IR1();
   void init_module_and_passmanager(const char *modname);
 
+  // replace the module with the one in the bitcode or IR assembly file
+  bool load_module(const char *path);
+
+  // the data layout of the target, it is not set into the module, the module
+  // gets it when emitting code
+  void set_target_layout(const DataLayout &layout) { _target_layout = std::make_unique<DataLayout>(layout); }
+
 public:
   // generate variable
   Function *gen_function(Type *retty, const char *name, std::vector<Type *> params,
@@ -86,12 +97,28 @@ public:
 
   Constant *get_global_string(const std::string &s);
 
+  /// the alignment of accessing `ptr`, the member inside a packed struct is
+  /// only aligned to 1, otherwise none for the natural alignment of the type
+  MaybeAlign packed_align(Value *ptr) {
+    while (GEPOperator *gep = dyn_cast<GEPOperator>(ptr)) {
+      for (auto itr = gep_type_begin(gep), end = gep_type_end(gep); itr != end; ++itr) {
+	StructType *st = itr.getStructTypeOrNull();
+	if (st && st->isPacked())
+	  return Align(1);
+      }
+
+      ptr = gep->getPointerOperand();
+    }
+
+    return MaybeAlign();
+  }
+
   StoreInst *store_var(Value *ptr, Value *v) {
-    return _builder->CreateStore(v, ptr);
+    return _builder->CreateAlignedStore(v, ptr, packed_align(ptr));
   }
 
   LoadInst *load_var(Value *ptr, const char *vname) {
-    return _builder->CreateLoad(ptr, vname);
+    return _builder->CreateAlignedLoad(ptr->getType()->getPointerElementType(), ptr, packed_align(ptr), vname);
   }
 
   Value *gen_bool(bool value) {
@@ -133,15 +160,18 @@ public:
 
   template <typename F>
   Value *gen_add(F a, F b, const char *name = "add");
-  Value *gen_add(Value *a, Value *b, const char *name = "add");
+  Value *gen_add(Value *a, Value *b, const char *name = "add", bool nuw = false, bool nsw = false);
 
   template <typename F>
   Value *gen_sub(F a, F b, const char *name = "sub");
-  Value *gen_sub(Value *a, Value *b, const char *name = "sub");
+  Value *gen_sub(Value *a, Value *b, const char *name = "sub", bool nuw = false, bool nsw = false);
 
   template <typename F>
   Value *gen_mul(F a, F b, const char *name = "mul");
-  Value *gen_mul(Value *a, Value *b, const char *name = "mul");
+  Value *gen_mul(Value *a, Value *b, const char *name = "mul", bool nuw = false, bool nsw = false);
+
+  /// generate the `llvm.*.with.overflow` intrinsic call, `overflow` is set to the overflow bit
+  Value *gen_overflow_op(Intrinsic::ID id, Value *a, Value *b, Value **overflow, const char *name = "ovop");
 
   template <typename F>
   Value *gen_div(F a, F b, const char *name = "div");
@@ -246,8 +276,10 @@ public:
 
 private:
   void init_llvm_env();
+  void init_function_passmanager();
   Value *gen_two_ops_value(Value *a, Value *b, const char *name,
-			   two_fop_fn_t floatfn, two_op_fn_t intfn);
+			   two_fop_fn_t floatfn, two_op_fn_t intfn,
+			   bool nuw = false, bool nsw = false);
 private:
   std::unique_ptr<LLVMContext> _ctx;
   std::unique_ptr<Module> _module;
@@ -256,6 +288,7 @@ private:
   std::unique_ptr<legacy::FunctionPassManager> _fpm;
   std::unique_ptr<legacy::PassManager> _pm;
   std::map<std::string, Constant *> _global_strs;
+  std::unique_ptr<DataLayout> _target_layout;
 };
 
 template <typename F>
@@ -82,6 +82,12 @@ namespace jit_codegen {
     orc::JITTargetMachineBuilder builder(tpc.get()->getTargetTriple());
 #endif
 
+    // the memory manager of the object linking layer can not allocate TLS
+    // sections, so the `#[thread_local]` variables are emulated, they are
+    // accessed by `__emutls_get_address` of the C runtime support library
+    builder.getOptions().EmulatedTLS = true;
+    builder.getOptions().ExplicitEmulatedTLS = true;
+
     auto dl = builder.getDefaultDataLayoutForTarget();
     if (!dl)
       return dl.takeError();
@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+#include "lto.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/Internalize.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include <unordered_set>
+
+namespace lto {
+
+using namespace llvm;
+
+bool LTOLinker::add_file(const std::string &path) {
+  SMDiagnostic err;
+  std::unique_ptr<Module> module = parseIRFile(path, err, _ctx);
+  if (!module) {
+    err.print("ca", errs());
+    return false;
+  }
+
+  if (!_module) {
+    _module = std::move(module);
+    return true;
+  }
+
+  if (Linker::linkModules(*_module, std::move(module))) {
+    errs() << "link module failed: " << path << "\n";
+    return false;
+  }
+
+  return true;
+}
+
+void LTOLinker::optimize(const std::vector<std::string> &exports, unsigned optlevel) {
+  std::unordered_set<std::string> preserved(exports.begin(), exports.end());
+  preserved.insert("main");
+
+  internalizeModule(*_module, [&preserved](const GlobalValue &gv) {
+    return preserved.count(gv.getName().str()) > 0;
+  });
+
+  // the whole module pipeline with the inliner, the internalized functions are inlined across compile units
+  PassManagerBuilder builder;
+  builder.OptLevel = optlevel;
+  builder.Inliner = createFunctionInliningPass(optlevel, 0, false);
+
+  legacy::PassManager pm;
+  builder.populateModulePassManager(pm);
+  pm.run(*_module);
+}
+
+}
+
@@ -0,0 +1,56 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+/**
+ * @file the link time optimization (`-flto`).
+ *
+ * With `-flto` the object file of `-c` is the LLVM bitcode of the compile
+ * unit. The link step (`-flto-link`) merges the bitcode of all the compile
+ * units into one module, internalizes the symbols except `main` and the
+ * exported ones, so the functions of different compile units can be inlined
+ * and the unused ones are removed, then runs the whole module pipeline on it
+ * before emitting one native object, or the `.bc` / `.ll` file of the linked
+ * module when the output is named so.
+ */
+
+#ifndef __codegen_lto_h__
+#define __codegen_lto_h__
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lto {
+
+class LTOLinker {
+public:
+  explicit LTOLinker(llvm::LLVMContext &ctx) : _ctx(ctx) {}
+
+  /// merge the module in bitcode or IR assembly file `path`, return false when failed
+  bool add_file(const std::string &path);
+
+  /// internalize the symbols except `main` and `exports`, then run the module pipeline
+  void optimize(const std::vector<std::string> &exports, unsigned optlevel);
+
+  llvm::Module *module() { return _module.get(); }
+
+private:
+  llvm::LLVMContext &_ctx;
+  std::unique_ptr<llvm::Module> _module;
+};
+
+}
+
+#endif
+
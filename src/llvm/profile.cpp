@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+#include "profile.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Pass.h"
+#include "llvm/ProfileData/InstrProf.h"
+#include "llvm/ProfileData/InstrProfReader.h"
+#include "llvm/ProfileData/InstrProfWriter.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Instrumentation.h"
+#include <unordered_set>
+
+namespace profile {
+
+using namespace llvm;
+
+void ProfileInstr::instrument(Module &module, const std::string &output, bool forjit) {
+  _output = output;
+
+  legacy::PassManager genpm;
+  genpm.add(createPGOInstrumentationGenLegacyPass());
+  genpm.run(module);
+
+  // remember the counters of each function before they are lowered into variables
+  std::unordered_set<std::string> seen;
+  std::vector<Instruction *> valueprofiles;
+  for (Function &fn : module) {
+    for (Instruction &inst : instructions(fn)) {
+      if (isa<InstrProfValueProfileInst>(&inst)) {
+	valueprofiles.push_back(&inst);
+	continue;
+      }
+
+      InstrProfIncrementInst *inc = dyn_cast<InstrProfIncrementInst>(&inst);
+      if (!inc || !seen.insert(inc->getName()->getName().str()).second)
+	continue;
+
+      GlobalVariable *namevar = inc->getName();
+      Counters counters;
+      counters.name = getPGOFuncNameVarInitializer(namevar).str();
+      counters.var = getInstrProfCountersVarPrefix().str() +
+	namevar->getName().drop_front(getInstrProfNameVarPrefix().size()).str();
+      counters.hash = inc->getHash()->getZExtValue();
+      counters.num = inc->getNumCounters()->getZExtValue();
+      _counters.push_back(std::move(counters));
+    }
+  }
+
+  if (forjit) {
+    for (Instruction *inst : valueprofiles)
+      inst->eraseFromParent();
+  }
+
+  InstrProfOptions options;
+  if (!forjit)
+    options.InstrProfileOutput = output;
+
+  legacy::PassManager lowerpm;
+  lowerpm.add(createInstrProfilingLegacyPass(options));
+  lowerpm.run(module);
+
+  if (!forjit)
+    return;
+
+  // the counters are read by name after the jitted code runs
+  for (const Counters &counters : _counters) {
+    GlobalVariable *var = module.getNamedGlobal(counters.var);
+    if (var) {
+      var->setLinkage(GlobalValue::ExternalLinkage);
+      var->setVisibility(GlobalValue::DefaultVisibility);
+    }
+  }
+}
+
+bool ProfileInstr::write_jit_profile(const std::function<const uint64_t *(const std::string &)> &lookup) {
+  InstrProfWriter writer;
+#if LLVM_VERSION > 13
+  consumeError(writer.mergeProfileKind(InstrProfKind::IR));
+#else
+  consumeError(writer.setIsIRLevelProfile(true, false));
+#endif
+
+  for (const Counters &counters : _counters) {
+    const uint64_t *values = lookup(counters.var);
+    if (!values)
+      continue;
+
+    std::vector<uint64_t> counts(values, values + counters.num);
+    writer.addRecord(NamedInstrProfRecord(counters.name, counters.hash, std::move(counts)),
+		     [](Error e) { consumeError(std::move(e)); });
+  }
+
+  std::error_code ec;
+#if LLVM_VERSION > 12
+  raw_fd_ostream os(_output, ec, sys::fs::OF_None);
+#else
+  raw_fd_ostream os(_output, ec, sys::fs::F_None);
+#endif
+
+  if (ec) {
+    errs() << "could not open profile file: " << _output << ", error code: " << ec.message() << "\n";
+    return false;
+  }
+
+#if LLVM_VERSION > 13
+  if (Error e = writer.write(os)) {
+    errs() << "write profile file failed: " << toString(std::move(e)) << "\n";
+    return false;
+  }
+#else
+  writer.write(os);
+#endif
+
+  return true;
+}
+
+bool ProfileInstr::use(Module &module, const std::string &path) {
+  if (!sys::fs::exists(path)) {
+    errs() << "profile file not exists: " << path << "\n";
+    return false;
+  }
+
+  // the use pass only warns and goes on without profile when it cannot read the file
+  auto reader = IndexedInstrProfReader::create(path);
+  if (!reader) {
+    errs() << "cannot read profile file: " << path << ", " << toString(reader.takeError()) << "\n";
+    return false;
+  }
+
+  legacy::PassManager pm;
+  pm.add(createPGOInstrumentationUseLegacyPass(path));
+  pm.run(module);
+  return true;
+}
+
+}
+
@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2023 Rusheng Xia <xrsh_2004@163.com>
+ * CA Programming Language and CA Compiler are licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ */
+
+/**
+ * @file the profile guided optimization (`-fprofile-generate`, `-fprofile-use`).
+ *
+ * The module is instrumented by the IR level instrumentation of LLVM before
+ * the optimization passes, so the instrumented and the optimized build see
+ * the same control flow graph and the function hashes match.
+ *
+ * - the native program is linked with the LLVM profile runtime, which writes
+ *   a `.profraw` file at exit, it is merged into `.profdata` by `llvm-profdata`;
+ * - the jit has no profile runtime, the counters are read from the jitted
+ *   module after `main` returns and written as an indexed `.profdata` file
+ *   directly, the value profiling is dropped because it calls the runtime.
+ *
+ * The `.profdata` file is loaded by `-fprofile-use=<file>`, which sets the
+ * branch weights and the entry counts used by the following passes.
+ */
+
+#ifndef __codegen_profile_h__
+#define __codegen_profile_h__
+
+#include "llvm/IR/Module.h"
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace profile {
+
+class ProfileInstr {
+public:
+  /// instrument the module, `output` is the profile file path, `forjit` for the jit
+  void instrument(llvm::Module &module, const std::string &output, bool forjit);
+
+  /// write the counters of the jitted module, `lookup` gets the address of a counter variable
+  bool write_jit_profile(const std::function<const uint64_t *(const std::string &)> &lookup);
+
+  /// load the profile `path` and annotate the module with it, false when it cannot be read
+  static bool use(llvm::Module &module, const std::string &path);
+
+private:
+  struct Counters {
+    std::string name;   /// the PGO name of the function
+    std::string var;    /// the name of the counter variable
+    uint64_t hash;
+    uint32_t num;
+  };
+
+  std::vector<Counters> _counters;
+  std::string _output;
+};
+
+}
+
+#endif
+
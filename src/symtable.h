@@ -47,6 +47,7 @@ typedef enum SymType {
   Sym_Member,
   Sym_TraitDef,
   Sym_TraitImpl,
+  Sym_Const,
 } SymType;
 
 #define MAX_ARGS 16
@@ -138,7 +139,7 @@ typedef enum CAStructType {
   Struct_GeneralTuple,/// 2: general tuple (unnamed)
   Struct_Slice,       /// 3: slice
   Struct_Union,       /// 4: union type
-  Struct_Enum,        /// 5: enum type, NOTE: enum type seems not suitable here
+  Struct_Enum,        /// 5: enum type, the fields are the variants, see CAEnum
 
   /**
    * n: You can add a new enum variant before this.
@@ -154,10 +155,35 @@ typedef struct CAStruct {
   int fieldnum;
   int capacity;  /// private
   int packed;    /// 0: default, 1: pack 1, ...
+  int align;     /// 0: natural alignment, N: `#[repr(align(N))]` the minimum alignment
+  int reordered; /// 1: `#[repr(auto)]` the fields are ordered by descending alignment
   int fieldmaxalign;
   struct CAStructField *fields;
+  struct CAEnum *enum_layout; /// when type is Struct_Enum
 } CAStruct;
 
+/**
+ * The layout of enum type. Each variant is a field of CAStruct, the field type
+ * is the general tuple of the variant fields (the payload) and the field
+ * offset is where the payload is placed, all the payloads share the memory.
+ *
+ * The variant is distinguished by the tag, it is the integer of the minimal
+ * width holding all the discriminants. When only one variant has payload and
+ * the payload contains a field having invalid values (the niche), such as the
+ * value larger than 1 of bool, the other variants are stored as the invalid
+ * values of the field, so no tag is needed. The pointer has no niche, null is
+ * a valid pointer value.
+ */
+typedef struct CAEnum {
+  int64_t *values;     /// the discriminant of each variant
+  int reprc;           /// `#[repr(C)]`: always use the tag, the niche is not used
+  int tagsize;         /// the bytes of the tag or the niche field, 0 when only one variant
+  size_t tagoffset;    /// the offset of the tag or the niche field
+  int tagsigned;       /// the tag is compared in signed
+  int dataful;         /// the variant stored without tag when using niche, otherwise -1
+  uint64_t nichestart; /// the niche value of the first variant other than `dataful`
+} CAEnum;
+
 /*
  * The C language treats multiple dimension arrays or typedef-ed arrays
  * as the same type. For example:
@@ -329,6 +355,8 @@ typedef struct CAVariable {
   SLoc loc;
   int name;
   int global; /// is global variable
+  int isstatic; /// is `static` item, it is immutable and placed in read-only data
+  int tls; /// is `#[thread_local]` global variable, every thread has its own copy
 
   /**
    * Opaque memory for storing LLVM Value* type.
@@ -350,6 +378,9 @@ typedef enum PatternType {
   PT_Struct,
   PT_IgnoreOne,
   PT_IgnoreRange,
+  PT_Literal,     /// the literal `1`, `'a'`, `-1`, `true`, refutable, only in `match`
+  PT_Range,       /// the range `1..=9`, `'a'..'z'`, refutable, only in `match`
+  PT_Variant,     /// the enum variant `E::A`, `E::B(x, _)`, refutable, only in `match`
 } PatternType;
 
 typedef struct PatternGroup {
@@ -377,6 +408,12 @@ typedef struct CAPattern {
   SLoc loc;
   int name;  /// struct name, tuple name or variable name
   PatternGroup *items; /// vec for CAPattern *
+
+  /// the constant expressions of PT_Literal (`lo` only) and the bounds of PT_Range
+  struct ASTNode *lo;
+  struct ASTNode *hi;
+  int inclusive; /// the PT_Range includes `hi`: `a..=b`
+  int variant;   /// the variant name of PT_Variant, `name` is the enum name
 } CAPattern;
 
 typedef struct ST_ArgList {
@@ -389,6 +426,12 @@ typedef struct ST_ArgList {
   struct SymTable *symtable;
 } ST_ArgList;
 
+/// the variant of enum type, the name is in the `members` of the enum
+typedef struct ST_EnumVariant {
+  typeid_t payload;   /// the general tuple type of the variant fields
+  int64_t value;      /// the discriminant
+} ST_EnumVariant;
+
 // TODO: will use later
 typedef struct ST_MemberList {
   struct ST_ArgList member;
@@ -476,13 +519,17 @@ typedef struct STEntry {
     CAVariableShielding varshielding;  // when sym_type are Sym_Variable Sym_Member
     //CADataType *datatype; /// when sym_type is Sym_DataType
     struct {
-      CAStructType tuple;  /// 1: When it is a tuple type; otherwise, it is a struct
+      CAStructType tuple;  /// 1: When it is a tuple type; 5: enum type; otherwise, it is a struct
       typeid_t id;         /// when sym_type is Sym_DataType
+      int repr;            /// the struct layout attributes, bitmask of CASA_*
 
       /// When id is of struct type, it has members.
-      // TODO: Refactor to make it extensible to other complex types like enum, etc.
+      /// When it is enum type, the members are the variant names.
       ST_ArgList *members;
 
+      /// when it is enum type, the payload and discriminant of each variant
+      struct ST_EnumVariant *variants;
+
       /*
        * TODO: Assign symtable value for the id and use it when unwinding
        * the type. Not using the symbol table during type definition may
@@ -501,6 +548,10 @@ typedef struct STEntry {
     struct {
       TypeImplInfo impl_info;
     } trait_impl;
+
+    struct {
+      struct ASTNode *litnode; /// the evaluated literal node of the value
+    } constant;             /// when type is Sym_Const
   } u;
 } STEntry;
 
@@ -608,6 +659,7 @@ CAArrayExpr arrayexpr_new();
 CAArrayExpr arrayexpr_append(CAArrayExpr obj, struct ASTNode *expr);
 size_t arrayexpr_size(CAArrayExpr obj);
 struct ASTNode *arrayexpr_get(CAArrayExpr obj, int idx);
+void arrayexpr_set(CAArrayExpr obj, int idx, struct ASTNode *expr);
 CAArrayExpr arrayexpr_fill(CAArrayExpr obj, struct ASTNode *expr, size_t n);
 
 CAVariable *cavar_create(int name, typeid_t datatype);
@@ -445,6 +445,10 @@ ASTNode *arrayexpr_get(CAArrayExpr obj, int idx) {
   return static_cast<std::vector<ASTNode *> *>(obj.data)->at(idx);
 }
 
+void arrayexpr_set(CAArrayExpr obj, int idx, ASTNode *expr) {
+  static_cast<std::vector<ASTNode *> *>(obj.data)->at(idx) = expr;
+}
+
 CAArrayExpr arrayexpr_fill(CAArrayExpr obj, ASTNode *expr, size_t n) {
   std::vector<ASTNode *> *vs = static_cast<std::vector<ASTNode *> *>(obj.data);
   //vs->resize(n, expr);
@@ -460,6 +464,8 @@ CAVariable *cavar_create(int name, typeid_t datatype) {
   var->name = name;
   var->llvm_value = nullptr;
   var->global = 0;
+  var->isstatic = 0;
+  var->tls = 0;
   return var;
 }
 
@@ -490,6 +496,8 @@ CAVariable *cavar_create_self(int name) {
   var->name = name;
   var->llvm_value = nullptr;
   var->global = 0;
+  var->isstatic = 0;
+  var->tls = 0;
   return var;
 }
 
@@ -505,6 +513,11 @@ CAPattern *capattern_new(int name, PatternType type, PatternGroup *pg) {
   cap->fieldname = -1;
   cap->morebind = nullptr;
   cap->loc = (SLoc){glineno, gcolno};
+  cap->items = nullptr;
+  cap->lo = nullptr;
+  cap->hi = nullptr;
+  cap->inclusive = 0;
+  cap->variant = -1;
   switch (type) {
   case PT_Var:
     cap->name = name;
@@ -513,11 +526,14 @@ CAPattern *capattern_new(int name, PatternType type, PatternGroup *pg) {
   case PT_GenTuple:
   case PT_Tuple:
   case PT_Struct:
+  case PT_Variant:
     cap->name = name;
     cap->items = pg;
     break;
   case PT_IgnoreOne:
   case PT_IgnoreRange:
+  case PT_Literal:
+  case PT_Range:
     break;
   default:
     caerror(&cap->loc, &cap->loc, "Unknown pattern type: `%d`", type);
@@ -87,6 +87,11 @@ std::unordered_map<typeid_t, CADataType *> s_type_map;
 
 CADataType *g_catype_void_ptr = nullptr;
 
+// the element name part of vector type names, indexed by `token - VOID`
+static const char *s_vector_elem_names[] = {
+  "", "i16", "i32", "i64", "u16", "u32", "u64", "f32", "f64", "", "i8", "u8",
+};
+
 std::unordered_map<std::string, int> s_token_primitive_map {
   {"void",   VOID},
   {"short",  I16},
@@ -182,16 +187,23 @@ std::unordered_map<std::string, int> s_token_map = {
   {"fn",     FN},
   {"extern", EXTERN},
   {"return", RET},
+  {"become", BECOME},
   {"let",    LET},
+  {"const",  CONST},
+  {"static", STATIC},
   {"struct", STRUCT},
+  {"enum",   ENUM},
   {"type",   TYPE},
   {"as",     AS},
   {"sizeof", SIZEOF},
   {"typeof", TYPEOF},
   {"typeid", TYPEID},
+  {"likely", LIKELY},
+  {"unlikely", UNLIKELY},
   {"__zero_init__", ZERO_INITIAL},
   {"loop",   LOOP},
   {"for",    FOR},
+  {"parallel", PARALLEL},
   {"in",     IN},
   {"break",  BREAK},
   {"continue",  CONTINUE},
@@ -324,6 +336,34 @@ tokenid_t sym_primitive_token_from_id(typeid_t id) {
   return tokenid_novalue;
 }
 
+/**
+ * @brief Make the fixed width SIMD vector type of `lanes` elements of
+ * `elemtype`, it is named like `v4f32` and registered as primitive type.
+ * The element type and lanes are stored as the one dimension array layout.
+ */
+static CADataType *catype_make_vector_type(tokenid_t elemtype, int lanes) {
+  char namebuf[32];
+  CADataType *elemdt = catype_get_primitive_by_token(elemtype);
+  sprintf(namebuf, "t:v%d%s", lanes, s_vector_elem_names[elemtype - VOID]);
+  CADataType *datatype = catype_make_type(namebuf, VECTOR, lanes * elemdt->size);
+  datatype->array_layout = new CAArray;
+  datatype->array_layout->type = elemdt;
+  datatype->array_layout->dimension = 1;
+  datatype->array_layout->dimarray[0] = lanes;
+  return datatype;
+}
+
+static void catype_init_vector_types() {
+  static const tokenid_t elemtypes[] = {I8, U8, I16, U16, I32, U32, I64, U64, F32, F64};
+
+  // the vector of 128 and 256 bits width, they are the SSE and AVX registers
+  for (tokenid_t elemtype : elemtypes) {
+    int size = catype_get_primitive_by_token(elemtype)->size;
+    for (int width = 16; width <= 32; width *= 2)
+      catype_make_vector_type(elemtype, width / size);
+  }
+}
+
 int catype_init() {
   CADataType *datatype;
   int name;
@@ -369,9 +409,31 @@ int catype_init() {
 
   g_catype_void_ptr = catype_make_pointer_type(datatype);
 
+  catype_init_vector_types();
+
   return 0;
 }
 
+CADataType *catype_get_vector_type(CADataType *elemtype, int lanes) {
+  if (!catype_is_integer(elemtype->type) && !catype_is_float(elemtype->type))
+    return nullptr;
+
+  char namebuf[32];
+  sprintf(namebuf, "t:v%d%s", lanes, s_vector_elem_names[elemtype->type - VOID]);
+  return catype_get_primitive_by_name(symname_check_insert(namebuf));
+}
+
+CADataType *catype_get_vector_mask_type(CADataType *vectype) {
+  static const tokenid_t masktypes[] = {I8, I16, 0, I32, 0, 0, 0, I64};
+  CADataType *elemtype = vectype->array_layout->type;
+  CADataType *maskelem = catype_get_primitive_by_token(masktypes[elemtype->size - 1]);
+  return catype_get_vector_type(maskelem, vectype->array_layout->dimarray[0]);
+}
+
+tokenid_t catype_scalar_token(CADataType *catype) {
+  return catype->type == VECTOR ? catype->array_layout->type->type : catype->type;
+}
+
 int catype_put_primitive_by_name(typeid_t name, CADataType *datatype) {
   s_type_map.insert(std::move(std::make_pair(name, datatype)));
   return 0;
@@ -738,6 +800,19 @@ static bool is_named_struct_type(CAStructType struct_type) {
     struct_type == Struct_Enum;
 }
 
+static CAEnum *caenum_new(const int64_t *values, int num, int reprc) {
+  CAEnum *layout = new CAEnum;
+  layout->values = new int64_t[num];
+  std::copy(values, values + num, layout->values);
+  layout->reprc = reprc;
+  layout->tagsize = 0;
+  layout->tagoffset = 0;
+  layout->tagsigned = 0;
+  layout->dataful = -1;
+  layout->nichestart = 0;
+  return layout;
+}
+
 static int catype_unwind_type_struct(SymTable *symtable, const char *pchbegin,
 				     const std::map<std::string, CADataType *> &prenamemap,
 				     const std::set<std::string> &rcheckset,
@@ -763,10 +838,9 @@ static int catype_unwind_type_struct(SymTable *symtable, const char *pchbegin,
       struct_type = Struct_Union;
       yyerror("not implemented for the `union` unwinding");
     } else if (!strcmp(namebuf, "enum")) {
-      // <enum;EE;A,B=3,C> or even <enum;EE;{A;i32}, {B;f1:i32,f2:i64}, D=5> or
-      // <enum;EE;A> #enum cannot be empty
+      // <enum;EE;A=0:(;),B=3:(;i32,*EE)>, the variant name, the discriminant
+      // and the payload tuple, enum cannot be empty
       struct_type = Struct_Enum;
-      yyerror("not implemented for the `enum` unwinding");
     } else {
       if (elen)
 	yyerror("not implemented for the unknown `%s` unwinding", namebuf);
@@ -835,10 +909,31 @@ static int catype_unwind_type_struct(SymTable *symtable, const char *pchbegin,
   if (is_named_struct_type(struct_type))
     namemap.insert(std::make_pair(namebuf, addrdt));
 
+  std::vector<int64_t> values;
   while ((struct_type == Struct_NamedStruct && *pch != '}') ||
 	 (is_tuple_type(struct_type) && *pch != ')') ||
 	 (is_general_struct_type(struct_type) && *pch != '>')) {
-    if (is_named_field_struct_type(struct_type)) {
+    if (struct_type == Struct_Enum) {
+      // extract variant name and the discriminant: A=-1:
+      int elen = signature_extract_name(namebuf, sigbuf, sigi, pch);
+      if (elen == 0 || *pch != '=') {
+	yyerror("(internal) bad format of enum variant `%s`", pch);
+	return -1;
+      }
+
+      sigbuf[sigi++] = *pch++; // = '=';
+      char *endp = nullptr;
+      values.push_back(strtoll(pch, &endp, 10));
+      if (endp == pch || *endp != ':') {
+	yyerror("(internal) bad format of enum discriminant `%s`", pch);
+	return -1;
+      }
+
+      while (pch != endp)
+	sigbuf[sigi++] = *pch++;
+
+      sigbuf[sigi++] = *pch++; // = ':';
+    } else if (is_named_field_struct_type(struct_type)) {
       // extract field name
       int elen = signature_extract_name(namebuf, sigbuf, sigi, pch);
       if (elen == 0) {
@@ -879,13 +974,23 @@ static int catype_unwind_type_struct(SymTable *symtable, const char *pchbegin,
 
     if (retdt) {
       castruct_add_member(addrdt->struct_layout,
-			  !is_named_field_struct_type(struct_type)
+			  !is_named_field_struct_type(struct_type) && struct_type != Struct_Enum
                               ? -1
                               : symname_check_insert(namebuf),
                           *outdt, 0);
     }
   }
 
+  if (struct_type == Struct_Enum) {
+    if (values.empty()) {
+      yyerror("(internal) enum have no variant `%s`", pchbegin);
+      return -1;
+    }
+
+    if (retdt)
+      addrdt->struct_layout->enum_layout = caenum_new(values.data(), values.size(), 0);
+  }
+
   sigbuf[sigi++] = *pch++; // = '}'; or ')' when tuple, '>' when general structure
   buflen = sigi;
 
@@ -1114,6 +1219,25 @@ static int catype_unwind_type_name(SymTable *symtable, const char *pch,
     int nameid = symname_check_insert(namebuf);
     addrdt = catype_make_struct_type(nameid, *typesize, entry->u.datatype.tuple, 10);
     *retdt = addrdt;
+
+    // the layout attributes, they take effect in catype_formalize_type_layout
+    int repr = entry->u.datatype.repr;
+    if (repr & CASA_ReprPacked)
+      addrdt->struct_layout->packed = 1;
+    if (repr & CASA_ReprAlign)
+      addrdt->struct_layout->align = 1 << (repr >> CASA_AlignShift);
+    if (repr & CASA_ReprAuto)
+      addrdt->struct_layout->reordered = 1;
+
+    if (entry->u.datatype.tuple == Struct_Enum) {
+      ST_ArgList *members = entry->u.datatype.members;
+      std::vector<int64_t> values;
+      for (int j = 0; j < members->argc; ++j)
+	values.push_back(entry->u.datatype.variants[j].value);
+
+      addrdt->struct_layout->enum_layout =
+	caenum_new(values.data(), values.size(), (repr & CASA_ReprC) != 0);
+    }
   }
 
   namemap.insert(std::make_pair(namebuf, addrdt));
@@ -1123,7 +1247,10 @@ static int catype_unwind_type_name(SymTable *symtable, const char *pch,
   int calcing = 0;
 
   int sigi = 0;
-  if (entry->u.datatype.tuple)
+  CAStructType struct_type = entry->u.datatype.tuple;
+  if (struct_type == Struct_Enum)
+    sigi = sprintf(sigbuf, "<enum;%s;", caname);
+  else if (struct_type)
     sigi = sprintf(sigbuf, "(%s;", caname);
   else
     sigi = sprintf(sigbuf, "{%s;", caname);
@@ -1131,7 +1258,12 @@ static int catype_unwind_type_name(SymTable *symtable, const char *pch,
   ST_ArgList *members = entry->u.datatype.members;
   for (int j = 0; j < members->argc; ++j) {
     typeid_t membertype = typeid_novalue;
-    if (entry->u.datatype.tuple) {
+    if (struct_type == Struct_Enum) {
+      // the variant is the general tuple of its fields: A=1:(;i32,f64)
+      ST_EnumVariant *variant = &entry->u.datatype.variants[j];
+      sigi += sprintf(sigbuf + sigi, "%s=%lld:", symname_get(members->argnames[j]), (long long)variant->value);
+      membertype = variant->payload;
+    } else if (struct_type) {
       membertype = members->types[j];
     } else {
       const char *argname = symname_get(members->argnames[j]);
@@ -1171,7 +1303,8 @@ static int catype_unwind_type_name(SymTable *symtable, const char *pch,
       castruct_add_member(addrdt->struct_layout, members->argnames[j], *outdt, 0);
   }
 
-  sigbuf[sigi-1] = entry->u.datatype.tuple ? ')' : '}'; // remove last ',' or ';' when it is empty struct
+  // remove last ',' or ';' when it is empty struct
+  sigbuf[sigi-1] = struct_type == Struct_Enum ? '>' : struct_type ? ')' : '}';
   sigbuf[sigi] = '\0';
 
   buflen = sigi;
@@ -1586,11 +1719,16 @@ static typeid_t typeid_get_top_down(CADataType *catype, std::set<CADataType *> &
 
     rcheck.insert(catype);
 
-    buf[0] = struct_type ? '(' : '{';
     structname = struct_type == Struct_GeneralTuple ? "" : symname_get(catype->struct_layout->name);
-    len = strlen(structname) + 1;
-    strcpy(buf+1, structname);
-    buf[len++] = ';';
+    if (struct_type == Struct_Enum) {
+      len = sprintf(buf, "<enum;%s;", structname);
+    } else {
+      buf[0] = struct_type ? '(' : '{';
+      len = strlen(structname) + 1;
+      strcpy(buf+1, structname);
+      buf[len++] = ';';
+    }
+
     for (int i = 0; i < catype->struct_layout->fieldnum; ++i) {
       auto *&type = catype->struct_layout->fields[i].type;
 
@@ -1599,7 +1737,11 @@ static typeid_t typeid_get_top_down(CADataType *catype, std::set<CADataType *> &
       //rcheck.erase(catype);
 
       subname = catype_get_type_name(subid);
-      if (struct_type) {
+      if (struct_type == Struct_Enum) {
+	varname = symname_get(catype->struct_layout->fields[i].name);
+	len += sprintf(buf+len, "%s=%lld:%s,", varname,
+		       (long long)catype->struct_layout->enum_layout->values[i], subname);
+      } else if (struct_type) {
 	len += sprintf(buf+len, "%s,", subname);
       } else {
 	varname = symname_get(catype->struct_layout->fields[i].name);
@@ -1609,7 +1751,7 @@ static typeid_t typeid_get_top_down(CADataType *catype, std::set<CADataType *> &
 
     rcheck.erase(catype);
 
-    buf[len-1] = struct_type ? ')' : '}';
+    buf[len-1] = struct_type == Struct_Enum ? '>' : struct_type ? ')' : '}';
     buf[len] = '\0';
     catype->signature = sym_form_type_id_by_str(buf);
     catype->status = CADT_Expand;
@@ -1716,12 +1858,12 @@ static CADataType *catype_formalize_type_expand(CADataType *datatype, std::set<C
   return nullptr;
 }
 
-static int catype_get_field_align(CADataType *type) {
+int catype_get_align(CADataType *type) {
   switch(type->type) {
   case POINTER:
     return sizeof(void *);
   case ARRAY:
-    return catype_get_field_align(type->array_layout->type);
+    return catype_get_align(type->array_layout->type);
   case SLICE:
   case STRUCT:
     return type->struct_layout->fieldmaxalign;
@@ -1730,6 +1872,167 @@ static int catype_get_field_align(CADataType *type) {
   }
 }
 
+/**
+ * @brief Find the niche of the type: the values of the bytes at `offset` of
+ * `size` which never appear in a valid object, starting from `start`.
+ * @return the number of the niche values, 0 when there is no niche
+ */
+static uint64_t catype_find_niche(CADataType *type, size_t *offset, int *size, uint64_t *start) {
+  switch (type->type) {
+  case BOOL:
+    *offset = 0;
+    *size = 1;
+    *start = 2;
+    return 254;
+  case STRUCT: {
+    CAStruct *layout = type->struct_layout;
+    if (layout->type == Struct_Enum) {
+      CAEnum *el = layout->enum_layout;
+      if (el->dataful != -1) {
+	// the niche values of the payload not used by the nested enum
+	uint64_t used = layout->fieldnum - 1;
+	uint64_t n = catype_find_niche(layout->fields[el->dataful].type, offset, size, start);
+	if (n <= used)
+	  return 0;
+
+	*start += used;
+	return n - used;
+      }
+
+      // the tag values not used by the nested enum
+      if (el->tagsigned)
+	return 0;
+
+      uint64_t used = 0;
+      for (int i = 0; i < layout->fieldnum; ++i)
+	used = std::max(used, (uint64_t)el->values[i] + 1);
+
+      uint64_t limit = el->tagsize == 8 ? UINT64_MAX : (1ULL << (el->tagsize * 8)) - 1;
+      if (used == 0 || used > limit)
+	return 0;
+
+      *offset = el->tagoffset;
+      *size = el->tagsize;
+      *start = used;
+      return limit - used + 1;
+    }
+
+    for (int i = 0; i < layout->fieldnum; ++i) {
+      uint64_t n = catype_find_niche(layout->fields[i].type, offset, size, start);
+      if (n) {
+	*offset += layout->fields[i].offset;
+	return n;
+      }
+    }
+
+    return 0;
+  }
+  case ARRAY:
+    if (type->array_layout->dimarray[0] == 0)
+      return 0;
+
+    return catype_find_niche(type->array_layout->type, offset, size, start);
+  default:
+    return 0;
+  }
+}
+
+/**
+ * @brief Layout the enum type after the payloads are layouted.
+ *
+ * When only one variant have payload and the payload have niche, the other
+ * variants are encoded as the niche values, the enum is as large as the
+ * payload. Otherwise the tag of the minimal width is placed at offset 0 and
+ * each payload is placed after it with its own alignment.
+ */
+static void catype_formalize_enum_layout(CADataType *datatype) {
+  CAStruct *layout = datatype->struct_layout;
+  CAEnum *el = layout->enum_layout;
+  int num = layout->fieldnum;
+  int maxalign = 1;
+  int payloadnum = 0;
+  int dataful = 0;
+
+  for (int i = 0; i < num; ++i) {
+    CADataType *payload = layout->fields[i].type;
+    layout->fields[i].offset = 0;
+    maxalign = std::max(maxalign, catype_get_align(payload));
+    if (payload->size) {
+      ++payloadnum;
+      dataful = i;
+    }
+  }
+
+  el->tagsize = 0;
+  el->tagoffset = 0;
+  el->tagsigned = 0;
+  el->dataful = -1;
+  el->nichestart = 0;
+
+  size_t nicheoffset = 0;
+  int nichesize = 0;
+  uint64_t nichestart = 0;
+  if (num == 1 || (payloadnum == 1 && !el->reprc &&
+		   catype_find_niche(layout->fields[dataful].type, &nicheoffset,
+				     &nichesize, &nichestart) >= (uint64_t)(num - 1))) {
+    // the single variant needs no tag
+    el->dataful = dataful;
+    el->tagsize = num == 1 ? 0 : nichesize;
+    el->tagoffset = nicheoffset;
+    el->nichestart = nichestart;
+    layout->fieldmaxalign = maxalign;
+    datatype->size = layout->fields[dataful].type->size;
+    return;
+  }
+
+  int64_t minvalue = el->values[0];
+  int64_t maxvalue = el->values[0];
+  for (int i = 1; i < num; ++i) {
+    minvalue = std::min(minvalue, el->values[i]);
+    maxvalue = std::max(maxvalue, el->values[i]);
+  }
+
+  el->tagsigned = minvalue < 0;
+  if (el->tagsigned) {
+    if (minvalue >= INT8_MIN && maxvalue <= INT8_MAX)
+      el->tagsize = 1;
+    else if (minvalue >= INT16_MIN && maxvalue <= INT16_MAX)
+      el->tagsize = 2;
+    else if (minvalue >= INT32_MIN && maxvalue <= INT32_MAX)
+      el->tagsize = 4;
+    else
+      el->tagsize = 8;
+  } else {
+    if (maxvalue <= UINT8_MAX)
+      el->tagsize = 1;
+    else if (maxvalue <= UINT16_MAX)
+      el->tagsize = 2;
+    else if (maxvalue <= UINT32_MAX)
+      el->tagsize = 4;
+    else
+      el->tagsize = 8;
+  }
+
+  maxalign = std::max(maxalign, el->tagsize);
+  size_t size = el->tagsize;
+  for (int i = 0; i < num; ++i) {
+    CADataType *payload = layout->fields[i].type;
+    size_t offset = el->tagsize;
+    int align = catype_get_align(payload);
+    if (offset % align != 0)
+      offset += align - offset % align;
+
+    layout->fields[i].offset = offset;
+    size = std::max(size, offset + payload->size);
+  }
+
+  if (size % maxalign != 0)
+    size += maxalign - size % maxalign;
+
+  layout->fieldmaxalign = maxalign;
+  datatype->size = size;
+}
+
 static void catype_formalize_type_layout(CADataType *datatype, std::set<CADataType *> &rcheck) {
   switch (datatype->type) {
   case POINTER:
@@ -1751,8 +2054,30 @@ static void catype_formalize_type_layout(CADataType *datatype, std::set<CADataTy
       rcheck.insert(field.type);
       catype_formalize_type_layout(field.type, rcheck);
       rcheck.erase(field.type);
+    }
+
+    if (layout->type == Struct_Enum) {
+      catype_formalize_enum_layout(datatype);
+      break;
+    }
+
+    // `#[repr(auto)]`: the descending alignment order leaves no padding between fields
+    if (layout->reordered) {
+      std::stable_sort(layout->fields, layout->fields + layout->fieldnum,
+		       [](const CAStructField &a, const CAStructField &b) {
+			 return catype_get_align(a.type) > catype_get_align(b.type);
+		       });
+    }
+
+    for (int i = 0; i < layout->fieldnum; ++i) {
+      CAStructField &field = layout->fields[i];
+      if (rcheck.find(field.type) != rcheck.end())
+	  continue;
+
+      int align = catype_get_align(field.type);
+      if (layout->packed && align > layout->packed)
+	align = layout->packed;
 
-      int align = catype_get_field_align(field.type);
       if (offset % align != 0)
 	offset += align - offset % align;
 
@@ -1762,6 +2087,8 @@ static void catype_formalize_type_layout(CADataType *datatype, std::set<CADataTy
       maxalign = std::max(maxalign, align);
     }
 
+    // `#[repr(align(N))]` raises the alignment, the size is padded to it
+    maxalign = std::max(maxalign, layout->align);
     layout->fieldmaxalign = maxalign;
 
     if (offset % maxalign != 0)
@@ -1933,7 +2260,8 @@ CADataType *catype_from_capattern(CAPattern *cap, SymTable *symtable) {
     return catype;
   }
   case PT_Tuple:
-  case PT_Struct: {
+  case PT_Struct:
+  case PT_Variant: {
     typeid_t type = sym_form_type_id(cap->name);
     CADataType *catype = catype_get_by_name(symtable, type);
     if (!catype) {
@@ -1961,6 +2289,8 @@ CADataType *catype_from_capattern(CAPattern *cap, SymTable *symtable) {
   }
   case PT_IgnoreOne:
   case PT_IgnoreRange:
+  case PT_Literal:
+  case PT_Range:
     return nullptr;
   default:
     caerror(&(cap->loc), nullptr, "Unknown pattern type `%d` when create catype", cap->type);
@@ -2431,6 +2761,9 @@ CADataType *catype_clone_thin(const CADataType *type) {
     // TODO:
     dt->struct_layout = type->struct_layout;
     break;
+  case VECTOR:
+    dt->array_layout = type->array_layout;
+    break;
   case ARRAY:
     dt->array_layout = new CAArray;
     dt->array_layout->type = type->array_layout->type;
@@ -2603,6 +2936,8 @@ CADataType *catype_make_struct_type(int nameid, int typesize, CAStructType struc
   castruct->fieldnum = 0;
   castruct->capacity = init_capacity;
   castruct->packed = 0;
+  castruct->align = 0;
+  castruct->reordered = 0;
   castruct->fieldmaxalign = 1;
   castruct->fields = new CAStructField[castruct->capacity];
 
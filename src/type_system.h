@@ -55,9 +55,19 @@ int catype_put_primitive_by_name(typeid_t name, CADataType *datatype);
 CADataType *catype_get_primitive_by_name(typeid_t name);
 int catype_put_primitive_by_token(tokenid_t token, CADataType *datatype);
 CADataType *catype_get_primitive_by_token(tokenid_t token);
+
+// the SIMD vector type like `v4f32`, return NULL when no such vector type
+CADataType *catype_get_vector_type(CADataType *elemtype, int lanes);
+
+// the signed integer vector type with the same lanes and width, the result type of vector comparison
+CADataType *catype_get_vector_mask_type(CADataType *vectype);
+
+// the element type token of vector type, or the type token itself for others
+tokenid_t catype_scalar_token(CADataType *catype);
 bool catype_is_float(tokenid_t typetok);
 bool catype_is_complex_type(CADataType *catype);
 CADataType *catype_get_by_name(SymTable *symtable, typeid_t name);
+int catype_get_align(CADataType *type);
 CADataType *catype_from_capattern(CAPattern *cap, SymTable *symtable);
 CADataType *catype_from_range(ASTNode *node, GeneralRangeType type, int inclusive, CADataType *startdt, CADataType *enddt);
 
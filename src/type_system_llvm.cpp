@@ -27,6 +27,7 @@
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/ir1.h"
 
+#include <algorithm>
 #include <unordered_map>
 #include <map>
 
@@ -132,13 +133,18 @@ static Type *llvmtype_from_catype_inner(CADataType *catype, std::map<CADataType
 
     return arrtype;
   }
+  case VECTOR: {
+    // the SIMD vector type, e.g. v4f32 -> <4 x float>
+    Type *elemtype = llvmtype_from_token(catype->array_layout->type->type);
+    return FixedVectorType::get(elemtype, catype->array_layout->dimarray[0]);
+  }
   case SLICE:
   case STRUCT: {
     // create llvm struct type
     size_t fieldnum = catype->struct_layout->fieldnum;
     std::vector<Type *> fields;
     StringRef name = symname_get(catype->formalname);
-    bool pack = false;
+    bool pack = catype->struct_layout->packed != 0;
 
     StructType *sttype = nullptr;
     auto itr = g_llvmtype_map.find(catype->signature);
@@ -149,12 +155,37 @@ static Type *llvmtype_from_catype_inner(CADataType *catype, std::map<CADataType
       g_llvmtype_map.insert(std::make_pair(catype->signature, static_cast<Type *>(sttype)));
     }
 
+    if (catype->struct_layout->type == Struct_Enum) {
+      // the enum is the memory of its size and alignment, the tag and the
+      // payloads are accessed by the offsets of CAEnum and the fields
+      int unit = std::min(catype->struct_layout->fieldmaxalign, 8);
+      Type *unittype = IntegerType::get(ir1.ctx(), unit * 8);
+      fields.push_back(ArrayType::get(unittype, catype->size / unit));
+      sttype->setBody(fields);
+      return sttype;
+    }
+
     rcheck.insert(std::make_pair(catype, sttype));
     for (int i = 0; i < catype->struct_layout->fieldnum; ++i) {
       Type *fieldtype = llvmtype_from_catype_inner(catype->struct_layout->fields[i].type, rcheck);
       fields.push_back(fieldtype);
     }
     rcheck.erase(catype);
+
+    // `#[repr(align(N))]`: llvm struct type have no alignment, the tail
+    // padding keeps the size and the array stride same as the catype
+    CAStruct *layout = catype->struct_layout;
+    if (layout->align) {
+      size_t end = 0;
+      if (layout->fieldnum) {
+	CAStructField &last = layout->fields[layout->fieldnum - 1];
+	end = last.offset + last.type->size;
+      }
+
+      if (catype->size > end)
+	fields.push_back(ArrayType::get(ir1.int_type<int8_t>(), catype->size - end));
+    }
+
     sttype->setBody(fields, pack);
 
     // following code generated unnamed struct, but not used yet
@@ -742,8 +773,9 @@ Instruction::CastOps gen_cast_ops(CADataType *fromtype, CADataType *totype) {
   if (fromtype->signature == totype->signature)
     return (Instruction::CastOps)0;
 
-  tokenid_t fromtok = fromtype->type;
-  tokenid_t totok = totype->type;
+  // the vectors with same lanes are casted element-wise
+  tokenid_t fromtok = catype_scalar_token(fromtype);
+  tokenid_t totok = catype_scalar_token(totype);
   return llvmtype_cast_table[fromtok-VOID][totok-VOID];
 }
 
@@ -0,0 +1,24 @@
+// the C version of rt_read_sum.ca
+// build with: gcc -O2 rt_read_sum.c -o rt_read_sum
+#include <stdio.h>
+#include <stdlib.h>
+
+int main() {
+  FILE *fp = fopen("/tmp/ca_numbers.txt", "r");
+  if (!fp) {
+    printf("cannot open /tmp/ca_numbers.txt\n");
+    return 0;
+  }
+
+  char line[256];
+  long lines = 0;
+  long sum = 0;
+  while (fgets(line, sizeof(line), fp)) {
+    sum += strtol(line, NULL, 10);
+    lines += 1;
+  }
+
+  printf("lines = %ld, sum = %ld\n", lines, sum);
+  fclose(fp);
+  return 0;
+}
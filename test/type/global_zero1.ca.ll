@@ -6,10 +6,10 @@ source_filename = "global_zero1.ca"
 %A2 = type { %A1, double }
 %A3 = type { %A2, i1 }
 
-@aa = internal global %AA zeroinitializer, align 4
-@a1 = internal global %A1 zeroinitializer, align 4
-@a2 = internal global %A2 zeroinitializer, align 4
-@a3 = internal global %A3 zeroinitializer, align 4
+@aa = internal global %AA zeroinitializer, align 8
+@a1 = internal global %A1 zeroinitializer, align 8
+@a2 = internal global %A2 zeroinitializer, align 8
+@a3 = internal global %A3 zeroinitializer, align 8
 @0 = private unnamed_addr constant [6 x i8] c"good\0A\00", align 1
 @1 = private unnamed_addr constant [3 x i8] c"%s\00", align 1
 
@@ -6,9 +6,9 @@ source_filename = "global_zero2.ca"
 %A2 = type { [2 x %A1], [3 x double]* }
 %A3 = type { %A2***, [9 x %A2***], [3 x i1***] }
 
-@aa = internal global %AA zeroinitializer, align 4
-@a1 = internal global %A1 zeroinitializer, align 4
-@a2 = internal global %A2 zeroinitializer, align 4
-@a3 = internal global %A3 zeroinitializer, align 4
+@aa = internal global %AA zeroinitializer, align 8
+@a1 = internal global %A1 zeroinitializer, align 8
+@a2 = internal global %A2 zeroinitializer, align 8
+@a3 = internal global %A3 zeroinitializer, align 8
 
 declare i32 @printf(i8*, ...)
@@ -6,7 +6,7 @@ source_filename = "more_scope.ca"
 %AA.0 = type { i1 }
 %AA = type { double }
 
-@a = internal global double 3.132300e+00, align 4
+@a = internal global double 3.132300e+00, align 8
 @0 = private unnamed_addr constant [3 x i8] c"%d\00", align 1
 @1 = private unnamed_addr constant [2 x i8] c"\0A\00", align 1
 @2 = private unnamed_addr constant [3 x i8] c"%s\00", align 1
@@ -17,15 +17,9 @@ define i32 @func1(i32 %a, i32 %b) !dbg !8 {
 entry:
   %c = alloca i32, align 4
   %retslot = alloca i32, align 4
-  %a1 = alloca i32, align 4
-  store volatile i32 %a, i32* %a1, align 4
-  call void @llvm.dbg.declare(metadata i32* %a1, metadata !13, metadata !DIExpression()), !dbg !17
-  %b2 = alloca i32, align 4
-  store volatile i32 %b, i32* %b2, align 4
-  call void @llvm.dbg.declare(metadata i32* %b2, metadata !15, metadata !DIExpression()), !dbg !17
-  %v1 = load i32, i32* %a1, align 4, !dbg !18
-  %v2 = load i32, i32* %b2, align 4, !dbg !18
-  %add = add i32 %v1, %v2, !dbg !18
+  call void @llvm.dbg.value(metadata i32 %a, metadata !13, metadata !DIExpression()), !dbg !17
+  call void @llvm.dbg.value(metadata i32 %b, metadata !15, metadata !DIExpression()), !dbg !17
+  %add = add i32 %a, %b, !dbg !18
   store volatile i32 %add, i32* %c, align 4, !dbg !18
   call void @llvm.dbg.declare(metadata i32* %c, metadata !16, metadata !DIExpression()), !dbg !19
   %load = load i32, i32* %c, align 4, !dbg !18
@@ -46,7 +40,6 @@ entry:
   %0 = alloca %AA.2, align 8
   %1 = alloca [3 x i32], align 4
   %c = alloca i32, align 4
-  %calltmp = alloca i32, align 4
   %b = alloca i32, align 4
   %a2 = alloca %AA.1, align 8
   %2 = alloca %AA.1, align 8
@@ -88,9 +81,7 @@ entry:
   %19 = getelementptr inbounds %AA.1, %AA.1* %a2, i32 0, i32 1, !dbg !61
   %exprarg3 = load i32, i32* %19, align 4, !dbg !61
   %func1 = call i32 @func1(i32 %exprarg, i32 %exprarg3), !dbg !61
-  store volatile i32 %func1, i32* %calltmp, align 4, !dbg !61
-  %tmpexpr = load i32, i32* %calltmp, align 4, !dbg !61
-  store volatile i32 %tmpexpr, i32* %c, align 4, !dbg !61
+  store volatile i32 %func1, i32* %c, align 4, !dbg !61
   call void @llvm.dbg.declare(metadata i32* %c, metadata !43, metadata !DIExpression()), !dbg !62
   %v14 = load i32, i32* %b, align 4, !dbg !63
   %v25 = load i32, i32* %c, align 4, !dbg !63
@@ -132,6 +123,9 @@ ret:                                              ; preds = %outbb
 ; Function Attrs: nofree nosync nounwind readnone speculatable willreturn
 declare void @llvm.dbg.declare(metadata, metadata, metadata) #0
 
+; Function Attrs: nofree nosync nounwind readnone speculatable willreturn
+declare void @llvm.dbg.value(metadata, metadata, metadata) #0
+
 ; Function Attrs: argmemonly nofree nosync nounwind willreturn
 declare void @llvm.memcpy.p0i8.p0i8.i64(i8* noalias nocapture writeonly, i8* noalias nocapture readonly, i64, i1 immarg) #1
 